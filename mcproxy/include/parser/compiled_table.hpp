@@ -0,0 +1,107 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+
+#ifndef COMPILED_TABLE_HPP
+#define COMPILED_TABLE_HPP
+
+#include "include/utils/ip_addr.hpp"
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+class table;
+
+/**
+ * @brief Flattened form of a filter table. A table matches if one of its address
+ *        rules matches, nested tables and table references are resolved at creation.
+ *
+ * The rules are grouped by address family and interface name (interned as an index).
+ * For each group the group addresses are split into elementary intervals which
+ * have the same set of rules. Every elementary interval holds the merged source
+ * intervals of its rules, so a lookup is one binary search over the group intervals
+ * and one over the source intervals.
+ */
+class compiled_table
+{
+private:
+    //closed address interval
+    struct addr_interval {
+        ip_addr from;
+        ip_addr to;
+    };
+
+    struct rule_interval {
+        addr_interval group;
+        addr_interval source;
+    };
+
+    //all rules of one interface (or of all interfaces) and one address family
+    class rule_set
+    {
+    private:
+        //first address of each elementary group interval, the last interval ends at the highest address
+        std::vector<ip_addr> m_group_starts;
+
+        //the source intervals of elementary group interval i are m_sources[m_source_offsets[i]] to m_sources[m_source_offsets[i + 1] - 1]
+        std::vector<uint32_t> m_source_offsets;
+        std::vector<addr_interval> m_sources;
+
+    public:
+        rule_set() = default;
+        rule_set(int addr_family, const std::vector<rule_interval>& rules);
+        bool match(const ip_addr& gaddr, const ip_addr& saddr) const;
+        std::size_t get_interval_count() const;
+    };
+
+    struct family_rules {
+        rule_set any_interface;
+        std::vector<rule_set> interfaces; //indexed by the interface id
+    };
+
+    std::unordered_map<std::string, unsigned int> m_interface_ids;
+    family_rules m_ipv4;
+    family_rules m_ipv6;
+    std::size_t m_rule_count;
+
+    void init_family_rules(int addr_family, const table& t, family_rules& fr);
+
+public:
+    compiled_table(const table& t);
+
+    /**
+     * @brief Same result as table::match(), but gaddr and saddr must be of the same address family.
+     */
+    bool match(const std::string& if_name, const ip_addr& gaddr, const ip_addr& saddr) const;
+
+    std::string to_string() const;
+
+    /**
+     * @brief Compare match() with table::match() on random tables (nested tables, references,
+     *        wildcards, inverted and mixed-family ranges) and random queries.
+     */
+    static void test_compiled_table();
+};
+
+#endif // COMPILED_TABLE_HPP
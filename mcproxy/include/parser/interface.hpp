@@ -27,17 +27,31 @@
 #include <string>
 #include <memory>
 #include <chrono>
+#include <vector>
 
 #include "include/utils/addr_storage.hpp"
+#include "include/utils/ip_addr.hpp"
+#include "include/parser/compiled_table.hpp"
+
+//an unused multicast source is removed after this time (in milliseconds) if the instance sets no other value
+#define INSTANCE_DEFINITION_DEFAULT_SOURCE_LIFE_TIME 20000
+
+class rule_addr;
 
 struct addr_match {
     bool is_wildcard(const addr_storage& addr, int addr_family) const;
     virtual bool match(const addr_storage& addr) const = 0;
+
+    //closed interval of all addresses of addr_family which match, false if none matches
+    virtual bool get_interval(int addr_family, ip_addr& from, ip_addr& to) const = 0;
     virtual std::string to_string() const = 0;
 };
 
 struct rule_box {
     virtual bool match(const std::string& if_name, const addr_storage& saddr, const addr_storage& gaddr) const = 0;
+
+    //all address rules of this box, tables and table references are resolved
+    virtual void collect_rules(std::vector<const rule_addr*>& rules) const = 0;
     virtual std::string to_string() const = 0;
 };
 
@@ -47,6 +61,7 @@ class single_addr: public addr_match
 public:
     single_addr(const addr_storage& addr);
     bool match(const addr_storage& addr) const override;
+    bool get_interval(int addr_family, ip_addr& from, ip_addr& to) const override;
     std::string to_string() const override;
 };
 
@@ -59,6 +74,7 @@ public:
 
     //uncluding from and to
     bool match(const addr_storage& addr) const override;
+    bool get_interval(int addr_family, ip_addr& from, ip_addr& to) const override;
     std::string to_string() const override;
 };
 
@@ -70,7 +86,13 @@ class rule_addr : public rule_box
 public:
     rule_addr(const std::string& if_name, std::unique_ptr<addr_match> group, std::unique_ptr<addr_match> source);
     bool match(const std::string& if_name, const addr_storage& gaddr, const addr_storage& saddr) const override;
+    void collect_rules(std::vector<const rule_addr*>& rules) const override;
     std::string to_string() const override;
+
+    //empty for all interfaces
+    const std::string& get_if_name() const;
+    const addr_match& get_group() const;
+    const addr_match& get_source() const;
 };
 
 class table : public rule_box
@@ -82,6 +104,7 @@ public:
     table(const std::string& name, std::list<std::unique_ptr<rule_box>>&& rule_box_list);
     const std::string& get_name() const;
     bool match(const std::string& if_name, const addr_storage& gaddr, const addr_storage& saddr) const override;
+    void collect_rules(std::vector<const rule_addr*>& rules) const override;
     std::string to_string() const override;
     friend bool operator<(const table& t1, const table& t2);
 };
@@ -98,6 +121,7 @@ class rule_table : public rule_box
 public:
     rule_table(std::unique_ptr<table> t);
     bool match(const std::string& if_name, const addr_storage& gaddr, const addr_storage& saddr) const override;
+    void collect_rules(std::vector<const rule_addr*>& rules) const override;
     std::string to_string() const override;
 };
 
@@ -118,6 +142,7 @@ class rule_table_ref : public rule_box
 public:
     rule_table_ref(const std::string& table_name, const std::shared_ptr<const global_table_set>& global_table_set);
     bool match(const std::string& if_name, const addr_storage& gaddr, const addr_storage& saddr) const override;
+    void collect_rules(std::vector<const rule_addr*>& rules) const override;
     std::string to_string() const override;
 };
 
@@ -154,12 +179,16 @@ private:
     rb_filter_type m_filter_type;
     std::unique_ptr<table> m_table;
 
+    //m_table flattened at config load, the global tables do not change after their definition
+    std::unique_ptr<compiled_table> m_compiled_table;
+
     //RBT_RULE_MATCHING
     rb_rule_matching_type m_rule_matching_type;
     std::chrono::milliseconds m_timeout;
 
     std::string to_string_table_filter() const;
     std::string to_string_rule_matching() const;
+    bool match_filter_type(bool table_match) const;
 
 public:
     rule_binding(const std::string& instance_name, rb_interface_type interface_type, const std::string& if_name, rb_interface_direction filter_direction, rb_filter_type filter_type, std::unique_ptr<table> filter_table);
@@ -176,6 +205,9 @@ public:
     const table& get_table() const;
     bool match(const std::string& if_name, const addr_storage& saddr, const addr_storage& gaddr) const;
 
+    //the addresses of the multicast data path, matched without converting them
+    bool match(const std::string& if_name, const ip_addr& saddr, const ip_addr& gaddr) const;
+
     //RBT_RULE_MATCHING
     rb_rule_matching_type get_rule_matching_type() const;
     std::chrono::milliseconds get_timeout() const;
@@ -189,12 +221,15 @@ class interface
     std::unique_ptr<rule_binding> m_output_filter;
     std::unique_ptr<rule_binding> m_input_filter;
     bool match_filter(const std::string& input_if_name, const addr_storage& saddr, const addr_storage& gaddr, const std::unique_ptr<rule_binding>& filter) const;
+    bool match_filter(const std::string& input_if_name, const ip_addr& saddr, const ip_addr& gaddr, const std::unique_ptr<rule_binding>& filter) const;
 
 public:
     interface(const std::string& if_name);
     std::string get_if_name() const;
     bool match_output_filter(const std::string& input_if_name, const addr_storage& saddr, const addr_storage& gaddr) const;
     bool match_input_filter(const std::string& input_if_name, const addr_storage& saddr, const addr_storage& gaddr) const;
+    bool match_output_filter(const std::string& input_if_name, const ip_addr& saddr, const ip_addr& gaddr) const;
+    bool match_input_filter(const std::string& input_if_name, const ip_addr& saddr, const ip_addr& gaddr) const;
 
     std::string to_string_rule_binding() const;
     std::string to_string_interface() const;
@@ -209,6 +244,9 @@ class instance_definition
     std::string m_instance_name;
     int m_table_number;
     bool m_user_selected_table_number; 
+    std::chrono::milliseconds m_source_life_time;
+    std::chrono::milliseconds m_upstream_report_interval;
+    bool m_host_reports;
     std::list<std::shared_ptr<interface>> m_upstreams;
     std::list<std::shared_ptr<interface>> m_downstreams;
 
@@ -223,6 +261,9 @@ public:
     const std::list<std::shared_ptr<rule_binding>>& get_global_settings() const;
     int get_table_number() const;
     bool get_user_selected_table_number() const; 
+    const std::chrono::milliseconds& get_source_life_time() const;
+    const std::chrono::milliseconds& get_upstream_report_interval() const;
+    bool get_host_reports() const;
     friend bool operator<(const instance_definition& i1, const instance_definition& i2);
     friend class parser;
     std::string to_string_instance() const;
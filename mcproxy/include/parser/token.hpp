@@ -49,6 +49,9 @@ enum token_type {
     TT_FIRST,
     TT_MUTEX,
     TT_DISABLE,
+    TT_SOURCE_LIFE_TIME,
+    TT_UPSTREAM_REPORT_INTERVAL,
+    TT_HOST_REPORTS,
     //TT_PATH, //@path@
     TT_LEFT_BRACE, //"{"
     TT_RIGHT_BRACE, //"}"
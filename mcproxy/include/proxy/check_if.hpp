@@ -28,8 +28,8 @@
 #ifndef CHECK_IF_H
 #define CHECK_IF_H
 
-#include "include/utils/if_prop.hpp"
 #include "vector"
+#include <map>
 
 /**
  * @brief Monitored the running state of the network interfaces.
@@ -39,14 +39,15 @@ class check_if
 private:
     int m_addr_family;
 
-    if_prop m_if_property_a;
-    if_prop m_if_property_b;
-    if_prop* m_current_prop;
+    //running state of the monitored interfaces after the last monitoring trigger
+    std::map<int, bool> m_running;
 
     std::vector<int> m_check_lst;
     std::vector<int> m_swap_to_up;
     std::vector<int> m_swap_to_down;
 
+    bool is_running(int if_index) const;
+
 public:
 
     /**
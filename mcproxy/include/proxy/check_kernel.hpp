@@ -31,6 +31,7 @@
 #include <string>
 
 class mroute_socket;
+class mroute_netlink;
 
 /**
  * @brief Check the currently available kernel features.
@@ -45,6 +46,12 @@ public:
      * @brief Check the currently available kernel features.
      */
     void check_kernel_features();
+
+    /**
+     * @brief Open the netlink socket and check whether the kernel accepts multicast routes via netlink (IPv4 only).
+     * @return Return true if mrt_netlink can be used instead of the setsockopt calls of the mroute_socket.
+     */
+    static bool check_mroute_netlink(mroute_netlink& mrt_netlink);
 };
 
 #endif // CHECK_KERNEL_H
@@ -23,6 +23,8 @@
 #ifndef DEF_HPP
 #define DEF_HPP
 
+#include "include/proxy/source_list.hpp"
+
 #include <netinet/in.h>
 
 #include <map>
@@ -54,13 +56,11 @@ std::string time_to_string(const std::chrono::milliseconds& msec);
 //------------------------------------------------------------------------
 std::string indention(std::string str);
 //------------------------------------------------------------------------
-template<typename T> using source_list = std::set<T>;
-
 //A+B means the union of set A and B
 template<typename T>
 inline source_list<T>& operator+=(source_list<T>& l, const source_list<T>& r)
 {
-    l.insert(r.cbegin(), r.cend());
+    l.unite(r);
     return l;
 }
 
@@ -76,24 +76,7 @@ inline source_list<T> operator+(const source_list<T>& l, const source_list<T>& r
 template<typename T>
 inline source_list<T>& operator*=(source_list<T>& l, const source_list<T>& r)
 {
-    auto cur_l = std::begin(l);
-    auto cur_r = std::begin(r);
-
-    while (cur_l != std::end(l) && cur_r != std::end(r)) {
-        if (*cur_l == *cur_r) {
-            cur_l++;
-            cur_r++;
-        } else if (*cur_l < *cur_r) {
-            cur_l = l.erase(cur_l);
-        } else { //cur_l > cur_r
-            cur_r++;
-        }
-    }
-
-    if (cur_l != std::end(l)) {
-        l.erase(cur_l, std::end(l));
-    }
-
+    l.intersect(r);
     return l;
 }
 
@@ -109,10 +92,7 @@ inline source_list<T> operator*(const source_list<T>& l, const source_list<T>& r
 template<typename T>
 inline source_list<T>& operator-=(source_list<T>& l, const source_list<T>& r)
 {
-    for (auto e : r) {
-        l.erase(e);
-    }
-
+    l.subtract(r);
     return l;
 }
 
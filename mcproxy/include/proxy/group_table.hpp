@@ -0,0 +1,424 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+#ifndef GROUP_TABLE_HPP
+#define GROUP_TABLE_HPP
+
+#include "include/utils/ip_addr.hpp"
+
+#include <cstdint>
+#include <deque>
+#include <new>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <type_traits>
+
+#define GROUP_TABLE_NO_INDEX 0xffffffff
+#define GROUP_TABLE_INIT_CAPACITY 16
+
+/**
+ * @brief Stable reference to an entry of a group_table. A handle becomes
+ *        invalid as soon as its entry is erased, even if the slot is reused.
+ */
+struct group_handle {
+    group_handle()
+        : index(GROUP_TABLE_NO_INDEX)
+        , generation(0) {}
+
+    group_handle(uint32_t index, uint32_t generation)
+        : index(index)
+        , generation(generation) {}
+
+    uint32_t index;
+    uint32_t generation;
+};
+
+/**
+ * @brief Hash table of multicast group addresses (open addressing with robin hood hashing).
+ *
+ * The entries lie in a node pool and never move, only the small index slots are
+ * shifted and rehashed. A group_handle addresses a node directly, so the owner of
+ * a handle (e.g. a timer) gets its entry without hashing. The iteration order is
+ * undefined.
+ */
+template<typename V>
+class group_table
+{
+public:
+    using key_type = ip_addr;
+    using mapped_type = V;
+    using value_type = std::pair<ip_addr, V>;
+
+private:
+    struct node {
+        typename std::aligned_storage<sizeof(value_type), alignof(value_type)>::type storage;
+        uint32_t generation;
+        bool used;
+
+        value_type* get() {
+            return reinterpret_cast<value_type*>(&storage);
+        }
+
+        const value_type* get() const {
+            return reinterpret_cast<const value_type*>(&storage);
+        }
+    };
+
+    struct slot {
+        uint32_t index; //GROUP_TABLE_NO_INDEX if empty
+        uint32_t hash;
+    };
+
+    std::deque<node> m_nodes;
+    std::vector<uint32_t> m_free_nodes;
+    std::vector<slot> m_slots;
+    std::size_t m_size;
+
+    static uint32_t get_hash(const ip_addr& key) {
+        return static_cast<uint32_t>(key.hash());
+    }
+
+    uint32_t get_mask() const {
+        return static_cast<uint32_t>(m_slots.size() - 1);
+    }
+
+    //distance of a slot from the home slot of its hash
+    uint32_t get_probe_distance(uint32_t hash, uint32_t pos) const {
+        return (pos - (hash & get_mask())) & get_mask();
+    }
+
+    uint32_t find_slot(const ip_addr& key) const {
+        if (m_size == 0) {
+            return GROUP_TABLE_NO_INDEX;
+        }
+
+        uint32_t hash = get_hash(key);
+        uint32_t pos = hash & get_mask();
+        for (uint32_t dist = 0;; ++dist) {
+            const slot& s = m_slots[pos];
+            if (s.index == GROUP_TABLE_NO_INDEX || get_probe_distance(s.hash, pos) < dist) {
+                return GROUP_TABLE_NO_INDEX;
+            } else if (s.hash == hash && m_nodes[s.index].get()->first == key) {
+                return pos;
+            }
+            pos = (pos + 1) & get_mask();
+        }
+    }
+
+    void insert_slot(slot s) {
+        uint32_t pos = s.hash & get_mask();
+        for (uint32_t dist = 0;; ++dist) {
+            slot& cur = m_slots[pos];
+            if (cur.index == GROUP_TABLE_NO_INDEX) {
+                cur = s;
+                return;
+            }
+
+            uint32_t cur_dist = get_probe_distance(cur.hash, pos);
+            if (cur_dist < dist) { //take from the rich
+                std::swap(cur, s);
+                dist = cur_dist;
+            }
+            pos = (pos + 1) & get_mask();
+        }
+    }
+
+    //backward shift deletion, no tombstones are left
+    void erase_slot(uint32_t pos) {
+        uint32_t next = (pos + 1) & get_mask();
+        while (m_slots[next].index != GROUP_TABLE_NO_INDEX && get_probe_distance(m_slots[next].hash, next) > 0) {
+            m_slots[pos] = m_slots[next];
+            pos = next;
+            next = (next + 1) & get_mask();
+        }
+        m_slots[pos].index = GROUP_TABLE_NO_INDEX;
+    }
+
+    void rehash(std::size_t capacity) {
+        std::vector<slot> old_slots(capacity, slot {GROUP_TABLE_NO_INDEX, 0});
+        old_slots.swap(m_slots);
+        for (auto & s : old_slots) {
+            if (s.index != GROUP_TABLE_NO_INDEX) {
+                insert_slot(s);
+            }
+        }
+    }
+
+    //max load factor 3/4
+    void reserve_one() {
+        if (m_slots.empty()) {
+            rehash(GROUP_TABLE_INIT_CAPACITY);
+        } else if ((m_size + 1) * 4 > m_slots.size() * 3) {
+            rehash(m_slots.size() * 2);
+        }
+    }
+
+    uint32_t alloc_node() {
+        if (!m_free_nodes.empty()) {
+            uint32_t index = m_free_nodes.back();
+            m_free_nodes.pop_back();
+            return index;
+        } else {
+            m_nodes.push_back(node());
+            m_nodes.back().generation = 1;
+            m_nodes.back().used = false;
+            return static_cast<uint32_t>(m_nodes.size() - 1);
+        }
+    }
+
+    void free_node(uint32_t index) {
+        node& n = m_nodes[index];
+        n.get()->~value_type();
+        n.used = false;
+        ++n.generation;
+        m_free_nodes.push_back(index);
+    }
+
+    template<typename Table, typename Value>
+    class iterator_base
+    {
+    private:
+        friend class group_table;
+        Table* m_table;
+        uint32_t m_index;
+
+        void skip_unused() {
+            while (m_index < m_table->m_nodes.size() && !m_table->m_nodes[m_index].used) {
+                ++m_index;
+            }
+        }
+
+    public:
+        iterator_base()
+            : m_table(nullptr)
+            , m_index(0) {}
+
+        iterator_base(Table* table, uint32_t index)
+            : m_table(table)
+            , m_index(index) {
+            skip_unused();
+        }
+
+        //iterator to const_iterator
+        template<typename OtherTable, typename OtherValue>
+        iterator_base(const iterator_base<OtherTable, OtherValue>& it)
+            : m_table(it.m_table)
+            , m_index(it.m_index) {}
+
+        Value& operator*() const {
+            return *m_table->m_nodes[m_index].get();
+        }
+
+        Value* operator->() const {
+            return m_table->m_nodes[m_index].get();
+        }
+
+        iterator_base& operator++() {
+            ++m_index;
+            skip_unused();
+            return *this;
+        }
+
+        iterator_base operator++(int) {
+            iterator_base tmp(*this);
+            ++(*this);
+            return tmp;
+        }
+
+        group_handle get_handle() const {
+            return group_handle(m_index, m_table->m_nodes[m_index].generation);
+        }
+
+        friend bool operator==(const iterator_base& l, const iterator_base& r) {
+            return l.m_index == r.m_index;
+        }
+
+        friend bool operator!=(const iterator_base& l, const iterator_base& r) {
+            return l.m_index != r.m_index;
+        }
+
+        template<typename, typename> friend class iterator_base;
+    };
+
+public:
+    using iterator = iterator_base<group_table, value_type>;
+    using const_iterator = iterator_base<const group_table, const value_type>;
+
+    group_table()
+        : m_size(0) {}
+
+    group_table(const group_table&) = delete;
+    group_table& operator=(const group_table&) = delete;
+
+    group_table(group_table&& other)
+        : m_nodes(std::move(other.m_nodes))
+        , m_free_nodes(std::move(other.m_free_nodes))
+        , m_slots(std::move(other.m_slots))
+        , m_size(other.m_size) {
+        other.m_nodes.clear();
+        other.m_free_nodes.clear();
+        other.m_slots.clear();
+        other.m_size = 0;
+    }
+
+    group_table& operator=(group_table && other) {
+        if (this != &other) {
+            clear();
+            m_nodes.swap(other.m_nodes);
+            m_free_nodes.swap(other.m_free_nodes);
+            m_slots.swap(other.m_slots);
+            std::swap(m_size, other.m_size);
+        }
+        return *this;
+    }
+
+    ~group_table() {
+        clear();
+    }
+
+    iterator begin() {
+        return iterator(this, 0);
+    }
+
+    iterator end() {
+        return iterator(this, static_cast<uint32_t>(m_nodes.size()));
+    }
+
+    const_iterator begin() const {
+        return const_iterator(this, 0);
+    }
+
+    const_iterator end() const {
+        return const_iterator(this, static_cast<uint32_t>(m_nodes.size()));
+    }
+
+    std::size_t size() const {
+        return m_size;
+    }
+
+    bool empty() const {
+        return m_size == 0;
+    }
+
+    void clear() {
+        for (auto & n : m_nodes) {
+            if (n.used) {
+                n.get()->~value_type();
+            }
+        }
+        m_nodes.clear();
+        m_free_nodes.clear();
+        m_slots.clear();
+        m_size = 0;
+    }
+
+    iterator find(const ip_addr& key) {
+        uint32_t pos = find_slot(key);
+        return pos == GROUP_TABLE_NO_INDEX ? end() : iterator(this, m_slots[pos].index);
+    }
+
+    const_iterator find(const ip_addr& key) const {
+        uint32_t pos = find_slot(key);
+        return pos == GROUP_TABLE_NO_INDEX ? end() : const_iterator(this, m_slots[pos].index);
+    }
+
+    /**
+     * @brief Find the entry of key, the lookup is skipped if handle still refers to this entry.
+     */
+    iterator find(const ip_addr& key, const group_handle& handle) {
+        if (handle.index < m_nodes.size()) {
+            node& n = m_nodes[handle.index];
+            if (n.used && n.generation == handle.generation && n.get()->first == key) {
+                return iterator(this, handle.index);
+            }
+        }
+        return find(key);
+    }
+
+    std::pair<iterator, bool> insert(value_type&& value) {
+        uint32_t pos = find_slot(value.first);
+        if (pos != GROUP_TABLE_NO_INDEX) {
+            return std::make_pair(iterator(this, m_slots[pos].index), false);
+        }
+
+        reserve_one();
+
+        uint32_t index = alloc_node();
+        node& n = m_nodes[index];
+        new (&n.storage) value_type(std::move(value));
+        n.used = true;
+
+        insert_slot(slot {index, get_hash(n.get()->first)});
+        ++m_size;
+
+        return std::make_pair(iterator(this, index), true);
+    }
+
+    std::pair<iterator, bool> insert(const value_type& value) {
+        return insert(value_type(value));
+    }
+
+    /**
+     * @return iterator to the next entry
+     */
+    iterator erase(iterator it) {
+        uint32_t pos = find_slot(it->first);
+        if (pos != GROUP_TABLE_NO_INDEX) {
+            erase_slot(pos);
+            free_node(it.m_index);
+            --m_size;
+        }
+        return ++it;
+    }
+
+    std::size_t erase(const ip_addr& key) {
+        uint32_t pos = find_slot(key);
+        if (pos != GROUP_TABLE_NO_INDEX) {
+            uint32_t index = m_slots[pos].index;
+            erase_slot(pos);
+            free_node(index);
+            --m_size;
+            return 1;
+        } else {
+            return 0;
+        }
+    }
+
+    /**
+     * @brief All entries ordered by their group address (slow, for the status output).
+     */
+    std::vector<const value_type*> get_sorted() const {
+        std::vector<const value_type*> result;
+        result.reserve(m_size);
+        for (auto & e : *this) {
+            result.push_back(&e);
+        }
+
+        std::sort(result.begin(), result.end(), [](const value_type * l, const value_type * r) {
+            return l->first < r->first;
+        });
+        return result;
+    }
+};
+
+#endif // GROUP_TABLE_HPP
@@ -0,0 +1,199 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+/**
+ * @addtogroup mod_sender Sender
+ * @{
+ */
+
+#ifndef HOST_REPORTER_HPP
+#define HOST_REPORTER_HPP
+
+#include "include/proxy/def.hpp"
+#include "include/proxy/sender.hpp"
+#include "include/proxy/message_format.hpp"
+#include "include/utils/ip_addr.hpp"
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+class worker;
+class timing;
+
+/**
+ * @brief Host part of IGMPv3/MLDv2 (RFC 3376 Section 5, RFC 3810 Section 6) for the upstream interfaces.
+ *
+ * Instead of joining the upstream groups on sockets and leaving the reports to the kernel, the
+ * host reporter keeps the membership state of each upstream interface, sends the state change
+ * reports and their retransmissions and answers the queries of the upstream querier. All records
+ * that are due at the same time are packed into as few reports as the MTU allows. The answer to a
+ * general query is split into reports that are spread over the maximum response time.
+ *
+ * The host reporter does not implement the compatibility modes for IGMPv1/v2 and MLDv1 queriers.
+ * While such a querier is present on an upstream interface (RFC 3376 Section 7.2.1, RFC 3810
+ * Section 8.2.1), the memberships of the interface are joined on sockets and reported by the
+ * kernel, which answers the older queries in the version of the querier.
+ */
+class host_reporter
+{
+private:
+    using time_point = std::chrono::steady_clock::time_point;
+
+    struct group_state {
+        group_state();
+
+        mc_filter m_filter_mode;
+        std::set<ip_addr> m_sources;
+
+        //pending state change report (RFC 3376 Section 5.1)
+        unsigned int m_retransmissions;
+        bool m_is_filter_mode_change;
+        std::set<ip_addr> m_allow;
+        std::set<ip_addr> m_block;
+
+        //pending answer to a group specific or group and source specific query
+        bool m_is_query_pending;
+        time_point m_query_response_time;
+        std::set<ip_addr> m_queried_sources; //empty for a group specific query
+
+        bool is_unused() const;
+    };
+
+    struct general_response {
+        time_point m_time;
+        std::vector<ip_addr> m_groups;
+    };
+
+    struct upstream_state {
+        upstream_state();
+
+        std::map<ip_addr, group_state> m_groups;
+
+        //groups with a state change that is sent at the next flush
+        std::set<ip_addr> m_changed;
+
+        //groups with pending retransmissions
+        std::set<ip_addr> m_retransmit;
+        time_point m_retransmit_time;
+
+        //groups with a pending answer to a group (and source) specific query
+        std::set<ip_addr> m_queried;
+
+        //parts of the answer to a general query, ordered by time
+        std::vector<general_response> m_general_responses;
+
+        //robustness variable of the querier
+        unsigned int m_qrv;
+
+        //end of the older version querier present timeout, max if the querier uses the version of the host reporter
+        time_point m_older_querier_end;
+
+        bool is_older_querier_present() const;
+
+        std::shared_ptr<host_report_timer_msg> m_timer;
+        time_point m_timer_end;
+    };
+
+    const worker* const m_msg_worker;
+    const group_mem_protocol m_group_mem_protocol;
+    const std::shared_ptr<const sender> m_sender;
+    const std::shared_ptr<timing> m_timing;
+    const timers_values m_timers_values;
+
+    std::map<unsigned int, upstream_state> m_upstreams;
+
+    std::default_random_engine m_random_engine;
+
+    unsigned long m_state_change_count;
+    unsigned long m_query_count;
+    unsigned long m_old_querier_count;
+    unsigned long m_record_count;
+    unsigned long m_report_count;
+
+    std::chrono::milliseconds get_random_delay(std::chrono::milliseconds max_delay);
+
+    //state change record (ALLOW/BLOCK or TO_IN/TO_EX) of a pending state change
+    void add_state_change_records(const ip_addr& gaddr, const group_state& g, std::vector<report_record>& records) const;
+
+    //current state record (IS_IN/IS_EX), nothing for INCLUDE{}
+    void add_current_state_record(const ip_addr& gaddr, const group_state& g, std::vector<report_record>& records) const;
+
+    //answer to a group and source specific query (RFC 3376 Section 5.2)
+    void add_source_query_record(const ip_addr& gaddr, const group_state& g, std::vector<report_record>& records) const;
+
+    //count down the retransmissions of the sent state changes
+    void sent_state_changes(upstream_state& u, const std::set<ip_addr>& groups);
+
+    //split the records into reports that fit into the MTU
+    std::vector<std::vector<report_record>> pack(unsigned int if_index, std::vector<report_record>&& records) const;
+    void send(unsigned int if_index, std::vector<report_record>&& records);
+
+    //send the state changes of one upstream interface
+    void flush(unsigned int if_index, upstream_state& u, time_point now);
+
+    //pass the memberships to the kernel while an older version querier is present and take them back afterwards
+    void enter_compatibility_mode(unsigned int if_index, upstream_state& u);
+    void leave_compatibility_mode(unsigned int if_index, upstream_state& u, time_point now);
+
+    void erase_unused_group(upstream_state& u, const ip_addr& gaddr);
+    void arm_timer(unsigned int if_index, upstream_state& u, time_point end_time, time_point now);
+    void rearm_timer(unsigned int if_index, upstream_state& u, time_point now);
+
+public:
+    host_reporter(const worker* msg_worker, group_mem_protocol gmp, const std::shared_ptr<const sender>& sender, const std::shared_ptr<timing>& timing);
+
+    host_reporter(const host_reporter&) = delete;
+    host_reporter& operator=(const host_reporter&) = delete;
+
+    /**
+     * @brief Set the membership of a group on an upstream interface, the change is reported at the next flush().
+     */
+    void set_state(unsigned int if_index, const ip_addr& gaddr, mc_filter filter_mode, const source_list<source>& slist);
+
+    /**
+     * @brief Send the state changes since the last flush, packed into as few reports as possible.
+     */
+    void flush();
+
+    /**
+     * @brief Schedule the answer to a query received on an upstream interface.
+     */
+    void receive_query(const std::shared_ptr<membership_query_msg>& msg);
+
+    void timer_triggerd(const std::shared_ptr<host_report_timer_msg>& msg);
+
+    /**
+     * @brief Leave all groups of the upstream interface and forget its state.
+     */
+    void del_interface(unsigned int if_index);
+
+    std::string to_string() const;
+    friend std::ostream& operator<<(std::ostream& stream, const host_reporter& h);
+};
+
+#endif // HOST_REPORTER_HPP
+/** @} */
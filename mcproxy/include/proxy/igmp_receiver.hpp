@@ -50,12 +50,13 @@ private:
     int get_ctrl_min_size() override;
     int get_iov_min_size() override;
     void analyse_packet(struct msghdr* msg, int info_size) override;
+    void generate_socket_filter(std::vector<struct sock_filter>& prog) const override;
 
 public:
     /**
      * @brief Create an igmp_receiver.
      */
-    igmp_receiver(proxy_instance* pr_i, const std::shared_ptr<const mroute_socket> mrt_sock,const std::shared_ptr<const interfaces> interfaces, bool in_debug_testing_mode);
+    igmp_receiver(proxy_instance* pr_i, const std::shared_ptr<const mroute_socket> mrt_sock,const std::shared_ptr<const interfaces> interfaces, bool in_debug_testing_mode, const receiver_msg_handler& msg_handler = nullptr);
 };
 
 #endif // IGMP_RECEIVER_HPP
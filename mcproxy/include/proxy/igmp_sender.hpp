@@ -36,7 +36,14 @@
 class igmp_sender : public sender
 {
 private:
-    bool send_igmpv3_query(unsigned int if_index, const timers_values& tv, const addr_storage& gaddr, bool s_flag, const source_list<source>& slist) const;
+    //destination of a query, the all nodes address for a general query and the group address otherwise
+    addr_storage get_query_dst_addr(const addr_storage& gaddr) const;
+
+    //append a query to buf, a source list that does not fit into the MTU is split into multiple packets
+    void add_igmpv3_query(packet_buffer& buf, unsigned int if_index, const timers_values& tv, const addr_storage& gaddr, bool s_flag, const source_list<source>& slist) const;
+
+    //send all queries of buf for gaddr with one sendmmsg() call
+    bool send_igmpv3_queries(unsigned int if_index, const addr_storage& gaddr, const packet_buffer& buf) const;
 
 public:
     igmp_sender(const std::shared_ptr<const interfaces>& interfaces);
@@ -49,6 +56,11 @@ public:
 
     bool send_mc_addr_and_src_specific_query(unsigned int if_index, const timers_values& tv, const addr_storage& gaddr, source_list<source>& slist) const override;
 
+    unsigned int get_report_capacity(unsigned int if_index) const override;
+
+    unsigned int get_record_size(unsigned int num_of_srcs) const override;
+
+    bool send_report(unsigned int if_index, const std::vector<report_record>& records) const override;
 };
 
 #endif // IGMP_SENDER_HPP
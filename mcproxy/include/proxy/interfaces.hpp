@@ -23,7 +23,7 @@
 #ifndef INTERFACES_HPP
 #define INTERFACES_HPP
 
-#include "include/utils/if_prop.hpp"
+#include "include/utils/if_registry.hpp"
 #include "include/utils/reverse_path_filter.hpp"
 
 #include <string>
@@ -37,7 +37,8 @@ class addr_storage;
 #define INTERFACES_UNKOWN_VIF_INDEX -1
 
 /**
- * @brief summary of the most use interface properties
+ * @brief summary of the most use interface properties,
+ *        the properties of the network interfaces are read from the if_registry
  */
 class interfaces
 {
@@ -46,7 +47,6 @@ private:
 
     //ipv4 only
     bool m_reset_reverse_path_filter;
-    if_prop m_if_prop;
     reverse_path_filter m_reverse_path_filter;
 
     std::map<int, unsigned int> m_vif_if;
@@ -79,7 +79,7 @@ public:
     static unsigned int get_if_index(const char* if_name);
     unsigned int get_if_index(int virtual_if_index) const;
 
-    //ipv4 only
+    //longest prefix match of the source address against the subnets of the interfaces
     unsigned int get_if_index(const addr_storage& saddr) const;
 
     std::string to_string() const;
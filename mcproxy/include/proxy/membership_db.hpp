@@ -27,12 +27,15 @@
 #include "include/proxy/def.hpp"
 #include "include/proxy/membership_db.hpp"
 #include "include/proxy/message_format.hpp"
+#include "include/proxy/group_table.hpp"
 
 #include <iostream>
 #include <set>
 #include <map>
 #include <chrono>
 #include <memory>
+#include <vector>
+#include <cstdint>
 
 struct gaddr_info {
     gaddr_info(group_mem_protocol compatibility_mode_variable);
@@ -59,14 +62,30 @@ struct gaddr_info {
     source_list<source> include_requested_list;
     source_list<source> exclude_list;
 
+    group_handle handle; //entry of this group in membership_db::group_info, is set by the querier
+
+    //forwarding state at the last state change notification, notified_fingerprint is 0 if nothing has been notified
+    uint64_t notified_fingerprint;
+    bool notified_all_sources;
+    mc_filter notified_filter_mode;
+    std::vector<ip_addr> notified_sources;
+
     bool is_in_backward_compatibility_mode() const;
     bool is_under_bakcward_compatibility_effects() const; 
+
+    //hash of the forwarding state (filter mode and the forwarded or blocked sources), never 0
+    uint64_t get_forwarding_fingerprint() const;
+
+    //true if the forwarding state with this fingerprint is the notified one, equal fingerprints are confirmed with the notified state
+    bool is_notified_forwarding_state(uint64_t fingerprint) const;
+    void set_notified_forwarding_state(uint64_t fingerprint);
+
     std::string to_string() const;
     friend std::ostream& operator<<(std::ostream& stream, const gaddr_info& g);
 };
 
-using gaddr_map = std::map<addr_storage, gaddr_info>;
-using gaddr_pair = std::pair<addr_storage, gaddr_info>;
+using gaddr_map = group_table<gaddr_info>;
+using gaddr_pair = gaddr_map::value_type;
 
 /**
  * @brief The Membership Database maintaines the membership records for one specific interface (RFC 4605)
@@ -87,6 +106,16 @@ struct membership_db {
 
     static void test_arithmetic();
 
+    /**
+     * @brief Benchmark union, intersection, difference and erase_if() of source lists with 1 to 4096 sources (powers of two) against std::set.
+     */
+    static void test_source_list();
+
+    /**
+     * @brief Benchmark the group_table with 10k, 100k and 1M groups against std::map.
+     */
+    static void test_group_table();
+
     std::string to_string() const;
 
     friend std::ostream& operator<<(std::ostream& stream, const membership_db& mdb);
@@ -29,7 +29,9 @@
 
 #include "include/hamcast_logging.h"
 #include "include/utils/addr_storage.hpp"
+#include "include/utils/ip_addr.hpp"
 #include "include/proxy/def.hpp"
+#include "include/proxy/group_table.hpp"
 #include "include/proxy/interfaces.hpp"
 #include "include/proxy/timers_values.hpp"
 #include "include/parser/interface.hpp"
@@ -37,9 +39,12 @@
 #include <iostream>
 #include <string>
 #include <map>
+#include <vector>
 #include <memory>
 #include <chrono>
 
+struct timer_position;
+
 struct proxy_msg {
     enum message_type {
         INIT_MSG,
@@ -48,13 +53,17 @@ struct proxy_msg {
         FILTER_TIMER_MSG,
         SOURCE_TIMER_MSG,
         NEW_SOURCE_MSG,
-        NEW_SOURCE_TIMER_MSG,
+        SOURCE_SWEEP_TIMER_MSG,
+        UPSTREAM_REPORT_TIMER_MSG,
+        HOST_REPORT_TIMER_MSG,
         RET_GROUP_TIMER_MSG, //retransmission group timer message
         RET_SOURCE_TIMER_MSG,
         OLDER_HOST_PRESENT_TIMER_MSG,
         GENERAL_QUERY_TIMER_MSG,
         CONFIG_MSG,
         GROUP_RECORD_MSG,
+        GROUP_REPORT_MSG,
+        MEMBERSHIP_QUERY_MSG,
         DEBUG_MSG
     };
 
@@ -72,13 +81,17 @@ struct proxy_msg {
             {FILTER_TIMER_MSG,     "FILTER_TIMER_MSG"    },
             {SOURCE_TIMER_MSG,     "SOURCE_TIMER_MSG"    },
             {NEW_SOURCE_MSG,       "NEW_SOURCE_MSG"      },
-            {NEW_SOURCE_TIMER_MSG, "NEW_SOURCE_TIMER_MSG"},
+            {SOURCE_SWEEP_TIMER_MSG, "SOURCE_SWEEP_TIMER_MSG"},
+            {UPSTREAM_REPORT_TIMER_MSG, "UPSTREAM_REPORT_TIMER_MSG"},
+            {HOST_REPORT_TIMER_MSG, "HOST_REPORT_TIMER_MSG"},
             {RET_GROUP_TIMER_MSG,  "RET_GROUP_TIMER_MSG" },
             {RET_SOURCE_TIMER_MSG, "RET_SOURCE_TIMER_MSG"},
             {OLDER_HOST_PRESENT_TIMER_MSG, "OLDER_HOST_PRESENT_TIMER_MSG"},
             {GENERAL_QUERY_TIMER_MSG,      "GENERAL_QUERY_TIMER_MSG"     },
             {CONFIG_MSG,           "CONFIG_MSG"          },
             {GROUP_RECORD_MSG,     "GROUP_RECORD_MSG"    },
+            {GROUP_REPORT_MSG,     "GROUP_REPORT_MSG"    },
+            {MEMBERSHIP_QUERY_MSG, "MEMBERSHIP_QUERY_MSG"},
             {DEBUG_MSG,            "DEBUG_MSG"           }
         };
         return name_map[mt];
@@ -133,9 +146,17 @@ protected:
     message_priority m_prio;
 };
 
-struct comp_proxy_msg {
-    bool operator()(const std::shared_ptr<proxy_msg>& l, const std::shared_ptr<proxy_msg>& r) const {
-        return *l > *r;
+//maps the message priority to a lane of the job queue, lane 0 is drained first
+struct lane_proxy_msg {
+    unsigned int operator()(const std::shared_ptr<proxy_msg>& msg) const {
+        switch (msg->get_priority()) {
+        case proxy_msg::USER_INPUT:
+            return 0;
+        case proxy_msg::SYSTEMIC:
+            return 1;
+        default:
+            return 2;
+        }
     }
 };
 
@@ -162,7 +183,7 @@ private:
 
 //------------------------------------------------------------------------
 struct timer_msg : public proxy_msg {
-    timer_msg(message_type type, unsigned int if_index, const addr_storage& gaddr, const std::chrono::milliseconds& duration)
+    timer_msg(message_type type, unsigned int if_index, const ip_addr& gaddr, const std::chrono::milliseconds& duration)
         : proxy_msg(type, SYSTEMIC)
         , m_if_index(if_index)
         , m_gaddr(gaddr)
@@ -174,7 +195,7 @@ struct timer_msg : public proxy_msg {
         return m_if_index;
     }
 
-    const addr_storage& get_gaddr() {
+    const ip_addr& get_gaddr() {
         return m_gaddr;
     }
 
@@ -196,14 +217,34 @@ struct timer_msg : public proxy_msg {
         return s.str();
     }
 
+    //handle of the cancelable reminder which delivers this message, see timing::arm_time()
+    const std::shared_ptr<timer_position>& get_timer_handle() {
+        return m_timer_handle;
+    }
+
+    void set_timer_handle(const std::shared_ptr<timer_position>& timer_handle) {
+        m_timer_handle = timer_handle;
+    }
+
+    //entry of the group in the membership database, saves the lookup when the timer expires
+    const group_handle& get_group_handle() {
+        return m_group_handle;
+    }
+
+    void set_group_handle(const group_handle& handle) {
+        m_group_handle = handle;
+    }
+
 private:
     unsigned int m_if_index;
-    addr_storage m_gaddr;
+    ip_addr m_gaddr;
     std::chrono::time_point<std::chrono::steady_clock> m_end_time;
+    std::shared_ptr<timer_position> m_timer_handle;
+    group_handle m_group_handle;
 };
 
 struct filter_timer_msg : public timer_msg {
-    filter_timer_msg(unsigned int if_index, const addr_storage& gaddr, std::chrono::milliseconds duration): timer_msg(FILTER_TIMER_MSG, if_index, gaddr, duration), m_is_used_as_source_timer(false) {
+    filter_timer_msg(unsigned int if_index, const ip_addr& gaddr, std::chrono::milliseconds duration): timer_msg(FILTER_TIMER_MSG, if_index, gaddr, duration), m_is_used_as_source_timer(false) {
         HC_LOG_TRACE("");
     }
 
@@ -220,49 +261,77 @@ private:
 };
 
 struct source_timer_msg : public timer_msg {
-    source_timer_msg(unsigned int if_index, const addr_storage& gaddr, std::chrono::milliseconds duration): timer_msg(SOURCE_TIMER_MSG, if_index, gaddr, duration) {
+    source_timer_msg(unsigned int if_index, const ip_addr& gaddr, std::chrono::milliseconds duration): timer_msg(SOURCE_TIMER_MSG, if_index, gaddr, duration) {
         HC_LOG_TRACE("");
     }
 };
 
 struct retransmit_group_timer_msg : public timer_msg {
-    retransmit_group_timer_msg(unsigned int if_index, const addr_storage& gaddr, std::chrono::milliseconds duration): timer_msg(RET_GROUP_TIMER_MSG, if_index, gaddr, duration) {
+    retransmit_group_timer_msg(unsigned int if_index, const ip_addr& gaddr, std::chrono::milliseconds duration): timer_msg(RET_GROUP_TIMER_MSG, if_index, gaddr, duration) {
         HC_LOG_TRACE("");
     }
 };
 
 struct retransmit_source_timer_msg : public timer_msg {
-    retransmit_source_timer_msg(unsigned int if_index, const addr_storage& gaddr, std::chrono::milliseconds duration): timer_msg(RET_SOURCE_TIMER_MSG, if_index, gaddr, duration) {
+    retransmit_source_timer_msg(unsigned int if_index, const ip_addr& gaddr, std::chrono::milliseconds duration): timer_msg(RET_SOURCE_TIMER_MSG, if_index, gaddr, duration) {
         HC_LOG_TRACE("");
     }
 };
 
 struct older_host_present_timer_msg : public timer_msg {
-    older_host_present_timer_msg(unsigned int if_index, const addr_storage& gaddr, std::chrono::milliseconds duration): timer_msg(OLDER_HOST_PRESENT_TIMER_MSG, if_index, gaddr, duration) {
+    older_host_present_timer_msg(unsigned int if_index, const ip_addr& gaddr, std::chrono::milliseconds duration): timer_msg(OLDER_HOST_PRESENT_TIMER_MSG, if_index, gaddr, duration) {
         HC_LOG_TRACE("");
     }
 };
 
 struct general_query_timer_msg : public timer_msg {
-    general_query_timer_msg(unsigned int if_index, std::chrono::milliseconds duration): timer_msg(GENERAL_QUERY_TIMER_MSG, if_index, addr_storage(), duration) {
+    general_query_timer_msg(unsigned int if_index, std::chrono::milliseconds duration): timer_msg(GENERAL_QUERY_TIMER_MSG, if_index, ip_addr(), duration) {
         HC_LOG_TRACE("");
     }
 };
 
-struct new_source_timer_msg : public timer_msg {
-    new_source_timer_msg(unsigned int if_index, const addr_storage& gaddr, const addr_storage& saddr, std::chrono::milliseconds duration)
-        : timer_msg(NEW_SOURCE_TIMER_MSG, if_index, gaddr, duration)
-        , m_saddr(saddr)  {
+//ages all multicast sources of the routing which expire in the same time slot
+struct source_sweep_timer_msg : public timer_msg {
+    struct aging_source {
+        unsigned int if_index;
+        ip_addr gaddr;
+        ip_addr saddr;
+    };
+
+    source_sweep_timer_msg(long slot, std::chrono::milliseconds duration)
+        : timer_msg(SOURCE_SWEEP_TIMER_MSG, 0, ip_addr(), duration)
+        , m_slot(slot)  {
         HC_LOG_TRACE("");
     }
 
-    const addr_storage& get_saddr() {
-        HC_LOG_TRACE("");
-        return m_saddr;
+    long get_slot() {
+        return m_slot;
+    }
+
+    //a source is only aged if its shared_source_timer still refers to this message
+    std::vector<aging_source>& get_sources() {
+        return m_sources;
     }
 
 private:
-    addr_storage m_saddr;
+    long m_slot;
+    std::vector<aging_source> m_sources;
+};
+
+//sends the delayed upstream membership changes of the routing
+struct upstream_report_timer_msg : public timer_msg {
+    upstream_report_timer_msg(std::chrono::milliseconds duration)
+        : timer_msg(UPSTREAM_REPORT_TIMER_MSG, 0, ip_addr(), duration) {
+        HC_LOG_TRACE("");
+    }
+};
+
+//sends the due reports of the host reporter on an upstream interface
+struct host_report_timer_msg : public timer_msg {
+    host_report_timer_msg(unsigned int if_index, std::chrono::milliseconds duration)
+        : timer_msg(HOST_REPORT_TIMER_MSG, if_index, ip_addr(), duration) {
+        HC_LOG_TRACE("");
+    }
 };
 
 //------------------------------------------------------------------------
@@ -283,12 +352,16 @@ struct source {
     source(const source&) = default;
     source& operator=(const source& s) = default;
 
-    source(const addr_storage& saddr)
+    source(const ip_addr& saddr)
         : saddr(saddr)
         , shared_source_timer(nullptr)
         , retransmission_count(-1) { /*not in a retransmission state*/
     }
 
+    explicit source(const addr_storage& saddr)
+        : source(ip_addr(saddr)) {
+    }
+
     std::string to_string() const {
         std::ostringstream s;
         s << saddr;
@@ -315,7 +388,7 @@ struct source {
         return l.saddr == r.saddr;
     }
 
-    addr_storage saddr;
+    ip_addr saddr;
     mutable std::shared_ptr<timer_msg> shared_source_timer;
     mutable long retransmission_count;
 };
@@ -324,12 +397,12 @@ struct group_record_msg : public proxy_msg {
     //group_record_msg()
     //: group_record_msg(0, MODE_IS_INCLUDE, addr_storage(), source_list<source>(), IGMPv3) {}
 
-    group_record_msg(unsigned int if_index, mcast_addr_record_type record_type, const addr_storage& gaddr, source_list<source>&& slist, group_mem_protocol grp_mem_proto)
+    group_record_msg(unsigned int if_index, mcast_addr_record_type record_type, const ip_addr& gaddr, source_list<source>&& slist, group_mem_protocol grp_mem_proto)
         : proxy_msg(GROUP_RECORD_MSG, LOSEABLE)
         , m_if_index(if_index)
         , m_record_type(record_type)
         , m_gaddr(gaddr)
-        , m_slist(slist)
+        , m_slist(std::move(slist))
         , m_grp_mem_proto(grp_mem_proto){}
 
     friend std::ostream& operator<<(std::ostream& stream, const group_record_msg& r) {
@@ -355,7 +428,7 @@ struct group_record_msg : public proxy_msg {
         return m_record_type;
     }
 
-    const addr_storage& get_gaddr() {
+    const ip_addr& get_gaddr() {
         return m_gaddr;
     }
 
@@ -370,13 +443,106 @@ struct group_record_msg : public proxy_msg {
 private:
     unsigned int m_if_index;
     mcast_addr_record_type m_record_type;
-    addr_storage m_gaddr;
+    ip_addr m_gaddr;
     source_list<source> m_slist;
     group_mem_protocol m_grp_mem_proto;
 };
 
+//all group records of one IGMPv3/MLDv2 report
+struct group_report_msg : public proxy_msg {
+    group_report_msg(unsigned int if_index, group_mem_protocol grp_mem_proto, unsigned int num_records)
+        : proxy_msg(GROUP_REPORT_MSG, LOSEABLE)
+        , m_if_index(if_index)
+        , m_grp_mem_proto(grp_mem_proto) {
+        m_records.reserve(num_records);
+    }
+
+    friend std::ostream& operator<<(std::ostream& stream, const group_report_msg& r) {
+        return stream << r.to_string();
+    }
+
+    std::string to_string() const {
+        HC_LOG_TRACE("");
+        std::ostringstream s;
+        s << "number of records: " << m_records.size();
+        for (auto & e : m_records) {
+            s << std::endl << e.to_string();
+        }
+        return s.str();
+    }
+
+    void add_record(mcast_addr_record_type record_type, const ip_addr& gaddr, source_list<source>&& slist) {
+        m_records.emplace_back(m_if_index, record_type, gaddr, std::move(slist), m_grp_mem_proto);
+    }
+
+    unsigned int get_if_index() {
+        return m_if_index;
+    }
+
+    group_mem_protocol get_grp_mem_proto() {
+        return m_grp_mem_proto;
+    }
+
+    std::vector<group_record_msg>& get_records() {
+        return m_records;
+    }
+
+private:
+    unsigned int m_if_index;
+    group_mem_protocol m_grp_mem_proto;
+    std::vector<group_record_msg> m_records;
+};
+
+//a received IGMP/MLD query, the group address is invalid for a general query
+struct membership_query_msg : public proxy_msg {
+    membership_query_msg(unsigned int if_index, group_mem_protocol grp_mem_proto, const ip_addr& gaddr, std::chrono::milliseconds max_resp_time, unsigned int qrv, std::vector<ip_addr>&& sources)
+        : proxy_msg(MEMBERSHIP_QUERY_MSG, SYSTEMIC)
+        , m_if_index(if_index)
+        , m_grp_mem_proto(grp_mem_proto)
+        , m_gaddr(gaddr)
+        , m_max_resp_time(max_resp_time)
+        , m_qrv(qrv)
+        , m_sources(std::move(sources)) {
+        HC_LOG_TRACE("");
+    }
+
+    unsigned int get_if_index() {
+        return m_if_index;
+    }
+
+    //version of the querier, IGMPv1/v2 and MLDv1 queries have no sources and no robustness variable
+    group_mem_protocol get_grp_mem_proto() {
+        return m_grp_mem_proto;
+    }
+
+    const ip_addr& get_gaddr() {
+        return m_gaddr;
+    }
+
+    std::chrono::milliseconds get_max_resp_time() {
+        return m_max_resp_time;
+    }
+
+    //0 if not set by the querier
+    unsigned int get_qrv() {
+        return m_qrv;
+    }
+
+    const std::vector<ip_addr>& get_sources() {
+        return m_sources;
+    }
+
+private:
+    unsigned int m_if_index;
+    group_mem_protocol m_grp_mem_proto;
+    ip_addr m_gaddr;
+    std::chrono::milliseconds m_max_resp_time;
+    unsigned int m_qrv;
+    std::vector<ip_addr> m_sources;
+};
+
 struct new_source_msg : public proxy_msg {
-    new_source_msg(unsigned int if_index, const addr_storage& gaddr, const addr_storage& saddr)
+    new_source_msg(unsigned int if_index, const ip_addr& gaddr, const ip_addr& saddr)
         : proxy_msg(NEW_SOURCE_MSG, LOSEABLE)
         , m_if_index(if_index)
         , m_gaddr(gaddr)
@@ -388,18 +554,18 @@ struct new_source_msg : public proxy_msg {
         return m_if_index;
     }
 
-    const addr_storage& get_gaddr() {
+    const ip_addr& get_gaddr() {
         return m_gaddr;
     }
 
-    const addr_storage& get_saddr() {
+    const ip_addr& get_saddr() {
         return m_saddr;
     }
 
 private:
     unsigned int m_if_index;
-    addr_storage m_gaddr;
-    addr_storage m_saddr;
+    ip_addr m_gaddr;
+    ip_addr m_saddr;
 };
 
 //------------------------------------------------------------------------
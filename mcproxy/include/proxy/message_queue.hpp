@@ -30,32 +30,194 @@
 #ifndef MESSAGE_QUEUE_HPP
 #define MESSAGE_QUEUE_HPP
 #include "include/hamcast_logging.h"
-#include <thread>
-#include <condition_variable>
+#include <atomic>
 #include <mutex>
-#include <queue>
-#include <climits>
+#include <list>
 #include <vector>
+#include <memory>
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+#include <errno.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+//upper bound of the ring buffer of one lane, a lane which must not lose messages continues in an overflow list
+#define MESSAGE_QUEUE_MAX_LANE_SIZE 65536
+
+//keeps the producer and the consumer index in different cache lines
+#define MESSAGE_QUEUE_CACHE_LINE_SIZE 64
+
+/**
+ * @brief Bounded lock-free ring buffer for multiple producers and a single consumer.
+ * Each cell carries a sequence number which tells whether it is free for the
+ * producer of a specific round or filled for the consumer.
+ */
+template<typename T>
+class mpsc_ring
+{
+private:
+    struct cell {
+        std::atomic<size_t> m_seq;
+        T m_data;
+    };
+
+    std::unique_ptr<cell[]> m_buffer;
+    const size_t m_mask;
+    const size_t m_limit;
+
+    char m_pad0[MESSAGE_QUEUE_CACHE_LINE_SIZE];
+    std::atomic<size_t> m_enqueue_pos;
+    char m_pad1[MESSAGE_QUEUE_CACHE_LINE_SIZE];
+    std::atomic<size_t> m_dequeue_pos;
+    char m_pad2[MESSAGE_QUEUE_CACHE_LINE_SIZE];
+
+    static size_t get_capacity(unsigned int size) {
+        size_t c = 2;
+        while (c < size && c < MESSAGE_QUEUE_MAX_LANE_SIZE) {
+            c <<= 1;
+        }
+        return c;
+    }
+
+    mpsc_ring(const mpsc_ring&) = delete;
+    mpsc_ring& operator=(const mpsc_ring&) = delete;
+
+public:
+    /**
+      * @param size maximum number of elements, the buffer is rounded up to a power of two
+      */
+    mpsc_ring(unsigned int size)
+        : m_buffer(new cell[get_capacity(size)])
+        , m_mask(get_capacity(size) - 1)
+        , m_limit(std::min<size_t>(size, get_capacity(size)))
+        , m_enqueue_pos(0)
+        , m_dequeue_pos(0) {
+        for (size_t i = 0; i <= m_mask; ++i) {
+            m_buffer[i].m_seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+      * @brief Add an element on tail, return false if the ring holds size elements (any thread).
+      */
+    bool try_enqueue(const T& t) {
+        size_t pos = m_enqueue_pos.load(std::memory_order_relaxed);
+        cell* c;
+
+        for (;;) {
+            c = &m_buffer[pos & m_mask];
+            size_t seq = c->m_seq.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                //the consumer only moves forward, so the claimed cells never exceed the limit
+                if (pos - m_dequeue_pos.load(std::memory_order_relaxed) >= m_limit) {
+                    return false;
+                }
+
+                if (m_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = m_enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+
+        c->m_data = t;
+        c->m_seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+      * @brief Get the element on head, return false if the ring is empty (consumer thread only).
+      */
+    bool try_dequeue(T& t) {
+        size_t pos = m_dequeue_pos.load(std::memory_order_relaxed);
+        cell* c = &m_buffer[pos & m_mask];
+
+        if (c->m_seq.load(std::memory_order_acquire) != pos + 1) {
+            return false;
+        }
+
+        t = std::move(c->m_data);
+        c->m_data = T();
+        c->m_seq.store(pos + m_mask + 1, std::memory_order_release);
+        m_dequeue_pos.store(pos + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /**
+      * @brief Return true if no published element is on head (consumer thread only).
+      */
+    bool is_empty() const {
+        size_t pos = m_dequeue_pos.load(std::memory_order_relaxed);
+        return m_buffer[pos & m_mask].m_seq.load(std::memory_order_acquire) != pos + 1;
+    }
+
+    /**
+      * @brief Return the number of claimed cells, only a snapshot if called concurrently.
+      */
+    size_t size() const {
+        return m_enqueue_pos.load(std::memory_order_relaxed) - m_dequeue_pos.load(std::memory_order_relaxed);
+    }
+
+    size_t max_size() const {
+        return m_limit;
+    }
+};
 
 /**
- * @brief Fixed sized synchronised priority job queue.
+ * @brief Fixed sized synchronised job queue with a fixed number of priority lanes.
+ * Each lane is a lock-free ring buffer, the lanes are drained in ascending order
+ * and each lane in FIFO order. Any thread can add elements but only one thread
+ * may dequeue them. The consumer blocks on an eventfd only if all lanes are empty.
  */
-template<typename T, typename Compare = std::less<T>>
+template<typename T, typename Lane, unsigned int LaneCount = 3>
 class message_queue
 {
 private:
-    std::priority_queue<T, std::vector<T>, Compare> m_q;
+    struct lane {
+        lane(unsigned int size)
+            : m_ring(size)
+            , m_overflow_size(0) {}
+
+        mpsc_ring<T> m_ring;
+
+        //holds the elements of a full ring which must not be lost
+        std::atomic<unsigned int> m_overflow_size;
+        std::mutex m_overflow_lock;
+        std::list<T> m_overflow;
+    };
+
+    std::vector<std::unique_ptr<lane>> m_lanes;
     unsigned int m_size;
+    Lane m_lane_of;
+
+    int m_wakeup_fd;
+    std::atomic<bool> m_is_waiting;
 
-    std::mutex m_global_lock;
-    std::condition_variable cond_empty;
+    bool try_dequeue(T& t);
+    bool is_empty_unsafe() const;
+    void wait();
+    void wake_up();
+
+    message_queue(const message_queue&) = delete;
+    message_queue& operator=(const message_queue&) = delete;
 
 public:
     /**
       * @brief Create a message_queue with a maximum size.
-      * @param size size of the message_queue.
+      * @param size size of the message_queue, no lane holds more elements in its ring buffer
+      *             and loseable elements are dropped if the message_queue holds size elements.
+      * @param lane_of returns the lane of an element (0 .. LaneCount - 1), lane 0 has the highest priority.
       */
-    message_queue(int size = UINT_MAX, Compare compare = Compare());
+    message_queue(int size = UINT_MAX, Lane lane_of = Lane());
+
+    virtual ~message_queue();
 
     /**
       * @brief Return true if the message queue is empty.
@@ -73,12 +235,12 @@ public:
     int max_size() const;
 
     /**
-     * @brief Add an element on tail or delete the element if the queue is full.
+     * @brief Add an element on tail of its lane or delete the element if the lane or the queue is full.
      */
     bool enqueue_loseable(const T& t);
 
     /**
-     * @brief Add an element on tail and wait if the queie is full.
+     * @brief Add an element on tail of its lane, if the lane is full the element is kept in an overflow list.
      */
     void enqueue(const T& t);
 
@@ -86,91 +248,270 @@ public:
      * @brief get and el element on head and wait if empty.
      */
     T dequeue(void);
+
+    /**
+     * @brief Append up to max_count elements in priority order to batch and wait if empty.
+     * @return number of appended elements
+     */
+    unsigned int dequeue_batch(std::vector<T>& batch, unsigned int max_count);
+
+    /**
+     * @brief Append up to max_count elements in priority order to batch without waiting.
+     * @return number of appended elements
+     */
+    unsigned int try_dequeue_batch(std::vector<T>& batch, unsigned int max_count);
+
+    /**
+     * @brief Return the eventfd of the consumer to wait for it in an external event loop.
+     *        It is only signaled between begin_external_wait() and end_external_wait().
+     */
+    int get_event_fd() const;
+
+    /**
+     * @brief Announce that the consumer is going to wait for the eventfd.
+     * @return false if the queue is not empty, the consumer must not wait
+     */
+    bool begin_external_wait();
+
+    /**
+     * @brief Finish the waiting for the eventfd.
+     * @param is_signaled true if the eventfd is readable and has to be reset
+     */
+    void end_external_wait(bool is_signaled);
 };
 
-template<typename T, typename Compare>
-message_queue<T, Compare>::message_queue(int size, Compare compare)
-    : m_q(compare)
-    , m_size(size)
+template<typename T, typename Lane, unsigned int LaneCount>
+message_queue<T, Lane, LaneCount>::message_queue(int size, Lane lane_of)
+    : m_size(size)
+    , m_lane_of(lane_of)
+    , m_wakeup_fd(-1)
+    , m_is_waiting(false)
+{
+    HC_LOG_TRACE("");
+
+    for (unsigned int i = 0; i < LaneCount; ++i) {
+        m_lanes.emplace_back(new lane(m_size));
+    }
+
+    m_wakeup_fd = eventfd(0, EFD_CLOEXEC);
+    if (m_wakeup_fd < 0) {
+        HC_LOG_ERROR("failed to create eventfd! Error: " << strerror(errno) << " errno: " << errno);
+        throw "failed to create eventfd";
+    }
+}
+
+template<typename T, typename Lane, unsigned int LaneCount>
+message_queue<T, Lane, LaneCount>::~message_queue()
 {
     HC_LOG_TRACE("");
+    close(m_wakeup_fd);
 }
 
-template<typename T, typename Compare>
-bool message_queue<T, Compare>::is_empty() const
+template<typename T, typename Lane, unsigned int LaneCount>
+bool message_queue<T, Lane, LaneCount>::is_empty() const
 {
     HC_LOG_TRACE("");
+    return size() == 0;
+}
 
-    std::lock_guard<std::mutex> lock(m_global_lock);
+template<typename T, typename Lane, unsigned int LaneCount>
+unsigned int message_queue<T, Lane, LaneCount>::size() const
+{
+    HC_LOG_TRACE("");
 
-    return m_q.empty();
+    unsigned int result = 0;
+    for (auto & e : m_lanes) {
+        result += e->m_ring.size() + e->m_overflow_size.load();
+    }
+    return result;
 }
 
-template<typename T, typename Compare>
-unsigned int message_queue<T, Compare>::size() const
+template<typename T, typename Lane, unsigned int LaneCount>
+int message_queue<T, Lane, LaneCount>::max_size() const
 {
     HC_LOG_TRACE("");
 
-    std::lock_guard<std::mutex> lock(m_global_lock);
+    return m_size;
+}
 
-    return m_q.size();
+template<typename T, typename Lane, unsigned int LaneCount>
+bool message_queue<T, Lane, LaneCount>::enqueue_loseable(const T& t)
+{
+    HC_LOG_TRACE("");
+
+    lane& l = *m_lanes[m_lane_of(t)];
+    if (size() >= m_size || !l.m_ring.try_enqueue(t)) {
+        HC_LOG_WARN("message_queue is full, failed to insert message");
+        return false;
+    }
+
+    wake_up();
+    return true;
 }
 
-template<typename T, typename Compare>
-int message_queue<T, Compare>::max_size() const
+template<typename T, typename Lane, unsigned int LaneCount>
+void message_queue<T, Lane, LaneCount>::enqueue(const T& t)
 {
     HC_LOG_TRACE("");
 
-    return m_size;
+    lane& l = *m_lanes[m_lane_of(t)];
+
+    //as long as the overflow list is in use the ring is bypassed to keep the FIFO order of each producer
+    if (l.m_overflow_size.load() != 0 || !l.m_ring.try_enqueue(t)) {
+        std::lock_guard<std::mutex> lock(l.m_overflow_lock);
+        l.m_overflow.push_back(t);
+        ++l.m_overflow_size;
+    }
+
+    wake_up();
+}
+
+template<typename T, typename Lane, unsigned int LaneCount>
+T message_queue<T, Lane, LaneCount>::dequeue(void)
+{
+    HC_LOG_TRACE("");
+
+    T t;
+    while (!try_dequeue(t)) {
+        wait();
+    }
+    return t;
 }
 
-template<typename T, typename Compare>
-bool message_queue<T, Compare>::enqueue_loseable(const T& t)
+template<typename T, typename Lane, unsigned int LaneCount>
+unsigned int message_queue<T, Lane, LaneCount>::dequeue_batch(std::vector<T>& batch, unsigned int max_count)
 {
     HC_LOG_TRACE("");
 
-    {
-        std::unique_lock<std::mutex> lock(m_global_lock);
-        if (m_q.size() < m_size) {
-            m_q.push(t);
+    unsigned int count = 0;
+    T t;
+
+    while (count < max_count) {
+        if (try_dequeue(t)) {
+            batch.push_back(std::move(t));
+            ++count;
+        } else if (count == 0) {
+            wait();
         } else {
-            HC_LOG_WARN("message_queue is full, failed to insert message");
-            return false;
+            break;
         }
     }
-    cond_empty.notify_one();
-    return true;
+
+    return count;
 }
 
-template<typename T, typename Compare>
-void message_queue<T, Compare>::enqueue(const T& t)
+template<typename T, typename Lane, unsigned int LaneCount>
+unsigned int message_queue<T, Lane, LaneCount>::try_dequeue_batch(std::vector<T>& batch, unsigned int max_count)
 {
     HC_LOG_TRACE("");
 
-    {
-        std::unique_lock<std::mutex> lock(m_global_lock);
-        m_q.push(t);
+    unsigned int count = 0;
+    T t;
+
+    while (count < max_count && try_dequeue(t)) {
+        batch.push_back(std::move(t));
+        ++count;
     }
-    cond_empty.notify_one();
-    HC_LOG_DEBUG("!!!!!test2");
+
+    return count;
 }
 
-template<typename T, typename Compare>
-T message_queue<T, Compare>::dequeue(void)
+template<typename T, typename Lane, unsigned int LaneCount>
+int message_queue<T, Lane, LaneCount>::get_event_fd() const
+{
+    return m_wakeup_fd;
+}
+
+template<typename T, typename Lane, unsigned int LaneCount>
+bool message_queue<T, Lane, LaneCount>::begin_external_wait()
 {
     HC_LOG_TRACE("");
 
-    T t;
-    {
-        std::unique_lock<std::mutex> lock(m_global_lock);
-        cond_empty.wait(lock, [&]() {
-            return m_q.size() != 0;
-        });
+    //same protocol as wait(), a producer either sees the flag or its element is found
+    m_is_waiting.store(true);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
 
-        t = m_q.top();
-        m_q.pop();
+    if (!is_empty_unsafe()) {
+        m_is_waiting.store(false);
+        return false;
+    }
+    return true;
+}
+
+template<typename T, typename Lane, unsigned int LaneCount>
+void message_queue<T, Lane, LaneCount>::end_external_wait(bool is_signaled)
+{
+    HC_LOG_TRACE("");
+
+    m_is_waiting.store(false);
+
+    if (is_signaled) {
+        uint64_t value;
+        if (read(m_wakeup_fd, &value, sizeof(value)) < 0 && errno != EINTR) {
+            HC_LOG_ERROR("failed to read eventfd! Error: " << strerror(errno) << " errno: " << errno);
+        }
+    }
+}
+
+template<typename T, typename Lane, unsigned int LaneCount>
+bool message_queue<T, Lane, LaneCount>::try_dequeue(T& t)
+{
+    for (auto & e : m_lanes) {
+        if (e->m_ring.try_dequeue(t)) {
+            return true;
+        }
+
+        if (e->m_overflow_size.load() != 0) {
+            std::lock_guard<std::mutex> lock(e->m_overflow_lock);
+            t = std::move(e->m_overflow.front());
+            e->m_overflow.pop_front();
+            --e->m_overflow_size;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+template<typename T, typename Lane, unsigned int LaneCount>
+bool message_queue<T, Lane, LaneCount>::is_empty_unsafe() const
+{
+    for (auto & e : m_lanes) {
+        if (!e->m_ring.is_empty() || e->m_overflow_size.load() != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template<typename T, typename Lane, unsigned int LaneCount>
+void message_queue<T, Lane, LaneCount>::wait()
+{
+    //announce the sleep before the last check, a producer either sees the flag or its element is found
+    m_is_waiting.store(true);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (is_empty_unsafe()) {
+        uint64_t value;
+        if (read(m_wakeup_fd, &value, sizeof(value)) < 0 && errno != EINTR) {
+            HC_LOG_ERROR("failed to read eventfd! Error: " << strerror(errno) << " errno: " << errno);
+        }
+    }
+
+    m_is_waiting.store(false);
+}
+
+template<typename T, typename Lane, unsigned int LaneCount>
+void message_queue<T, Lane, LaneCount>::wake_up()
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (m_is_waiting.load()) {
+        uint64_t value = 1;
+        if (write(m_wakeup_fd, &value, sizeof(value)) < 0) {
+            HC_LOG_ERROR("failed to write eventfd! Error: " << strerror(errno) << " errno: " << errno);
+        }
     }
-    return t;
 }
 
 #endif // MESSAGE_QUEUE_HPP
@@ -44,9 +44,12 @@ private:
     int get_ctrl_min_size() override; //size in byte
     int get_iov_min_size() override; //size in byte
     void analyse_packet(struct msghdr* msg, int info_size) override;
+    void generate_socket_filter(std::vector<struct sock_filter>& prog) const override;
+
+    static addr_storage get_saddr(struct msghdr* msg);
 
 public:
-    mld_receiver(proxy_instance* pr_i, std::shared_ptr<const mroute_socket> mrt_sock, std::shared_ptr<const interfaces> interfaces, bool in_debug_testing_mode);
+    mld_receiver(proxy_instance* pr_i, std::shared_ptr<const mroute_socket> mrt_sock, std::shared_ptr<const interfaces> interfaces, bool in_debug_testing_mode, const receiver_msg_handler& msg_handler = nullptr);
 };
 
 #endif // MLD_RECEIVER_HPP
@@ -50,6 +50,7 @@ private:
     int m_verbose_lvl;
     bool m_print_proxy_status;
     bool m_reset_rp_filter;
+    bool m_event_loop_mode;
     std::string m_config_path;
 
     std::unique_ptr<configuration> m_configuration;
@@ -37,8 +37,16 @@
 
 #include <memory>
 #include <set>
+#include <map>
+#include <vector>
 #include <functional>
 
+//maximum number of messages the worker thread takes from the job queue at once
+#define PROXY_INSTANCE_MSG_BATCH_SIZE 64
+
+//file descriptors of the event loop: mroute socket, timerfd and eventfd of the job queue
+#define PROXY_INSTANCE_EVENT_LOOP_FDS 3
+
 class timing;
 class receiver;
 class sender;
@@ -48,6 +56,7 @@ class interface;
 class simple_mc_proxy_routing;
 class routing_management;
 class interface_memberships;
+class host_reporter;
 
 /**
  * @brief Represent a multicast proxy (RFC 4605)
@@ -86,8 +95,20 @@ private:
     //defines the mulitcast routing talbe, if set to 0 (default routing table) no other instances running on the system to simplifie the kernel calls.
     const std::string m_instance_name;
     const int m_table_number;
+
+    //an unused multicast source is removed from the routing after this time
+    const std::chrono::milliseconds m_source_life_time;
+
+    //minimum time between two membership changes of a group on an upstream
+    const std::chrono::milliseconds m_upstream_report_interval;
+
+    //the upstream membership reports are sent by the host reporter instead of the kernel
+    const bool m_host_reports;
     const bool m_in_debug_testing_mode;
 
+    //one thread polls the mroute socket, the timers and the job queue, see event_loop()
+    const bool m_in_event_loop_mode;
+
     const std::shared_ptr<const interfaces> m_interfaces;
     const std::shared_ptr<timing> m_timing;
 
@@ -97,6 +118,7 @@ private:
     std::unique_ptr<receiver> m_receiver;
     std::unique_ptr<routing> m_routing;
     std::unique_ptr<routing_management> m_routing_management;
+    std::unique_ptr<host_reporter> m_host_reporter;
 
     //to match the proxy debug output with the wireshark time stamp
     const std::chrono::time_point<std::chrono::steady_clock> m_proxy_start_time;
@@ -110,15 +132,34 @@ private:
     std::shared_ptr<rule_binding> m_upstream_input_rule;
     std::shared_ptr<rule_binding> m_upstream_output_rule;
 
+    //querier state changes of the current batch (group address, interface index), the routing is recalculated once per group at the end of the batch
+    std::map<ip_addr, unsigned int> m_deferred_state_changes;
+
+    //batch size statistics, the histogram buckets are powers of two (1, 2-3, 4-7, ...)
+    unsigned long m_batch_count;
+    unsigned long m_batch_msg_count;
+    unsigned int m_max_batch_size;
+    std::vector<unsigned long> m_batch_size_histogram;
+
     //init
     bool init_mrt_socket();
     bool init_sender();
     bool init_receiver();
     bool init_routing();
     bool init_routing_management();
+    bool init_host_reporter();
 
     //receives and process all events
     void worker_thread();
+    void event_loop();
+    void process_msg(const std::shared_ptr<proxy_msg>& msg);
+
+    //callback of the queriers
+    void defer_querier_state_change(unsigned int if_index, const ip_addr& gaddr);
+    void process_deferred_state_changes();
+
+    void count_batch(unsigned int batch_size);
+    std::string to_string_batch_statistics() const;
 
     //add and del interfaces
     void handle_config(const std::shared_ptr<config_msg>& msg);
@@ -133,11 +174,15 @@ public:
     /**
      * @param group_mem_protocol Defines the highest group membership protocol version for IPv4 or Ipv6 to use.
      * @param table_number Set the multicast routing table. If set to 0 (default routing table) no other instances running on the system (this simplifie the kernel calls).
+     * @param source_life_time Time after which an unused multicast source and its routes are removed.
+     * @param upstream_report_interval Minimum time between two membership changes of a group on an upstream interface.
+     * @param host_reports If true the upstream membership reports are sent by this proxy instance (IGMPv3 and MLDv2 only) instead of by the kernel.
      * @param interfaces Holds all possible needed information of all upstream and downstream interfaces.
      * @param shared_timing Stores and triggers all time-dependent events for this proxy instance.
      * @param in_debug_testing_mode If true this proxy instance stops receiving group membership messages and prints a lot of status messages to the command line.
+     * @param in_event_loop_mode If true this proxy instance uses its own timing instead of shared_timing and processes received packets, timers and job messages in a single thread.
      */
-    proxy_instance(group_mem_protocol group_mem_protocol, const std::string& intance_name, int table_number, const std::shared_ptr<const interfaces>& interfaces, const std::shared_ptr<timing>& shared_timing, bool in_debug_testing_mode = false);
+    proxy_instance(group_mem_protocol group_mem_protocol, const std::string& intance_name, int table_number, const std::chrono::milliseconds& source_life_time, const std::chrono::milliseconds& upstream_report_interval, bool host_reports, const std::shared_ptr<const interfaces>& interfaces, const std::shared_ptr<timing>& shared_timing, bool in_debug_testing_mode = false, bool in_event_loop_mode = false);
 
     /**
      * @brief Release all resources.
@@ -146,6 +191,13 @@ public:
 
     static void test_querier(std::string if_name);
 
+    /**
+     * @brief Benchmark the latency from a membership report to the return of the route flush that installs its multicast route,
+     *        threaded mode (receiver thread and job queue) against event loop mode (one epoll loop). It needs root privileges and
+     *        two multicast capable interfaces with an IPv4 address (e.g. dummy interfaces), the reports are looped back on the downstream.
+     */
+    static void test_event_loop_latency(const std::string& upstream_if_name, const std::string& downstream_if_name);
+
     static void test_a(std::function < void(mcast_addr_record_type, source_list<source>&&, group_mem_protocol) > send_record, std::function<void()> print_proxy_instance);
     static void test_b(std::function < void(mcast_addr_record_type, source_list<source>&&, group_mem_protocol) > send_record, std::function<void()> print_proxy_instance);
     static void test_c(std::function < void(mcast_addr_record_type, source_list<source>&&, group_mem_protocol) > send_record, std::function<void()> print_proxy_instance);
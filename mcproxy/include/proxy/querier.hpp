@@ -39,7 +39,7 @@ class worker;
  * @brief Callback function to publish querier state change informations.
  * The callback function informs about the involved interface index, group address and the involved multicast sources.
  */
-using callback_querier_state_change = std::function<void(unsigned int, const addr_storage&)>;
+using callback_querier_state_change = std::function<void(unsigned int, const ip_addr&)>;
 
 /**
  * @brief Defines the behaviour of a multicast querier for a specific interface.
@@ -56,32 +56,35 @@ private:
     const std::shared_ptr<const sender> m_sender;
     const std::shared_ptr<timing> m_timing;
 
+    unsigned long m_notification_count;
+    unsigned long m_suppressed_notification_count;
+
     //join all router groups or leave them
     bool router_groups_function(bool subscribe) const;
     bool send_general_query();
 
     //
-    void receive_record_in_include_mode(mcast_addr_record_type record_type, const addr_storage& gaddr, source_list<source>& slist, gaddr_info& ginfo);
-    void receive_record_in_exclude_mode(mcast_addr_record_type record_type, const addr_storage& gaddr, source_list<source>& slist, gaddr_info& ginfo);
+    void receive_record_in_include_mode(mcast_addr_record_type record_type, const ip_addr& gaddr, source_list<source>& slist, gaddr_info& ginfo);
+    void receive_record_in_exclude_mode(mcast_addr_record_type record_type, const ip_addr& gaddr, source_list<source>& slist, gaddr_info& ginfo);
 
     //RFC3810 Section 7.2.3 Definition of Souce timers
     //Updates the filter_timer to the Multicast Address Listener Interval
-    void mali(const addr_storage& gaddr, gaddr_info& ginfo) const;
+    void mali(const ip_addr& gaddr, gaddr_info& ginfo) const;
 
     //Updates a list of source_timers to the Multicast Address Listener Interval
-    void mali(const addr_storage& gaddr, source_list<source>& slist) const;
+    void mali(const ip_addr& gaddr, source_list<source>& slist) const;
 
     //Updates specific source timers (tmp_slist) of list slist to the Multicast Address Listener Interval
-    void mali(const addr_storage& gaddr, source_list<source>& slist, source_list<source>&& tmp_slist) const;
+    void mali(const ip_addr& gaddr, source_list<source>& slist, source_list<source>&& tmp_slist) const;
 
     //Set specific source timers (tmp_slist) of list slist to the corresponding filter time
     void filter_time(gaddr_info& ginfo, source_list<source>& slist, source_list<source>&& tmp_slist);
 
     //send multicast address specific query
-    void send_Q(const addr_storage& gaddr, gaddr_info& ginfo);
+    void send_Q(const ip_addr& gaddr, gaddr_info& ginfo);
 
     //send multicast address and source specific and include only elements of tmp_list
-    void send_Q(const addr_storage& gaddr, gaddr_info& ginfo, source_list<source>& slist, source_list<source>&& tmp_list, bool in_retransmission_state = false);
+    void send_Q(const ip_addr& gaddr, gaddr_info& ginfo, source_list<source>& slist, source_list<source>&& tmp_list, bool in_retransmission_state = false);
 
     void timer_triggerd_filter_timer(gaddr_map::iterator db_info_it, const std::shared_ptr<timer_msg>& msg);
     void timer_triggerd_source_timer(gaddr_map::iterator db_info_it, const std::shared_ptr<timer_msg>& msg);
@@ -90,8 +93,16 @@ private:
     void timer_triggerd_older_host_present_timer(gaddr_map::iterator db_info_it, const std::shared_ptr<timer_msg>& msg);
     void timer_triggerd_general_query_timer(const std::shared_ptr<timer_msg>& msg);
 
-    //call the callback function querier_state_change
-    void state_change_notification(const addr_storage& gaddr);
+    //arm a cancelable reminder for a timer message
+    void arm_timer(std::chrono::milliseconds delay, const std::shared_ptr<timer_msg>& tm) const;
+    void arm_timer(std::chrono::milliseconds delay, const std::shared_ptr<timer_msg>& tm, const gaddr_info& ginfo) const;
+
+    //remove a replaced timer message from the module Timer before it fires
+    void cancel_timer(const std::shared_ptr<timer_msg>& tm) const;
+
+    //call the callback function querier_state_change if the forwarding state of the group has changed since the last call,
+    //e.g. the periodic current state records of the hosts change nothing
+    void state_change_notification(const ip_addr& gaddr);
 
 public:
     virtual ~querier();
@@ -113,6 +124,12 @@ public:
      */
     void receive_record(const std::shared_ptr<proxy_msg>& msg);
 
+    /**
+     * @brief Process a single group record, e.g. of a group report.
+     * @param gr the reveived group record
+     */
+    void receive_record(group_record_msg& gr);
+
     /**
      * @brief all timer events orderd by this querier musst be submitted to this function. 
      * @param msg the timer event 
@@ -128,12 +145,12 @@ public:
      * @param interface_filter_fun If the filter function is false the interface will be not added to rt_slist
      * If the querier suggest to forward traffic of the group address gaddr and the source it adds its own interface to the return list.
      */
-    void suggest_to_forward_traffic(const addr_storage& gaddr, std::list<std::pair<source, std::list<unsigned int>>>& rt_slist, std::function<bool(const addr_storage&)> interface_filter_fun) const;
+    void suggest_to_forward_traffic(const ip_addr& gaddr, std::list<std::pair<source, std::list<unsigned int>>>& rt_slist, std::function<bool(const ip_addr&)> interface_filter_fun) const;
 
     /**
      * @return return all group membership information of group address gaddr
      */
-    std::pair<mc_filter, source_list<source>> get_group_membership_infos(const addr_storage& gaddr);
+    std::pair<mc_filter, source_list<source>> get_group_membership_infos(const ip_addr& gaddr);
 
     /**
      * @brief Roadworks
@@ -42,13 +42,36 @@
 #include <mutex>
 #include <memory>
 #include <sstream>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <functional>
+#include <linux/filter.h>
 
 class proxy_instance;
 
 /**
- * @brief Receive timout set to have not a blocking receive funktion.
+ * @brief Processes a received message in the thread that calls receiver::receive_pending(),
+ *        the receiver holds none of its locks while calling it.
  */
-#define RECEIVER_RECV_TIMEOUT 100 //msec
+using receiver_msg_handler = std::function<void(const std::shared_ptr<proxy_msg>&)>;
+
+/**
+ * @brief Maximum number of packets received with one recvmmsg() call.
+ */
+#define RECEIVER_MSG_BATCH_SIZE 64
+
+/**
+ * @brief Return values of the socket filter, accept the whole packet or drop it.
+ */
+#define RECEIVER_FILTER_ACCEPT 0xffffffff
+#define RECEIVER_FILTER_DROP 0
+
+/**
+ * @brief Maximum number of interfaces checked by the socket filter, with more relevant interfaces
+ *        the ingress interface is checked only in userspace.
+ */
+#define RECEIVER_FILTER_MAX_IF_INDEXES 128
 
 /**
  * @brief Abstract basic receiver class.
@@ -61,10 +84,46 @@ private:
     bool m_in_debug_testing_mode;
     std::unique_ptr<std::thread> m_thread;
 
+    //eventfd to wake up the worker thread on stop
+    int m_wakeup_fd;
+
+    //if set the receiver has no own thread and passes the received messages to this handler
+    const receiver_msg_handler m_msg_handler;
+
+    //messages of the current batch, they are passed to the handler after releasing m_data_lock
+    std::vector<std::shared_ptr<proxy_msg>> m_handler_msgs;
+
+    //ring of RECEIVER_MSG_BATCH_SIZE messages for recvmmsg()
+    unsigned int m_ctrl_size;
+    std::unique_ptr<unsigned char[]> m_iov_buf;
+    std::unique_ptr<unsigned char[]> m_ctrl_buf;
+    std::vector<struct iovec> m_iovs;
+    std::vector<struct sockaddr_storage> m_names;
+    std::vector<struct mmsghdr> m_msgs;
+
+    //number of messages received by the last recvmmsg() call
+    int m_last_msg_count;
+
+    //receive statistics
+    const std::chrono::time_point<std::chrono::steady_clock> m_start_time;
+    std::atomic<unsigned long> m_syscall_count;
+    std::atomic<unsigned long> m_packet_count;
+    std::atomic<unsigned int> m_max_packets_per_syscall;
+
     std::set<unsigned int> m_relevant_if_index;
 
+    //interfaces that pass queries to the proxy instance (upstreams of a host reporter)
+    std::set<unsigned int> m_query_if_index;
+
+    void init_msg_ring();
     void worker_thread();
 
+    //regenerates the socket filter for the current relevant interfaces
+    void update_socket_filter();
+
+    //accepts the packet if it was received on one of the interfaces and drops it otherwise
+    static void add_filter_interfaces(std::vector<struct sock_filter>& prog, const std::set<unsigned int>& if_indexes);
+
     std::mutex m_data_lock;
 
     void stop();
@@ -83,6 +142,42 @@ protected:
 
     bool is_if_index_relevant(unsigned int if_index) const;
 
+    /**
+     * @brief Check whether queries are received on any interface.
+     */
+    bool is_query_relevant() const;
+
+    /**
+     * @brief Get the interface index a packet was received on from its packet info (IP_PKTINFO or IPV6_PKTINFO).
+     *        Without packet info the interface is looked up by the source address.
+     * @return interface index or INTERFACES_UNKOWN_IF_INDEX
+     */
+    unsigned int get_ingress_if_index(struct msghdr* msg, const addr_storage& saddr) const;
+
+    /**
+     * @brief Generate the classic BPF program of the mroute socket. It has to accept the used
+     *        kernel messages and the group membership messages of the relevant interfaces.
+     */
+    virtual void generate_socket_filter(std::vector<struct sock_filter>& prog) const = 0;
+
+    /**
+     * @brief Append a filter block that drops the packet if the accumulator is none of the types,
+     *        otherwise the filter continues with the following instructions.
+     */
+    static void add_filter_types(std::vector<struct sock_filter>& prog, const std::vector<unsigned char>& types);
+
+    /**
+     * @brief Append a filter block that accepts the packet if it was received on a relevant interface
+     *        and drops it otherwise. If the accumulator holds query_type the packet is accepted only on
+     *        an interface registered for queries. It terminates the program.
+     */
+    void add_filter_relevant_interfaces(std::vector<struct sock_filter>& prog, unsigned char query_type) const;
+
+    /**
+     * @brief Pass a message of an analysed packet to the proxy instance.
+     */
+    void forward_msg(const std::shared_ptr<proxy_msg>& msg);
+
     /**
      * @brief Get the size for the control buffer for recvmsg().
      */
@@ -103,8 +198,10 @@ protected:
 public:
     /**
       * @brief Create a receiver.
+      * @param msg_handler if set no receiver thread is started, the owner has to call receive_pending()
+      *        whenever the mroute socket is readable and gets the received messages passed to msg_handler.
      */
-    receiver(proxy_instance* pr_i, int addr_family, const std::shared_ptr<const mroute_socket> mrt_sock, const std::shared_ptr<const interfaces> interfaces, bool in_debug_testing_mode= false);
+    receiver(proxy_instance* pr_i, int addr_family, const std::shared_ptr<const mroute_socket> mrt_sock, const std::shared_ptr<const interfaces> interfaces, bool in_debug_testing_mode= false, const receiver_msg_handler& msg_handler = nullptr);
 
     /**
      * @brief Release all resources.
@@ -126,10 +223,31 @@ public:
      */
     void del_interface(unsigned int if_index);
 
+    /**
+     * @brief Receive queries on an interface, the socket filter drops queries of all other interfaces.
+     * @param if_index interface index of the interface
+     */
+    void registrate_query_interface(unsigned int if_index);
+
+    /**
+     * @brief Stop receiving queries on an interface.
+     * @param if_index interface index of the interface
+     */
+    void del_query_interface(unsigned int if_index);
+
+    /**
+     * @brief Receive and analyse up to RECEIVER_MSG_BATCH_SIZE pending packets with one recvmmsg() call.
+     * @return number of received packets
+     */
+    int receive_pending();
+
     /**
      * @brief Check whether the receiver is running.
      */
     bool is_running();
+
+    std::string to_string() const;
+    friend std::ostream& operator<<(std::ostream& stream, const receiver& r);
 };
 
 #endif // RECEIVER_HPP
@@ -30,14 +30,17 @@
 #define ROUTING_HPP
 
 //#include "include/utils/mroute_socket.hpp"
-#include "include/utils/if_prop.hpp"
 
 #include <set>
 #include <list>
 #include <memory>
+#include <string>
+#include <utility>
 
 class interfaces;
 class mroute_socket;
+class mroute_netlink;
+struct mroute_change;
 class addr_storage;
 
 /**
@@ -51,10 +54,12 @@ private:
 
     const std::shared_ptr<const interfaces> m_interfaces;
     const std::shared_ptr<const mroute_socket> m_mrt_sock;
-    if_prop m_if_prop; //return interface properties
 
     mutable std::set<unsigned int> m_added_ifs; 
 
+    //batched multicast routes via netlink, nullptr if the kernel does not support it (see check_kernel)
+    std::unique_ptr<mroute_netlink> m_mrt_netlink;
+
 public:
     routing(int addr_family, std::shared_ptr<const mroute_socket> mrt_sock, std::shared_ptr<const interfaces> interfaces, int table_number);
 
@@ -82,6 +87,21 @@ public:
       * @return Return true on success.
       */
     bool del_route(int vif, const addr_storage& g_addr, const addr_storage& src_addr) const;
+
+    /**
+      * @brief Pass the queued multicast routes to the linux kernel, if they are set via netlink.
+      * @return Return true on success.
+      */
+    bool flush_routes() const;
+
+    /**
+      * @brief Pass the queued multicast routes to the linux kernel, if they are set via netlink.
+      * @param failed_routes receives every route change the kernel has not applied or whose result is unknown
+      * @return Return true on success.
+      */
+    bool flush_routes(std::list<mroute_change>& failed_routes) const;
+
+    std::string to_string() const;
 };
 
 #endif // ROUTING_HPP
@@ -32,7 +32,7 @@
 struct proxy_msg;
 struct source;
 class proxy_instance;
-class addr_storage;
+class ip_addr;
 
 /**
  * @brief abstract interface of a summary of routing events 
@@ -46,9 +46,19 @@ public:
     routing_management(const proxy_instance* p): m_p(p) {}
 
     virtual void event_new_source(const std::shared_ptr<proxy_msg>& msg) = 0;
-    virtual void event_querier_state_change(unsigned int if_index, const addr_storage& gaddr) = 0;
+    virtual void event_querier_state_change(unsigned int if_index, const ip_addr& gaddr) = 0;
     virtual void timer_triggerd_maintain_routing_table(const std::shared_ptr<proxy_msg>& msg) = 0;
 
+    /**
+     * @brief An upstream or downstream interface has been added or deleted.
+     */
+    virtual void event_interface_change() {}
+
+    /**
+     * @brief Pass the queued multicast routes to the kernel at the end of a batch of events.
+     */
+    virtual void flush_routes() = 0;
+
     virtual std::string to_string() const {return std::string();}
 
     friend std::ostream& operator<<(std::ostream& stream, const routing_management& rm) {
@@ -30,14 +30,37 @@
 #define SENDER_HPP
 
 #include "include/utils/mroute_socket.hpp"
+#include "include/utils/membership_socket_pool.hpp"
 #include "include/proxy/def.hpp"
 #include "include/proxy/interfaces.hpp"
 
 #include "memory"
+#include <map>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+//assumed MTU of an interface with unknown MTU
+#define SENDER_DEFAULT_IPV4_MTU 576
+#define SENDER_DEFAULT_IPV6_MTU 1280
+
+//packets in a packet buffer start at a multiple of this alignment
+#define SENDER_PACKET_ALIGNMENT 8
 
 class timers_values;
 struct source;
 class addr_storage;
+
+/**
+ * @brief Group record of a membership report generated by the proxy itself, see host_reporter.
+ */
+struct report_record {
+    mcast_addr_record_type type;
+    ip_addr gaddr;
+    std::vector<ip_addr> sources;
+};
+
 /**
  * @brief Abstract basic sender class.
  */
@@ -49,6 +72,36 @@ protected:
 
     mroute_socket m_sock;
 
+    //memberships of the upstream interfaces and the router groups of the downstream interfaces
+    mutable membership_socket_pool m_memberships;
+
+    //packets of one message (e.g. a query with a long source list split by the MTU), sent with one sendmmsg() call
+    struct packet_buffer {
+        std::vector<unsigned char> data;
+        std::vector<unsigned int> offsets;
+        std::vector<unsigned int> sizes;
+    };
+
+    //one buffer per interface, it keeps its memory for the next message
+    mutable std::map<unsigned int, packet_buffer> m_packet_buffers;
+    mutable std::vector<struct iovec> m_iovecs;
+    mutable std::vector<struct mmsghdr> m_msgs;
+
+    mutable unsigned long m_message_count;
+    mutable unsigned long m_packet_count;
+
+    //MTU of the interface or the default MTU of the address family
+    unsigned int get_mtu(unsigned int if_index) const;
+
+    //return the emptied packet buffer of the interface
+    packet_buffer& get_packet_buffer(unsigned int if_index) const;
+
+    //append a zeroed packet to the buffer, the pointer is valid until the next packet is added
+    unsigned char* add_packet(packet_buffer& buf, unsigned int size) const;
+
+    //send all packets of the buffer to dst_addr on the interface chosen before
+    bool send_packets(const addr_storage& dst_addr, const packet_buffer& buf) const;
+
 public:
 
     sender(const std::shared_ptr<const interfaces>& interfaces, group_mem_protocol gmp);
@@ -61,6 +114,24 @@ public:
 
     virtual bool send_mc_addr_and_src_specific_query(unsigned int if_index, const timers_values& tv, const addr_storage& gaddr, source_list<source>& slist) const;
 
+    /**
+     * @brief Return the space for group records in one membership report on the interface.
+     */
+    virtual unsigned int get_report_capacity(unsigned int if_index) const;
+
+    /**
+     * @brief Return the size of a group record with num_of_srcs sources.
+     */
+    virtual unsigned int get_record_size(unsigned int num_of_srcs) const;
+
+    /**
+     * @brief Send the records in one IGMPv3/MLDv2 membership report, they have to fit into get_report_capacity().
+     */
+    virtual bool send_report(unsigned int if_index, const std::vector<report_record>& records) const;
+
+    std::string to_string() const;
+    friend std::ostream& operator<<(std::ostream& stream, const sender& s);
+
     virtual ~sender();
 };
 
@@ -24,29 +24,47 @@
 #define SIMPLE_ROUTING_DATA_HPP
 
 #include "include/proxy/def.hpp"
+#include "include/utils/ip_addr.hpp"
 #include <map>
+#include <unordered_map>
 #include <memory>
 #include <string>
 #include <set>
+#include <chrono>
+
+//packet counters read with one netlink dump are reused for this time (in milliseconds)
+#define SIMPLE_ROUTING_DATA_STATS_MAX_AGE 1000
+
+//after this number of failed dumps in a row the packet counters are always read for each route
+#define SIMPLE_ROUTING_DATA_MAX_DUMP_FAILURES 5
 
-class addr_storage;
 struct source;
 struct timer_msg;
 class mroute_socket;
+class mroute_netlink;
 
 struct sr_data_value {
-    sr_data_value(const source_list<source>& slist, std::map<addr_storage, unsigned int> if_map)
+    sr_data_value(const source_list<source>& slist, std::map<ip_addr, unsigned int> if_map)
         : m_source_list(slist)
         , m_if_map(if_map) {}
 
     source_list<source> m_source_list;
 
     //source address, interface index
-    std::map<addr_storage, unsigned int> m_if_map;
+    std::map<ip_addr, unsigned int> m_if_map;
+};
+
+using s_routing_data = std::map<ip_addr, sr_data_value>;
+using s_routing_data_pair = std::pair<ip_addr, sr_data_value>;
+
+struct sg_hash {
+    std::size_t operator()(const std::pair<ip_addr, ip_addr>& sg) const {
+        return sg.first.hash() * 31 + sg.second.hash();
+    }
 };
 
-using s_routing_data = std::map<addr_storage, sr_data_value>;
-using s_routing_data_pair = std::pair<addr_storage,sr_data_value>;
+//group address and source address, packet count
+using s_packet_counts = std::unordered_map<std::pair<ip_addr, ip_addr>, unsigned long, sg_hash>;
 
 /**
  * @brief a small database for saving and maintaining multicast sources 
@@ -57,22 +75,45 @@ private:
     s_routing_data m_data;
     group_mem_protocol m_group_mem_protocol;
     const std::shared_ptr<const mroute_socket> m_mrt_sock;
-    unsigned long get_current_packet_count(const addr_storage& gaddr, const addr_storage& saddr);
+
+    //packet counters of all routes, nullptr if the kernel cannot dump them
+    std::unique_ptr<mroute_netlink> m_mrt_netlink;
+    s_packet_counts m_packet_counts;
+    std::chrono::steady_clock::time_point m_packet_counts_time;
+    bool m_packet_counts_valid;
+    unsigned int m_dump_failure_count; //failed dumps in a row
+
+    unsigned long m_dump_count;
+    unsigned long m_ioctl_count;
+
+    bool refresh_packet_counts();
+    unsigned long get_current_packet_count(const ip_addr& gaddr, const ip_addr& saddr);
 
 public:
-    simple_routing_data(group_mem_protocol group_mem_protocol, const std::shared_ptr<const mroute_socket>& mrt_sock);
+    /**
+     * @param table_number multicast routing table of the routes, 0 is the default table
+     */
+    simple_routing_data(group_mem_protocol group_mem_protocol, const std::shared_ptr<const mroute_socket>& mrt_sock, int table_number);
+
+    simple_routing_data(const simple_routing_data&) = delete;
+    simple_routing_data& operator=(const simple_routing_data&) = delete;
+
+    virtual ~simple_routing_data();
+
+    void set_source(unsigned int if_index, const ip_addr& gaddr, const source& saddr);
 
-    void set_source(unsigned int if_index, const addr_storage& gaddr, const source& saddr);
+    void del_source(const ip_addr& gaddr, const ip_addr& saddr);
 
-    void del_source(const addr_storage& gaddr, const addr_storage& saddr);
+    //read the packet counters of all routes now, the following refreshes compare against this reading
+    void take_packet_count_snapshot();
 
     //return true if the source has been refreshed 
     //iterator of the refrehed source
-    std::pair<source_list<source>::iterator, bool> refresh_source_or_del_it_if_unused(const addr_storage& gaddr, const addr_storage& saddr);
+    std::pair<source_list<source>::iterator, bool> refresh_source_or_del_it_if_unused(const ip_addr& gaddr, const ip_addr& saddr);
 
-    const source_list<source>& get_available_sources(const addr_storage& gaddr) const;
+    const source_list<source>& get_available_sources(const ip_addr& gaddr) const;
 
-    const std::map<addr_storage, unsigned int>& get_interface_map(const addr_storage& gaddr) const;
+    const std::map<ip_addr, unsigned int>& get_interface_map(const ip_addr& gaddr) const;
 
     std::string to_string() const;
     friend std::ostream& operator<<(std::ostream& stream, const simple_routing_data& srd); 
@@ -0,0 +1,265 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+#ifndef SOURCE_LIST_HPP
+#define SOURCE_LIST_HPP
+
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <initializer_list>
+#include <utility>
+
+/**
+ * @brief Set of sources stored as sorted contiguous array.
+ *
+ * The interface follows std::set (iterators are constant, an element is never
+ * replaced by an equal one), but insert and erase invalidate iterators like
+ * std::vector does. The set operations of RFC 3376 and RFC 3810 (unite, intersect
+ * and subtract) are linear merges over both arrays and keep the elements
+ * (and with it the timers) of the left hand side.
+ */
+template<typename T>
+class source_list
+{
+private:
+    std::vector<T> m_data;
+
+public:
+    using value_type = T;
+    using size_type = typename std::vector<T>::size_type;
+    using const_iterator = typename std::vector<T>::const_iterator;
+    using iterator = const_iterator;
+
+    source_list() = default;
+
+    source_list(std::initializer_list<T> init) {
+        insert(init.begin(), init.end());
+    }
+
+    const_iterator begin() const {
+        return m_data.cbegin();
+    }
+
+    const_iterator end() const {
+        return m_data.cend();
+    }
+
+    const_iterator cbegin() const {
+        return m_data.cbegin();
+    }
+
+    const_iterator cend() const {
+        return m_data.cend();
+    }
+
+    bool empty() const {
+        return m_data.empty();
+    }
+
+    size_type size() const {
+        return m_data.size();
+    }
+
+    void clear() {
+        m_data.clear();
+    }
+
+    void reserve(size_type n) {
+        m_data.reserve(n);
+    }
+
+    const_iterator find(const T& value) const {
+        auto it = std::lower_bound(m_data.cbegin(), m_data.cend(), value);
+        if (it != m_data.cend() && !(value < *it)) {
+            return it;
+        } else {
+            return m_data.cend();
+        }
+    }
+
+    size_type count(const T& value) const {
+        return find(value) != end() ? 1 : 0;
+    }
+
+    /**
+     * @brief Insert value if no equal element exists, appending in ascending order needs no search.
+     * @return the position of the (new or existing) element and true if value has been inserted
+     */
+    std::pair<const_iterator, bool> insert(const T& value) {
+        if (m_data.empty() || m_data.back() < value) {
+            m_data.push_back(value);
+            return std::make_pair(m_data.cend() - 1, true);
+        }
+
+        auto it = std::lower_bound(m_data.begin(), m_data.end(), value);
+        if (!(value < *it)) {
+            return std::make_pair(const_iterator(it), false);
+        }
+
+        return std::make_pair(const_iterator(m_data.insert(it, value)), true);
+    }
+
+    template<typename InputIt>
+    void insert(InputIt first, InputIt last) {
+        auto old_size = m_data.size();
+        m_data.insert(m_data.end(), first, last);
+
+        auto mid = m_data.begin() + old_size;
+        std::stable_sort(mid, m_data.end());
+        std::inplace_merge(m_data.begin(), mid, m_data.end());
+
+        //std::unique keeps the first element of equal ones, these are the old ones
+        m_data.erase(std::unique(m_data.begin(), m_data.end(), [](const T & l, const T & r) {
+            return !(l < r) && !(r < l);
+        }), m_data.end());
+    }
+
+    const_iterator erase(const_iterator pos) {
+        return m_data.erase(m_data.begin() + (pos - m_data.cbegin()));
+    }
+
+    const_iterator erase(const_iterator first, const_iterator last) {
+        return m_data.erase(m_data.begin() + (first - m_data.cbegin()), m_data.begin() + (last - m_data.cbegin()));
+    }
+
+    size_type erase(const T& value) {
+        auto it = find(value);
+        if (it != end()) {
+            erase(it);
+            return 1;
+        } else {
+            return 0;
+        }
+    }
+
+    /**
+     * @brief Erase all elements for which pred returns true with one compaction of the array
+     *        instead of one shift per erased element, pred is called once per element.
+     * @return the number of erased elements
+     */
+    template<typename Predicate>
+    size_type erase_if(Predicate pred) {
+        auto first = std::remove_if(m_data.begin(), m_data.end(), [&pred](const T & e) {
+            return pred(e);
+        });
+
+        size_type count = m_data.end() - first;
+        m_data.erase(first, m_data.end());
+        return count;
+    }
+
+    /**
+     * @brief Union, elements of this list win against equal elements of r.
+     */
+    void unite(const source_list<T>& r) {
+        if (r.m_data.empty()) {
+            return;
+        } else if (m_data.empty() || m_data.back() < r.m_data.front()) {
+            m_data.insert(m_data.end(), r.m_data.cbegin(), r.m_data.cend());
+            return;
+        }
+
+        std::vector<T> result;
+        result.reserve(m_data.size() + r.m_data.size());
+
+        auto cur_l = m_data.begin();
+        auto cur_r = r.m_data.cbegin();
+        while (cur_l != m_data.end() && cur_r != r.m_data.cend()) {
+            if (*cur_l < *cur_r) {
+                result.push_back(std::move(*cur_l++));
+            } else if (*cur_r < *cur_l) {
+                result.push_back(*cur_r++);
+            } else {
+                result.push_back(std::move(*cur_l++));
+                ++cur_r;
+            }
+        }
+
+        std::move(cur_l, m_data.end(), std::back_inserter(result));
+        result.insert(result.end(), cur_r, r.m_data.cend());
+        m_data.swap(result);
+    }
+
+    /**
+     * @brief Intersection, compacts this list in place.
+     */
+    void intersect(const source_list<T>& r) {
+        auto write = m_data.begin();
+        auto cur_l = m_data.begin();
+        auto cur_r = r.m_data.cbegin();
+        while (cur_l != m_data.end() && cur_r != r.m_data.cend()) {
+            if (*cur_l < *cur_r) {
+                ++cur_l;
+            } else if (*cur_r < *cur_l) {
+                ++cur_r;
+            } else {
+                if (write != cur_l) {
+                    *write = std::move(*cur_l);
+                }
+                ++write;
+                ++cur_l;
+                ++cur_r;
+            }
+        }
+
+        m_data.erase(write, m_data.end());
+    }
+
+    /**
+     * @brief Difference, compacts this list in place.
+     */
+    void subtract(const source_list<T>& r) {
+        auto write = m_data.begin();
+        auto cur_l = m_data.begin();
+        auto cur_r = r.m_data.cbegin();
+        while (cur_l != m_data.end()) {
+            while (cur_r != r.m_data.cend() && *cur_r < *cur_l) {
+                ++cur_r;
+            }
+
+            if (cur_r != r.m_data.cend() && !(*cur_l < *cur_r)) { //equal
+                ++cur_l;
+                ++cur_r;
+                continue;
+            }
+
+            if (write != cur_l) {
+                *write = std::move(*cur_l);
+            }
+            ++write;
+            ++cur_l;
+        }
+
+        m_data.erase(write, m_data.end());
+    }
+
+    friend bool operator==(const source_list<T>& l, const source_list<T>& r) {
+        return l.m_data == r.m_data;
+    }
+
+    friend bool operator!=(const source_list<T>& l, const source_list<T>& r) {
+        return !(l == r);
+    }
+};
+
+#endif // SOURCE_LIST_HPP
@@ -32,37 +32,141 @@
 #include "include/proxy/message_format.hpp"
 
 #include <list>
+#include <array>
 #include <thread>
 #include <memory>
-#include <condition_variable>
 #include <mutex>
 #include <chrono>
-#include <tuple>
-#include <map>
+#include <string>
+#include <ostream>
 
-#define TIMING_IDLE_POLLING_INTERVAL 1 //sec
+//geometry of the timing wheel, one tick is one millisecond
+#define TIMING_WHEEL_MSEC_SLOTS 1000 //one slot per millisecond of the current second
+#define TIMING_WHEEL_SEC_SLOTS 60 //one slot per second of the current minute
+#define TIMING_WHEEL_MIN_SLOTS 60 //one slot per minute of the current hour
+
+#define TIMING_TICKS_PER_SEC TIMING_WHEEL_MSEC_SLOTS
+#define TIMING_TICKS_PER_MIN (TIMING_TICKS_PER_SEC * TIMING_WHEEL_SEC_SLOTS)
+#define TIMING_TICKS_PER_HOUR (TIMING_TICKS_PER_MIN * TIMING_WHEEL_MIN_SLOTS)
 
 class worker;
 
-using timing_db_value = std::tuple<const worker*, std::shared_ptr<proxy_msg>>;
-using timing_db_key = std::chrono::time_point<std::chrono::steady_clock>;
-using timing_db = std::map<timing_db_key, timing_db_value>; 
-using timing_db_pair = std::pair<timing_db_key, timing_db_value>;
+using timing_tick = unsigned long long;
+
+struct timer_position;
+
+struct timing_entry {
+    timing_entry(timing_tick expiry, const worker* msg_worker, const std::shared_ptr<proxy_msg>& pr_msg)
+        : m_expiry(expiry)
+        , m_worker(msg_worker)
+        , m_msg(pr_msg) {}
+
+    timing_entry(timing_tick expiry, const worker* msg_worker, const std::weak_ptr<proxy_msg>& pr_msg, const std::shared_ptr<timer_position>& position)
+        : m_expiry(expiry)
+        , m_worker(msg_worker)
+        , m_weak_msg(pr_msg)
+        , m_position(position) {}
+
+    timing_tick m_expiry;
+    const worker* m_worker;
+    std::shared_ptr<proxy_msg> m_msg;
+
+    //cancelable reminders hold their message only weakly, a message without owner is discarded on expiry
+    std::weak_ptr<proxy_msg> m_weak_msg;
+    std::shared_ptr<timer_position> m_position;
+};
+
+using timing_bucket = std::list<timing_entry>;
 
 /**
- * @brief Organizes timer events.
+ * @brief Position of a cancelable reminder in the timing wheel,
+ *        it is only accessed under the lock of the module Timer.
+ */
+struct timer_position {
+    timer_position()
+        : m_is_pending(false)
+        , m_bucket(nullptr) {}
+
+    bool m_is_pending;
+    timing_bucket* m_bucket;
+    timing_bucket::iterator m_it;
+};
+
+/**
+ * @brief Handle of a cancelable reminder, see timing::arm_time().
+ */
+using timer_handle = std::shared_ptr<timer_position>;
+
+#define TIMING_LATENESS_BUCKETS 8 //see timing.cpp for the bounds of each bucket
+
+/**
+ * @brief Organizes timer events in a hierarchical timing wheel (milliseconds, seconds, minutes).
+ *
+ * A timer is stored in the finest level that covers its expiry relative to the next tick
+ * to process, e.g. a timer of the current second in the millisecond wheel. At each second,
+ * minute or hour boundary the corresponding bucket of the next coarser level is cascaded
+ * down. Timers beyond the current hour are kept in an overflow bucket.
+ *
+ * The worker thread blocks on a timerfd armed to the next event of the wheel, an eventfd
+ * is used to wake it up for shutdown. Without an own thread the owner waits for the
+ * timerfd in its event loop and calls process_timer_fd().
  */
 class timing
 {
 private:
-    timing_db m_db;
+    const std::chrono::time_point<std::chrono::steady_clock> m_start_time;
+
+    //next tick to process
+    timing_tick m_next_tick;
+    unsigned long m_size;
+
+    std::array<timing_bucket, TIMING_WHEEL_MSEC_SLOTS> m_msec_wheel;
+    std::array<timing_bucket, TIMING_WHEEL_SEC_SLOTS> m_sec_wheel;
+    std::array<timing_bucket, TIMING_WHEEL_MIN_SLOTS> m_min_wheel;
+    timing_bucket m_overflow;
+
+    int m_timer_fd;
+    int m_wakeup_fd;
+
+    //tick the timerfd is armed to, valid if m_is_armed is true
+    bool m_is_armed;
+    timing_tick m_armed_tick;
+
+    //how late the reminders fired compared to their deadline
+    std::array<unsigned long, TIMING_LATENESS_BUCKETS> m_lateness_histogram;
+    unsigned long m_canceled_count;
+    unsigned long m_orphaned_count;
 
     bool m_running;
     std::unique_ptr<std::thread> m_thread;
     void worker_thread();
 
-    std::mutex m_global_lock;
-    std::condition_variable m_con_var;
+    mutable std::mutex m_global_lock;
+
+    //arms the timerfd to an absolute tick
+    bool arm_timer_fd(timing_tick tick);
+
+    timing_tick get_current_tick() const;
+
+    //returns the expiry tick of a reminder due after delay
+    timing_tick get_expiry_tick(std::chrono::milliseconds delay) const;
+
+    //returns the bucket of the finest level that covers the expiry relative to m_next_tick
+    timing_bucket& get_bucket(timing_tick expiry);
+
+    //moves a timer from its current bucket to the bucket covering its expiry
+    void place(timing_bucket& from, timing_bucket::iterator it);
+
+    //redistributes all timers of a bucket to the finer levels
+    void cascade(timing_bucket& bucket);
+
+    //returns the next tick at which a timer expires or a non empty bucket has to be cascaded
+    timing_tick get_next_event_tick() const;
+
+    //fires all timers expired until the tick now
+    void expire(timing_tick now);
+
+    void fire(timing_bucket& bucket);
 
     void start();
     void stop();
@@ -74,7 +178,21 @@ private:
     timing& operator=(const timing&&) = delete;
 
 public:
-    timing();
+    /**
+     * @param own_thread if false no worker thread is started, see get_timer_fd()
+     */
+    timing(bool own_thread = true);
+
+    /**
+     * @brief Return the timerfd, it becomes readable when the next reminder is due.
+     */
+    int get_timer_fd() const;
+
+    /**
+     * @brief Fire all due reminders and re-arm the timerfd. Is called by the worker
+     *        thread or by the owner of a timing without own thread.
+     */
+    void process_timer_fd();
 
     /**
      * @brief Add a new reminder with an predefined time.
@@ -84,18 +202,48 @@ public:
      */
     void add_time(std::chrono::milliseconds delay, const worker* msg_worker, const std::shared_ptr<proxy_msg>& pr_msg);
 
+    /**
+     * @brief Add a new cancelable reminder with an predefined time. The reminder holds its message
+     *        only weakly, if the message has no owner at the time of expiry it is discarded.
+     * @param delay predefined time in millisecond
+     * @param msg_worker pointer to the owner of the reminder
+     * @param pr_msg message of the reminder
+     * @return handle to re-arm or cancel the reminder
+     */
+    timer_handle arm_time(std::chrono::milliseconds delay, const worker* msg_worker, const std::shared_ptr<proxy_msg>& pr_msg);
+
+    /**
+     * @brief Move a pending reminder to a new predefined time.
+     * @return false if the reminder has already fired or was canceled
+     */
+    bool rearm_time(const timer_handle& handle, std::chrono::milliseconds delay);
+
+    /**
+     * @brief Remove a pending reminder, it will not reach its worker.
+     * @return false if the reminder has already fired or was canceled
+     */
+    bool cancel_time(const timer_handle& handle);
+
     /**
      * @brief Delete all reminder from a specific proxy instance.
      * @param proxy_instance* pointer to the specific proxy instance
      */
     void stop_all_time(const worker* msg_worker);
 
+    std::string to_string() const;
+    friend std::ostream& operator<<(std::ostream& stream, const timing& t);
+
     virtual ~timing();
     
         /**
      * @brief Test the functionality of the module Timer.
      */
     static void test_timing();
+
+    /**
+     * @brief Benchmark the timing wheel with 1M reminders against an ordered multimap (the former data structure).
+     */
+    static void test_timing_wheel();
 };
 
 #endif // TIME_HPP
@@ -58,7 +58,7 @@ protected:
     /**
      * @brief Job queue to process proxy_msg.
      */
-    mutable message_queue<std::shared_ptr<proxy_msg>,comp_proxy_msg> m_job_queue;
+    mutable message_queue<std::shared_ptr<proxy_msg>, lane_proxy_msg> m_job_queue;
     void join() const;
     void start();
     void stop();
@@ -84,6 +84,11 @@ public:
     void add_msg(const std::shared_ptr<proxy_msg>& msg) const;
 
     static void test_worker();
+
+    /**
+     * @brief Benchmark the job queue with 1 to 8 producer threads against a mutex protected priority queue (the former job queue), both with single and batch dequeues.
+     */
+    static void test_job_queue();
 };
 
 #endif // WORKER_HPP
@@ -252,6 +252,11 @@ public:
      */
     static void test_addr_storage_a();
     static void test_addr_storage_b();
+
+    /**
+     * @brief Benchmark 100k group addresses as map keys, addr_storage against ip_addr.
+     */
+    static void test_ip_addr();
 };
 
 #endif // ADDR_STORAGE_HPP
@@ -0,0 +1,71 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+#ifndef BENCHMARK_HPP
+#define BENCHMARK_HPP
+
+#ifdef DEBUG_MODE
+
+#include "include/hamcast_logging.h"
+
+#include <chrono>
+
+/**
+ * @brief Disables the logging while it exists, the trace output
+ *        would dominate the measurements of the benchmark tests.
+ */
+class log_silencer
+{
+private:
+    hc_log_fun_t m_log_fun;
+
+public:
+    log_silencer()
+        : m_log_fun(hc_get_log_fun()) {
+        hc_set_log_fun(nullptr);
+    }
+
+    log_silencer(const log_silencer&) = delete;
+    log_silencer& operator=(const log_silencer&) = delete;
+
+    ~log_silencer() {
+        hc_set_log_fun(m_log_fun);
+    }
+};
+
+/**
+ * @brief Call @p fun @p runs times.
+ * @return the elapsed time of all runs in nanoseconds
+ */
+template<typename Fun>
+unsigned long measure_nsec(Fun fun, unsigned long runs = 1)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned long i = 0; i < runs; ++i) {
+        fun();
+    }
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+#endif /* DEBUG_MODE */
+
+#endif // BENCHMARK_HPP
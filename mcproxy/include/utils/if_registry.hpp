@@ -0,0 +1,194 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+#ifndef IF_REGISTRY_HPP
+#define IF_REGISTRY_HPP
+
+#include "include/utils/addr_storage.hpp"
+#include "include/utils/prefix_trie.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+struct nlmsghdr;
+
+//receive buffer of the netlink dumps and events
+#define IF_REGISTRY_RECV_BUF_SIZE 32768
+
+//a dump is repeated if the interfaces changed during the dump
+#define IF_REGISTRY_DUMP_RETRIES 3
+
+/**
+ * @brief Address of an interface.
+ */
+struct if_registry_addr {
+    addr_storage addr;
+    addr_storage dstaddr; //peer address of a point to point interface, otherwise invalid
+    unsigned int prefix_len;
+};
+
+/**
+ * @brief Cached properties of a network interface.
+ */
+struct if_registry_entry {
+    unsigned int if_index;
+    std::string if_name;
+    unsigned int flags; //IFF_UP IFF_LOOPBACK IFF_POINTOPOINT IFF_RUNNING IFF_ALLMULTI ...
+    unsigned int mtu; //0 if unknown
+
+    //in the order of the kernel, the first address is the primary one
+    std::vector<if_registry_addr> ip4_addrs;
+    std::vector<if_registry_addr> ip6_addrs;
+
+    const std::vector<if_registry_addr>& get_addrs(int addr_family) const;
+};
+
+/**
+ * @brief Process wide table of the network interfaces (index, name, flags and addresses).
+ *
+ * The table is read with an RTM_GETLINK and an RTM_GETADDR dump. A listener thread receives
+ * the link and address events of rtnetlink and reads the table again after each burst of events.
+ * Each dump is published as new immutable snapshot with std::atomic_store(). Readers take a reference
+ * to the current snapshot with std::atomic_load() and copy the requested values out. A replaced snapshot
+ * is freed when its last reader drops the reference.
+ *
+ * If rtnetlink is not available the registry stays empty, callers have to fall back to the syscalls.
+ */
+class if_registry
+{
+private:
+    struct snapshot {
+        snapshot();
+
+        unsigned long version;
+
+        //ordered by interface name
+        std::vector<if_registry_entry> entries;
+        std::unordered_map<unsigned int, const if_registry_entry*> by_index;
+        std::unordered_map<std::string, const if_registry_entry*> by_name;
+
+        //subnets of all interface addresses, on the same subnet the first interface in name order wins
+        prefix_trie subnets_ip4;
+        prefix_trie subnets_ip6;
+    };
+
+    //accessed only with std::atomic_load() and std::atomic_store()
+    std::shared_ptr<const snapshot> m_current;
+
+    //accessed by the listener thread only (and the constructor)
+    unsigned long m_version;
+    uint32_t m_seq;
+    std::vector<char> m_buf;
+
+    int m_dump_sock;
+    int m_event_sock;
+    int m_wakeup_fd;
+
+    std::atomic<bool> m_running;
+    std::unique_ptr<std::thread> m_thread;
+
+    std::atomic<unsigned long> m_event_count;
+    std::atomic<unsigned long> m_dump_count;
+
+    if_registry();
+
+    bool create_sockets();
+    void listener_thread();
+
+    //read all pending events without blocking, returns true if a link or an address changed
+    bool receive_events();
+
+    //returns false on error or if the dump was interrupted by a change
+    bool dump(uint16_t type, const std::function<void(const nlmsghdr*)>& msg_fun);
+    bool refresh();
+
+    std::shared_ptr<const snapshot> get_snapshot() const;
+    const if_registry_entry* find(const snapshot* s, unsigned int if_index) const;
+
+public:
+    if_registry(const if_registry&) = delete;
+    if_registry& operator=(const if_registry&) = delete;
+
+    /**
+     * @brief Stop the listener thread.
+     */
+    virtual ~if_registry();
+
+    /**
+     * @brief Return the registry, the first call reads the interfaces and starts the listener thread.
+     */
+    static if_registry& get_instance();
+
+    /**
+     * @brief Return true if the interfaces have been read.
+     */
+    bool is_valid() const;
+
+    /**
+     * @brief Return the number of the current snapshot, it changes with every update.
+     */
+    unsigned long get_version() const;
+
+    /**
+     * @return Return false if the interface is unknown.
+     */
+    bool get_if_name(unsigned int if_index, std::string& if_name) const;
+
+    /**
+     * @return Return 0 if the interface is unknown.
+     */
+    unsigned int get_if_index(const std::string& if_name) const;
+
+    /**
+     * @brief Longest prefix match of an address against the subnets of all interfaces.
+     * @return Return 0 if no subnet matches.
+     */
+    unsigned int get_if_index(const addr_storage& addr) const;
+
+    /**
+     * @brief Copy the properties of an interface.
+     * @return Return false if the interface is unknown.
+     */
+    bool get_entry(unsigned int if_index, if_registry_entry& entry) const;
+
+    /**
+     * @return Return 0 if the interface or its MTU is unknown.
+     */
+    unsigned int get_mtu(unsigned int if_index) const;
+
+    /**
+     * @brief Call fun for all interfaces in name order, fun must not block.
+     */
+    void for_each(const std::function<void(const if_registry_entry&)>& fun) const;
+
+    std::string to_string() const;
+    friend std::ostream& operator<<(std::ostream& stream, const if_registry& r);
+};
+
+#endif // IF_REGISTRY_HPP
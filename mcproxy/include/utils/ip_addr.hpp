@@ -0,0 +1,197 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+#ifndef IP_ADDR_HPP
+#define IP_ADDR_HPP
+
+#include "include/utils/addr_storage.hpp"
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <ostream>
+#include <functional>
+
+/**
+ * @brief Compact IPv4 or IPv6 address (24 byte instead of the 128 byte of an addr_storage)
+ *        used as key and payload of the membership and routing data.
+ *
+ * The address is stored as 128 bit number in host byte order (IPv4 in the lower word),
+ * so comparing and hashing need no branches on the address family. Ports are not stored.
+ * The conversions from and to addr_storage are explicit, see to_addr_storage().
+ */
+class ip_addr
+{
+private:
+    uint64_t m_hi;
+    uint64_t m_lo;
+    int m_addr_family;
+
+    static uint64_t load_word(const unsigned char* bytes) {
+        uint64_t result = 0;
+        for (int i = 0; i < 8; ++i) {
+            result = (result << 8) | bytes[i];
+        }
+        return result;
+    }
+
+    static void store_word(uint64_t word, unsigned char* bytes) {
+        for (int i = 7; i >= 0; --i) {
+            bytes[i] = word & 0xff;
+            word >>= 8;
+        }
+    }
+
+public:
+    /**
+     * @brief Create an invalid address.
+     */
+    constexpr ip_addr()
+        : m_hi(0)
+        , m_lo(0)
+        , m_addr_family(AF_UNSPEC) {}
+
+    constexpr ip_addr(int addr_family, uint64_t hi, uint64_t lo)
+        : m_hi(hi)
+        , m_lo(lo)
+        , m_addr_family(addr_family) {}
+
+    explicit ip_addr(const in_addr& addr)
+        : m_hi(0)
+        , m_lo(ntohl(addr.s_addr))
+        , m_addr_family(AF_INET) {}
+
+    explicit ip_addr(const in6_addr& addr)
+        : m_hi(load_word(addr.s6_addr))
+        , m_lo(load_word(addr.s6_addr + 8))
+        , m_addr_family(AF_INET6) {}
+
+    explicit ip_addr(const addr_storage& addr)
+        : ip_addr() {
+        if (addr.get_addr_family() == AF_INET) {
+            *this = ip_addr(addr.get_in_addr());
+        } else if (addr.get_addr_family() == AF_INET6) {
+            *this = ip_addr(addr.get_in6_addr());
+        }
+    }
+
+    addr_storage to_addr_storage() const {
+        if (m_addr_family == AF_INET) {
+            return addr_storage(get_in_addr());
+        } else if (m_addr_family == AF_INET6) {
+            return addr_storage(get_in6_addr());
+        } else {
+            return addr_storage();
+        }
+    }
+
+    in_addr get_in_addr() const {
+        in_addr addr;
+        addr.s_addr = htonl(static_cast<uint32_t>(m_lo));
+        return addr;
+    }
+
+    in6_addr get_in6_addr() const {
+        in6_addr addr;
+        store_word(m_hi, addr.s6_addr);
+        store_word(m_lo, addr.s6_addr + 8);
+        return addr;
+    }
+
+    constexpr int get_addr_family() const {
+        return m_addr_family;
+    }
+
+    constexpr bool is_valid() const {
+        return m_addr_family == AF_INET || m_addr_family == AF_INET6;
+    }
+
+    //lowest and highest address of an address family
+    static constexpr ip_addr get_lowest(int addr_family) {
+        return ip_addr(addr_family, 0, 0);
+    }
+
+    static constexpr ip_addr get_highest(int addr_family) {
+        return addr_family == AF_INET ? ip_addr(AF_INET, 0, 0xffffffff) : ip_addr(addr_family, ~0ULL, ~0ULL);
+    }
+
+    //the following address, must not be called for the highest address
+    constexpr ip_addr get_next() const {
+        return ip_addr(m_addr_family, m_lo == ~0ULL ? m_hi + 1 : m_hi, m_lo + 1);
+    }
+
+    constexpr bool is_multicast_addr() const {
+        return (m_addr_family == AF_INET && (m_lo >> 28) == 0xe) || (m_addr_family == AF_INET6 && (m_hi >> 56) == 0xff);
+    }
+
+    std::string to_string() const {
+        return to_addr_storage().to_string();
+    }
+
+    constexpr std::size_t hash() const {
+        return static_cast<std::size_t>(((m_lo * 0x9e3779b97f4a7c15ULL) ^ ((m_hi + m_addr_family) * 0xc2b2ae3d27d4eb4fULL)) >> 7);
+    }
+
+    friend constexpr bool operator==(const ip_addr& l, const ip_addr& r) {
+        return (l.m_lo == r.m_lo) & (l.m_hi == r.m_hi) & (l.m_addr_family == r.m_addr_family);
+    }
+
+    friend constexpr bool operator!=(const ip_addr& l, const ip_addr& r) {
+        return !(l == r);
+    }
+
+    friend constexpr bool operator<(const ip_addr& l, const ip_addr& r) {
+        return (l.m_addr_family < r.m_addr_family) | ((l.m_addr_family == r.m_addr_family) & ((l.m_hi < r.m_hi) | ((l.m_hi == r.m_hi) & (l.m_lo < r.m_lo))));
+    }
+
+    friend constexpr bool operator>(const ip_addr& l, const ip_addr& r) {
+        return r < l;
+    }
+
+    friend constexpr bool operator<=(const ip_addr& l, const ip_addr& r) {
+        return !(r < l);
+    }
+
+    friend constexpr bool operator>=(const ip_addr& l, const ip_addr& r) {
+        return !(l < r);
+    }
+
+    friend std::ostream& operator<<(std::ostream& stream, const ip_addr& a) {
+        return stream << a.to_string();
+    }
+};
+
+namespace std
+{
+template <>
+struct hash<ip_addr> {
+    std::size_t operator()(const ip_addr& a) const {
+        return a.hash();
+    }
+};
+}
+
+#endif // IP_ADDR_HPP
@@ -25,8 +25,10 @@
 
 #include "include/utils/addr_storage.hpp"
 #include <list>
+#include <vector>
 #include <time.h>
 #include <string>
+#include <linux/filter.h>
 
 ///@author Sebastian Woelke
 ///@brief socket for multicast applications
@@ -141,6 +143,11 @@ public:
      */
     int get_addr_family() const;
 
+    /**
+     * @return Get the socket descriptor, e.g. to wait for it with poll().
+     */
+    int get_socket() const;
+
     /**
      * @brief Bind IPv4 or IPv6 socket to a specific port and address.
      * @return Return true on success.
@@ -199,6 +206,31 @@ public:
      */
     bool receive_msg(struct msghdr* msg, int& sizeOfInfo) const;
 
+    /**
+     * @brief Receive up to vlen messages with the kernel function recvmmsg() without blocking.
+     * @param[in,out] msgvec vector of prepared messages, the received size of each message is stored in msg_len
+     * @param vlen number of messages in msgvec
+     * @param[out] num_msgs number of received messages, 0 if no message is pending
+     * @return Return true on success.
+     */
+    bool receive_mmsg(struct mmsghdr* msgvec, unsigned int vlen, int& num_msgs) const;
+
+    /**
+     * @brief Send up to vlen messages with the kernel function sendmmsg().
+     * @param msgvec vector of prepared messages
+     * @param vlen number of messages in msgvec
+     * @param[out] num_msgs number of sent messages, the messages after them are not sent
+     * @return Return true on success.
+     */
+    bool send_mmsg(struct mmsghdr* msgvec, unsigned int vlen, int& num_msgs) const;
+
+    /**
+     * @brief Attach a classic BPF program to the socket (SO_ATTACH_FILTER), a previously attached program is replaced.
+     * @param prog program to attach
+     * @return Return true on success.
+     */
+    bool set_socket_filter(const std::vector<struct sock_filter>& prog) const;
+
     /**
      * @brief Set a receive timeout.
      * @param msec timeout in millisecond
@@ -0,0 +1,137 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+#ifndef MEMBERSHIP_SOCKET_POOL_HPP
+#define MEMBERSHIP_SOCKET_POOL_HPP
+
+#include "include/utils/mc_socket.hpp"
+#include "include/utils/ip_addr.hpp"
+
+#include <list>
+#include <memory>
+#include <set>
+#include <string>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+//limit of the memberships per IPv4 socket
+#define MEMBERSHIP_SOCKET_POOL_IPV4_MAX_MEMBERSHIPS_FILE "/proc/sys/net/ipv4/igmp_max_memberships"
+
+//default of net.ipv4.igmp_max_memberships
+#define MEMBERSHIP_SOCKET_POOL_IPV4_DEFAULT_CAPACITY 20
+
+//IPv6 has no such limit, the memberships and source filters are charged to the option memory (net.core.optmem_max) of the socket
+#define MEMBERSHIP_SOCKET_POOL_IPV6_DEFAULT_CAPACITY 64
+
+//the occupancy is printed per socket up to this number of sockets
+#define MEMBERSHIP_SOCKET_POOL_PRINT_LIMIT 64
+
+/**
+ * @brief Joins the groups of the upstream interfaces on a pool of UDP sockets.
+ *
+ * Linux limits the memberships of one socket (net.ipv4.igmp_max_memberships) and walks the
+ * membership list of the socket for every join and source filter change. The pool places a new
+ * membership on the socket selected by the hash of interface and group, if this socket is full on
+ * the next socket with a free slot, and opens a new socket if all sockets are full. A membership
+ * stays on its socket until it is left. A socket counts as full if it reached the capacity or if
+ * the kernel refused a join with ENOBUFS or ENOMEM, the latter until one of its memberships is left.
+ */
+class membership_socket_pool
+{
+private:
+    struct membership_key {
+        unsigned int if_index;
+        ip_addr gaddr;
+
+        bool operator==(const membership_key& k) const {
+            return if_index == k.if_index && gaddr == k.gaddr;
+        }
+    };
+
+    struct membership_key_hash {
+        std::size_t operator()(const membership_key& k) const {
+            return std::hash<ip_addr>()(k.gaddr) ^ (k.if_index * 0x9e3779b97f4a7c15ULL);
+        }
+    };
+
+    struct pool_socket {
+        std::unique_ptr<mc_socket> sock;
+        unsigned int count;
+        unsigned int capacity;
+    };
+
+    int m_addr_family;
+    unsigned int m_capacity;
+
+    std::vector<pool_socket> m_sockets;
+
+    //indexes of the sockets with free slots
+    std::set<unsigned int> m_free_sockets;
+
+    std::unordered_map<membership_key, unsigned int, membership_key_hash> m_memberships;
+
+    unsigned long m_join_count;
+    unsigned long m_leave_count;
+    unsigned long m_filter_count;
+    unsigned long m_kernel_limit_count;
+
+    static unsigned int read_ipv4_capacity();
+
+    bool add_socket();
+    void set_count(unsigned int sock_index, unsigned int count);
+
+    //returns the socket of a new membership or -1 on error
+    int join(const membership_key& key);
+
+public:
+    /**
+     * @param addr_family AF_INET or AF_INET6
+     */
+    membership_socket_pool(int addr_family);
+
+    membership_socket_pool(const membership_socket_pool&) = delete;
+    membership_socket_pool& operator=(const membership_socket_pool&) = delete;
+
+    /**
+     * @brief Join the group if necessary and set its source filter.
+     * @param filter_mode MCAST_INCLUDE or MCAST_EXCLUDE
+     * @return Return true on success.
+     */
+    bool set_source_filter(unsigned int if_index, const addr_storage& gaddr, uint32_t filter_mode, const std::list<addr_storage>& src_list);
+
+    /**
+     * @brief Leave the group, nothing happens if the group is not joined.
+     * @return Return true on success.
+     */
+    bool leave_group(unsigned int if_index, const addr_storage& gaddr);
+
+    /**
+     * @brief Return the number of joined groups.
+     */
+    unsigned int size() const;
+
+    std::string to_string() const;
+    friend std::ostream& operator<<(std::ostream& stream, const membership_socket_pool& p);
+};
+
+#endif // MEMBERSHIP_SOCKET_POOL_HPP
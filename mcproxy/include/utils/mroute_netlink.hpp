@@ -0,0 +1,167 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+#ifndef MROUTE_NETLINK_HPP
+#define MROUTE_NETLINK_HPP
+
+#include "include/utils/addr_storage.hpp"
+#include "include/utils/ip_addr.hpp"
+
+#include <list>
+#include <deque>
+#include <vector>
+#include <string>
+#include <utility>
+#include <ostream>
+#include <cstdint>
+#include <functional>
+
+//the queued route changes are sent as soon as they exceed this size
+#define MROUTE_NETLINK_BATCH_SIZE 32768
+
+//receive buffer for the acknowledgements
+#define MROUTE_NETLINK_ACK_BUF_SIZE 16384
+
+/**
+ * @brief Change of a multicast route, an added (or replaced) or a deleted route.
+ */
+struct mroute_change {
+    bool is_add;
+    addr_storage gaddr;
+    addr_storage saddr;
+};
+
+using mroute_change_list = std::list<mroute_change>;
+
+/**
+ * @brief Set and delete multicast forwarding cache entries with rtnetlink (RTM_NEWROUTE/RTM_DELROUTE
+ *        of the family RTNL_FAMILY_IPMR). The changes are queued and sent with one sendmsg() per flush(),
+ *        the kernel acknowledgements are read later without blocking.
+ *
+ * The Linux kernel supports this only for IPv4, IPv6 routes are set with the mroute_socket.
+ * The packet counters of all routes can be read with one dump for IPv4 and IPv6.
+ */
+class mroute_netlink
+{
+private:
+    struct pending_request {
+        uint32_t seq;
+        mroute_change change;
+        bool is_failed; //already added to m_failed_routes
+    };
+
+    int m_sock;
+    int m_table_number;
+    uint32_t m_seq;
+
+    std::vector<char> m_send_buf;
+    std::deque<pending_request> m_pending;
+
+    //rejected or unsent changes, they are passed to the caller of flush(mroute_change_list&)
+    mroute_change_list m_failed_routes;
+
+    unsigned long m_request_count;
+    unsigned long m_sendmsg_count;
+    unsigned long m_error_count;
+
+    void queue_request(uint16_t type, unsigned int input_if_index, const addr_storage& source_addr, const addr_storage& group_addr, const std::list<int>* output_vif);
+    void add_attr(std::size_t msg_offset, uint16_t type, const void* data, std::size_t len);
+
+    //mark all pending changes as failed, a change is added to m_failed_routes only once
+    void fail_pending();
+    void fail_request(pending_request& req);
+
+    /**
+     * @brief Read the available acknowledgements without blocking, the rejected changes are added to m_failed_routes.
+     * @return number of rejected changes
+     */
+    unsigned int collect_acks();
+
+public:
+    /**
+     * @param table_number multicast routing table of the routes, 0 is the default table
+     */
+    mroute_netlink(int table_number);
+
+    mroute_netlink(const mroute_netlink&) = delete;
+    mroute_netlink& operator=(const mroute_netlink&) = delete;
+
+    /**
+     * @brief Send the queued changes and close the netlink socket.
+     */
+    virtual ~mroute_netlink();
+
+    /**
+     * @brief Open the rtnetlink socket.
+     * @return Return true on success.
+     */
+    bool create_socket();
+
+    /**
+     * @brief Delete a route that cannot exist and check the answer of the kernel.
+     * @return Return true if the kernel supports multicast routes via netlink.
+     */
+    bool probe();
+
+    /**
+     * @brief Queue a multicast route, an existing route is replaced.
+     * @param input_if_index interface index (not virtual interface index) of the incoming traffic
+     * @param output_vif virtual interface indexes of the outgoing traffic
+     * @return Return true on success.
+     */
+    bool add_mroute(unsigned int input_if_index, const addr_storage& source_addr, const addr_storage& group_addr, const std::list<int>& output_vif);
+
+    /**
+     * @brief Queue the deletion of a multicast route.
+     * @return Return true on success.
+     */
+    bool del_mroute(const addr_storage& source_addr, const addr_storage& group_addr);
+
+    /**
+     * @brief Send all queued changes with one sendmsg().
+     * @return Return true on success.
+     */
+    bool flush();
+
+    /**
+     * @brief Send all queued changes with one sendmsg() and report the changes the kernel has not applied.
+     * @param failed_routes receives all changes rejected by the kernel or not sent, since the last call
+     *        (including the ones of implicit flushes, e.g. if the queue exceeds MROUTE_NETLINK_BATCH_SIZE).
+     *        If acknowledgements are lost, all changes of the batch are reported, also the applied ones.
+     *        The deletion of a route that does not exist is not reported.
+     * @return Return true on success.
+     */
+    bool flush(mroute_change_list& failed_routes);
+
+    /**
+     * @brief Read the packet counters of all multicast routes of the routing table with one RTM_GETROUTE dump.
+     * @param addr_family AF_INET or AF_INET6
+     * @param stats_fun is called for every route with group address, source address and packet count
+     * @return Return true on success.
+     */
+    bool dump_mroute_stats(int addr_family, const std::function<void(const ip_addr&, const ip_addr&, uint64_t)>& stats_fun);
+
+    std::string to_string() const;
+    friend std::ostream& operator<<(std::ostream& stream, const mroute_netlink& m);
+};
+
+#endif // MROUTE_NETLINK_HPP
@@ -144,6 +144,12 @@ public:
      */
     bool set_ipv6_recv_pkt_info() const;
 
+    /**
+     * @brief Set to pass the receive packet information (IP_PKTINFO) to userpace.
+     * @return Return true on success
+     */
+    bool set_ipv4_recv_pkt_info() const;
+
     /**
      * @brief Enable or disable MRT flag to manipulate the multicast routing tables.
      *        - sysctl net.ipv4.conf.all.mc_forwarding will be set/reset
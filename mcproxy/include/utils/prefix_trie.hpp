@@ -0,0 +1,86 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+#ifndef PREFIX_TRIE_HPP
+#define PREFIX_TRIE_HPP
+
+#include "include/utils/addr_storage.hpp"
+
+#include <memory>
+
+#define PREFIX_TRIE_NO_VALUE 0
+
+/**
+ * @brief Binary trie of IPv4 or IPv6 prefixes for the longest prefix match.
+ *        A lookup walks at most one node per address bit, independent of the number of prefixes.
+ */
+class prefix_trie
+{
+private:
+    struct node {
+        node(): m_value(PREFIX_TRIE_NO_VALUE) {}
+
+        std::unique_ptr<node> m_child[2];
+        unsigned int m_value;
+    };
+
+    int m_addr_family;
+    std::unique_ptr<node> m_root;
+
+    unsigned int get_max_prefix_len() const;
+
+    //returns bit i of the address, bit 0 is the most significant bit
+    static bool get_bit(const unsigned char* addr, unsigned int i);
+    const unsigned char* get_bytes(const addr_storage& addr) const;
+
+public:
+    /**
+     * @param addr_family address family of the stored prefixes (AF_INET or AF_INET6)
+     */
+    prefix_trie(int addr_family);
+
+    /**
+     * @brief Store a value for a prefix, an existing value of the same prefix is kept.
+     * @param prefix address of the prefix, the bits behind prefix_len are ignored
+     * @param prefix_len length of the prefix in bits
+     * @param value value of the prefix, must not be PREFIX_TRIE_NO_VALUE
+     * @return false if the prefix is invalid or already stored
+     */
+    bool insert(const addr_storage& prefix, unsigned int prefix_len, unsigned int value);
+
+    /**
+     * @brief Return the value of the longest prefix matching the address or PREFIX_TRIE_NO_VALUE.
+     */
+    unsigned int lookup(const addr_storage& addr) const;
+
+    /**
+     * @brief Remove all prefixes.
+     */
+    void clear();
+
+    /**
+     * @brief Return the prefix length of a netmask (number of leading one bits).
+     */
+    static unsigned int get_prefix_len(const addr_storage& netmask);
+};
+
+#endif // PREFIX_TRIE_HPP
@@ -51,10 +51,14 @@ SOURCES += src/main.cpp \
            src/hamcast_logging.cpp \
                #utils
            src/utils/mc_socket.cpp \
+           src/utils/membership_socket_pool.cpp \
            src/utils/addr_storage.cpp \
            src/utils/mroute_socket.cpp \
+           src/utils/mroute_netlink.cpp \
            src/utils/if_prop.cpp \
+           src/utils/if_registry.cpp \
            src/utils/reverse_path_filter.cpp \
+           src/utils/prefix_trie.cpp \
                #proxy
            src/proxy/proxy.cpp \
            src/proxy/sender.cpp \
@@ -63,6 +67,7 @@ SOURCES += src/main.cpp \
            src/proxy/igmp_receiver.cpp \
            src/proxy/mld_sender.cpp \
            src/proxy/igmp_sender.cpp \
+           src/proxy/host_reporter.cpp \
            src/proxy/proxy_instance.cpp \
            src/proxy/routing.cpp \
            src/proxy/worker.cpp \
@@ -81,15 +86,22 @@ SOURCES += src/main.cpp \
            src/parser/token.cpp \
            src/parser/configuration.cpp \
            src/parser/parser.cpp \
-           src/parser/interface.cpp
+           src/parser/interface.cpp \
+           src/parser/compiled_table.cpp
 
 HEADERS += include/hamcast_logging.h \
                 #utils
            include/utils/mc_socket.hpp \
+           include/utils/membership_socket_pool.hpp \
            include/utils/addr_storage.hpp \
            include/utils/reverse_path_filter.hpp \
            include/utils/mroute_socket.hpp \
+           include/utils/mroute_netlink.hpp \
            include/utils/if_prop.hpp \
+           include/utils/if_registry.hpp \
+           include/utils/prefix_trie.hpp \
+           include/utils/ip_addr.hpp \
+           include/utils/benchmark.hpp \
            include/utils/extended_mld_defines.hpp \
            include/utils/extended_igmp_defines.hpp \
                #proxy
@@ -100,6 +112,7 @@ HEADERS += include/hamcast_logging.h \
            include/proxy/igmp_receiver.hpp \
            include/proxy/mld_sender.hpp \
            include/proxy/igmp_sender.hpp \
+           include/proxy/host_reporter.hpp \
            include/proxy/proxy_instance.hpp \
            include/proxy/message_queue.hpp \
            include/proxy/message_format.hpp \
@@ -109,7 +122,9 @@ HEADERS += include/hamcast_logging.h \
            include/proxy/check_if.hpp \
            include/proxy/check_kernel.hpp \
            include/proxy/membership_db.hpp \
+           include/proxy/group_table.hpp \
            include/proxy/def.hpp \
+           include/proxy/source_list.hpp \
            include/proxy/querier.hpp \
            include/proxy/timers_values.hpp \
            include/proxy/interfaces.hpp \
@@ -121,7 +136,8 @@ HEADERS += include/hamcast_logging.h \
            include/parser/token.hpp \
            include/parser/configuration.hpp \
            include/parser/parser.hpp \
-           include/parser/interface.hpp
+           include/parser/interface.hpp \
+           include/parser/compiled_table.hpp
 
 LIBS += -L/usr/lib -lpthread 
 
@@ -84,16 +84,24 @@ void test_test()
     //mc_socket::test_all();
     //addr_storage::test_addr_storage_a();
     //addr_storage::test_addr_storage_b();
+    //addr_storage::test_ip_addr();
     //membership_db::test_arithmetic();
+    //membership_db::test_source_list();
+    //membership_db::test_group_table();
     //timers_values::test_timers_values();
     //timers_values::test_timers_values_copy();
     //timing::test_timing();
+    //timing::test_timing_wheel();
     //worker::test_worker();
+    //worker::test_job_queue();
     //proxy_instance::test_querier("lo");
+    //proxy_instance::test_event_loop_latency("dummy0", "dummy1");
     //simple_routing_data::test_simple_routing_data();
+    //interface_memberships::test_upstream_in_mutex();
     //igmp_sender::test_igmp_sender();
     //mroute_socket::quick_test();
     //configuration::test_configuration();
+    //compiled_table::test_compiled_table();
     //if_prop::test_if_prop();
 }
 #endif /* DEBUG_MODE */
@@ -0,0 +1,320 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+#include "include/hamcast_logging.h"
+#include "include/parser/compiled_table.hpp"
+#include "include/parser/interface.hpp"
+
+#include <algorithm>
+#include <sstream>
+
+#ifdef DEBUG_MODE
+#include "include/utils/benchmark.hpp"
+
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#endif /* DEBUG_MODE */
+
+compiled_table::rule_set::rule_set(int addr_family, const std::vector<rule_interval>& rules)
+{
+    HC_LOG_TRACE("");
+
+    if (rules.empty()) {
+        return;
+    }
+
+    const ip_addr highest = ip_addr::get_highest(addr_family);
+
+    //borders of the elementary group intervals
+    std::vector<ip_addr> starts;
+    for (auto & r : rules) {
+        starts.push_back(r.group.from);
+        if (r.group.to != highest) {
+            starts.push_back(r.group.to.get_next());
+        }
+    }
+    std::sort(starts.begin(), starts.end());
+    starts.erase(std::unique(starts.begin(), starts.end()), starts.end());
+
+    std::vector<addr_interval> sources;
+    for (auto & start : starts) {
+        sources.clear();
+        for (auto & r : rules) {
+            if (r.group.from <= start && start <= r.group.to) {
+                sources.push_back(r.source);
+            }
+        }
+
+        std::sort(sources.begin(), sources.end(), [](const addr_interval & l, const addr_interval & r) {
+            return l.from < r.from;
+        });
+
+        //merge overlapping source intervals
+        std::vector<addr_interval> merged;
+        for (auto & s : sources) {
+            if (!merged.empty() && s.from <= merged.back().to) {
+                merged.back().to = std::max(merged.back().to, s.to);
+            } else {
+                merged.push_back(s);
+            }
+        }
+
+        //an elementary interval with the same sources as its predecessor extends the predecessor
+        if (!m_group_starts.empty() && m_sources.size() - m_source_offsets.back() == merged.size()) {
+            bool is_equal = true;
+            for (std::size_t i = 0; i < merged.size(); ++i) {
+                const addr_interval& prev = m_sources[m_source_offsets.back() + i];
+                if (prev.from != merged[i].from || prev.to != merged[i].to) {
+                    is_equal = false;
+                    break;
+                }
+            }
+
+            if (is_equal) {
+                continue;
+            }
+        }
+
+        m_group_starts.push_back(start);
+        m_source_offsets.push_back(static_cast<uint32_t>(m_sources.size()));
+        m_sources.insert(m_sources.end(), merged.begin(), merged.end());
+    }
+
+    m_source_offsets.push_back(static_cast<uint32_t>(m_sources.size()));
+}
+
+bool compiled_table::rule_set::match(const ip_addr& gaddr, const ip_addr& saddr) const
+{
+    auto group_it = std::upper_bound(m_group_starts.begin(), m_group_starts.end(), gaddr);
+    if (group_it == m_group_starts.begin()) {
+        return false;
+    }
+
+    std::size_t i = (group_it - m_group_starts.begin()) - 1;
+    auto first = m_sources.begin() + m_source_offsets[i];
+    auto last = m_sources.begin() + m_source_offsets[i + 1];
+
+    auto source_it = std::upper_bound(first, last, saddr, [](const ip_addr & addr, const addr_interval & interval) {
+        return addr < interval.from;
+    });
+
+    return source_it != first && saddr <= (source_it - 1)->to;
+}
+
+std::size_t compiled_table::rule_set::get_interval_count() const
+{
+    return m_group_starts.size();
+}
+
+compiled_table::compiled_table(const table& t)
+    : m_rule_count(0)
+{
+    HC_LOG_TRACE("");
+
+    init_family_rules(AF_INET, t, m_ipv4);
+    init_family_rules(AF_INET6, t, m_ipv6);
+}
+
+void compiled_table::init_family_rules(int addr_family, const table& t, family_rules& fr)
+{
+    HC_LOG_TRACE("");
+
+    std::vector<const rule_addr*> rules;
+    t.collect_rules(rules);
+    m_rule_count = rules.size();
+
+    std::vector<rule_interval> any_interface;
+    std::vector<std::vector<rule_interval>> interfaces;
+
+    for (auto r : rules) {
+        rule_interval ri;
+        if (!r->get_group().get_interval(addr_family, ri.group.from, ri.group.to) || !r->get_source().get_interval(addr_family, ri.source.from, ri.source.to)) {
+            continue;
+        }
+
+        if (r->get_if_name().empty()) {
+            any_interface.push_back(ri);
+        } else {
+            auto id_it = m_interface_ids.insert(std::make_pair(r->get_if_name(), static_cast<unsigned int>(m_interface_ids.size()))).first;
+            if (interfaces.size() <= id_it->second) {
+                interfaces.resize(id_it->second + 1);
+            }
+            interfaces[id_it->second].push_back(ri);
+        }
+    }
+
+    fr.any_interface = rule_set(addr_family, any_interface);
+    for (auto & e : interfaces) {
+        fr.interfaces.push_back(rule_set(addr_family, e));
+    }
+}
+
+bool compiled_table::match(const std::string& if_name, const ip_addr& gaddr, const ip_addr& saddr) const
+{
+    const family_rules& fr = gaddr.get_addr_family() == AF_INET ? m_ipv4 : m_ipv6;
+
+    if (fr.any_interface.match(gaddr, saddr)) {
+        return true;
+    }
+
+    if (!fr.interfaces.empty()) {
+        auto id_it = m_interface_ids.find(if_name);
+        if (id_it != m_interface_ids.end() && id_it->second < fr.interfaces.size()) {
+            return fr.interfaces[id_it->second].match(gaddr, saddr);
+        }
+    }
+
+    return false;
+}
+
+std::string compiled_table::to_string() const
+{
+    HC_LOG_TRACE("");
+    std::ostringstream s;
+
+    std::size_t ipv4_intervals = m_ipv4.any_interface.get_interval_count();
+    for (auto & e : m_ipv4.interfaces) {
+        ipv4_intervals += e.get_interval_count();
+    }
+
+    std::size_t ipv6_intervals = m_ipv6.any_interface.get_interval_count();
+    for (auto & e : m_ipv6.interfaces) {
+        ipv6_intervals += e.get_interval_count();
+    }
+
+    s << "rules: " << m_rule_count << " interfaces: " << m_interface_ids.size() << " group intervals (IPv4/IPv6): " << ipv4_intervals << "/" << ipv6_intervals;
+    return s.str();
+}
+
+#ifdef DEBUG_MODE
+void compiled_table::test_compiled_table()
+{
+    using namespace std;
+    HC_LOG_TRACE("");
+    cout << "##-- test compiled table --##" << endl;
+
+    log_silencer silencer;
+
+    std::default_random_engine random_engine(42);
+    auto random = [&](unsigned int n) {
+        return static_cast<unsigned int>(random_engine() % n);
+    };
+
+    const vector<string> if_names {"", "eth0", "eth1"};
+    const vector<string> query_if_names {"eth0", "eth1", "eth2"};
+    const vector<string> table_names {"t0", "t1", "t2", "missing"};
+
+    //a few addresses per family so that rules and queries overlap, including the borders of the address space
+    auto get_addr = [&](int addr_family, unsigned int n) {
+        ostringstream s;
+        if (addr_family == AF_INET) {
+            s << (n == 0 ? "0.0.0.0" : n == 1 ? "255.255.255.255" : "10.0.0.") << (n < 2 ? "" : std::to_string(n));
+        } else {
+            s << (n == 0 ? "::" : n == 1 ? "ffff:ffff:ffff:ffff:ffff:ffff:ffff:ffff" : "2001:db8::") << (n < 2 ? "" : std::to_string(n));
+        }
+        return addr_storage(s.str());
+    };
+
+    const unsigned int addr_pool = 12;
+    auto get_random_addr = [&](int addr_family) {
+        //the wildcard (0.0.0.0 or ::) is drawn more often than the other addresses
+        return get_addr(addr_family, random(4) == 0 ? 0 : random(addr_pool));
+    };
+
+    //single addresses, wildcards, ranges in any order and ranges with borders of different families
+    auto get_addr_match = [&](int addr_family) {
+        unique_ptr<addr_match> result;
+        if (random(2) == 0) {
+            result.reset(new single_addr(get_random_addr(addr_family)));
+        } else {
+            int from_family = random(5) == 0 ? (addr_family == AF_INET ? AF_INET6 : AF_INET) : addr_family;
+            int to_family = random(5) == 0 ? (addr_family == AF_INET ? AF_INET6 : AF_INET) : addr_family;
+            result.reset(new addr_range(get_random_addr(from_family), get_random_addr(to_family)));
+        }
+        return result;
+    };
+
+    auto gts = make_shared<global_table_set>();
+
+    function<unique_ptr<table>(const string&, unsigned int, unsigned int)> get_table;
+    get_table = [&](const string & name, unsigned int depth, unsigned int referable_tables) {
+        list<unique_ptr<rule_box>> rule_box_list;
+        unsigned int size = 1 + random(5);
+        for (unsigned int i = 0; i < size; ++i) {
+            unsigned int kind = random(10);
+            if (kind < 2 && depth < 3) {
+                rule_box_list.push_back(unique_ptr<rule_box>(new rule_table(get_table("", depth + 1, referable_tables))));
+            } else if (kind < 4) {
+                //a reference to an earlier global table or to a table that does not exist
+                unsigned int n = random(referable_tables + 1);
+                const string& ref_name = n < referable_tables ? table_names[n] : table_names.back();
+                rule_box_list.push_back(unique_ptr<rule_box>(new rule_table_ref(ref_name, gts)));
+            } else {
+                int addr_family = random(2) == 0 ? AF_INET : AF_INET6;
+                rule_box_list.push_back(unique_ptr<rule_box>(new rule_addr(if_names[random(if_names.size())], get_addr_match(addr_family), get_addr_match(addr_family))));
+            }
+        }
+        return unique_ptr<table>(new table(name, move(rule_box_list)));
+    };
+
+    //the global tables may refer to the global tables defined before them
+    for (unsigned int i = 0; i < table_names.size() - 1; ++i) {
+        gts->insert(get_table(table_names[i], 0, i));
+    }
+
+    const unsigned int num_of_tables = 2000;
+    const unsigned int num_of_queries = 300;
+    unsigned long matches = 0;
+    unsigned long failed = 0;
+
+    for (unsigned int t = 0; t < num_of_tables; ++t) {
+        auto tab = get_table("test", 0, table_names.size() - 1);
+        compiled_table ct(*tab);
+
+        for (unsigned int q = 0; q < num_of_queries; ++q) {
+            int addr_family = random(2) == 0 ? AF_INET : AF_INET6;
+            const string& if_name = query_if_names[random(query_if_names.size())];
+            addr_storage gaddr = get_addr(addr_family, random(addr_pool + 4));
+            addr_storage saddr = get_addr(addr_family, random(addr_pool + 4));
+
+            bool expected = tab->match(if_name, gaddr, saddr);
+            if (expected) {
+                ++matches;
+            }
+
+            if (ct.match(if_name, ip_addr(gaddr), ip_addr(saddr)) != expected) {
+                if (failed == 0) {
+                    cout << "first difference: " << if_name << "(" << gaddr << " | " << saddr << ") table::match(): " << expected << endl;
+                    cout << tab->to_string() << endl;
+                }
+                ++failed;
+            }
+        }
+    }
+
+    cout << num_of_tables << " tables, " << num_of_tables * num_of_queries << " queries, " << matches << " matches, " << failed << " differences" << endl;
+
+    cout << "finished" << endl;
+}
+#endif /* DEBUG_MODE */
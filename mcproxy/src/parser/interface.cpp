@@ -24,6 +24,7 @@
 #include "include/parser/interface.hpp"
 #include "include/proxy/def.hpp"
 #include "include/proxy/interfaces.hpp"
+#include "include/proxy/timers_values.hpp"
 
 #include <sstream>
 
@@ -44,6 +45,22 @@ bool single_addr::match(const addr_storage& addr) const
     return addr == m_addr || is_wildcard(m_addr, addr.get_addr_family());
 }
 
+bool single_addr::get_interval(int addr_family, ip_addr& from, ip_addr& to) const
+{
+    if (m_addr.get_addr_family() != addr_family) {
+        return false;
+    }
+
+    if (is_wildcard(m_addr, addr_family)) {
+        from = ip_addr::get_lowest(addr_family);
+        to = ip_addr::get_highest(addr_family);
+    } else {
+        from = ip_addr(m_addr);
+        to = ip_addr(m_addr);
+    }
+    return true;
+}
+
 std::string single_addr::to_string() const
 {
     return m_addr.to_string();
@@ -61,6 +78,19 @@ bool addr_range::match(const addr_storage& addr) const
     return (addr >= m_from || is_wildcard(m_from, addr.get_addr_family())) && (addr <= m_to || is_wildcard(m_to, addr.get_addr_family()) );
 }
 
+bool addr_range::get_interval(int addr_family, ip_addr& from, ip_addr& to) const
+{
+    //an address of another family is never lower or equal to m_to,
+    //but it is never lower than m_from (see addr_storage comparison)
+    if (m_to.get_addr_family() != addr_family) {
+        return false;
+    }
+
+    from = m_from.get_addr_family() == addr_family ? ip_addr(m_from) : ip_addr::get_lowest(addr_family);
+    to = is_wildcard(m_to, addr_family) ? ip_addr::get_highest(addr_family) : ip_addr(m_to);
+    return from <= to;
+}
+
 std::string addr_range::to_string() const
 {
     std::ostringstream s;
@@ -85,6 +115,26 @@ bool rule_addr::match(const std::string& if_name, const addr_storage& gaddr, con
     }
 }
 
+void rule_addr::collect_rules(std::vector<const rule_addr*>& rules) const
+{
+    rules.push_back(this);
+}
+
+const std::string& rule_addr::get_if_name() const
+{
+    return m_if_name;
+}
+
+const addr_match& rule_addr::get_group() const
+{
+    return *m_group;
+}
+
+const addr_match& rule_addr::get_source() const
+{
+    return *m_source;
+}
+
 std::string rule_addr::to_string() const
 {
     std::ostringstream s;
@@ -121,6 +171,13 @@ bool table::match(const std::string& if_name, const addr_storage& gaddr, const a
     return false;
 }
 
+void table::collect_rules(std::vector<const rule_addr*>& rules) const
+{
+    for (auto & e : m_rule_box_list) {
+        e->collect_rules(rules);
+    }
+}
+
 std::string table::to_string() const
 {
     std::ostringstream s;
@@ -187,6 +244,11 @@ bool rule_table::match(const std::string& if_name, const addr_storage& gaddr, co
     return m_table->match(if_name, gaddr, saddr);
 }
 
+void rule_table::collect_rules(std::vector<const rule_addr*>& rules) const
+{
+    m_table->collect_rules(rules);
+}
+
 std::string rule_table::to_string() const
 {
     return m_table->to_string();
@@ -209,6 +271,14 @@ bool rule_table_ref::match(const std::string& if_name, const addr_storage& gaddr
     }
 }
 
+void rule_table_ref::collect_rules(std::vector<const rule_addr*>& rules) const
+{
+    auto t = m_global_table_set->get_table(m_table_name);
+    if (t != nullptr) {
+        t->collect_rules(rules);
+    }
+}
+
 std::string rule_table_ref::to_string() const
 {
     std::ostringstream s;
@@ -224,6 +294,7 @@ rule_binding::rule_binding(const std::string& instance_name, rb_interface_type i
     , m_filter_direction(filter_direction)
     , m_filter_type(filter_type)
     , m_table(std::move(filter_table))
+    , m_compiled_table(m_table != nullptr ? new compiled_table(*m_table) : nullptr)
     , m_rule_matching_type(RMT_UNDEFINED)
     , m_timeout(std::chrono::milliseconds(0))
 {
@@ -238,6 +309,7 @@ rule_binding::rule_binding(const std::string& instance_name, rb_interface_type i
     , m_filter_direction(filter_direction)
     , m_filter_type(FT_UNDEFINED)
     , m_table(nullptr)
+    , m_compiled_table(nullptr)
     , m_rule_matching_type(rule_matching_type)
     , m_timeout(timeout)
 {
@@ -302,16 +374,47 @@ bool rule_binding::match(const std::string& if_name, const addr_storage& saddr,
 {
     HC_LOG_TRACE("");
     if (m_table != nullptr) {
-        if (m_filter_type == FT_BLACKLIST) {
-            return !m_table->match(if_name, saddr, gaddr);
-        } else if (m_filter_type == FT_WHITELIST) {
-            return m_table->match(if_name, saddr, gaddr);
+        ip_addr first_addr(saddr);
+        ip_addr second_addr(gaddr);
+
+        //the compiled table knows only addresses of the same family
+        if (first_addr.is_valid() && first_addr.get_addr_family() == second_addr.get_addr_family()) {
+            return match_filter_type(m_compiled_table->match(if_name, first_addr, second_addr));
+        } else {
+            return match_filter_type(m_table->match(if_name, saddr, gaddr));
+        }
+    }
+
+    return false;
+}
+
+bool rule_binding::match(const std::string& if_name, const ip_addr& saddr, const ip_addr& gaddr) const
+{
+    HC_LOG_TRACE("");
+    if (m_table != nullptr) {
+
+        //the compiled table knows only addresses of the same family
+        if (saddr.is_valid() && saddr.get_addr_family() == gaddr.get_addr_family()) {
+            return match_filter_type(m_compiled_table->match(if_name, saddr, gaddr));
+        } else {
+            return match_filter_type(m_table->match(if_name, saddr.to_addr_storage(), gaddr.to_addr_storage()));
         }
     }
 
     return false;
 }
 
+bool rule_binding::match_filter_type(bool table_match) const
+{
+    if (m_filter_type == FT_BLACKLIST) {
+        return !table_match;
+    } else if (m_filter_type == FT_WHITELIST) {
+        return table_match;
+    }
+
+    return false;
+}
+
 std::string rule_binding::to_string() const
 {
     HC_LOG_TRACE("");
@@ -432,6 +535,18 @@ bool interface::match_input_filter(const std::string& input_if_name, const addr_
     return match_filter(input_if_name, saddr, gaddr, m_input_filter);
 }
 
+bool interface::match_output_filter(const std::string& input_if_name, const ip_addr& saddr, const ip_addr& gaddr) const
+{
+    HC_LOG_TRACE("");
+    return match_filter(input_if_name, saddr, gaddr, m_output_filter);
+}
+
+bool interface::match_input_filter(const std::string& input_if_name, const ip_addr& saddr, const ip_addr& gaddr) const
+{
+    HC_LOG_TRACE("");
+    return match_filter(input_if_name, saddr, gaddr, m_input_filter);
+}
+
 std::string interface::to_string_rule_binding() const
 {
     HC_LOG_TRACE("");
@@ -467,6 +582,15 @@ bool interface::match_filter(const std::string& input_if_name, const addr_storag
     }
 }
 
+bool interface::match_filter(const std::string& input_if_name, const ip_addr& saddr, const ip_addr& gaddr, const std::unique_ptr<rule_binding>& filter) const
+{
+    if (filter != nullptr) {
+        return filter->match(input_if_name, saddr, gaddr);
+    } else {
+        return true; //default behaviour
+    }
+}
+
 bool operator<(const interface& i1, const interface& i2)
 {
     return i1.m_if_name.compare(i2.m_if_name) < 0;
@@ -485,6 +609,9 @@ instance_definition::instance_definition(const std::string& instance_name)
     : m_instance_name(instance_name)
     , m_table_number(0)
     , m_user_selected_table_number(false)
+    , m_source_life_time(INSTANCE_DEFINITION_DEFAULT_SOURCE_LIFE_TIME)
+    , m_upstream_report_interval(timers_values().get_unsolicited_report_interval())
+    , m_host_reports(false)
 {
     HC_LOG_TRACE("");
 }
@@ -493,6 +620,9 @@ instance_definition::instance_definition(const std::string& instance_name, std::
     : m_instance_name(instance_name)
     , m_table_number(table_number)
     , m_user_selected_table_number(user_selected_table_number)
+    , m_source_life_time(INSTANCE_DEFINITION_DEFAULT_SOURCE_LIFE_TIME)
+    , m_upstream_report_interval(timers_values().get_unsolicited_report_interval())
+    , m_host_reports(false)
     , m_upstreams(std::move(upstreams))
     , m_downstreams(std::move(downstreams))
 {
@@ -535,6 +665,24 @@ bool instance_definition::get_user_selected_table_number() const
     return m_user_selected_table_number;
 }
 
+const std::chrono::milliseconds& instance_definition::get_source_life_time() const
+{
+    HC_LOG_TRACE("");
+    return m_source_life_time;
+}
+
+const std::chrono::milliseconds& instance_definition::get_upstream_report_interval() const
+{
+    HC_LOG_TRACE("");
+    return m_upstream_report_interval;
+}
+
+bool instance_definition::get_host_reports() const
+{
+    HC_LOG_TRACE("");
+    return m_host_reports;
+}
+
 bool operator<(const instance_definition& i1, const instance_definition& i2)
 {
     return i1.m_instance_name.compare(i2.m_instance_name) < 0;
@@ -552,6 +700,15 @@ std::string instance_definition::to_string_instance() const
     for (auto & e : m_downstreams) {
         s << e->to_string_interface() << " ";
     }
+    if (m_source_life_time != std::chrono::milliseconds(INSTANCE_DEFINITION_DEFAULT_SOURCE_LIFE_TIME)) {
+        s << "(source life time: " << m_source_life_time.count() << "msec)";
+    }
+    if (m_upstream_report_interval != timers_values().get_unsolicited_report_interval()) {
+        s << "(upstream report interval: " << m_upstream_report_interval.count() << "msec)";
+    }
+    if (m_host_reports) {
+        s << "(host reports)";
+    }
     return s.str();
 }
 
@@ -46,8 +46,10 @@ parser_type parser::get_parser_type()
             return PT_INSTANCE_DEFINITION;
         } else if (cmp_token.get_type() == TT_UPSTREAM || cmp_token.get_type() == TT_DOWNSTREAM) {
             return PT_INTERFACE_RULE_BINDING;
+        } else if (cmp_token.get_type() == TT_SOURCE_LIFE_TIME || cmp_token.get_type() == TT_UPSTREAM_REPORT_INTERVAL || cmp_token.get_type() == TT_HOST_REPORTS) {
+            return PT_INSTANCE_SETTING;
         } else {
-            HC_LOG_ERROR("failed to parse line " << m_current_line << " unknown token " << get_token_type_name(cmp_token.get_type()) << " with value " << cmp_token.get_string() << ", expected \":\" or \"upstream\" or \"downstream\"");
+            HC_LOG_ERROR("failed to parse line " << m_current_line << " unknown token " << get_token_type_name(cmp_token.get_type()) << " with value " << cmp_token.get_string() << ", expected \":\" or \"upstream\" or \"downstream\" or \"sourcelifetime\" or \"upstreamreportinterval\" or \"hostreports\"");
             throw "failed to parse config file";
         }
     } else if(m_current_token.get_type() == TT_DISABLE) {
@@ -446,6 +448,80 @@ void parser::parse_interface_rule_binding(const std::shared_ptr<const global_tab
     throw "this code should never reached";
 }
 
+void parser::parse_instance_setting(const inst_def_set& ids)
+{
+    HC_LOG_TRACE("");
+
+    //pinstance myProxy sourcelifetime 30000;
+    //pinstance myProxy upstreamreportinterval 500;
+    //pinstance myProxy hostreports;
+    auto error_notification = [&]() {
+        HC_LOG_ERROR("failed to parse line " << m_current_line << " unknown token " << get_token_type_name(m_current_token.get_type()) << " with value " << m_current_token.get_string() << " in this context");
+        throw "failed to parse config file";
+    };
+
+    if (get_parser_type() != PT_INSTANCE_SETTING) {
+        error_notification();
+    }
+
+    get_next_token();
+    auto instance_it = ids.find(m_current_token.get_string());
+    if (m_current_token.get_type() != TT_STRING || instance_it == ids.end()) {
+        HC_LOG_ERROR("failed to parse line " << m_current_line << " proxy instance " << m_current_token.get_string() << " not defined");
+        throw "failed to parse config file";
+    }
+
+    get_next_token();
+    if (m_current_token.get_type() == TT_SOURCE_LIFE_TIME) {
+        get_next_token();
+        if (m_current_token.get_type() == TT_STRING) {
+            int tmp_life_time = 0;
+            try {
+                tmp_life_time = std::stoi(m_current_token.get_string());
+            } catch (...) {
+                error_notification();
+            }
+
+            if (tmp_life_time <= 0) {
+                HC_LOG_ERROR("failed to parse line " << m_current_line << " source life time must be greater than zero");
+                throw "failed to parse config file";
+            }
+
+            (*instance_it)->m_source_life_time = std::chrono::milliseconds(tmp_life_time);
+        } else {
+            error_notification();
+        }
+    } else if (m_current_token.get_type() == TT_UPSTREAM_REPORT_INTERVAL) {
+        get_next_token();
+        if (m_current_token.get_type() == TT_STRING) {
+            int tmp_interval = -1;
+            try {
+                tmp_interval = std::stoi(m_current_token.get_string());
+            } catch (...) {
+                error_notification();
+            }
+
+            if (tmp_interval < 0) {
+                HC_LOG_ERROR("failed to parse line " << m_current_line << " upstream report interval must not be negative");
+                throw "failed to parse config file";
+            }
+
+            (*instance_it)->m_upstream_report_interval = std::chrono::milliseconds(tmp_interval);
+        } else {
+            error_notification();
+        }
+    } else if (m_current_token.get_type() == TT_HOST_REPORTS) {
+        (*instance_it)->m_host_reports = true;
+    } else {
+        error_notification();
+    }
+
+    get_next_token();
+    if (m_current_token.get_type() != TT_NIL) {
+        error_notification();
+    }
+}
+
 void parser::parse_interface_table_binding(
     std::string && instance_name
     , rb_interface_type interface_type
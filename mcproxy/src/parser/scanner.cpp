@@ -190,6 +190,12 @@ token scanner::read_next_token()
                 return TT_MUTEX;
             } else if (cmp_str.compare("disable") == 0) {
                 return TT_DISABLE;
+            } else if (cmp_str.compare("sourcelifetime") == 0) {
+                return TT_SOURCE_LIFE_TIME;
+            } else if (cmp_str.compare("upstreamreportinterval") == 0) {
+                return TT_UPSTREAM_REPORT_INTERVAL;
+            } else if (cmp_str.compare("hostreports") == 0) {
+                return TT_HOST_REPORTS;
             } else {
                 return token(TT_STRING, s.str());
             }
@@ -51,6 +51,9 @@ std::string get_token_type_name(token_type tt)
         {TT_ALL, "TT_ALL"},
         {TT_FIRST, "TT_FIRST"},
         {TT_MUTEX, "TT_MUTEX"},
+        {TT_SOURCE_LIFE_TIME, "TT_SOURCE_LIFE_TIME"},
+        {TT_UPSTREAM_REPORT_INTERVAL, "TT_UPSTREAM_REPORT_INTERVAL"},
+        {TT_HOST_REPORTS, "TT_HOST_REPORTS"},
         //{TT_MILLISECONDS, "TT_MILLISECONDS"},
         //{TT_TABLE_NAME, "TT_TABLE_NAME"},
         //{TT_PATH, "TT_PATH"},
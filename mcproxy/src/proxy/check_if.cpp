@@ -23,6 +23,7 @@
 
 #include "include/hamcast_logging.h"
 #include "include/proxy/check_if.hpp"
+#include "include/utils/if_registry.hpp"
 #include <net/if.h>
 #include <unistd.h>
 #include <iostream>
@@ -32,6 +33,18 @@ check_if::check_if()
     HC_LOG_TRACE("");
 }
 
+bool check_if::is_running(int if_index) const
+{
+    HC_LOG_TRACE("");
+
+    if_registry_entry e;
+    if (!if_registry::get_instance().get_entry(if_index, e) || e.get_addrs(m_addr_family).empty()) {
+        return false;
+    }
+
+    return e.flags & IFF_RUNNING;
+}
+
 std::vector<int> check_if::init(std::vector<int>& check_lst, int addr_family)
 {
     HC_LOG_TRACE("");
@@ -40,25 +53,17 @@ std::vector<int> check_if::init(std::vector<int>& check_lst, int addr_family)
     this->m_addr_family = addr_family;
 
     std::vector<int> result;
-    m_if_property_a.refresh_network_interfaces();
-    m_current_prop = &m_if_property_a;
+    if (m_addr_family != AF_INET && m_addr_family != AF_INET6) {
+        HC_LOG_ERROR("wrong address family: " << addr_family);
+        return result;
+    }
 
+    m_running.clear();
     for (std::vector<int>::iterator i = m_check_lst.begin(); i != m_check_lst.end(); i++) {
-        char cstr[IF_NAMESIZE];
-        std::string if_name(if_indextoname(*i, cstr)); //fehler wenn null?????????????????????
-
-        const struct ifaddrs* prop;
-        if (m_addr_family == AF_INET) {
-            prop = m_current_prop->get_ip4_if(if_name);
-        } else if (m_addr_family == AF_INET6) {
-            const std::list<const struct ifaddrs*>* ipv6_if_list = m_current_prop->get_ip6_if(if_name);
-            prop = *(ipv6_if_list->begin());
-        } else {
-            HC_LOG_ERROR("wrong address family: " << addr_family);
-            return result;
-        }
+        bool running = is_running(*i);
+        m_running[*i] = running;
 
-        if (!(prop->ifa_flags & IFF_RUNNING)) { //down
+        if (!running) { //down
             result.push_back(*i);
         }
     }
@@ -73,43 +78,18 @@ bool check_if::check()
     m_swap_to_up.clear();
     m_swap_to_down.clear();
 
-    if_prop* if_property_old = m_current_prop;
-
-    if (m_current_prop == &m_if_property_a) {
-        m_current_prop = &m_if_property_b;
-    } else if (m_current_prop == &m_if_property_b) {
-        m_current_prop = &m_if_property_a;
-    } else {
-        HC_LOG_ERROR("unknown pointer");
-        return false;
-    }
-
-    m_current_prop->refresh_network_interfaces();
-
+    //the registry is kept up to date by rtnetlink events, no refresh is needed
     for (std::vector<int>::iterator i = m_check_lst.begin(); i != m_check_lst.end(); i++) {
-        char cstr[IF_NAMESIZE];
-        std::string if_name(if_indextoname(*i, cstr)); //fehler wenn null??????????????????
+        bool running = is_running(*i);
+        bool& old_running = m_running[*i];
 
-        const struct ifaddrs* prop_new = m_current_prop->get_ip4_if(if_name);
-        const struct ifaddrs* prop_old = if_property_old->get_ip4_if(if_name);
-
-        if (m_addr_family == AF_INET) {
-            prop_new = m_current_prop->get_ip4_if(if_name);
-            prop_old = if_property_old->get_ip4_if(if_name);
-        } else if (m_addr_family == AF_INET6) {
-            const std::list<const struct ifaddrs*>* ipv6_if_list_new = m_current_prop->get_ip6_if(if_name);
-            const std::list<const struct ifaddrs*>* ipv6_if_list_old = if_property_old->get_ip6_if(if_name);
-
-            prop_new = *(ipv6_if_list_new->begin());
-            prop_old = *(ipv6_if_list_old->begin());
-        }
-
-        if (((prop_new->ifa_flags ^ prop_old->ifa_flags) & IFF_RUNNING)) { //IFF_RUNNING changed
-            if (prop_new->ifa_flags & IFF_RUNNING) { //up
+        if (running != old_running) { //IFF_RUNNING changed
+            if (running) { //up
                 m_swap_to_up.push_back(*i);
             } else { //down
                 m_swap_to_down.push_back(*i);
             }
+            old_running = running;
         }
     }
 
@@ -136,19 +116,16 @@ void check_if::test_check_if()
     HC_LOG_TRACE("");
 
     check_if c;
-    if_prop prop;
     vector<int> if_list_tmp;
     char cstr[IF_NAMESIZE];
     int sleeptime = 0;
 
     //fill if_list_tmp
-    prop.refresh_network_interfaces();
-    const if_prop_map* if_prop_map_p = prop.get_if_props();
     cout << "available interfaces under test:" << endl;
-    for (if_prop_map::const_iterator i = if_prop_map_p->begin(); i != if_prop_map_p->end(); i++) {
-        cout << i->first << " ";
-        if_list_tmp.push_back(if_nametoindex(i->first.c_str()));
-    }
+    if_registry::get_instance().for_each([&](const if_registry_entry & e) {
+        cout << e.if_name << " ";
+        if_list_tmp.push_back(e.if_index);
+    });
     cout << endl;
 
     //init status
@@ -24,6 +24,7 @@
 #include "include/hamcast_logging.h"
 #include "include/proxy/check_kernel.hpp"
 #include "include/utils/mroute_socket.hpp"
+#include "include/utils/mroute_netlink.hpp"
 #include "include/utils/addr_storage.hpp"
 
 #include <iostream>
@@ -57,6 +58,15 @@ void check_kernel::check_kernel_features()
         cout << " - ipv4 multicast: Ok!" << endl;
     }
     check_routing_tables(ms, "ipv4");
+
+    mroute_netlink mrt_netlink(0);
+    if (!check_mroute_netlink(mrt_netlink)) {
+        HC_LOG_DEBUG(" - ipv4 multicast routes via netlink: Failed!");
+        cout << " - ipv4 multicast routes via netlink: Failed!" << endl;
+    } else {
+        HC_LOG_DEBUG(" - ipv4 multicast routes via netlink: Ok!");
+        cout << " - ipv4 multicast routes via netlink: Ok!" << endl;
+    }
     cout << endl;
     check_kernel_limits(ms, "ipv4");
 
@@ -75,6 +85,11 @@ void check_kernel::check_kernel_features()
     check_kernel_limits(ms, "ipv6");
 }
 
+bool check_kernel::check_mroute_netlink(mroute_netlink& mrt_netlink)
+{
+    HC_LOG_TRACE("");
+    return mrt_netlink.create_socket() && mrt_netlink.probe();
+}
 
 void check_kernel::check_routing_tables(mroute_socket& ms, std::string version)
 {
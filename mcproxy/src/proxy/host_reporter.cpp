@@ -0,0 +1,691 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+#include "include/hamcast_logging.h"
+#include "include/proxy/host_reporter.hpp"
+#include "include/proxy/timing.hpp"
+#include "include/proxy/interfaces.hpp"
+
+#include <algorithm>
+#include <sstream>
+
+host_reporter::group_state::group_state()
+    : m_filter_mode(INCLUDE_MODE)
+    , m_retransmissions(0)
+    , m_is_filter_mode_change(false)
+    , m_is_query_pending(false)
+{
+}
+
+bool host_reporter::group_state::is_unused() const
+{
+    return m_filter_mode == INCLUDE_MODE && m_sources.empty() && m_retransmissions == 0 && !m_is_query_pending;
+}
+
+host_reporter::upstream_state::upstream_state()
+    : m_retransmit_time(time_point::max())
+    , m_qrv(timers_values().get_robustness_variable())
+    , m_older_querier_end(time_point::max())
+    , m_timer(nullptr)
+    , m_timer_end(time_point::max())
+{
+}
+
+bool host_reporter::upstream_state::is_older_querier_present() const
+{
+    return m_older_querier_end != time_point::max();
+}
+
+host_reporter::host_reporter(const worker* msg_worker, group_mem_protocol gmp, const std::shared_ptr<const sender>& sender, const std::shared_ptr<timing>& timing)
+    : m_msg_worker(msg_worker)
+    , m_group_mem_protocol(gmp)
+    , m_sender(sender)
+    , m_timing(timing)
+    , m_random_engine(std::random_device()())
+    , m_state_change_count(0)
+    , m_query_count(0)
+    , m_old_querier_count(0)
+    , m_record_count(0)
+    , m_report_count(0)
+{
+    HC_LOG_TRACE("");
+}
+
+std::chrono::milliseconds host_reporter::get_random_delay(std::chrono::milliseconds max_delay)
+{
+    HC_LOG_TRACE("");
+
+    if (max_delay.count() <= 0) {
+        return std::chrono::milliseconds(0);
+    }
+
+    std::uniform_int_distribution<long> distribution(0, max_delay.count());
+    return std::chrono::milliseconds(distribution(m_random_engine));
+}
+
+void host_reporter::set_state(unsigned int if_index, const ip_addr& gaddr, mc_filter filter_mode, const source_list<source>& slist)
+{
+    HC_LOG_TRACE("");
+
+    upstream_state& u = m_upstreams[if_index];
+    auto it = u.m_groups.find(gaddr);
+    if (it == std::end(u.m_groups)) {
+        if (filter_mode == INCLUDE_MODE && slist.empty()) {
+            return;
+        }
+        it = u.m_groups.insert(std::make_pair(gaddr, group_state())).first;
+    }
+
+    group_state& g = it->second;
+
+    std::set<ip_addr> sources;
+    for (auto & e : slist) {
+        sources.insert(e.saddr);
+    }
+
+    if (g.m_filter_mode == filter_mode && g.m_sources == sources) {
+        return;
+    }
+
+    //the kernel reports the change in the version of the older querier
+    if (u.is_older_querier_present()) {
+        if (!m_sender->send_record(if_index, filter_mode, gaddr.to_addr_storage(), slist)) {
+            HC_LOG_ERROR("failed to pass the membership of group " << gaddr << " on interface " << interfaces::get_if_name(if_index) << " to the kernel");
+        }
+
+        g.m_filter_mode = filter_mode;
+        g.m_sources = std::move(sources);
+        erase_unused_group(u, gaddr);
+        ++m_state_change_count;
+        return;
+    }
+
+    //RFC 3376 Section 5.1, merge the change into a pending state change report
+    if (g.m_filter_mode != filter_mode) {
+        g.m_is_filter_mode_change = true;
+        g.m_allow.clear();
+        g.m_block.clear();
+    } else if (!g.m_is_filter_mode_change) {
+        auto move_to = [](const ip_addr & saddr, std::set<ip_addr>& to, std::set<ip_addr>& from) {
+            to.insert(saddr);
+            from.erase(saddr);
+        };
+
+        std::set<ip_addr>& new_sources_set = filter_mode == INCLUDE_MODE ? g.m_allow : g.m_block;
+        std::set<ip_addr>& old_sources_set = filter_mode == INCLUDE_MODE ? g.m_block : g.m_allow;
+
+        for (auto & e : sources) {
+            if (g.m_sources.find(e) == std::end(g.m_sources)) {
+                move_to(e, new_sources_set, old_sources_set);
+            }
+        }
+
+        for (auto & e : g.m_sources) {
+            if (sources.find(e) == std::end(sources)) {
+                move_to(e, old_sources_set, new_sources_set);
+            }
+        }
+    }
+
+    g.m_filter_mode = filter_mode;
+    g.m_sources = std::move(sources);
+    g.m_retransmissions = u.m_qrv;
+
+    u.m_changed.insert(gaddr);
+    u.m_retransmit.insert(gaddr);
+    ++m_state_change_count;
+}
+
+void host_reporter::flush()
+{
+    HC_LOG_TRACE("");
+
+    auto now = std::chrono::steady_clock::now();
+    for (auto & e : m_upstreams) {
+        flush(e.first, e.second, now);
+    }
+}
+
+void host_reporter::flush(unsigned int if_index, upstream_state& u, time_point now)
+{
+    HC_LOG_TRACE("");
+
+    if (u.m_changed.empty()) {
+        return;
+    }
+
+    std::set<ip_addr> changed;
+    changed.swap(u.m_changed);
+
+    std::vector<report_record> records;
+    for (auto & gaddr : changed) {
+        auto it = u.m_groups.find(gaddr);
+        if (it != std::end(u.m_groups)) {
+            add_state_change_records(gaddr, it->second, records);
+        }
+    }
+
+    send(if_index, std::move(records));
+    sent_state_changes(u, changed);
+
+    if (!u.m_retransmit.empty() && u.m_retransmit_time == time_point::max()) {
+        u.m_retransmit_time = now + get_random_delay(m_timers_values.get_unsolicited_report_interval());
+    }
+
+    rearm_timer(if_index, u, now);
+}
+
+void host_reporter::receive_query(const std::shared_ptr<membership_query_msg>& msg)
+{
+    HC_LOG_TRACE("");
+
+    ++m_query_count;
+
+    upstream_state& u = m_upstreams[msg->get_if_index()];
+    auto now = std::chrono::steady_clock::now();
+    auto max_resp_time = msg->get_max_resp_time();
+
+    //RFC 3376 Section 7.2.1 and RFC 3810 Section 8.2.1, older version querier present timeout
+    if (msg->get_grp_mem_proto() != m_group_mem_protocol) {
+        ++m_old_querier_count;
+
+        if (!u.is_older_querier_present()) {
+            HC_LOG_WARN("the querier of interface " << interfaces::get_if_name(msg->get_if_index()) << " uses " << get_group_mem_protocol_name(msg->get_grp_mem_proto()) << ", the kernel reports the memberships until it is gone");
+            enter_compatibility_mode(msg->get_if_index(), u);
+        }
+
+        u.m_older_querier_end = now + u.m_qrv * m_timers_values.get_query_interval() + max_resp_time;
+        rearm_timer(msg->get_if_index(), u, now);
+        return;
+    }
+
+    //the kernel answers the queries while an older version querier is present
+    if (u.is_older_querier_present()) {
+        return;
+    }
+
+    if (msg->get_qrv() > 0) {
+        u.m_qrv = msg->get_qrv();
+    }
+
+    if (!msg->get_gaddr().is_valid()) {
+        //RFC 3376 Section 5.2, a pending answer to a general query is not rescheduled
+        if (!u.m_general_responses.empty()) {
+            return;
+        }
+
+        std::vector<report_record> records;
+        for (auto & e : u.m_groups) {
+            add_current_state_record(e.first, e.second, records);
+        }
+
+        auto reports = pack(msg->get_if_index(), std::move(records));
+        if (reports.empty()) {
+            return;
+        }
+
+        //each report gets its own slot of the maximum response time
+        auto slot = max_resp_time / reports.size();
+        for (unsigned int i = 0; i < reports.size(); ++i) {
+            general_response r;
+            r.m_time = now + slot * i + get_random_delay(slot);
+
+            //a split record is answered as a whole with the first part
+            for (auto & e : reports[i]) {
+                if (r.m_groups.empty() || r.m_groups.back() != e.gaddr) {
+                    if (i == 0 || u.m_general_responses.back().m_groups.empty() || u.m_general_responses.back().m_groups.back() != e.gaddr) {
+                        r.m_groups.push_back(e.gaddr);
+                    }
+                }
+            }
+
+            u.m_general_responses.push_back(std::move(r));
+        }
+    } else {
+        auto it = u.m_groups.find(msg->get_gaddr());
+        if (it == std::end(u.m_groups)) {
+            return;
+        }
+        group_state& g = it->second;
+
+        auto response_time = now + get_random_delay(max_resp_time);
+        if (!u.m_general_responses.empty() && u.m_general_responses.back().m_time <= response_time) {
+            return;
+        }
+
+        if (!g.m_is_query_pending) {
+            g.m_is_query_pending = true;
+            g.m_query_response_time = response_time;
+            g.m_queried_sources = std::set<ip_addr>(msg->get_sources().begin(), msg->get_sources().end());
+        } else {
+            if (msg->get_sources().empty() || g.m_queried_sources.empty()) {
+                g.m_queried_sources.clear();
+            } else {
+                g.m_queried_sources.insert(msg->get_sources().begin(), msg->get_sources().end());
+            }
+            g.m_query_response_time = std::min(g.m_query_response_time, response_time);
+        }
+
+        u.m_queried.insert(msg->get_gaddr());
+    }
+
+    rearm_timer(msg->get_if_index(), u, now);
+}
+
+void host_reporter::timer_triggerd(const std::shared_ptr<host_report_timer_msg>& msg)
+{
+    HC_LOG_TRACE("");
+
+    auto uit = m_upstreams.find(msg->get_if_index());
+    if (uit == std::end(m_upstreams)) {
+        HC_LOG_DEBUG("upstream interface of the host report timer is removed");
+        return;
+    }
+
+    upstream_state& u = uit->second;
+    if (u.m_timer.get() != msg.get()) {
+        HC_LOG_DEBUG("host report timer is outdated");
+        return;
+    }
+    u.m_timer.reset();
+    u.m_timer_end = time_point::max();
+
+    auto now = std::chrono::steady_clock::now();
+
+    if (u.is_older_querier_present()) {
+        if (u.m_older_querier_end <= now) {
+            leave_compatibility_mode(msg->get_if_index(), u, now);
+        } else {
+            rearm_timer(msg->get_if_index(), u, now);
+        }
+        return;
+    }
+
+    std::vector<report_record> records;
+
+    //retransmissions of the state changes
+    std::set<ip_addr> retransmitted;
+    if (u.m_retransmit_time <= now) {
+        for (auto & gaddr : u.m_retransmit) {
+            auto it = u.m_groups.find(gaddr);
+            if (it != std::end(u.m_groups)) {
+                add_state_change_records(gaddr, it->second, records);
+            }
+        }
+        retransmitted = u.m_retransmit;
+        u.m_retransmit_time = time_point::max();
+    }
+
+    //answers to group and group and source specific queries
+    std::vector<ip_addr> answered;
+    for (auto & gaddr : u.m_queried) {
+        auto it = u.m_groups.find(gaddr);
+        if (it == std::end(u.m_groups)) {
+            answered.push_back(gaddr);
+            continue;
+        }
+
+        group_state& g = it->second;
+        if (g.m_query_response_time <= now) {
+            if (g.m_queried_sources.empty()) {
+                add_current_state_record(gaddr, g, records);
+            } else {
+                add_source_query_record(gaddr, g, records);
+            }
+            g.m_is_query_pending = false;
+            g.m_queried_sources.clear();
+            answered.push_back(gaddr);
+        }
+    }
+
+    for (auto & gaddr : answered) {
+        u.m_queried.erase(gaddr);
+        erase_unused_group(u, gaddr);
+    }
+
+    //due parts of the answer to a general query
+    auto due_end = std::find_if(u.m_general_responses.begin(), u.m_general_responses.end(), [&](const general_response & r) {
+        return r.m_time > now;
+    });
+    for (auto it = u.m_general_responses.begin(); it != due_end; ++it) {
+        for (auto & gaddr : it->m_groups) {
+            auto git = u.m_groups.find(gaddr);
+            if (git != std::end(u.m_groups)) {
+                add_current_state_record(gaddr, git->second, records);
+            }
+        }
+    }
+    u.m_general_responses.erase(u.m_general_responses.begin(), due_end);
+
+    send(msg->get_if_index(), std::move(records));
+    sent_state_changes(u, retransmitted);
+
+    if (!u.m_retransmit.empty() && u.m_retransmit_time == time_point::max()) {
+        u.m_retransmit_time = now + get_random_delay(m_timers_values.get_unsolicited_report_interval());
+    }
+
+    rearm_timer(msg->get_if_index(), u, now);
+}
+
+void host_reporter::del_interface(unsigned int if_index)
+{
+    HC_LOG_TRACE("");
+
+    auto uit = m_upstreams.find(if_index);
+    if (uit == std::end(m_upstreams)) {
+        return;
+    }
+
+    upstream_state& u = uit->second;
+    std::vector<report_record> records;
+    for (auto & e : u.m_groups) {
+        const group_state& g = e.second;
+        if (u.is_older_querier_present()) {
+            m_sender->send_record(if_index, INCLUDE_MODE, e.first.to_addr_storage(), source_list<source>());
+        } else if (g.m_filter_mode == EXCLUDE_MODE) {
+            records.push_back(report_record {CHANGE_TO_INCLUDE_MODE, e.first, std::vector<ip_addr>()});
+        } else if (!g.m_sources.empty()) {
+            records.push_back(report_record {BLOCK_OLD_SOURCES, e.first, std::vector<ip_addr>(g.m_sources.begin(), g.m_sources.end())});
+        }
+    }
+    send(if_index, std::move(records));
+
+    if (u.m_timer != nullptr) {
+        m_timing->cancel_time(u.m_timer->get_timer_handle());
+    }
+
+    m_upstreams.erase(uit);
+}
+
+void host_reporter::enter_compatibility_mode(unsigned int if_index, upstream_state& u)
+{
+    HC_LOG_TRACE("");
+
+    //pending reports and answers are left to the kernel
+    u.m_changed.clear();
+    u.m_retransmit.clear();
+    u.m_retransmit_time = time_point::max();
+    u.m_queried.clear();
+    u.m_general_responses.clear();
+
+    for (auto it = u.m_groups.begin(); it != std::end(u.m_groups);) {
+        group_state& g = it->second;
+        g.m_retransmissions = 0;
+        g.m_is_filter_mode_change = false;
+        g.m_allow.clear();
+        g.m_block.clear();
+        g.m_is_query_pending = false;
+        g.m_queried_sources.clear();
+
+        if (g.is_unused()) {
+            it = u.m_groups.erase(it);
+            continue;
+        }
+
+        source_list<source> slist;
+        for (auto & e : g.m_sources) {
+            slist.insert(source(e));
+        }
+
+        if (!m_sender->send_record(if_index, g.m_filter_mode, it->first.to_addr_storage(), slist)) {
+            HC_LOG_ERROR("failed to pass the membership of group " << it->first << " on interface " << interfaces::get_if_name(if_index) << " to the kernel");
+        }
+
+        ++it;
+    }
+}
+
+void host_reporter::leave_compatibility_mode(unsigned int if_index, upstream_state& u, time_point now)
+{
+    HC_LOG_TRACE("");
+
+    HC_LOG_DEBUG("the older version querier of interface " << interfaces::get_if_name(if_index) << " is gone");
+    u.m_older_querier_end = time_point::max();
+
+    //the kernel leaves the groups, their memberships are reported again as filter mode changes
+    for (auto & e : u.m_groups) {
+        group_state& g = e.second;
+        m_sender->send_record(if_index, INCLUDE_MODE, e.first.to_addr_storage(), source_list<source>());
+
+        g.m_is_filter_mode_change = true;
+        g.m_retransmissions = u.m_qrv;
+        u.m_changed.insert(e.first);
+        u.m_retransmit.insert(e.first);
+    }
+
+    flush(if_index, u, now);
+}
+
+void host_reporter::add_state_change_records(const ip_addr& gaddr, const group_state& g, std::vector<report_record>& records) const
+{
+    HC_LOG_TRACE("");
+
+    if (g.m_is_filter_mode_change) {
+        mcast_addr_record_type type = g.m_filter_mode == INCLUDE_MODE ? CHANGE_TO_INCLUDE_MODE : CHANGE_TO_EXCLUDE_MODE;
+        records.push_back(report_record {type, gaddr, std::vector<ip_addr>(g.m_sources.begin(), g.m_sources.end())});
+    } else {
+        if (!g.m_allow.empty()) {
+            records.push_back(report_record {ALLOW_NEW_SOURCES, gaddr, std::vector<ip_addr>(g.m_allow.begin(), g.m_allow.end())});
+        }
+
+        if (!g.m_block.empty()) {
+            records.push_back(report_record {BLOCK_OLD_SOURCES, gaddr, std::vector<ip_addr>(g.m_block.begin(), g.m_block.end())});
+        }
+    }
+}
+
+void host_reporter::add_current_state_record(const ip_addr& gaddr, const group_state& g, std::vector<report_record>& records) const
+{
+    HC_LOG_TRACE("");
+
+    if (g.m_filter_mode == EXCLUDE_MODE) {
+        records.push_back(report_record {MODE_IS_EXCLUDE, gaddr, std::vector<ip_addr>(g.m_sources.begin(), g.m_sources.end())});
+    } else if (!g.m_sources.empty()) {
+        records.push_back(report_record {MODE_IS_INCLUDE, gaddr, std::vector<ip_addr>(g.m_sources.begin(), g.m_sources.end())});
+    }
+}
+
+void host_reporter::add_source_query_record(const ip_addr& gaddr, const group_state& g, std::vector<report_record>& records) const
+{
+    HC_LOG_TRACE("");
+
+    //INCLUDE: queried sources that are included, EXCLUDE: queried sources that are not excluded
+    report_record r {MODE_IS_INCLUDE, gaddr, std::vector<ip_addr>()};
+    for (auto & e : g.m_queried_sources) {
+        bool is_listed = g.m_sources.find(e) != std::end(g.m_sources);
+        if (is_listed == (g.m_filter_mode == INCLUDE_MODE)) {
+            r.sources.push_back(e);
+        }
+    }
+
+    if (!r.sources.empty()) {
+        records.push_back(std::move(r));
+    }
+}
+
+void host_reporter::sent_state_changes(upstream_state& u, const std::set<ip_addr>& groups)
+{
+    HC_LOG_TRACE("");
+
+    for (auto & gaddr : groups) {
+        auto it = u.m_groups.find(gaddr);
+        if (it == std::end(u.m_groups)) {
+            u.m_retransmit.erase(gaddr);
+            continue;
+        }
+
+        group_state& g = it->second;
+        if (g.m_retransmissions > 0) {
+            --g.m_retransmissions;
+        }
+
+        if (g.m_retransmissions == 0) {
+            g.m_is_filter_mode_change = false;
+            g.m_allow.clear();
+            g.m_block.clear();
+            u.m_retransmit.erase(gaddr);
+            erase_unused_group(u, gaddr);
+        }
+    }
+}
+
+std::vector<std::vector<report_record>> host_reporter::pack(unsigned int if_index, std::vector<report_record>&& records) const
+{
+    HC_LOG_TRACE("");
+
+    std::vector<std::vector<report_record>> reports;
+    if (records.empty()) {
+        return reports;
+    }
+
+    const unsigned int capacity = m_sender->get_report_capacity(if_index);
+    const unsigned int record_size = m_sender->get_record_size(0);
+    const unsigned int source_size = m_sender->get_record_size(1) - record_size;
+    if (capacity < record_size + source_size) {
+        HC_LOG_ERROR("the MTU of interface " << interfaces::get_if_name(if_index) << " is too small for a membership report");
+        return reports;
+    }
+    const unsigned int max_sources = (capacity - record_size) / source_size;
+
+    unsigned int used = capacity;
+    auto add = [&](report_record && r) {
+        unsigned int size = record_size + r.sources.size() * source_size;
+        if (used + size > capacity) {
+            reports.push_back(std::vector<report_record>());
+            used = 0;
+        }
+        reports.back().push_back(std::move(r));
+        used += size;
+    };
+
+    for (auto & r : records) {
+        if (r.sources.size() <= max_sources) {
+            add(std::move(r));
+        } else if (r.type == MODE_IS_EXCLUDE || r.type == CHANGE_TO_EXCLUDE_MODE) {
+            //RFC 3376 Section 4.2.16, the remaining sources are not reported
+            r.sources.resize(max_sources);
+            add(std::move(r));
+        } else {
+            //RFC 3376 Section 4.2.16, split into records with different subsets of the sources
+            for (unsigned int i = 0; i < r.sources.size(); i += max_sources) {
+                auto last = std::min<std::size_t>(i + max_sources, r.sources.size());
+                add(report_record {r.type, r.gaddr, std::vector<ip_addr>(r.sources.begin() + i, r.sources.begin() + last)});
+            }
+        }
+    }
+
+    return reports;
+}
+
+void host_reporter::send(unsigned int if_index, std::vector<report_record>&& records)
+{
+    HC_LOG_TRACE("");
+
+    for (auto & e : pack(if_index, std::move(records))) {
+        if (!m_sender->send_report(if_index, e)) {
+            HC_LOG_ERROR("failed to send membership report on interface " << interfaces::get_if_name(if_index));
+        }
+        ++m_report_count;
+        m_record_count += e.size();
+    }
+}
+
+void host_reporter::erase_unused_group(upstream_state& u, const ip_addr& gaddr)
+{
+    HC_LOG_TRACE("");
+
+    auto it = u.m_groups.find(gaddr);
+    if (it != std::end(u.m_groups) && it->second.is_unused() && u.m_changed.find(gaddr) == std::end(u.m_changed)) {
+        u.m_groups.erase(it);
+    }
+}
+
+void host_reporter::arm_timer(unsigned int if_index, upstream_state& u, time_point end_time, time_point now)
+{
+    HC_LOG_TRACE("");
+    using namespace std::chrono;
+
+    if (u.m_timer != nullptr) {
+        if (u.m_timer_end <= end_time) {
+            return;
+        }
+        m_timing->cancel_time(u.m_timer->get_timer_handle());
+    }
+
+    //round up, the timer must not expire before the end time
+    auto delay = end_time > now ? duration_cast<milliseconds>(end_time - now) + milliseconds(1) : milliseconds(0);
+    u.m_timer = std::make_shared<host_report_timer_msg>(if_index, delay);
+    u.m_timer->set_timer_handle(m_timing->arm_time(delay, m_msg_worker, u.m_timer));
+    u.m_timer_end = end_time;
+}
+
+void host_reporter::rearm_timer(unsigned int if_index, upstream_state& u, time_point now)
+{
+    HC_LOG_TRACE("");
+
+    time_point end_time = std::min(u.m_retransmit_time, u.m_older_querier_end);
+
+    for (auto & gaddr : u.m_queried) {
+        auto it = u.m_groups.find(gaddr);
+        if (it != std::end(u.m_groups) && it->second.m_is_query_pending) {
+            end_time = std::min(end_time, it->second.m_query_response_time);
+        }
+    }
+
+    if (!u.m_general_responses.empty()) {
+        end_time = std::min(end_time, u.m_general_responses.front().m_time);
+    }
+
+    if (end_time != time_point::max()) {
+        arm_timer(if_index, u, end_time, now);
+    }
+}
+
+std::string host_reporter::to_string() const
+{
+    HC_LOG_TRACE("");
+    std::ostringstream s;
+
+    unsigned int group_count = 0;
+    unsigned int older_querier_count = 0;
+    for (auto & e : m_upstreams) {
+        group_count += e.second.m_groups.size();
+        if (e.second.is_older_querier_present()) {
+            ++older_querier_count;
+        }
+    }
+
+    s << "##-- host reporter --##" << std::endl;
+    s << "groups: " << group_count << " state changes: " << m_state_change_count << " queries: " << m_query_count << " older version queries: " << m_old_querier_count;
+    s << " upstreams with an older version querier: " << older_querier_count;
+    s << " records: " << m_record_count << " reports: " << m_report_count;
+    if (m_report_count > 0) {
+        s << " records per report: " << static_cast<double>(m_record_count) / m_report_count;
+    }
+
+    return s.str();
+}
+
+std::ostream& operator<<(std::ostream& stream, const host_reporter& h)
+{
+    return stream << h.to_string();
+}
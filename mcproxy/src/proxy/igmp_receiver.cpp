@@ -74,13 +74,43 @@ void print_buf(const unsigned char * buf, unsigned int size)
 }
 #endif /* DEBUG_MODE */
 
-igmp_receiver::igmp_receiver(proxy_instance* pr_i, const std::shared_ptr<const mroute_socket> mrt_sock, const std::shared_ptr<const interfaces> interfaces, bool in_debug_testing_mode): receiver(pr_i, AF_INET, mrt_sock, interfaces, in_debug_testing_mode)
+igmp_receiver::igmp_receiver(proxy_instance* pr_i, const std::shared_ptr<const mroute_socket> mrt_sock, const std::shared_ptr<const interfaces> interfaces, bool in_debug_testing_mode, const receiver_msg_handler& msg_handler): receiver(pr_i, AF_INET, mrt_sock, interfaces, in_debug_testing_mode, msg_handler)
 {
     HC_LOG_TRACE("");
 
+    if (!m_mrt_sock->set_ipv4_recv_pkt_info()) {
+        throw "failed to set receive paket info";
+    }
+
     start();
 }
 
+void igmp_receiver::generate_socket_filter(std::vector<struct sock_filter>& prog) const
+{
+    HC_LOG_TRACE("");
+
+    //kernel messages have ip_p = 0, accept cache misses
+    prog.push_back(BPF_STMT(BPF_LD | BPF_B | BPF_ABS, offsetof(struct ip, ip_p)));
+    prog.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, IGMP_RECEIVER_KERNEL_MSG, 0, 4));
+    prog.push_back(BPF_STMT(BPF_LD | BPF_B | BPF_ABS, offsetof(struct igmpmsg, im_msgtype)));
+    prog.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, IGMPMSG_NOCACHE, 0, 1));
+    prog.push_back(BPF_STMT(BPF_RET | BPF_K, RECEIVER_FILTER_ACCEPT));
+    prog.push_back(BPF_STMT(BPF_RET | BPF_K, RECEIVER_FILTER_DROP));
+
+    //load the igmp type behind the ip header (X = ip header length)
+    prog.push_back(BPF_STMT(BPF_LDX | BPF_B | BPF_MSH, 0));
+    prog.push_back(BPF_STMT(BPF_LD | BPF_B | BPF_IND, offsetof(struct igmp, igmp_type)));
+    std::vector<unsigned char> types {IGMP_V2_MEMBERSHIP_REPORT, IGMP_V2_LEAVE_GROUP, IGMP_V3_MEMBERSHIP_REPORT};
+
+    //only the host reporter of the upstreams processes queries
+    if (is_query_relevant()) {
+        types.push_back(IGMP_MEMBERSHIP_QUERY);
+    }
+    add_filter_types(prog, types);
+
+    add_filter_relevant_interfaces(prog, IGMP_MEMBERSHIP_QUERY);
+}
+
 int igmp_receiver::get_iov_min_size()
 {
     HC_LOG_TRACE("");
@@ -92,8 +122,7 @@ int igmp_receiver::get_iov_min_size()
 int igmp_receiver::get_ctrl_min_size()
 {
     HC_LOG_TRACE("");
-    //useless
-    return 0;
+    return CMSG_SPACE(sizeof(struct in_pktinfo));
 }
 
 void igmp_receiver::analyse_packet(struct msghdr* msg, int)
@@ -133,7 +162,7 @@ void igmp_receiver::analyse_packet(struct msghdr* msg, int)
                 return;
             }
 
-            m_proxy_instance->add_msg(std::make_shared<new_source_msg>(if_index, gaddr, saddr));
+            forward_msg(std::make_shared<new_source_msg>(if_index, ip_addr(gaddr), ip_addr(saddr)));
             break;
         }
         default:
@@ -146,7 +175,7 @@ void igmp_receiver::analyse_packet(struct msghdr* msg, int)
             saddr = ip_hdr->ip_src;
             HC_LOG_DEBUG("\tsrc: " << saddr);
 
-            if ((if_index = m_interfaces->get_if_index(saddr)) == 0) {
+            if ((if_index = get_ingress_if_index(msg, saddr)) == 0) {
                 return;
             }
 
@@ -162,10 +191,10 @@ void igmp_receiver::analyse_packet(struct msghdr* msg, int)
 
             if (igmp_hdr->igmp_type == IGMP_V2_MEMBERSHIP_REPORT) {
                 HC_LOG_DEBUG("\treport received");
-                m_proxy_instance->add_msg(std::make_shared<group_record_msg>(if_index, MODE_IS_EXCLUDE, gaddr, source_list<source>(), IGMPv2));
+                forward_msg(std::make_shared<group_record_msg>(if_index, MODE_IS_EXCLUDE, ip_addr(gaddr), source_list<source>(), IGMPv2));
             } else if (igmp_hdr->igmp_type == IGMP_V2_LEAVE_GROUP) {
                 HC_LOG_DEBUG("\tleave group received");
-                m_proxy_instance->add_msg(std::make_shared<group_record_msg>(if_index, CHANGE_TO_INCLUDE_MODE, gaddr, source_list<source>(), IGMPv2));
+                forward_msg(std::make_shared<group_record_msg>(if_index, CHANGE_TO_INCLUDE_MODE, ip_addr(gaddr), source_list<source>(), IGMPv2));
             } else {
                 HC_LOG_ERROR("unkown igmp type: " << igmp_hdr->igmp_type); 
             }
@@ -181,7 +210,7 @@ void igmp_receiver::analyse_packet(struct msghdr* msg, int)
             saddr = ip_hdr->ip_src;
             HC_LOG_DEBUG("\tsaddr: " << saddr);
 
-            if ((if_index = m_interfaces->get_if_index(saddr)) == 0) {
+            if ((if_index = get_ingress_if_index(msg, saddr)) == 0) {
                 HC_LOG_DEBUG("no if_index found");
                 return;
             }
@@ -192,6 +221,8 @@ void igmp_receiver::analyse_packet(struct msghdr* msg, int)
                 return;
             }
 
+            auto report = std::make_shared<group_report_msg>(if_index, IGMPv3, num_records);
+
             for (int i = 0; i < num_records; ++i) {
                 mcast_addr_record_type rec_type = static_cast<mcast_addr_record_type>(rec->type);
                 unsigned int aux_size = rec->aux_data_len * 4; //RFC 3376 Section 4.2.6 Aux Data Len
@@ -202,7 +233,7 @@ void igmp_receiver::analyse_packet(struct msghdr* msg, int)
 
                 in_addr* src = reinterpret_cast<in_addr*>(reinterpret_cast<unsigned char*>(rec) + sizeof(igmpv3_mc_record));
                 for (int j = 0; j < nos; ++j) {
-                    slist.insert(addr_storage(*src));
+                    slist.insert(source(ip_addr(*src)));
                     ++src;
                 }
 
@@ -210,17 +241,61 @@ void igmp_receiver::analyse_packet(struct msghdr* msg, int)
                 HC_LOG_DEBUG("\tgaddr: " << gaddr);
                 HC_LOG_DEBUG("\tnumber of sources: " << slist.size());
                 HC_LOG_DEBUG("\tsource_list: " << slist);
-                m_proxy_instance->add_msg(std::make_shared<group_record_msg>(if_index, rec_type, gaddr, move(slist), IGMPv3));
+                report->add_record(rec_type, ip_addr(gaddr), std::move(slist));
 
                 rec = reinterpret_cast<igmpv3_mc_record*>(reinterpret_cast<unsigned char*>(rec) + sizeof(igmpv3_mc_record) + nos * sizeof(in_addr) + aux_size);
             }
 
+            forward_msg(report);
+
         } else if (igmp_hdr->igmp_type == IGMP_V1_MEMBERSHIP_REPORT) {
             HC_LOG_DEBUG("IGMP_V1_MEMBERSHIP_REPORT received");
             HC_LOG_WARN("protocol not supported");
         } else if (igmp_hdr->igmp_type == IGMP_MEMBERSHIP_QUERY) {
             HC_LOG_DEBUG("IGMP_MEMBERSHIP_QUERY received");
-            HC_LOG_WARN("querier election is not implemented");
+
+            saddr = ip_hdr->ip_src;
+            HC_LOG_DEBUG("\tsaddr: " << saddr);
+
+            if ((if_index = get_ingress_if_index(msg, saddr)) == 0) {
+                return;
+            }
+            HC_LOG_DEBUG("\treceived on interface:" << interfaces::get_if_name(if_index));
+
+            if (!is_if_index_relevant(if_index)) {
+                HC_LOG_DEBUG("interface is not relevant");
+                return;
+            }
+
+            //the group address of a general query is 0.0.0.0
+            ip_addr query_gaddr;
+            if (igmp_hdr->igmp_group.s_addr != INADDR_ANY) {
+                query_gaddr = ip_addr(igmp_hdr->igmp_group);
+            }
+
+            unsigned int igmp_size = ntohs(ip_hdr->ip_len) - ip_hdr->ip_hl * 4;
+            if (igmp_size >= sizeof(igmpv3_query)) { //RFC 3376 Section 7.1 Query Version Distinctions
+                igmpv3_query* query = reinterpret_cast<igmpv3_query*>(igmp_hdr);
+                unsigned int nos = ntohs(query->num_of_srcs);
+                if (igmp_size < sizeof(igmpv3_query) + nos * sizeof(in_addr)) {
+                    HC_LOG_WARN("truncated IGMPv3 query");
+                    return;
+                }
+
+                std::vector<ip_addr> sources;
+                sources.reserve(nos);
+                in_addr* src = reinterpret_cast<in_addr*>(reinterpret_cast<unsigned char*>(query) + sizeof(igmpv3_query));
+                for (unsigned int i = 0; i < nos; ++i) {
+                    sources.push_back(ip_addr(*src));
+                    ++src;
+                }
+
+                forward_msg(std::make_shared<membership_query_msg>(if_index, IGMPv3, query_gaddr, timers_values().maxrespc_igmpv3_to_maxrespi(query->igmp_code), static_cast<unsigned int>(query->qrv), std::move(sources)));
+            } else if (igmp_hdr->igmp_code != 0) {
+                forward_msg(std::make_shared<membership_query_msg>(if_index, IGMPv2, query_gaddr, std::chrono::milliseconds(igmp_hdr->igmp_code * 100), 0, std::vector<ip_addr>()));
+            } else {
+                forward_msg(std::make_shared<membership_query_msg>(if_index, IGMPv1, query_gaddr, std::chrono::milliseconds(10000), 0, std::vector<ip_addr>()));
+            }
         } else {
             HC_LOG_WARN("unknown IGMP-packet");
             HC_LOG_WARN("type: " << igmp_hdr->igmp_type);
@@ -30,6 +30,7 @@
 #include <netinet/ip.h>
 #include <net/if.h>
 
+#include <algorithm>
 #include <memory>
 
 igmp_sender::igmp_sender(const std::shared_ptr<const interfaces>& interfaces): sender(interfaces, IGMPv3)
@@ -51,16 +52,15 @@ bool igmp_sender::send_record(unsigned int if_index, mc_filter filter_mode, cons
     HC_LOG_TRACE("");
 
     if (filter_mode == INCLUDE_MODE && slist.empty() ) {
-        m_sock.leave_group(gaddr, if_index);
+        m_memberships.leave_group(if_index, gaddr);
         return true;
     } else if (filter_mode == EXCLUDE_MODE || filter_mode == INCLUDE_MODE) {
-        m_sock.join_group(gaddr, if_index);
         std::list<addr_storage> src_list;
         for (auto & e : slist) {
-            src_list.push_back(e.saddr);
+            src_list.push_back(e.saddr.to_addr_storage());
         }
 
-        return m_sock.set_source_filter(if_index, gaddr, filter_mode, src_list);
+        return m_memberships.set_source_filter(if_index, gaddr, filter_mode, src_list);
     } else {
         HC_LOG_ERROR("unknown filter mode");
         return false;
@@ -71,14 +71,18 @@ bool igmp_sender::send_general_query(unsigned int if_index, const timers_values&
 {
     HC_LOG_TRACE("");
 
-    return send_igmpv3_query(if_index, tv, addr_storage(AF_INET), false, source_list<source>());
+    packet_buffer& buf = get_packet_buffer(if_index);
+    add_igmpv3_query(buf, if_index, tv, addr_storage(AF_INET), false, source_list<source>());
+    return send_igmpv3_queries(if_index, addr_storage(AF_INET), buf);
 }
 
 bool igmp_sender::send_mc_addr_specific_query(unsigned int if_index, const timers_values& tv, const addr_storage& gaddr, bool s_flag) const
 {
     HC_LOG_TRACE("");
 
-    return send_igmpv3_query(if_index, tv, gaddr, s_flag, source_list<source>());
+    packet_buffer& buf = get_packet_buffer(if_index);
+    add_igmpv3_query(buf, if_index, tv, gaddr, s_flag, source_list<source>());
+    return send_igmpv3_queries(if_index, gaddr, buf);
 }
 
 bool igmp_sender::send_mc_addr_and_src_specific_query(unsigned int if_index, const timers_values& tv, const addr_storage& gaddr, source_list<source>& slist) const
@@ -108,47 +112,167 @@ bool igmp_sender::send_mc_addr_and_src_specific_query(unsigned int if_index, con
         }
     }
 
+    //both parts of the query are sent with one sendmmsg() call
+    packet_buffer& buf = get_packet_buffer(if_index);
     if (!slist_higher.empty()) {
-        send_igmpv3_query(if_index, tv, gaddr, true, slist_higher);
+        add_igmpv3_query(buf, if_index, tv, gaddr, true, slist_higher);
     }
 
     if (!slist_lower.empty()) {
-        send_igmpv3_query(if_index, tv, gaddr, false, slist_lower);
+        add_igmpv3_query(buf, if_index, tv, gaddr, false, slist_lower);
+    }
+
+    if (!buf.sizes.empty()) {
+        send_igmpv3_queries(if_index, gaddr, buf);
     }
 
     return rc;
 }
 
-bool igmp_sender::send_igmpv3_query(unsigned int if_index, const timers_values& tv, const addr_storage& gaddr, bool s_flag, const source_list<source>& slist) const
+void igmp_sender::add_igmpv3_query(packet_buffer& buf, unsigned int if_index, const timers_values& tv, const addr_storage& gaddr, bool s_flag, const source_list<source>& slist) const
 {
     HC_LOG_TRACE("");
 
-    std::unique_ptr<unsigned char[]> packet;
-    unsigned int size;
+    //RFC 3376 Section 4.1.8, a source list that does not fit into the MTU is split into multiple queries
+    const unsigned int header_size = sizeof(ip) + sizeof(router_alert_option) + sizeof(igmpv3_query);
+    const unsigned int mtu = get_mtu(if_index);
+    const unsigned int max_srcs = mtu > header_size + sizeof(in_addr) ? (mtu - header_size) / sizeof(in_addr) : 1;
+
+    const addr_storage dst_addr = get_query_dst_addr(gaddr);
+
+    const in_addr saddr = m_interfaces->get_saddr(interfaces::get_if_name(if_index)).get_in_addr();
+
+    auto src_it = slist.begin();
+    unsigned int remaining_srcs = slist.size();
+
+    do {
+        unsigned int num_of_srcs = std::min(remaining_srcs, max_srcs);
+        remaining_srcs -= num_of_srcs;
+
+        unsigned int size = header_size + num_of_srcs * sizeof(in_addr);
+        unsigned char* packet = add_packet(buf, size);
+
+        //-------------------------------------------------------------------
+        //fill ip header
+        ip* ip_hdr = reinterpret_cast<ip*>(packet);
+
+        ip_hdr->ip_v = 4;
+        ip_hdr->ip_hl = (sizeof(ip) + sizeof(router_alert_option)) / 4;
+        ip_hdr->ip_tos = 0;
+        ip_hdr->ip_len = htons(size);
+        ip_hdr->ip_id = 0;
+        ip_hdr->ip_off = htons(0 | IP_DF); //dont fragment flag
+        ip_hdr->ip_ttl = 1;
+        ip_hdr->ip_p = IPPROTO_IGMP;
+        ip_hdr->ip_sum = 0;
+        ip_hdr->ip_src = saddr;
+        ip_hdr->ip_dst = dst_addr.get_in_addr();
+
+        //-------------------------------------------------------------------
+        //fill router_alert_option header
+        router_alert_option* ra_hdr = reinterpret_cast<router_alert_option*>(packet + sizeof(ip));
+        *ra_hdr = router_alert_option();
+
+        ip_hdr->ip_sum = m_sock.calc_checksum(packet, sizeof(ip) + sizeof(router_alert_option));
+
+        //-------------------------------------------------------------------
+        //fill igmpv3 query
+        igmpv3_query* query = reinterpret_cast<igmpv3_query*>(packet + sizeof(ip) + sizeof(router_alert_option));
+
+        query->igmp_type = IGMP_MEMBERSHIP_QUERY;
+
+        if (gaddr == addr_storage(AF_INET)) { //general query
+            query->igmp_code = tv.maxrespi_to_maxrespc_igmpv3(tv.get_query_response_interval());
+        } else {
+            query->igmp_code = tv.maxrespi_to_maxrespc_igmpv3(tv.get_last_listener_query_time());
+        }
+
+        query->igmp_cksum = 0;
+        query->igmp_group = gaddr.get_in_addr();
+        query->resv2 = 0;
+        query->suppress = s_flag;
+
+        if (tv.get_robustness_variable() <= 7) {
+            query->qrv = tv.get_robustness_variable();
+        } else {
+            query->qrv = 0;
+        }
+
+        query->qqic = tv.qqi_to_qqic(tv.get_query_interval());
+        query->num_of_srcs = htons(num_of_srcs);
 
-    if (slist.empty()) {
-        size = sizeof(ip) + sizeof(router_alert_option) + sizeof(igmpv3_query);
-        packet.reset(new unsigned char[size]);
+        //-------------------------------------------------------------------
+        //add sources
+        in_addr* source_ptr = reinterpret_cast<in_addr*>(reinterpret_cast<unsigned char*>(query) + sizeof(igmpv3_query));
+        for (unsigned int i = 0; i < num_of_srcs; ++i, ++src_it) {
+            *source_ptr = src_it->saddr.get_in_addr();
+            source_ptr++;
+        }
+
+        query->igmp_cksum = m_sock.calc_checksum(reinterpret_cast<unsigned char*>(query), sizeof(igmpv3_query) + num_of_srcs * sizeof(in_addr));
+    } while (remaining_srcs > 0);
+}
+
+addr_storage igmp_sender::get_query_dst_addr(const addr_storage& gaddr) const
+{
+    HC_LOG_TRACE("");
+
+    if (gaddr == addr_storage(AF_INET)) { //general query
+        return addr_storage(IPV4_ALL_HOST_ADDR);
     } else { //all other types of queries
-        size = sizeof(ip) + sizeof(router_alert_option) + sizeof(igmpv3_query) + (slist.size() * sizeof(in_addr));
-        packet.reset(new unsigned char[size]);
+        return gaddr;
     }
+}
 
-    addr_storage dst_addr;
+bool igmp_sender::send_igmpv3_queries(unsigned int if_index, const addr_storage& gaddr, const packet_buffer& buf) const
+{
+    HC_LOG_TRACE("");
 
-    if (gaddr == addr_storage(AF_INET)) { //is general query
-        dst_addr = IPV4_ALL_HOST_ADDR;
-    } else {
-        dst_addr = gaddr;
+    if (!m_sock.choose_if(if_index)) {
+        return false;
+    }
+
+    return send_packets(get_query_dst_addr(gaddr), buf);
+}
+
+
+unsigned int igmp_sender::get_report_capacity(unsigned int if_index) const
+{
+    HC_LOG_TRACE("");
+
+    unsigned int mtu = get_mtu(if_index);
+    unsigned int header_size = sizeof(ip) + sizeof(router_alert_option) + sizeof(igmpv3_mc_report);
+    return mtu > header_size ? mtu - header_size : 0;
+}
+
+unsigned int igmp_sender::get_record_size(unsigned int num_of_srcs) const
+{
+    HC_LOG_TRACE("");
+    return sizeof(igmpv3_mc_record) + num_of_srcs * sizeof(in_addr);
+}
+
+bool igmp_sender::send_report(unsigned int if_index, const std::vector<report_record>& records) const
+{
+    HC_LOG_TRACE("");
+
+    unsigned int igmp_size = sizeof(igmpv3_mc_report);
+    for (auto & e : records) {
+        igmp_size += get_record_size(e.sources.size());
     }
 
+    unsigned int size = sizeof(ip) + sizeof(router_alert_option) + igmp_size;
+    packet_buffer& buf = get_packet_buffer(if_index);
+    unsigned char* packet = add_packet(buf, size);
+
+    addr_storage dst_addr(IPV4_IGMPV3_ADDR);
+
     //-------------------------------------------------------------------
     //fill ip header
-    ip* ip_hdr = reinterpret_cast<ip*>(packet.get());
+    ip* ip_hdr = reinterpret_cast<ip*>(packet);
 
     ip_hdr->ip_v = 4;
     ip_hdr->ip_hl = (sizeof(ip) + sizeof(router_alert_option)) / 4;
-    ip_hdr->ip_tos = 0;
+    ip_hdr->ip_tos = 0xc0; //internetwork control, RFC 3376 Section 4
     ip_hdr->ip_len = htons(size);
     ip_hdr->ip_id = 0;
     ip_hdr->ip_off = htons(0 | IP_DF); //dont fragment flag
@@ -166,47 +290,38 @@ bool igmp_sender::send_igmpv3_query(unsigned int if_index, const timers_values&
     ip_hdr->ip_sum = m_sock.calc_checksum(reinterpret_cast<unsigned char*>(ip_hdr), sizeof(ip) + sizeof(router_alert_option));
 
     //-------------------------------------------------------------------
-    //fill igmpv3 query
-    igmpv3_query* query = reinterpret_cast<igmpv3_query*>(reinterpret_cast<unsigned char*>(ra_hdr) + sizeof(router_alert_option));
-
-    query->igmp_type = IGMP_MEMBERSHIP_QUERY;
-
-    if (gaddr == addr_storage(AF_INET)) { //general query
-        query->igmp_code = tv.maxrespi_to_maxrespc_igmpv3(tv.get_query_response_interval());
-    } else {
-        query->igmp_code = tv.maxrespi_to_maxrespc_igmpv3(tv.get_last_listener_query_time());
-    }
-
-    query->igmp_cksum = 0;
-    query->igmp_group = gaddr.get_in_addr();
-    query->resv2 = 0;
-    query->suppress = s_flag;
-
-    if (tv.get_robustness_variable() <= 7) {
-        query->qrv = tv.get_robustness_variable();
-    } else {
-        query->qrv = 0;
-    }
-
-    query->qqic = tv.qqi_to_qqic(tv.get_query_interval());
-    query->num_of_srcs = ntohs(slist.size());
+    //fill igmpv3 report
+    igmpv3_mc_report* report = reinterpret_cast<igmpv3_mc_report*>(reinterpret_cast<unsigned char*>(ra_hdr) + sizeof(router_alert_option));
+    report->type = IGMP_V3_MEMBERSHIP_REPORT;
+    report->reservedA = 0;
+    report->checksum = 0;
+    report->reservedB = 0;
+    report->num_of_mc_records = htons(records.size());
 
     //-------------------------------------------------------------------
-    //add sources
-    if (!slist.empty()) {
-        in_addr* source_ptr = reinterpret_cast<in_addr*>(reinterpret_cast<unsigned char*>(query) + sizeof(igmpv3_query));
-        for (auto & e : slist) {
-            *source_ptr = e.saddr.get_in_addr();
+    //add records
+    unsigned char* pos = reinterpret_cast<unsigned char*>(report) + sizeof(igmpv3_mc_report);
+    for (auto & e : records) {
+        igmpv3_mc_record* rec = reinterpret_cast<igmpv3_mc_record*>(pos);
+        rec->type = e.type;
+        rec->aux_data_len = 0;
+        rec->num_of_srcs = htons(e.sources.size());
+        rec->gaddr = e.gaddr.get_in_addr();
+
+        in_addr* source_ptr = reinterpret_cast<in_addr*>(pos + sizeof(igmpv3_mc_record));
+        for (auto & s : e.sources) {
+            *source_ptr = s.get_in_addr();
             source_ptr++;
         }
+
+        pos += get_record_size(e.sources.size());
     }
 
-    query->igmp_cksum = m_sock.calc_checksum(reinterpret_cast<unsigned char*>(query), (sizeof(igmpv3_query) + (slist.size() * sizeof(in_addr))));
+    report->checksum = m_sock.calc_checksum(reinterpret_cast<unsigned char*>(report), igmp_size);
 
     if (!m_sock.choose_if(if_index)) {
         return false;
     }
 
-    return m_sock.send_packet(dst_addr, reinterpret_cast<unsigned char*>(ip_hdr), size);
+    return send_packets(dst_addr, buf);
 }
-
@@ -42,7 +42,7 @@ interfaces::interfaces(int addr_family, bool reset_reverse_path_filter)
         }
     }
 
-    if (!m_if_prop.refresh_network_interfaces()) {
+    if (!refresh_network_interfaces()) {
         throw "failed to refresh network interfaces";
     }
 }
@@ -119,18 +119,32 @@ bool interfaces::del_interface(unsigned int if_index)
 bool interfaces::refresh_network_interfaces()
 {
     HC_LOG_TRACE("");
-    return m_if_prop.refresh_network_interfaces();
+
+    //the registry follows the changes of the interfaces by itself
+    return if_registry::get_instance().is_valid();
 }
 
 unsigned int interfaces::get_if_index(const std::string& if_name)
 {
     HC_LOG_TRACE("");
-    return get_if_index(if_name.c_str());
+    unsigned int if_index = if_registry::get_instance().get_if_index(if_name);
+    if (if_index != INTERFACES_UNKOWN_IF_INDEX) {
+        return if_index;
+    }
+
+    //the interface is new and its event has not been processed yet
+    return if_nametoindex(if_name.c_str());
 }
 
 unsigned int interfaces::get_if_index(const char* if_name)
 {
     HC_LOG_TRACE("");
+    unsigned int if_index = if_registry::get_instance().get_if_index(if_name);
+    if (if_index != INTERFACES_UNKOWN_IF_INDEX) {
+        return if_index;
+    }
+
+    //the interface is new and its event has not been processed yet
     return if_nametoindex(if_name);
 }
 
@@ -163,26 +177,34 @@ addr_storage interfaces::get_saddr(const std::string& if_name) const
 {
     HC_LOG_TRACE("");
 
-    if (m_addr_family == AF_INET) {
-        auto tmp = m_if_prop.get_ip4_if(if_name);
-        return addr_storage(*tmp->ifa_addr);
-    } else if  (m_addr_family == AF_INET6) {
-        auto addr_list = m_if_prop.get_ip6_if(if_name);
-        if (addr_list->begin() != addr_list->end()) {
-            const struct ifaddrs* addr = *addr_list->begin();
-            return addr_storage(*addr->ifa_addr);
-        } else {
-            return addr_storage();
-        }
-    } else {
+    if (m_addr_family != AF_INET && m_addr_family != AF_INET6) {
         HC_LOG_ERROR("unkown addr_family: " << m_addr_family);
         return addr_storage();
     }
+
+    if_registry_entry e;
+    if (!if_registry::get_instance().get_entry(get_if_index(if_name), e)) {
+        HC_LOG_WARN("failed to get the properties of interface: " << if_name);
+        return addr_storage();
+    }
+
+    auto& addrs = e.get_addrs(m_addr_family);
+    if (addrs.empty()) {
+        return addr_storage();
+    } else {
+        return addrs.front().addr;
+    }
 }
 
 std::string interfaces::get_if_name(unsigned int if_index)
 {
     HC_LOG_TRACE("");
+    std::string result;
+    if (if_registry::get_instance().get_if_name(if_index, result)) {
+        return result;
+    }
+
+    //the interface is new and its event has not been processed yet
     char tmp[IF_NAMESIZE];
     const char* if_name = if_indextoname(if_index, tmp);
     if (if_name == nullptr) {
@@ -198,28 +220,13 @@ unsigned int interfaces::get_if_index(const addr_storage& saddr) const
 {
     HC_LOG_TRACE("");
 
-    addr_storage recv_subnet;
-    addr_storage src_subnet;
-
-    const if_prop_map* prop_map;
-
-    if (saddr.get_addr_family() == AF_INET) {
-        prop_map = m_if_prop.get_if_props();
-        for (auto & e : *prop_map) {
-            if (e.second.ip4_addr != nullptr && e.second.ip4_addr->ifa_netmask != nullptr && e.second.ip4_addr->ifa_addr != nullptr) {
-                recv_subnet = *e.second.ip4_addr->ifa_netmask;
-                src_subnet = *e.second.ip4_addr->ifa_addr;
-                src_subnet.mask_ipv4(recv_subnet);
-                if (src_subnet == recv_subnet.mask_ipv4(saddr)) {
-                    return get_if_index(e.second.ip4_addr->ifa_name);
-                }
-            }
-        }
-    }else{
-        HC_LOG_WARN("cannot map IPv6 addr to interface index:" << saddr);
+    unsigned int if_index = if_registry::get_instance().get_if_index(saddr);
+    if (if_index == PREFIX_TRIE_NO_VALUE) {
+        HC_LOG_DEBUG("cannot map addr to interface index: " << saddr);
+        return INTERFACES_UNKOWN_IF_INDEX;
     }
 
-    return INTERFACES_UNKOWN_IF_INDEX;
+    return if_index;
 }
 
 int interfaces::get_free_vif_number() const
@@ -262,26 +269,19 @@ int interfaces::get_free_vif_number() const
 bool interfaces::is_interface(unsigned if_index, unsigned int interface_flags) const
 {
     HC_LOG_TRACE("");
-    if (m_addr_family == AF_INET) {
-        const struct ifaddrs* prop = m_if_prop.get_ip4_if(get_if_name(if_index));
-        if (prop != nullptr) {
-            return prop->ifa_flags & interface_flags;
-        } else {
-            HC_LOG_WARN("failed to get interface ipv4 properties of interface: " << get_if_name(if_index));
-            return false;
-        }
-    } else if (m_addr_family == AF_INET6) {
-        const std::list<const struct ifaddrs*>* prop = m_if_prop.get_ip6_if(get_if_name(if_index));
-        if (prop != nullptr && !prop->empty()) {
-            return (*(begin(*prop)))->ifa_flags & interface_flags;
-        } else {
-            HC_LOG_WARN("failed to get interface ipv6 properties of interface: " << get_if_name(if_index));
-            return false;
-        }
-    } else {
+    if (m_addr_family != AF_INET && m_addr_family != AF_INET6) {
         HC_LOG_ERROR("wrong addr_family: " << m_addr_family);
         return false;
     }
+
+    //an interface without address of the used IP version cannot send queries or reports
+    if_registry_entry e;
+    if (if_registry::get_instance().get_entry(if_index, e) && !e.get_addrs(m_addr_family).empty()) {
+        return e.flags & interface_flags;
+    } else {
+        HC_LOG_WARN("failed to get interface " << (m_addr_family == AF_INET ? "ipv4" : "ipv6") << " properties of interface: " << get_if_name(if_index));
+        return false;
+    }
 }
 
 std::string interfaces::to_string() const
@@ -302,6 +302,7 @@ std::string interfaces::to_string() const
 
     s << std::endl;
     s << "reset reverse path filter: " << m_reset_reverse_path_filter << std::endl;
+    s << if_registry::get_instance() << std::endl;
     s << std::endl;
 
     s << m_reverse_path_filter;
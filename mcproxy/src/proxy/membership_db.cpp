@@ -28,8 +28,15 @@
 #include <string>
 #include <vector>
 #include <set>
+#include <algorithm>
 
 #ifdef DEBUG_MODE
+#include "include/utils/benchmark.hpp"
+
+#include <iomanip>
+#include <map>
+#include <random>
+
 void membership_db::test_arithmetic()
 {
     using namespace std;
@@ -80,6 +87,248 @@ void membership_db::test_arithmetic()
     cout << source_list<int> {1, 5, 2} - source_list<int> {2} - source_list<int> {5, 2}  << endl;
 
 }
+
+//the set operations as they were implemented when source_list was an alias of std::set
+static void test_set_unite(std::set<source>& l, const std::set<source>& r)
+{
+    l.insert(r.cbegin(), r.cend());
+}
+
+static void test_set_intersect(std::set<source>& l, const std::set<source>& r)
+{
+    auto cur_l = std::begin(l);
+    auto cur_r = std::begin(r);
+
+    while (cur_l != std::end(l) && cur_r != std::end(r)) {
+        if (*cur_l == *cur_r) {
+            cur_l++;
+            cur_r++;
+        } else if (*cur_l < *cur_r) {
+            cur_l = l.erase(cur_l);
+        } else { //cur_l > cur_r
+            cur_r++;
+        }
+    }
+
+    if (cur_l != std::end(l)) {
+        l.erase(cur_l, std::end(l));
+    }
+}
+
+static void test_set_subtract(std::set<source>& l, const std::set<source>& r)
+{
+    for (auto & e : r) {
+        l.erase(e);
+    }
+}
+
+//erase while iterating, as the querier does with the sources of an expired source timer
+static void test_set_erase_if(std::set<source>& l, const std::set<source>& r)
+{
+    for (auto it = std::begin(l); it != std::end(l);) {
+        if (r.count(*it) > 0) {
+            it = l.erase(it);
+            continue;
+        }
+        ++it;
+    }
+}
+
+void membership_db::test_source_list()
+{
+    using namespace std;
+    HC_LOG_TRACE("");
+    cout << "##-- source_list test --##" << endl;
+
+    log_silencer silencer;
+
+    //every run copies the left hand side and applies one operation, the copy is part of both measurements
+    auto measure = [](const string & name, unsigned int size, unsigned int runs, unsigned long sl_nsec, unsigned long set_nsec) {
+        cout << setw(6) << left << name << " " << setw(5) << right << size << " sources: "
+             << "source_list " << setw(8) << sl_nsec / runs << "nsec, "
+             << "std::set " << setw(8) << set_nsec / runs << "nsec, "
+             << "speedup " << fixed << setprecision(1) << static_cast<double>(set_nsec) / sl_nsec << endl;
+    };
+
+    for (unsigned int size = 1; size <= 4096; size *= 2) {
+        const unsigned int runs = 1000000 / size;
+
+        //half of the sources are in both lists
+        source_list<source> sl_a;
+        source_list<source> sl_b;
+        set<source> set_a;
+        set<source> set_b;
+        for (unsigned int i = 0; i < size; ++i) {
+            in_addr a;
+            a.s_addr = htonl(0x0a000000 | (2 * i));
+            in_addr b;
+            b.s_addr = htonl(0x0a000000 | (2 * i + (i % 2) * size));
+            sl_a.insert(source(addr_storage(a)));
+            sl_b.insert(source(addr_storage(b)));
+            set_a.insert(source(addr_storage(a)));
+            set_b.insert(source(addr_storage(b)));
+        }
+
+        auto check = [&](const string & name, const source_list<source>& sl, const set<source>& s) {
+            if (sl.size() != s.size() || !equal(sl.begin(), sl.end(), s.begin())) {
+                cout << name << " " << size << " sources: FAILED, result differs from std::set" << endl;
+            }
+        };
+
+        auto run_source_list = [&](void (*op)(source_list<source>&, const source_list<source>&), source_list<source>& result) {
+            return measure_nsec([&]() {
+                result = sl_a;
+                op(result, sl_b);
+            }, runs);
+        };
+
+        auto run_set = [&](void (*op)(set<source>&, const set<source>&), set<source>& result) {
+            return measure_nsec([&]() {
+                result = set_a;
+                op(result, set_b);
+            }, runs);
+        };
+
+        source_list<source> sl_result;
+        set<source> set_result;
+        unsigned long sl_nsec;
+        unsigned long set_nsec;
+
+        sl_nsec = run_source_list([](source_list<source>& l, const source_list<source>& r) {
+            l += r;
+        }, sl_result);
+        set_nsec = run_set(test_set_unite, set_result);
+        check("a + b", sl_result, set_result);
+        measure("a + b", size, runs, sl_nsec, set_nsec);
+
+        sl_nsec = run_source_list([](source_list<source>& l, const source_list<source>& r) {
+            l *= r;
+        }, sl_result);
+        set_nsec = run_set(test_set_intersect, set_result);
+        check("a * b", sl_result, set_result);
+        measure("a * b", size, runs, sl_nsec, set_nsec);
+
+        sl_nsec = run_source_list([](source_list<source>& l, const source_list<source>& r) {
+            l -= r;
+        }, sl_result);
+        set_nsec = run_set(test_set_subtract, set_result);
+        check("a - b", sl_result, set_result);
+        measure("a - b", size, runs, sl_nsec, set_nsec);
+
+        sl_nsec = run_source_list([](source_list<source>& l, const source_list<source>& r) {
+            l.erase_if([&r](const source & s) {
+                return r.count(s) > 0;
+            });
+        }, sl_result);
+        set_nsec = run_set(test_set_erase_if, set_result);
+        check("erase", sl_result, set_result);
+        measure("erase", size, runs, sl_nsec, set_nsec);
+    }
+
+    cout << "finished" << endl;
+}
+
+void membership_db::test_group_table()
+{
+    using namespace std;
+    HC_LOG_TRACE("");
+    cout << "##-- group_table test --##" << endl;
+
+    log_silencer silencer;
+
+    const unsigned int num_of_lookups = 2000000;
+    std::default_random_engine random_engine(42);
+
+    for (unsigned int num_of_groups : {10000u, 100000u, 1000000u}) {
+        vector<ip_addr> groups;
+        groups.reserve(num_of_groups);
+        for (unsigned int i = 0; i < num_of_groups; ++i) {
+            in_addr a;
+            a.s_addr = htonl(0xe8000000 | i); //232.0.0.0/8
+            groups.push_back(ip_addr(a));
+        }
+        shuffle(groups.begin(), groups.end(), random_engine);
+
+        vector<unsigned int> lookups;
+        lookups.reserve(num_of_lookups);
+        uniform_int_distribution<unsigned int> index(0, num_of_groups - 1);
+        for (unsigned int i = 0; i < num_of_lookups; ++i) {
+            lookups.push_back(index(random_engine));
+        }
+
+        cout << num_of_groups << " groups, " << num_of_lookups << " lookups" << endl;
+
+        {
+            gaddr_map table;
+            vector<group_handle> handles;
+            handles.reserve(num_of_groups);
+
+            auto insert_msec = measure_nsec([&]() {
+                for (auto & e : groups) {
+                    auto it = table.insert(gaddr_pair(e, gaddr_info(IGMPv3))).first;
+                    it->second.handle = it.get_handle();
+                }
+            }) / 1000000;
+
+            //the handles are read back like the querier does when it arms a timer
+            for (auto & e : groups) {
+                handles.push_back(table.find(e)->second.handle);
+            }
+
+            unsigned long found = 0;
+            auto lookup_msec = measure_nsec([&]() {
+                for (auto i : lookups) {
+                    found += table.find(groups[i]) != table.end() ? 1 : 0;
+                }
+            }) / 1000000;
+
+            auto handle_msec = measure_nsec([&]() {
+                for (auto i : lookups) {
+                    found += table.find(groups[i], handles[i]) != table.end() ? 1 : 0;
+                }
+            }) / 1000000;
+
+            auto erase_msec = measure_nsec([&]() {
+                for (auto & e : groups) {
+                    table.erase(e);
+                }
+            }) / 1000000;
+
+            cout << "  group_table insert " << setw(5) << insert_msec << "msec, lookup " << setw(5) << lookup_msec
+                 << "msec, handle lookup " << setw(5) << handle_msec << "msec, erase " << setw(5) << erase_msec << "msec";
+            cout << (found == 2 * num_of_lookups && table.empty() ? "" : " FAILED") << endl;
+        }
+
+        {
+            map<ip_addr, gaddr_info> m;
+
+            auto insert_msec = measure_nsec([&]() {
+                for (auto & e : groups) {
+                    m.insert(make_pair(e, gaddr_info(IGMPv3)));
+                }
+            }) / 1000000;
+
+            unsigned long found = 0;
+            auto lookup_msec = measure_nsec([&]() {
+                for (auto i : lookups) {
+                    found += m.find(groups[i]) != m.end() ? 1 : 0;
+                }
+            }) / 1000000;
+
+            auto erase_msec = measure_nsec([&]() {
+                for (auto & e : groups) {
+                    m.erase(e);
+                }
+            }) / 1000000;
+
+            cout << "  std::map    insert " << setw(5) << insert_msec << "msec, lookup " << setw(5) << lookup_msec
+                 << "msec,                           erase " << setw(5) << erase_msec << "msec";
+            cout << (found == num_of_lookups && m.empty() ? "" : " FAILED") << endl;
+        }
+    }
+
+    cout << "finished" << endl;
+}
 #endif /* DEBUG_MODE */
 
 gaddr_info::gaddr_info(group_mem_protocol compatibility_mode_variable)
@@ -90,6 +339,9 @@ gaddr_info::gaddr_info(group_mem_protocol compatibility_mode_variable)
     , group_retransmission_timer(nullptr)
     , group_retransmission_count(-1) //not in a retransmission state
     , source_retransmission_timer(nullptr)
+    , notified_fingerprint(0)
+    , notified_all_sources(false)
+    , notified_filter_mode(INCLUDE_MODE)
 {
     HC_LOG_TRACE("");
 }
@@ -103,6 +355,59 @@ bool gaddr_info::is_under_bakcward_compatibility_effects() const{
     return older_host_present_timer.get() != nullptr;        
 }
 
+uint64_t gaddr_info::get_forwarding_fingerprint() const
+{
+    //the same state as seen by querier::suggest_to_forward_traffic() and querier::get_group_membership_infos()
+    if (is_under_bakcward_compatibility_effects()) {
+        return 1; //all sources
+    }
+
+    const source_list<source>& slist = filter_mode == INCLUDE_MODE ? include_requested_list : exclude_list;
+
+    uint64_t result = (filter_mode == INCLUDE_MODE ? 2 : 3) + slist.size() * 0x9e3779b97f4a7c15ULL;
+    for (auto & e : slist) {
+        result = (result ^ e.saddr.hash()) * 0x100000001b3ULL;
+    }
+
+    return result != 0 ? result : 2;
+}
+
+bool gaddr_info::is_notified_forwarding_state(uint64_t fingerprint) const
+{
+    //a different hash is a change for sure, an equal hash may be a collision
+    if (fingerprint != notified_fingerprint) {
+        return false;
+    }
+
+    if (is_under_bakcward_compatibility_effects() || notified_all_sources) {
+        return is_under_bakcward_compatibility_effects() && notified_all_sources;
+    }
+
+    if (filter_mode != notified_filter_mode) {
+        return false;
+    }
+
+    const source_list<source>& slist = filter_mode == INCLUDE_MODE ? include_requested_list : exclude_list;
+    return slist.size() == notified_sources.size() && std::equal(slist.begin(), slist.end(), notified_sources.begin(), [](const source & s, const ip_addr & addr) {
+        return s.saddr == addr;
+    });
+}
+
+void gaddr_info::set_notified_forwarding_state(uint64_t fingerprint)
+{
+    notified_fingerprint = fingerprint;
+    notified_all_sources = is_under_bakcward_compatibility_effects();
+    notified_filter_mode = filter_mode;
+    notified_sources.clear();
+
+    if (!notified_all_sources) {
+        const source_list<source>& slist = filter_mode == INCLUDE_MODE ? include_requested_list : exclude_list;
+        for (auto & e : slist) {
+            notified_sources.push_back(e.saddr);
+        }
+    }
+}
+
 std::ostream& operator<<(std::ostream& stream, const gaddr_info& g)
 {
     return stream << g.to_string();
@@ -170,9 +475,9 @@ std::string membership_db::to_string() const
     s << "startup query count: " << startup_query_count << endl;
 
     s << "subscribed groups: " << group_info.size();
-    for (auto & e : group_info) {
-        s << endl << "-- group address: " << e.first << endl;
-        s << indention(e.second.to_string());
+    for (auto e : group_info.get_sorted()) {
+        s << endl << "-- group address: " << e->first << endl;
+        s << indention(e->second.to_string());
     }
 
     return s.str();
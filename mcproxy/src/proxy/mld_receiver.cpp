@@ -34,8 +34,8 @@
 //DEBUG
 #include <net/if.h>
 
-mld_receiver::mld_receiver(proxy_instance* pr_i, const std::shared_ptr<const mroute_socket> mrt_sock, const std::shared_ptr<const interfaces> interfaces, bool in_debug_testing_mode)
-    : receiver(pr_i, AF_INET6, mrt_sock, interfaces, in_debug_testing_mode)
+mld_receiver::mld_receiver(proxy_instance* pr_i, const std::shared_ptr<const mroute_socket> mrt_sock, const std::shared_ptr<const interfaces> interfaces, bool in_debug_testing_mode, const receiver_msg_handler& msg_handler)
+    : receiver(pr_i, AF_INET6, mrt_sock, interfaces, in_debug_testing_mode, msg_handler)
 {
     HC_LOG_TRACE("");
     if (!m_mrt_sock->set_ipv6_recv_icmpv6_msg()) {
@@ -49,6 +49,30 @@ mld_receiver::mld_receiver(proxy_instance* pr_i, const std::shared_ptr<const mro
     start();
 }
 
+void mld_receiver::generate_socket_filter(std::vector<struct sock_filter>& prog) const
+{
+    HC_LOG_TRACE("");
+
+    //the socket delivers the icmpv6 header, kernel messages have the type 0, accept cache misses
+    prog.push_back(BPF_STMT(BPF_LD | BPF_B | BPF_ABS, offsetof(struct mld_hdr, mld_type)));
+    prog.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, MLD_RECEIVER_KERNEL_MSG, 0, 4));
+    prog.push_back(BPF_STMT(BPF_LD | BPF_B | BPF_ABS, offsetof(struct mrt6msg, im6_msgtype)));
+    prog.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, MRT6MSG_NOCACHE, 0, 1));
+    prog.push_back(BPF_STMT(BPF_RET | BPF_K, RECEIVER_FILTER_ACCEPT));
+    prog.push_back(BPF_STMT(BPF_RET | BPF_K, RECEIVER_FILTER_DROP));
+
+    //the accumulator still holds the mld type
+    std::vector<unsigned char> types {MLD_LISTENER_REPORT, MLD_LISTENER_REDUCTION, MLD_V2_LISTENER_REPORT};
+
+    //only the host reporter of the upstreams processes queries
+    if (is_query_relevant()) {
+        types.push_back(MLD_LISTENER_QUERY);
+    }
+    add_filter_types(prog, types);
+
+    add_filter_relevant_interfaces(prog, MLD_LISTENER_QUERY);
+}
+
 int mld_receiver::get_iov_min_size()
 {
     HC_LOG_TRACE("");
@@ -61,10 +85,23 @@ int mld_receiver::get_ctrl_min_size()
 {
     HC_LOG_TRACE("");
 
-    return sizeof(struct cmsghdr) + sizeof(struct in6_pktinfo);
+    //the control buffers of the receive ring are placed at multiples of this size, CMSG_SPACE keeps each cmsghdr aligned
+    return CMSG_SPACE(sizeof(struct in6_pktinfo));
+}
+
+addr_storage mld_receiver::get_saddr(struct msghdr* msg)
+{
+    HC_LOG_TRACE("");
+
+    //the raw socket delivers the mld message without ip header, the source address is the message name
+    if (msg->msg_name != nullptr && msg->msg_namelen >= sizeof(struct sockaddr_in6)) {
+        return addr_storage(*reinterpret_cast<struct sockaddr_in6*>(msg->msg_name));
+    } else {
+        return addr_storage(AF_INET6);
+    }
 }
 
-void mld_receiver::analyse_packet(struct msghdr* msg, int)
+void mld_receiver::analyse_packet(struct msghdr* msg, int info_size)
 {
     HC_LOG_TRACE("");
 
@@ -99,7 +136,7 @@ void mld_receiver::analyse_packet(struct msghdr* msg, int)
                 return;
             }
 
-            m_proxy_instance->add_msg(std::make_shared<new_source_msg>(if_index, gaddr, saddr));
+            forward_msg(std::make_shared<new_source_msg>(if_index, ip_addr(gaddr), ip_addr(saddr)));
             break;
         }
         default:
@@ -108,19 +145,12 @@ void mld_receiver::analyse_packet(struct msghdr* msg, int)
     } else if (hdr->mld_type == MLD_LISTENER_REPORT || hdr->mld_type == MLD_LISTENER_REDUCTION) {
         HC_LOG_DEBUG("MLD_LISTENER_REPORT or MLD_LISTENER_REDUCTION received");
 
-        struct in6_pktinfo* packet_info = nullptr;
+        saddr = get_saddr(msg);
+        HC_LOG_DEBUG("\tsaddr: " << saddr);
 
-        for (struct cmsghdr* cmsgptr = CMSG_FIRSTHDR(msg); cmsgptr != nullptr; cmsgptr = CMSG_NXTHDR(msg, cmsgptr)) {
-            if (cmsgptr->cmsg_len > 0 && cmsgptr->cmsg_level == IPPROTO_IPV6 && cmsgptr->cmsg_type == IPV6_PKTINFO ) {
-                packet_info = (struct in6_pktinfo*)CMSG_DATA(cmsgptr);
-            }
-        }
-        if (packet_info == nullptr) {
+        if ((if_index = get_ingress_if_index(msg, saddr)) == 0) {
             return;
         }
-
-        HC_LOG_DEBUG("\tsaddr: " << addr_storage(packet_info->ipi6_addr));
-        if_index = packet_info->ipi6_ifindex;
         HC_LOG_DEBUG("\treceived on interface:" << interfaces::get_if_name(if_index));
 
         if (!is_if_index_relevant(if_index)) {
@@ -133,24 +163,20 @@ void mld_receiver::analyse_packet(struct msghdr* msg, int)
 
         if (hdr->mld_type == MLD_LISTENER_REPORT) {
             HC_LOG_DEBUG("\treport received");
-            m_proxy_instance->add_msg(std::make_shared<group_record_msg>(if_index, MODE_IS_EXCLUDE, gaddr, source_list<source>(), MLDv1));
+            forward_msg(std::make_shared<group_record_msg>(if_index, MODE_IS_EXCLUDE, ip_addr(gaddr), source_list<source>(), MLDv1));
         } else if (hdr->mld_type == MLD_LISTENER_REDUCTION) {
             HC_LOG_DEBUG("\tlistener reduction received");
-            m_proxy_instance->add_msg(std::make_shared<group_record_msg>(if_index, CHANGE_TO_INCLUDE_MODE, gaddr, source_list<source>(), MLDv1));
+            forward_msg(std::make_shared<group_record_msg>(if_index, CHANGE_TO_INCLUDE_MODE, ip_addr(gaddr), source_list<source>(), MLDv1));
         } else {
             HC_LOG_ERROR("unkown mld type: " << hdr->mld_type);
         }
     } else if (hdr->mld_type == MLD_V2_LISTENER_REPORT) {
         HC_LOG_DEBUG("MLD_V2_LISTENER_REPORT received");
 
-        struct in6_pktinfo* packet_info = nullptr;
+        saddr = get_saddr(msg);
+        HC_LOG_DEBUG("\tsaddr: " << saddr);
 
-        for (struct cmsghdr* cmsgptr = CMSG_FIRSTHDR(msg); cmsgptr != nullptr; cmsgptr = CMSG_NXTHDR(msg, cmsgptr)) {
-            if (cmsgptr->cmsg_len > 0 && cmsgptr->cmsg_level == IPPROTO_IPV6 && cmsgptr->cmsg_type == IPV6_PKTINFO ) {
-                packet_info = (struct in6_pktinfo*)CMSG_DATA(cmsgptr);
-            }
-        }
-        if (packet_info == nullptr) {
+        if ((if_index = get_ingress_if_index(msg, saddr)) == 0) {
             return;
         }
 
@@ -160,7 +186,6 @@ void mld_receiver::analyse_packet(struct msghdr* msg, int)
         int num_records = ntohs(v3_report->num_of_mc_records);
         HC_LOG_DEBUG("\tnum of multicast records: " << num_records);
 
-        if_index = packet_info->ipi6_ifindex;
         HC_LOG_DEBUG("\treceived on interface:" << interfaces::get_if_name(if_index));
 
         if (!is_if_index_relevant(if_index)) {
@@ -168,6 +193,8 @@ void mld_receiver::analyse_packet(struct msghdr* msg, int)
             return;
         }
 
+        auto report = std::make_shared<group_report_msg>(if_index, MLDv2, num_records);
+
         for (int i = 0; i < num_records; ++i) {
             mcast_addr_record_type rec_type = static_cast<mcast_addr_record_type>(rec->type);
             unsigned int aux_size = rec->aux_data_len * 4; //RFC 3810 Section 5.2.6 Aux Data Len
@@ -178,7 +205,7 @@ void mld_receiver::analyse_packet(struct msghdr* msg, int)
 
             in6_addr* src = reinterpret_cast<in6_addr*>(reinterpret_cast<unsigned char*>(rec) + sizeof(mldv2_mc_record));
             for (int j = 0; j < nos; ++j) {
-                slist.insert(addr_storage(*src));
+                slist.insert(source(ip_addr(*src)));
                 ++src;
             }
 
@@ -186,13 +213,55 @@ void mld_receiver::analyse_packet(struct msghdr* msg, int)
             HC_LOG_DEBUG("\tgaddr: " << gaddr);
             HC_LOG_DEBUG("\tnumber of sources: " << slist.size());
             HC_LOG_DEBUG("\tsource_list: " << slist);
-            m_proxy_instance->add_msg(std::make_shared<group_record_msg>(if_index, rec_type, gaddr, move(slist), MLDv2));
+            report->add_record(rec_type, ip_addr(gaddr), std::move(slist));
 
             rec = reinterpret_cast<mldv2_mc_record*>(reinterpret_cast<unsigned char*>(rec) + sizeof(mldv2_mc_record) + nos * sizeof(in6_addr) + aux_size);
         }
+
+        forward_msg(report);
     } else if (hdr->mld_type == MLD_LISTENER_QUERY) {
         HC_LOG_DEBUG("MLD_LISTENER_QUERY received");
-        HC_LOG_WARN("querier election is not implemented");
+
+        saddr = get_saddr(msg);
+        HC_LOG_DEBUG("\tsaddr: " << saddr);
+
+        if ((if_index = get_ingress_if_index(msg, saddr)) == 0) {
+            return;
+        }
+        HC_LOG_DEBUG("\treceived on interface:" << interfaces::get_if_name(if_index));
+
+        if (!is_if_index_relevant(if_index)) {
+            HC_LOG_DEBUG("interface is not relevant");
+            return;
+        }
+
+        //the group address of a general query is ::
+        ip_addr query_gaddr;
+        if (!IN6_IS_ADDR_UNSPECIFIED(&hdr->mld_addr)) {
+            query_gaddr = ip_addr(hdr->mld_addr);
+        }
+
+        unsigned int mld_size = info_size;
+        if (mld_size >= sizeof(mldv2_query)) { //RFC 3810 Section 8.1 Query Version Distinctions
+            mldv2_query* query = reinterpret_cast<mldv2_query*>(hdr);
+            unsigned int nos = ntohs(query->num_of_srcs);
+            if (mld_size < sizeof(mldv2_query) + nos * sizeof(in6_addr)) {
+                HC_LOG_WARN("truncated MLDv2 query");
+                return;
+            }
+
+            std::vector<ip_addr> sources;
+            sources.reserve(nos);
+            in6_addr* src = reinterpret_cast<in6_addr*>(reinterpret_cast<unsigned char*>(query) + sizeof(mldv2_query));
+            for (unsigned int i = 0; i < nos; ++i) {
+                sources.push_back(ip_addr(*src));
+                ++src;
+            }
+
+            forward_msg(std::make_shared<membership_query_msg>(if_index, MLDv2, query_gaddr, timers_values().maxrespc_mldv2_to_maxrespi(ntohs(query->max_resp_delay)), static_cast<unsigned int>(query->qrv), std::move(sources)));
+        } else {
+            forward_msg(std::make_shared<membership_query_msg>(if_index, MLDv1, query_gaddr, std::chrono::milliseconds(ntohs(hdr->mld_maxdelay)), 0, std::vector<ip_addr>()));
+        }
     } else {
         HC_LOG_DEBUG("unknown MLD-packet: " << (int)(hdr->mld_type));
     }
@@ -29,6 +29,7 @@
 #include <netinet/icmp6.h>
 #include <netinet/ip6.h>
 
+#include <algorithm>
 #include <memory>
 
 mld_sender::mld_sender(const std::shared_ptr<const interfaces>& interfaces): sender(interfaces, MLDv2)
@@ -53,16 +54,15 @@ bool mld_sender::send_record(unsigned int if_index, mc_filter filter_mode, const
     HC_LOG_TRACE("");
 
     if (filter_mode == INCLUDE_MODE && slist.empty() ) {
-        m_sock.leave_group(gaddr, if_index);
+        m_memberships.leave_group(if_index, gaddr);
         return true;
-    } else if (filter_mode == EXCLUDE_MODE || filter_mode == EXCLUDE_MODE) {
-        m_sock.join_group(gaddr, if_index);
+    } else if (filter_mode == EXCLUDE_MODE || filter_mode == INCLUDE_MODE) {
         std::list<addr_storage> src_list;
         for (auto & e : slist) {
-            src_list.push_back(e.saddr);
+            src_list.push_back(e.saddr.to_addr_storage());
         }
 
-        return m_sock.set_source_filter(if_index, gaddr, filter_mode, src_list);
+        return m_memberships.set_source_filter(if_index, gaddr, filter_mode, src_list);
     } else {
         HC_LOG_ERROR("unknown filter mode");
         return false;
@@ -73,14 +73,18 @@ bool mld_sender::send_general_query(unsigned int if_index, const timers_values&
 {
     HC_LOG_TRACE("");
 
-    return send_mldv2_query(if_index, tv, addr_storage(AF_INET6), false, source_list<source>());
+    packet_buffer& buf = get_packet_buffer(if_index);
+    add_mldv2_query(buf, if_index, tv, addr_storage(AF_INET6), false, source_list<source>());
+    return send_mldv2_queries(if_index, addr_storage(AF_INET6), buf);
 }
 
 bool mld_sender::send_mc_addr_specific_query(unsigned int if_index, const timers_values& tv, const addr_storage& gaddr, bool s_flag) const
 {
     HC_LOG_TRACE("");
 
-    return send_mldv2_query(if_index, tv, gaddr, s_flag, source_list<source>());
+    packet_buffer& buf = get_packet_buffer(if_index);
+    add_mldv2_query(buf, if_index, tv, gaddr, s_flag, source_list<source>());
+    return send_mldv2_queries(if_index, gaddr, buf);
 }
 
 bool mld_sender::send_mc_addr_and_src_specific_query(unsigned int if_index, const timers_values& tv, const addr_storage& gaddr, source_list<source>& slist) const
@@ -110,73 +114,151 @@ bool mld_sender::send_mc_addr_and_src_specific_query(unsigned int if_index, cons
         }
     }
 
+    //both parts of the query are sent with one sendmmsg() call
+    packet_buffer& buf = get_packet_buffer(if_index);
     if (!slist_higher.empty()) {
-        send_mldv2_query(if_index, tv, gaddr, true, slist_higher);
+        add_mldv2_query(buf, if_index, tv, gaddr, true, slist_higher);
     }
 
     if (!slist_lower.empty()) {
-        send_mldv2_query(if_index, tv, gaddr, false, slist_lower);
+        add_mldv2_query(buf, if_index, tv, gaddr, false, slist_lower);
+    }
+
+    if (!buf.sizes.empty()) {
+        send_mldv2_queries(if_index, gaddr, buf);
     }
 
     return rc;
 }
 
-bool mld_sender::send_mldv2_query(unsigned int if_index, const timers_values& tv, const addr_storage& gaddr, bool s_flag, const source_list<source>& slist) const
+void mld_sender::add_mldv2_query(packet_buffer& buf, unsigned int if_index, const timers_values& tv, const addr_storage& gaddr, bool s_flag, const source_list<source>& slist) const
 {
     HC_LOG_TRACE("");
 
-    std::unique_ptr<mldv2_query> q;
-    unsigned int size;
+    //RFC 3810 Section 5.1.10, a source list that does not fit into the MTU is split into multiple queries
+    const unsigned int header_size = sizeof(ip6_hdr) + sizeof(ip6_hbh) + sizeof(ip6_opt_router) + sizeof(pad2) + sizeof(mldv2_query);
+    const unsigned int mtu = get_mtu(if_index);
+    const unsigned int max_srcs = mtu > header_size + sizeof(in6_addr) ? (mtu - header_size) / sizeof(in6_addr) : 1;
 
-    if (slist.empty()) {
-        size = sizeof(mldv2_query);
-        q.reset(new mldv2_query);
-    } else {
-        size = sizeof(mldv2_query) + (slist.size() * sizeof(in6_addr));
-        q.reset(reinterpret_cast<mldv2_query*>(new unsigned char[size]));
-    }
+    auto src_it = slist.begin();
+    unsigned int remaining_srcs = slist.size();
+
+    do {
+        unsigned int num_of_srcs = std::min(remaining_srcs, max_srcs);
+        remaining_srcs -= num_of_srcs;
+
+        mldv2_query* q = reinterpret_cast<mldv2_query*>(add_packet(buf, sizeof(mldv2_query) + num_of_srcs * sizeof(in6_addr)));
 
-    q->type = MLD_LISTENER_QUERY;
-    q->code = 0;
-    q->checksum = MC_MASSAGES_AUTO_FILL;
+        q->type = MLD_LISTENER_QUERY;
+        q->code = 0;
+        q->checksum = MC_MASSAGES_AUTO_FILL;
+
+        if (gaddr == addr_storage(AF_INET6)) { //general query
+            q->max_resp_delay = htons(tv.maxrespi_to_maxrespc_mldv2(tv.get_query_response_interval()));
+        } else {
+            q->max_resp_delay = htons(tv.maxrespi_to_maxrespc_mldv2(tv.get_last_listener_query_time()));
+        }
+
+        q->reserved = 0;
+        q->gaddr = gaddr.get_in6_addr();
+        q->resv2 = 0;
+        q->suppress = s_flag;
+
+        if (tv.get_robustness_variable() <= 7) {
+            q->qrv = tv.get_robustness_variable();
+        } else {
+            q->qrv = 0;
+        }
 
-    addr_storage dst_addr;
+        q->qqic = tv.qqi_to_qqic(tv.get_query_interval());
+        q->num_of_srcs = htons(num_of_srcs);
+
+        in6_addr* source_ptr = reinterpret_cast<in6_addr*>(reinterpret_cast<unsigned char*>(q) + sizeof(mldv2_query));
+        for (unsigned int i = 0; i < num_of_srcs; ++i, ++src_it) {
+            *source_ptr = src_it->saddr.get_in6_addr();
+            source_ptr++;
+        }
+    } while (remaining_srcs > 0);
+}
+
+addr_storage mld_sender::get_query_dst_addr(const addr_storage& gaddr) const
+{
+    HC_LOG_TRACE("");
 
     if (gaddr == addr_storage(AF_INET6)) { //general query
-        dst_addr = IPV6_ALL_NODES_ADDR;
-        q->max_resp_delay = htons(tv.maxrespi_to_maxrespc_mldv2(tv.get_query_response_interval()));
+        return addr_storage(IPV6_ALL_NODES_ADDR);
     } else { //all other types of queries
-        dst_addr = gaddr;
-        q->max_resp_delay = htons(tv.maxrespi_to_maxrespc_mldv2(tv.get_last_listener_query_time()));
+        return gaddr;
     }
+}
 
-    q->reserved = 0;
-    q->gaddr = gaddr.get_in6_addr();
-    q->resv2 = 0;
-    q->suppress = s_flag;
+bool mld_sender::send_mldv2_queries(unsigned int if_index, const addr_storage& gaddr, const packet_buffer& buf) const
+{
+    HC_LOG_TRACE("");
 
-    if (tv.get_robustness_variable() <= 7) {
-        q->qrv = tv.get_robustness_variable();
-    } else {
-        q->qrv = 0;
+    if (!m_sock.choose_if(if_index)) {
+        return false;
     }
 
-    q->qqic = tv.qqi_to_qqic(tv.get_query_interval());
-    q->num_of_srcs = ntohs(slist.size());
+    return send_packets(get_query_dst_addr(gaddr), buf);
+}
 
-    if (!slist.empty()) {
-        in6_addr* source_ptr = reinterpret_cast<in6_addr*>(reinterpret_cast<unsigned char*>(q.get()) + sizeof(mldv2_query));
-        for (auto & e : slist) {
-            *source_ptr = e.saddr.get_in6_addr();
+unsigned int mld_sender::get_report_capacity(unsigned int if_index) const
+{
+    HC_LOG_TRACE("");
+
+    unsigned int mtu = get_mtu(if_index);
+    unsigned int header_size = sizeof(ip6_hdr) + sizeof(ip6_hbh) + sizeof(ip6_opt_router) + sizeof(pad2) + sizeof(mldv2_mc_report);
+    return mtu > header_size ? mtu - header_size : 0;
+}
+
+unsigned int mld_sender::get_record_size(unsigned int num_of_srcs) const
+{
+    HC_LOG_TRACE("");
+    return sizeof(mldv2_mc_record) + num_of_srcs * sizeof(in6_addr);
+}
+
+bool mld_sender::send_report(unsigned int if_index, const std::vector<report_record>& records) const
+{
+    HC_LOG_TRACE("");
+
+    unsigned int size = sizeof(mldv2_mc_report);
+    for (auto & e : records) {
+        size += get_record_size(e.sources.size());
+    }
+
+    packet_buffer& buf = get_packet_buffer(if_index);
+    unsigned char* packet = add_packet(buf, size);
+
+    mldv2_mc_report* report = reinterpret_cast<mldv2_mc_report*>(packet);
+    report->type = MLD_V2_LISTENER_REPORT;
+    report->reservedA = 0;
+    report->checksum = MC_MASSAGES_AUTO_FILL;
+    report->reservedB = 0;
+    report->num_of_mc_records = htons(records.size());
+
+    unsigned char* pos = packet + sizeof(mldv2_mc_report);
+    for (auto & e : records) {
+        mldv2_mc_record* rec = reinterpret_cast<mldv2_mc_record*>(pos);
+        rec->type = e.type;
+        rec->aux_data_len = 0;
+        rec->num_of_srcs = htons(e.sources.size());
+        rec->gaddr = e.gaddr.get_in6_addr();
+
+        in6_addr* source_ptr = reinterpret_cast<in6_addr*>(pos + sizeof(mldv2_mc_record));
+        for (auto & s : e.sources) {
+            *source_ptr = s.get_in6_addr();
             source_ptr++;
         }
+
+        pos += get_record_size(e.sources.size());
     }
 
     if (!m_sock.choose_if(if_index)) {
         return false;
     }
 
-    return m_sock.send_packet(dst_addr, reinterpret_cast<unsigned char*>(q.get()), size);
+    return send_packets(addr_storage(IPV6_ALL_MLDv2_CAPABLE_ROUTERS), buf);
 }
 
 bool mld_sender::add_hbh_opt_header() const
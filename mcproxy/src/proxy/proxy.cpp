@@ -43,6 +43,7 @@ proxy::proxy(int arg_count, char* args[])
     : m_verbose_lvl(0)
     , m_print_proxy_status(false)
     , m_reset_rp_filter(false)
+    , m_event_loop_mode(false)
     , m_config_path(CONFIGURATION_DEFAULT_CONIG_PATH)
     , m_configuration(nullptr)
     , m_timing(std::make_shared<timing>())
@@ -91,7 +92,7 @@ void proxy::help_output()
     cout << "Usage:" << endl;
     cout << "  mcproxy [-h]" << endl;
     cout << "  mcproxy [-c]" << endl;
-    cout << "  mcproxy [-r] [-d] [-s] [-v [-v]] [-f <config file>]" << endl;
+    cout << "  mcproxy [-r] [-d] [-s] [-e] [-v [-v]] [-f <config file>]" << endl;
     cout << endl;
     cout << "\t-h" << endl;
     cout << "\t\tDisplay this help screen." << endl;
@@ -107,6 +108,10 @@ void proxy::help_output()
     cout << "\t-s" << endl;
     cout << "\t\tPrint proxy status information repeatedly." << endl;
 
+    cout << "\t-e" << endl;
+    cout << "\t\tRun each proxy instance in a single event loop thread" << endl;
+    cout << "\t\tinstead of separate receiver, worker and timing threads." << endl;
+
     cout << "\t-v" << endl;
     cout << "\t\tBe verbose. Give twice to see even more messages" << endl;
 
@@ -127,7 +132,7 @@ void proxy::prozess_commandline_args(int arg_count, char* args[])
     if (arg_count == 1) {
 
     } else {
-        for (int c; (c = getopt(arg_count, args, "hrdsvcf:")) != -1;) {
+        for (int c; (c = getopt(arg_count, args, "hrdsevcf:")) != -1;) {
             switch (c) {
             case 'h':
                 help_output();
@@ -145,6 +150,9 @@ void proxy::prozess_commandline_args(int arg_count, char* args[])
             case 's':
                 m_print_proxy_status = true;
                 break;
+            case 'e':
+                m_event_loop_mode = true;
+                break;
             case 'v':
                 m_verbose_lvl++;
                 break;
@@ -218,7 +226,7 @@ void proxy::start_proxy_instances()
 
         auto& interfaces = m_configuration->get_interfaces_for_pinstance(instance_name);
 
-        std::unique_ptr<proxy_instance> pr_i(new proxy_instance(m_configuration->get_group_mem_protocol(), instance_name, table_number, interfaces, m_timing));
+        std::unique_ptr<proxy_instance> pr_i(new proxy_instance(m_configuration->get_group_mem_protocol(), instance_name, table_number, pinstance->get_source_life_time(), pinstance->get_upstream_report_interval(), pinstance->get_host_reports(), interfaces, m_timing, false, m_event_loop_mode));
 
         //global rule bindung      
         auto& global_settings = pinstance->get_global_settings();
@@ -282,6 +290,8 @@ void proxy::start()
                 e.second->add_msg(std::make_shared<debug_msg>());
                 sleep(2);
             }
+            cout << *m_timing << endl;
+            cout << endl;
         } else {
             sleep(2);
         }
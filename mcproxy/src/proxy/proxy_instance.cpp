@@ -36,22 +36,35 @@
 #include "include/proxy/timing.hpp"
 #include "include/proxy/routing_management.hpp"
 #include "include/proxy/simple_mc_proxy_routing.hpp"
+#include "include/proxy/host_reporter.hpp"
+#include "include/utils/benchmark.hpp"
 
 #include <sstream>
 #include <iostream>
+#include <iomanip>
+#include <cstring>
 #include <random>
 #include <algorithm>
+#include <condition_variable>
+#include <future>
+#include <mutex>
 
 #include <unistd.h>
 #include <net/if.h>
+#include <arpa/inet.h>
+#include <sys/epoll.h>
 
-proxy_instance::proxy_instance(group_mem_protocol group_mem_protocol, const std::string& instance_name, int table_number, const std::shared_ptr<const interfaces>& interfaces, const std::shared_ptr<timing>& shared_timing, bool in_debug_testing_mode)
+proxy_instance::proxy_instance(group_mem_protocol group_mem_protocol, const std::string& instance_name, int table_number, const std::chrono::milliseconds& source_life_time, const std::chrono::milliseconds& upstream_report_interval, bool host_reports, const std::shared_ptr<const interfaces>& interfaces, const std::shared_ptr<timing>& shared_timing, bool in_debug_testing_mode, bool in_event_loop_mode)
 : m_group_mem_protocol(group_mem_protocol)
 , m_instance_name(instance_name)
 , m_table_number(table_number)
+, m_source_life_time(source_life_time)
+, m_upstream_report_interval(upstream_report_interval)
+, m_host_reports(host_reports)
 , m_in_debug_testing_mode(in_debug_testing_mode)
+, m_in_event_loop_mode(in_event_loop_mode)
 , m_interfaces(interfaces)
-, m_timing(shared_timing)
+, m_timing(in_event_loop_mode ? std::make_shared<timing>(false) : shared_timing)
 , m_mrt_sock(nullptr)
 , m_sender(nullptr)
 , m_receiver(nullptr)
@@ -59,6 +72,9 @@ proxy_instance::proxy_instance(group_mem_protocol group_mem_protocol, const std:
 , m_proxy_start_time(std::chrono::steady_clock::now())
 , m_upstream_input_rule(std::make_shared<rule_binding>(instance_name, IT_UPSTREAM, "*", ID_IN, RMT_FIRST, std::chrono::milliseconds(0)))
 , m_upstream_output_rule(std::make_shared<rule_binding>(instance_name, IT_UPSTREAM, "*", ID_OUT, RMT_ALL, std::chrono::milliseconds(0)))
+, m_batch_count(0)
+, m_batch_msg_count(0)
+, m_max_batch_size(0)
 {
 
     //rule_binding(const std::string& instance_name, rb_interface_type interface_type, const std::string& if_name, rb_interface_direction filter_direction, rb_rule_matching_type rule_matching_type, const std::chrono::milliseconds& timeout);
@@ -84,6 +100,10 @@ proxy_instance::proxy_instance(group_mem_protocol group_mem_protocol, const std:
         throw "failed to initialise routing";
     }
 
+    if (!init_host_reporter()) {
+        throw "failed to initialise host reporter";
+    }
+
     start();
 }
 
@@ -134,10 +154,18 @@ bool proxy_instance::init_receiver()
 {
     HC_LOG_TRACE("");
 
+    //in event loop mode the received messages are processed without the job queue
+    receiver_msg_handler msg_handler = nullptr;
+    if (m_in_event_loop_mode) {
+        msg_handler = [this](const std::shared_ptr<proxy_msg>& msg) {
+            process_msg(msg);
+        };
+    }
+
     if (is_IPv4(m_group_mem_protocol)) {
-        m_receiver.reset(new igmp_receiver(this, m_mrt_sock, m_interfaces, m_in_debug_testing_mode));
+        m_receiver.reset(new igmp_receiver(this, m_mrt_sock, m_interfaces, m_in_debug_testing_mode, msg_handler));
     } else if (is_IPv6(m_group_mem_protocol)) {
-        m_receiver.reset(new mld_receiver(this, m_mrt_sock, m_interfaces, m_in_debug_testing_mode));
+        m_receiver.reset(new mld_receiver(this, m_mrt_sock, m_interfaces, m_in_debug_testing_mode, msg_handler));
     } else {
         HC_LOG_ERROR("unknown ip version");
         return false;
@@ -160,6 +188,23 @@ bool proxy_instance::init_routing_management()
     return true;
 }
 
+bool proxy_instance::init_host_reporter()
+{
+    HC_LOG_TRACE("");
+
+    if (!m_host_reports) {
+        return true;
+    }
+
+    if (m_group_mem_protocol != IGMPv3 && m_group_mem_protocol != MLDv2) {
+        HC_LOG_ERROR("host reports require IGMPv3 or MLDv2");
+        return false;
+    }
+
+    m_host_reporter.reset(new host_reporter(this, m_group_mem_protocol, m_sender, m_timing));
+    return true;
+}
+
 proxy_instance::~proxy_instance()
 {
     HC_LOG_TRACE("");
@@ -169,67 +214,291 @@ proxy_instance::~proxy_instance()
 void proxy_instance::worker_thread()
 {
     HC_LOG_TRACE("");
+
+    if (m_in_event_loop_mode) {
+        event_loop();
+        return;
+    }
+
+    std::vector<std::shared_ptr<proxy_msg>> batch;
+    batch.reserve(PROXY_INSTANCE_MSG_BATCH_SIZE);
+
     while (m_running) {
-        auto msg = m_job_queue.dequeue();
-        switch (msg->get_type()) {
-        case proxy_msg::TEST_MSG:
-            (*msg)();
-            break;
-        case proxy_msg::CONFIG_MSG:
-            handle_config(std::static_pointer_cast<config_msg>(msg));
+        batch.clear();
+        count_batch(m_job_queue.dequeue_batch(batch, PROXY_INSTANCE_MSG_BATCH_SIZE));
+
+        for (auto & msg : batch) {
+            if (!m_running) {
+                break;
+            }
+            process_msg(msg);
+        }
+
+        process_deferred_state_changes();
+    }
+
+    HC_LOG_DEBUG("worker thread proxy_instance end");
+}
+
+void proxy_instance::event_loop()
+{
+    HC_LOG_TRACE("");
+
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0) {
+        HC_LOG_ERROR("failed to create epoll instance! Error: " << strerror(errno) << " errno: " << errno);
+        stop();
+        return;
+    }
+
+    const int mrt_fd = m_mrt_sock->get_socket();
+    const int timer_fd = m_timing->get_timer_fd();
+    const int queue_fd = m_job_queue.get_event_fd();
+
+    for (int fd : {mrt_fd, timer_fd, queue_fd}) {
+        epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            HC_LOG_ERROR("failed to add fd " << fd << " to epoll instance! Error: " << strerror(errno) << " errno: " << errno);
+            close(epoll_fd);
+            stop();
+            return;
+        }
+    }
+
+    std::vector<std::shared_ptr<proxy_msg>> batch;
+    batch.reserve(PROXY_INSTANCE_MSG_BATCH_SIZE);
+    epoll_event events[PROXY_INSTANCE_EVENT_LOOP_FDS];
+
+    while (m_running) {
+        //config, debug and timer messages
+        batch.clear();
+        count_batch(m_job_queue.try_dequeue_batch(batch, PROXY_INSTANCE_MSG_BATCH_SIZE));
+
+        for (auto & msg : batch) {
+            if (!m_running) {
+                break;
+            }
+            process_msg(msg);
+        }
+
+        process_deferred_state_changes();
+
+        if (!m_running) {
             break;
-        case proxy_msg::FILTER_TIMER_MSG:
-        case proxy_msg::SOURCE_TIMER_MSG:
-        case proxy_msg::RET_GROUP_TIMER_MSG:
-        case proxy_msg::RET_SOURCE_TIMER_MSG:
-        case proxy_msg::OLDER_HOST_PRESENT_TIMER_MSG:
-        case proxy_msg::GENERAL_QUERY_TIMER_MSG: {
-            auto it = m_downstreams.find(std::static_pointer_cast<timer_msg>(msg)->get_if_index());
-            if (it != std::end(m_downstreams)) {
-                it->second.m_querier->timer_triggerd(msg);
-            } else {
-                HC_LOG_DEBUG("failed to find querier of interface: " << interfaces::get_if_name(std::static_pointer_cast<timer_msg>(msg)->get_if_index()));
+        }
+
+        //block only if the job queue is empty, otherwise just look for pending packets and timers
+        bool is_waiting = m_job_queue.begin_external_wait();
+        int num_events = epoll_wait(epoll_fd, events, PROXY_INSTANCE_EVENT_LOOP_FDS, is_waiting ? -1 : 0);
+
+        bool is_signaled = false;
+        for (int i = 0; i < num_events; ++i) {
+            if (events[i].data.fd == queue_fd) {
+                is_signaled = true;
             }
         }
-        break;
-        case proxy_msg::GROUP_RECORD_MSG: {
-            auto r =  std::static_pointer_cast<group_record_msg>(msg);
 
-            if (m_in_debug_testing_mode) {
-                std::cout << "!!--ACTION: receive record" << std::endl;
-                std::cout << *r << std::endl;
-                std::cout << std::endl;
+        if (is_waiting) {
+            m_job_queue.end_external_wait(is_signaled);
+        }
+
+        if (num_events < 0) {
+            if (errno != EINTR) {
+                HC_LOG_ERROR("failed to wait for events! Error: " << strerror(errno) << " errno: " << errno);
+                sleep(1);
             }
+            continue;
+        }
 
-            auto it = m_downstreams.find(r->get_if_index());
-            if (it != std::end(m_downstreams)) {
-                it->second.m_querier->receive_record(msg);
-            } else {
-                HC_LOG_DEBUG("failed to find querier of interface: " << interfaces::get_if_name(std::static_pointer_cast<timer_msg>(msg)->get_if_index()));
+        for (int i = 0; i < num_events; ++i) {
+            if (events[i].data.fd == mrt_fd) {
+                //the packets are parsed and processed in this thread, the socket is level triggered so the rest follows next round
+                if (m_receiver->receive_pending() < 0) {
+                    sleep(1);
+                }
+            } else if (events[i].data.fd == timer_fd) {
+                //fired reminders are queued to this instance and processed next round
+                m_timing->process_timer_fd();
             }
         }
+
+        process_deferred_state_changes();
+    }
+
+    close(epoll_fd);
+    HC_LOG_DEBUG("event loop proxy_instance end");
+}
+
+void proxy_instance::process_msg(const std::shared_ptr<proxy_msg>& msg)
+{
+    HC_LOG_TRACE("");
+
+    switch (msg->get_type()) {
+    case proxy_msg::TEST_MSG:
+        (*msg)();
         break;
-        case proxy_msg::NEW_SOURCE_MSG:
-            m_routing_management->event_new_source(msg);
-            break;
-        case proxy_msg::NEW_SOURCE_TIMER_MSG:
-            m_routing_management->timer_triggerd_maintain_routing_table(msg);
-            break;
-        case proxy_msg::DEBUG_MSG:
-            std::cout << *this << std::endl;
+    case proxy_msg::CONFIG_MSG:
+        process_deferred_state_changes();
+        handle_config(std::static_pointer_cast<config_msg>(msg));
+        break;
+    case proxy_msg::FILTER_TIMER_MSG:
+    case proxy_msg::SOURCE_TIMER_MSG:
+    case proxy_msg::RET_GROUP_TIMER_MSG:
+    case proxy_msg::RET_SOURCE_TIMER_MSG:
+    case proxy_msg::OLDER_HOST_PRESENT_TIMER_MSG:
+    case proxy_msg::GENERAL_QUERY_TIMER_MSG: {
+        auto it = m_downstreams.find(std::static_pointer_cast<timer_msg>(msg)->get_if_index());
+        if (it != std::end(m_downstreams)) {
+            it->second.m_querier->timer_triggerd(msg);
+        } else {
+            HC_LOG_DEBUG("failed to find querier of interface: " << interfaces::get_if_name(std::static_pointer_cast<timer_msg>(msg)->get_if_index()));
+        }
+    }
+    break;
+    case proxy_msg::GROUP_RECORD_MSG: {
+        auto r =  std::static_pointer_cast<group_record_msg>(msg);
+
+        if (m_in_debug_testing_mode) {
+            std::cout << "!!--ACTION: receive record" << std::endl;
+            std::cout << *r << std::endl;
             std::cout << std::endl;
-            break;
-        case proxy_msg::EXIT_MSG:
-            HC_LOG_DEBUG("received exit command");
-            stop();
-            break;
-        default:
-            HC_LOG_ERROR("Received unknown message");
-            break;
+        }
+
+        auto it = m_downstreams.find(r->get_if_index());
+        if (it != std::end(m_downstreams)) {
+            it->second.m_querier->receive_record(msg);
+        } else {
+            HC_LOG_DEBUG("failed to find querier of interface: " << interfaces::get_if_name(std::static_pointer_cast<timer_msg>(msg)->get_if_index()));
         }
     }
+    break;
+    case proxy_msg::GROUP_REPORT_MSG: {
+        auto r =  std::static_pointer_cast<group_report_msg>(msg);
 
-    HC_LOG_DEBUG("worker thread proxy_instance end");
+        if (m_in_debug_testing_mode) {
+            std::cout << "!!--ACTION: receive report" << std::endl;
+            std::cout << *r << std::endl;
+            std::cout << std::endl;
+        }
+
+        auto it = m_downstreams.find(r->get_if_index());
+        if (it != std::end(m_downstreams)) {
+            for (auto & e : r->get_records()) {
+                it->second.m_querier->receive_record(e);
+            }
+        } else {
+            HC_LOG_DEBUG("failed to find querier of interface: " << interfaces::get_if_name(r->get_if_index()));
+        }
+    }
+    break;
+    case proxy_msg::NEW_SOURCE_MSG:
+        m_routing_management->event_new_source(msg);
+        break;
+    case proxy_msg::SOURCE_SWEEP_TIMER_MSG:
+    case proxy_msg::UPSTREAM_REPORT_TIMER_MSG:
+        m_routing_management->timer_triggerd_maintain_routing_table(msg);
+        break;
+    case proxy_msg::MEMBERSHIP_QUERY_MSG: {
+        auto q = std::static_pointer_cast<membership_query_msg>(msg);
+
+        //queries of the downstream interfaces are from other queriers on the link and ignored
+        if (m_host_reporter != nullptr && is_upstream(q->get_if_index())) {
+            m_host_reporter->receive_query(q);
+        }
+    }
+    break;
+    case proxy_msg::HOST_REPORT_TIMER_MSG:
+        if (m_host_reporter != nullptr) {
+            m_host_reporter->timer_triggerd(std::static_pointer_cast<host_report_timer_msg>(msg));
+        }
+        break;
+    case proxy_msg::DEBUG_MSG:
+        process_deferred_state_changes();
+        std::cout << *this << std::endl;
+        std::cout << std::endl;
+        break;
+    case proxy_msg::EXIT_MSG:
+        HC_LOG_DEBUG("received exit command");
+        stop();
+        break;
+    default:
+        HC_LOG_ERROR("Received unknown message");
+        break;
+    }
+}
+
+void proxy_instance::defer_querier_state_change(unsigned int if_index, const ip_addr& gaddr)
+{
+    HC_LOG_TRACE("");
+    m_deferred_state_changes[gaddr] = if_index;
+}
+
+void proxy_instance::process_deferred_state_changes()
+{
+    HC_LOG_TRACE("");
+
+    for (auto & e : m_deferred_state_changes) {
+        m_routing_management->event_querier_state_change(e.second, e.first);
+    }
+
+    m_deferred_state_changes.clear();
+
+    //end of a batch, pass the queued multicast routes to the kernel
+    m_routing_management->flush_routes();
+
+    //and the upstream membership changes to the upstream routers
+    if (m_host_reporter != nullptr) {
+        m_host_reporter->flush();
+    }
+}
+
+void proxy_instance::count_batch(unsigned int batch_size)
+{
+    HC_LOG_TRACE("");
+
+    if (batch_size == 0) {
+        return;
+    }
+
+    ++m_batch_count;
+    m_batch_msg_count += batch_size;
+    m_max_batch_size = std::max(m_max_batch_size, batch_size);
+
+    unsigned int bucket = 0;
+    while ((batch_size >>= 1) != 0) {
+        ++bucket;
+    }
+
+    if (m_batch_size_histogram.size() <= bucket) {
+        m_batch_size_histogram.resize(bucket + 1, 0);
+    }
+    ++m_batch_size_histogram[bucket];
+}
+
+std::string proxy_instance::to_string_batch_statistics() const
+{
+    HC_LOG_TRACE("");
+    std::ostringstream s;
+
+    s << "##-- job queue --##" << std::endl;
+    s << "batches: " << m_batch_count << " messages: " << m_batch_msg_count << " max batch size: " << m_max_batch_size;
+    if (m_batch_count > 0) {
+        s << " average batch size: " << static_cast<double>(m_batch_msg_count) / m_batch_count;
+    }
+    s << std::endl << "batch sizes:";
+    for (unsigned int i = 0; i < m_batch_size_histogram.size(); ++i) {
+        unsigned int from = 1 << i;
+        unsigned int to = (1 << (i + 1)) - 1;
+        if (from == to) {
+            s << " [" << from << "]:" << m_batch_size_histogram[i];
+        } else {
+            s << " [" << from << "-" << to << "]:" << m_batch_size_histogram[i];
+        }
+    }
+
+    return s.str();
 }
 
 std::string proxy_instance::to_string() const
@@ -247,6 +516,16 @@ std::string proxy_instance::to_string() const
 
     s << *m_routing_management << std::endl;
 
+    s << to_string_batch_statistics() << std::endl;
+
+    s << *m_receiver << std::endl;
+
+    s << *m_sender << std::endl;
+
+    if (m_host_reporter != nullptr) {
+        s << *m_host_reporter << std::endl;
+    }
+
     s << "##-- upstream interfaces --##" << std::endl;
     for (auto & e : m_upstreams) {
         s << interfaces::get_if_name(e.m_if_index) << "(index:" << e.m_if_index << ") ";
@@ -283,9 +562,10 @@ void proxy_instance::handle_config(const std::shared_ptr<config_msg>& msg)
             }
 
             //create a querier
-            std::function<void(unsigned int, const addr_storage&)> cb_state_change = std::bind(&routing_management::event_querier_state_change, m_routing_management.get(), std::placeholders::_1, std::placeholders::_2);
+            std::function<void(unsigned int, const ip_addr&)> cb_state_change = std::bind(&proxy_instance::defer_querier_state_change, this, std::placeholders::_1, std::placeholders::_2);
             std::unique_ptr<querier> q(new querier(this, m_group_mem_protocol, msg->get_if_index(), m_sender, m_timing, msg->get_timers_values(), cb_state_change));
             m_downstreams.insert(std::pair<unsigned int, downstream_infos>(msg->get_if_index(), downstream_infos(move(q), msg->get_interface())));
+            m_routing_management->event_interface_change();
         } else {
             HC_LOG_WARN("downstream interface: " << interfaces::get_if_name(msg->get_if_index()) << " already exists");
         }
@@ -306,6 +586,7 @@ void proxy_instance::handle_config(const std::shared_ptr<config_msg>& msg)
 
             //delete querier
             m_downstreams.erase(it);
+            m_routing_management->event_interface_change();
         } else {
             HC_LOG_WARN("failed to delete downstream interface: " << interfaces::get_if_name(msg->get_if_index()) << " interface not found");
         }
@@ -326,9 +607,14 @@ void proxy_instance::handle_config(const std::shared_ptr<config_msg>& msg)
                 HC_LOG_DEBUG("interface also used as downstream");
             }
 
+            if (m_host_reporter != nullptr) {
+                m_receiver->registrate_query_interface(msg->get_if_index());
+            }
+
             HC_LOG_DEBUG("registerd upstreams: " << m_upstreams.size());
             HC_LOG_DEBUG("upstream priority: " << msg->get_upstream_priority());
             m_upstreams.insert(upstream_infos(msg->get_if_index(), msg->get_interface(), msg->get_upstream_priority()));
+            m_routing_management->event_interface_change();
         }
         else {
             HC_LOG_WARN("upstream interface: " << interfaces::get_if_name(msg->get_if_index()) << " already exists");
@@ -351,7 +637,13 @@ void proxy_instance::handle_config(const std::shared_ptr<config_msg>& msg)
                 HC_LOG_DEBUG("interface still used as downstream");
             }
 
+            if (m_host_reporter != nullptr) {
+                m_receiver->del_query_interface(msg->get_if_index());
+                m_host_reporter->del_interface(msg->get_if_index());
+            }
+
             m_upstreams.erase(it);
+            m_routing_management->event_interface_change();
         } else {
             HC_LOG_WARN("failed to delete upstream interface: " << interfaces::get_if_name(msg->get_if_index()) << " interface not found");
         }
@@ -413,7 +705,7 @@ void proxy_instance::test_querier(std::string if_name)
 
     group_mem_protocol memproto = IGMPv3;
     //create a proxy_instance
-    proxy_instance pr_i(memproto, "test", 0,  make_shared<interfaces>(get_addr_family(memproto), false), make_shared<timing>(), true);
+    proxy_instance pr_i(memproto, "test", 0, std::chrono::milliseconds(INSTANCE_DEFINITION_DEFAULT_SOURCE_LIFE_TIME), timers_values().get_unsolicited_report_interval(), false, make_shared<interfaces>(get_addr_family(memproto), false), make_shared<timing>(), true);
 
     //add a downstream
     timers_values tv;
@@ -432,7 +724,7 @@ void proxy_instance::test_querier(std::string if_name)
     auto print_proxy_instance = bind(&proxy_instance::add_msg, &pr_i, make_shared<debug_msg>());
 
     auto __tmp = [&, if_name](mcast_addr_record_type t, source_list<source> && slist, group_mem_protocol gmp) {
-        return make_shared<group_record_msg>(interfaces::get_if_index(if_name), t, gaddr, move(slist), gmp);
+        return make_shared<group_record_msg>(interfaces::get_if_index(if_name), t, ip_addr(gaddr), move(slist), gmp);
     };
 
     auto send_record = bind(&proxy_instance::add_msg, &pr_i, bind(__tmp, placeholders::_1, placeholders::_2, placeholders::_3));
@@ -693,18 +985,18 @@ void proxy_instance::rand_test(std::function < void(mcast_addr_record_type, sour
     uniform_int_distribution<int> d_r_type(0, r_type.size() - 1);
 
     vector<source> src;
-    src.push_back(addr_storage("1.1.1.1"));
-    src.push_back(addr_storage("2.2.2.2"));
-    src.push_back(addr_storage("3.3.3.3"));
-    src.push_back(addr_storage("4.4.4.4"));
-    src.push_back(addr_storage("5.5.5.5"));
-    src.push_back(addr_storage("6.6.6.6"));
-    src.push_back(addr_storage("7.7.7.7"));
-    src.push_back(addr_storage("8.8.8.8"));
-    src.push_back(addr_storage("9.9.9.9"));
-    src.push_back(addr_storage("10.10.10.10"));
-    src.push_back(addr_storage("11.11.11.11"));
-    src.push_back(addr_storage("12.12.12.12"));
+    src.push_back(source(addr_storage("1.1.1.1")));
+    src.push_back(source(addr_storage("2.2.2.2")));
+    src.push_back(source(addr_storage("3.3.3.3")));
+    src.push_back(source(addr_storage("4.4.4.4")));
+    src.push_back(source(addr_storage("5.5.5.5")));
+    src.push_back(source(addr_storage("6.6.6.6")));
+    src.push_back(source(addr_storage("7.7.7.7")));
+    src.push_back(source(addr_storage("8.8.8.8")));
+    src.push_back(source(addr_storage("9.9.9.9")));
+    src.push_back(source(addr_storage("10.10.10.10")));
+    src.push_back(source(addr_storage("11.11.11.11")));
+    src.push_back(source(addr_storage("12.12.12.12")));
     uniform_int_distribution<int> d_src(0, 8);
 
     cout << "##-- querier random test --##" << endl;
@@ -741,4 +1033,190 @@ void proxy_instance::rand_test(std::function < void(mcast_addr_record_type, sour
     sleep(1);
     cout << "##-- querier end --##" << endl;
 }
+
+void proxy_instance::test_event_loop_latency(const std::string& upstream_if_name, const std::string& downstream_if_name)
+{
+    using namespace std;
+    using namespace std::chrono;
+    cout << "##-- test event loop latency --##" << endl;
+
+    log_silencer silencer;
+
+    const unsigned int num_of_groups = 1000;
+    const ip_addr saddr(addr_storage("10.1.1.1"));
+
+    auto get_gaddr = [](unsigned int n) {
+        in_addr a;
+        a.s_addr = htonl(0xe8010000 | n); //232.1.0.0/16
+        return ip_addr(a);
+    };
+
+    //runs a function in the thread of the proxy instance
+    struct call_msg : public proxy_msg {
+        call_msg(const function<void()>& fun): proxy_msg(TEST_MSG, SYSTEMIC), m_fun(fun) {}
+
+        void operator()() override {
+            m_fun();
+        }
+
+        function<void()> m_fun;
+    };
+
+    //wraps the routing management of the proxy instance and notes when the routes of a changed group are flushed
+    class flush_probe : public routing_management
+    {
+    private:
+        unique_ptr<routing_management> m_routing_management;
+        set<ip_addr> m_changed_groups;
+
+        mutex m_lock;
+        condition_variable m_cond;
+        map<ip_addr, steady_clock::time_point> m_flush_times;
+
+    public:
+        flush_probe(const proxy_instance* p, unique_ptr<routing_management> rm)
+            : routing_management(p)
+            , m_routing_management(move(rm)) {}
+
+        void event_new_source(const shared_ptr<proxy_msg>& msg) override {
+            m_routing_management->event_new_source(msg);
+        }
+
+        void event_querier_state_change(unsigned int if_index, const ip_addr& gaddr) override {
+            m_routing_management->event_querier_state_change(if_index, gaddr);
+            m_changed_groups.insert(gaddr);
+        }
+
+        void timer_triggerd_maintain_routing_table(const shared_ptr<proxy_msg>& msg) override {
+            m_routing_management->timer_triggerd_maintain_routing_table(msg);
+        }
+
+        void event_interface_change() override {
+            m_routing_management->event_interface_change();
+        }
+
+        void flush_routes() override {
+            m_routing_management->flush_routes();
+
+            if (!m_changed_groups.empty()) {
+                auto now = steady_clock::now();
+                {
+                    lock_guard<mutex> lock(m_lock);
+                    for (auto & e : m_changed_groups) {
+                        m_flush_times.insert(make_pair(e, now));
+                    }
+                }
+                m_changed_groups.clear();
+                m_cond.notify_all();
+            }
+        }
+
+        bool wait_for_flush(const ip_addr& gaddr, steady_clock::time_point& flush_time) {
+            unique_lock<mutex> lock(m_lock);
+            if (!m_cond.wait_for(lock, seconds(1), [&]() {
+            return m_flush_times.find(gaddr) != m_flush_times.end();
+            })) {
+                return false;
+            }
+
+            flush_time = m_flush_times[gaddr];
+            return true;
+        }
+
+        string to_string() const override {
+            return m_routing_management->to_string();
+        }
+    };
+
+    //a host on the downstream, its reports are looped back to the mroute socket of the proxy instance
+    class report_sender : public igmp_sender
+    {
+    public:
+        report_sender(const shared_ptr<const interfaces>& interfaces)
+            : igmp_sender(interfaces) {
+            if (!m_sock.set_loop_back(true)) {
+                throw "failed to set loop back";
+            }
+        }
+    };
+
+    auto run = [&](bool in_event_loop_mode) {
+        const unsigned int upstream_if_index = interfaces::get_if_index(upstream_if_name);
+        const unsigned int downstream_if_index = interfaces::get_if_index(downstream_if_name);
+
+        auto ifs = make_shared<interfaces>(AF_INET, false);
+        if (!ifs->add_interface(upstream_if_index) || !ifs->add_interface(downstream_if_index)) {
+            cout << "failed to add the interfaces " << upstream_if_name << " and " << downstream_if_name << endl;
+            return;
+        }
+        const shared_ptr<const interfaces> const_ifs = ifs;
+
+        unique_ptr<proxy_instance> pr_i(new proxy_instance(IGMPv3, "latency", 0, milliseconds(INSTANCE_DEFINITION_DEFAULT_SOURCE_LIFE_TIME), milliseconds(0), false, const_ifs, make_shared<timing>(), false, in_event_loop_mode));
+        proxy_instance* p = pr_i.get();
+
+        auto call = [&](const function<void()>& fun) {
+            auto done = make_shared<promise<void>>();
+            auto done_future = done->get_future();
+            p->add_msg(make_shared<call_msg>([fun, done]() {
+                fun();
+                done->set_value();
+            }));
+            done_future.wait();
+        };
+
+        flush_probe* probe = nullptr;
+        call([&]() {
+            probe = new flush_probe(p, move(p->m_routing_management));
+            p->m_routing_management.reset(probe);
+        });
+
+        p->add_msg(make_shared<config_msg>(config_msg::ADD_UPSTREAM, upstream_if_index, 0, make_shared<interface>(upstream_if_name)));
+        p->add_msg(make_shared<config_msg>(config_msg::ADD_DOWNSTREAM, downstream_if_index, make_shared<interface>(downstream_if_name), timers_values()));
+
+        //every group has a source on the upstream, so a report installs a multicast route
+        call([&]() {
+            for (unsigned int i = 0; i < num_of_groups; ++i) {
+                p->process_msg(make_shared<new_source_msg>(upstream_if_index, get_gaddr(i), saddr));
+            }
+            p->process_deferred_state_changes();
+        });
+
+        report_sender reporter(const_ifs);
+        vector<long> latencies;
+        latencies.reserve(num_of_groups);
+        unsigned int lost = 0;
+
+        for (unsigned int i = 0; i < num_of_groups; ++i) {
+            ip_addr gaddr = get_gaddr(i);
+            steady_clock::time_point flush_time;
+
+            auto send_time = steady_clock::now();
+            reporter.send_report(downstream_if_index, {report_record {CHANGE_TO_EXCLUDE_MODE, gaddr, {}}});
+
+            if (probe->wait_for_flush(gaddr, flush_time)) {
+                latencies.push_back(duration_cast<nanoseconds>(flush_time - send_time).count());
+            } else {
+                ++lost;
+            }
+        }
+
+        //stop the thread of the proxy instance before its members are destroyed
+        p->add_msg(make_shared<exit_cmd>());
+        p->join();
+        p->m_thread.reset();
+        pr_i.reset();
+
+        sort(latencies.begin(), latencies.end());
+        auto percentile = [&](double q) {
+            return latencies.empty() ? 0 : latencies[static_cast<size_t>(q * (latencies.size() - 1))] / 1000.0;
+        };
+        cout << (in_event_loop_mode ? "event loop" : "threaded  ") << " reports: " << latencies.size() << " lost: " << lost;
+        cout << fixed << setprecision(1) << " median: " << percentile(0.5) << "usec p90: " << percentile(0.9) << "usec p99: " << percentile(0.99) << "usec max: " << percentile(1) << "usec" << endl;
+    };
+
+    run(false);
+    run(true);
+
+    cout << "finished" << endl;
+}
 #endif /* DEBUG_MODE */
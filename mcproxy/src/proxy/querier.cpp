@@ -43,6 +43,8 @@ querier::querier(worker* msg_worker, group_mem_protocol querier_version_mode, in
     , m_cb_state_change(cb_state_change)
     , m_sender(sender)
     , m_timing(timing)
+    , m_notification_count(0)
+    , m_suppressed_notification_count(0)
 {
     HC_LOG_TRACE("");
 
@@ -108,9 +110,10 @@ bool querier::send_general_query()
     }
 
     auto gqt = std::make_shared<general_query_timer_msg>(m_if_index, t);
+    cancel_timer(m_db.general_query_timer);
     m_db.general_query_timer = gqt;
 
-    m_timing->add_time(t, m_msg_worker, gqt);
+    arm_timer(t, gqt);
     return m_sender->send_general_query(m_if_index, m_timers_values);
 }
 
@@ -123,38 +126,45 @@ void querier::receive_record(const std::shared_ptr<proxy_msg>& msg)
         return;
     }
 
-    auto gr = std::static_pointer_cast<group_record_msg>(msg);
+    receive_record(*std::static_pointer_cast<group_record_msg>(msg));
+}
 
-    auto db_info_it = m_db.group_info.find(gr->get_gaddr());
+void querier::receive_record(group_record_msg& gr)
+{
+    HC_LOG_TRACE("");
 
-    if (db_info_it == end(m_db.group_info)) {
+    auto db_info_it = m_db.group_info.find(gr.get_gaddr());
+
+    if (db_info_it == std::end(m_db.group_info)) {
         //add an empty neutral record  to membership database
         HC_LOG_DEBUG("gaddr not found");
-        db_info_it = m_db.group_info.insert(gaddr_pair(gr->get_gaddr(), gaddr_info(m_db.querier_version_mode))).first;
+        db_info_it = m_db.group_info.insert(gaddr_pair(gr.get_gaddr(), gaddr_info(m_db.querier_version_mode))).first;
+        db_info_it->second.handle = db_info_it.get_handle();
     }
 
     //backwards compatibility coordination
-    if (!is_newest_version(gr->get_grp_mem_proto()) && is_older_or_equal_version(gr->get_grp_mem_proto(), m_db.querier_version_mode) ) {
-        db_info_it->second.compatibility_mode_variable = gr->get_grp_mem_proto();
+    if (!is_newest_version(gr.get_grp_mem_proto()) && is_older_or_equal_version(gr.get_grp_mem_proto(), m_db.querier_version_mode) ) {
+        db_info_it->second.compatibility_mode_variable = gr.get_grp_mem_proto();
         auto ohpt = std::make_shared<older_host_present_timer_msg>(m_if_index, db_info_it->first, m_timers_values.get_older_host_present_interval());
+        cancel_timer(db_info_it->second.older_host_present_timer);
         db_info_it->second.older_host_present_timer = ohpt;
-        m_timing->add_time(m_timers_values.get_older_host_present_interval(), m_msg_worker, ohpt);
+        arm_timer(m_timers_values.get_older_host_present_interval(), ohpt, db_info_it->second);
     }
 
     //section 8.3.2. In the Presence of MLDv1 Multicast Address Listeners
     //MLDv2 BLOCK messages are ignored, as are source-lists in TO_EX()
     //messages (i.e., any TO_EX() message is treated as TO_EX( {} )).
     if (db_info_it->second.is_in_backward_compatibility_mode()) {
-        if (gr->get_record_type() == CHANGE_TO_EXCLUDE_MODE) {
-            gr->get_slist() = {};
-        } else if (gr->get_record_type() == BLOCK_OLD_SOURCES){
+        if (gr.get_record_type() == CHANGE_TO_EXCLUDE_MODE) {
+            gr.get_slist() = {};
+        } else if (gr.get_record_type() == BLOCK_OLD_SOURCES){
             return;     
         }
     }
 
     switch (db_info_it->second.filter_mode) {
     case  INCLUDE_MODE:
-        receive_record_in_include_mode(gr->get_record_type(), gr->get_gaddr(), gr->get_slist(), db_info_it->second);
+        receive_record_in_include_mode(gr.get_record_type(), gr.get_gaddr(), gr.get_slist(), db_info_it->second);
 
         //if the new created group is not used delete it
         if (db_info_it->second.filter_mode == INCLUDE_MODE && db_info_it->second.include_requested_list.empty()) {
@@ -163,7 +173,7 @@ void querier::receive_record(const std::shared_ptr<proxy_msg>& msg)
 
         break;
     case EXCLUDE_MODE:
-        receive_record_in_exclude_mode(gr->get_record_type(), gr->get_gaddr(), gr->get_slist(), db_info_it->second);
+        receive_record_in_exclude_mode(gr.get_record_type(), gr.get_gaddr(), gr.get_slist(), db_info_it->second);
         break;
     default :
         HC_LOG_ERROR("wrong filter mode: " << db_info_it->second.filter_mode);
@@ -172,7 +182,7 @@ void querier::receive_record(const std::shared_ptr<proxy_msg>& msg)
 
 }
 
-void querier::receive_record_in_include_mode(mcast_addr_record_type record_type, const addr_storage& gaddr, source_list<source>& slist, gaddr_info& ginfo)
+void querier::receive_record_in_include_mode(mcast_addr_record_type record_type, const ip_addr& gaddr, source_list<source>& slist, gaddr_info& ginfo)
 {
     HC_LOG_TRACE("record type: " << record_type);
     //7.4.1.  Reception of Current State Records
@@ -255,7 +265,7 @@ void querier::receive_record_in_include_mode(mcast_addr_record_type record_type,
     case MODE_IS_INCLUDE: {//IS_IN(x)
         A += B;
 
-        mali(gaddr, A, move(B));
+        mali(gaddr, A, std::move(B));
 
         state_change_notification(gaddr);
     }
@@ -269,7 +279,7 @@ void querier::receive_record_in_include_mode(mcast_addr_record_type record_type,
 
 }
 
-void querier::receive_record_in_exclude_mode(mcast_addr_record_type record_type, const addr_storage& gaddr, source_list<source>& slist, gaddr_info& ginfo)
+void querier::receive_record_in_exclude_mode(mcast_addr_record_type record_type, const ip_addr& gaddr, source_list<source>& slist, gaddr_info& ginfo)
 {
     HC_LOG_TRACE("record type: " << record_type);
     //7.4.1.  Reception of Current State Records
@@ -329,7 +339,7 @@ void querier::receive_record_in_exclude_mode(mcast_addr_record_type record_type,
         Y *= A;
 
         auto tmpXa = X;
-        send_Q(gaddr, ginfo, X, move(tmpXa)); //bad style, but i haven't a better solution right now ???????????
+        send_Q(gaddr, ginfo, X, std::move(tmpXa)); //bad style, but i haven't a better solution right now ???????????
         mali(gaddr, filter_timer);
 
         state_change_notification(gaddr);
@@ -405,9 +415,9 @@ void querier::timer_triggerd(const std::shared_ptr<proxy_msg>& msg)
         case proxy_msg::OLDER_HOST_PRESENT_TIMER_MSG: {
             tm = std::static_pointer_cast<timer_msg>(msg);
 
-            db_info_it = m_db.group_info.find(tm->get_gaddr());
+            db_info_it = m_db.group_info.find(tm->get_gaddr(), tm->get_group_handle());
 
-            if (db_info_it == end(m_db.group_info)) {
+            if (db_info_it == std::end(m_db.group_info)) {
                 HC_LOG_ERROR("filter_timer message is still in use but cannot found");
                 return;
             }
@@ -492,13 +502,13 @@ void querier::timer_triggerd_filter_timer(gaddr_map::iterator db_info_it, const
 
     if (ginfo.filter_mode == EXCLUDE_MODE) {
         if (ginfo.include_requested_list.empty()) {
-            addr_storage notify_gaddr = db_info_it->first;
+            ip_addr notify_gaddr = db_info_it->first;
 
             m_db.group_info.erase(db_info_it);
 
             state_change_notification(notify_gaddr); //only A
         } else {
-            addr_storage notify_gaddr = db_info_it->first;
+            ip_addr notify_gaddr = db_info_it->first;
 
             ginfo.filter_mode = INCLUDE_MODE;
             ginfo.shared_filter_timer.reset();
@@ -527,16 +537,11 @@ void querier::timer_triggerd_source_timer(gaddr_map::iterator db_info_it, const
         //Include List.  If there are no more source records left, the
         //multicast address record is deleted from the router.
     case INCLUDE_MODE: {
-        addr_storage notify_gaddr = db_info_it->first;
+        ip_addr notify_gaddr = db_info_it->first;
 
-        for (auto it = std::begin(ginfo.include_requested_list); it != std::end(ginfo.include_requested_list);) {
-            if (it->shared_source_timer.get() == msg.get()) {
-
-                it = ginfo.include_requested_list.erase(it);
-                continue;
-            }
-            ++it;
-        }
+        ginfo.include_requested_list.erase_if([&](const source & s) {
+            return s.shared_source_timer.get() == msg.get();
+        });
 
         if (ginfo.include_requested_list.empty()) {
             m_db.group_info.erase(db_info_it);
@@ -552,18 +557,19 @@ void querier::timer_triggerd_source_timer(gaddr_map::iterator db_info_it, const
     //of a source from the Requested List expires, the source is moved to
     //the Exclude List.
     case EXCLUDE_MODE: {
-        addr_storage notify_gaddr = db_info_it->first;
-
-        for (auto it = std::begin(ginfo.include_requested_list); it != std::end(ginfo.include_requested_list);) {
-            if (it->shared_source_timer.get() == msg.get()) {
-                it->shared_source_timer.reset();
-                ginfo.exclude_list.insert(*it);
-
-                it = ginfo.include_requested_list.erase(it);
-                continue;
+        ip_addr notify_gaddr = db_info_it->first;
+
+        //the expired sources are collected in ascending order and merged at once
+        source_list<source> expired_list;
+        ginfo.include_requested_list.erase_if([&](const source & s) {
+            if (s.shared_source_timer.get() == msg.get()) {
+                s.shared_source_timer.reset();
+                expired_list.insert(s);
+                return true;
             }
-            ++it;
-        }
+            return false;
+        });
+        ginfo.exclude_list += expired_list;
 
         state_change_notification(notify_gaddr); //only A
         break;
@@ -636,22 +642,26 @@ void querier::timer_triggerd_older_host_present_timer(gaddr_map::iterator db_inf
 
             auto ohpt = std::make_shared<older_host_present_timer_msg>(m_if_index, db_info_it->first, delay);
             ginfo.older_host_present_timer = ohpt;
-            m_timing->add_time(delay, m_msg_worker, ohpt);
+            arm_timer(delay, ohpt, ginfo);
         }
     }
 }
 
-void querier::mali(const addr_storage& gaddr, gaddr_info& ginfo) const
+void querier::mali(const ip_addr& gaddr, gaddr_info& ginfo) const
 {
     HC_LOG_TRACE("");
     auto ft = std::make_shared<filter_timer_msg>(m_if_index, gaddr, m_timers_values.get_multicast_address_listening_interval());
 
+    //a filter timer used as source timer is still needed by its sources
+    if (ginfo.shared_filter_timer != nullptr && !ginfo.shared_filter_timer->is_used_as_source_timer()) {
+        cancel_timer(ginfo.shared_filter_timer);
+    }
     ginfo.shared_filter_timer = ft;
 
-    m_timing->add_time(m_timers_values.get_multicast_address_listening_interval(), m_msg_worker, ft);
+    arm_timer(m_timers_values.get_multicast_address_listening_interval(), ft, ginfo);
 }
 
-void querier::mali(const addr_storage& gaddr, source_list<source>& slist) const
+void querier::mali(const ip_addr& gaddr, source_list<source>& slist) const
 {
     HC_LOG_TRACE("");
     auto st = std::make_shared<source_timer_msg>(m_if_index, gaddr, m_timers_values.get_multicast_address_listening_interval());
@@ -661,12 +671,14 @@ void querier::mali(const addr_storage& gaddr, source_list<source>& slist) const
         e.retransmission_count = -1;
     }
 
+    //a source timer is shared by several sources, it is not canceled explicitly but discarded by the
+    //module Timer as soon as no source refers to it anymore
     if (!slist.empty()) {
-        m_timing->add_time(m_timers_values.get_multicast_address_listening_interval(), m_msg_worker, st);
+        arm_timer(m_timers_values.get_multicast_address_listening_interval(), st);
     }
 }
 
-void querier::mali(const addr_storage& gaddr, source_list<source>& slist, source_list<source>&& tmp_slist) const
+void querier::mali(const ip_addr& gaddr, source_list<source>& slist, source_list<source>&& tmp_slist) const
 {
     HC_LOG_TRACE("");
     mali(gaddr, tmp_slist);
@@ -693,7 +705,7 @@ void querier::filter_time(gaddr_info& ginfo, source_list<source>& slist, source_
     }
 }
 
-void querier::send_Q(const addr_storage& gaddr, gaddr_info& ginfo)
+void querier::send_Q(const ip_addr& gaddr, gaddr_info& ginfo)
 {
     HC_LOG_TRACE("");
 
@@ -713,9 +725,12 @@ void querier::send_Q(const addr_storage& gaddr, gaddr_info& ginfo)
         auto llqt = m_timers_values.get_last_listener_query_time();
         auto ftimer = std::make_shared<filter_timer_msg>(m_if_index, gaddr, llqt);
 
+        if (ginfo.shared_filter_timer != nullptr && !ginfo.shared_filter_timer->is_used_as_source_timer()) {
+            cancel_timer(ginfo.shared_filter_timer);
+        }
         ginfo.shared_filter_timer = ftimer;
 
-        m_timing->add_time(llqt, m_msg_worker, ftimer);
+        arm_timer(llqt, ftimer, ginfo);
     }
 
     if (ginfo.group_retransmission_count > 0) {
@@ -724,11 +739,12 @@ void querier::send_Q(const addr_storage& gaddr, gaddr_info& ginfo)
         if (ginfo.group_retransmission_count > 0) {
             auto llqi = m_timers_values.get_last_listener_query_interval();
             auto rtimer = std::make_shared<retransmit_group_timer_msg>(m_if_index, gaddr, llqi);
+            cancel_timer(ginfo.group_retransmission_timer);
             ginfo.group_retransmission_timer = rtimer;
-            m_timing->add_time(llqi, m_msg_worker, rtimer);
+            arm_timer(llqi, rtimer, ginfo);
         }
 
-        m_sender->send_mc_addr_specific_query(m_if_index, m_timers_values, gaddr, ginfo.shared_filter_timer->is_remaining_time_greater_than(m_timers_values.get_last_listener_query_time()));
+        m_sender->send_mc_addr_specific_query(m_if_index, m_timers_values, gaddr.to_addr_storage(), ginfo.shared_filter_timer->is_remaining_time_greater_than(m_timers_values.get_last_listener_query_time()));
 
     } else { //reset itself
         ginfo.group_retransmission_timer = nullptr;
@@ -737,7 +753,7 @@ void querier::send_Q(const addr_storage& gaddr, gaddr_info& ginfo)
 }
 
 
-void querier::send_Q(const addr_storage& gaddr, gaddr_info& ginfo, source_list<source>& slist, source_list<source>&& tmp_list, bool in_retransmission_state)
+void querier::send_Q(const ip_addr& gaddr, gaddr_info& ginfo, source_list<source>& slist, source_list<source>&& tmp_list, bool in_retransmission_state)
 {
     HC_LOG_TRACE("");
 
@@ -759,22 +775,58 @@ void querier::send_Q(const addr_storage& gaddr, gaddr_info& ginfo, source_list<s
     }
 
     if (is_used) {
-        m_timing->add_time(llqt, m_msg_worker, st);
+        arm_timer(llqt, st, ginfo);
     }
 
     if (is_used  || in_retransmission_state) {
-        if (m_sender->send_mc_addr_and_src_specific_query(m_if_index, m_timers_values, gaddr, slist)) {
+        if (m_sender->send_mc_addr_and_src_specific_query(m_if_index, m_timers_values, gaddr.to_addr_storage(), slist)) {
             auto llqi = m_timers_values.get_last_listener_query_interval();
             auto rst = std::make_shared<retransmit_source_timer_msg>(m_if_index, gaddr, llqi);
+            cancel_timer(ginfo.source_retransmission_timer);
             ginfo.source_retransmission_timer = rst;
-            m_timing->add_time(llqi, m_msg_worker, rst);
+            arm_timer(llqi, rst, ginfo);
         }
     }
 }
 
-void querier::state_change_notification(const addr_storage& gaddr)
+void querier::arm_timer(std::chrono::milliseconds delay, const std::shared_ptr<timer_msg>& tm) const
+{
+    HC_LOG_TRACE("");
+    tm->set_timer_handle(m_timing->arm_time(delay, m_msg_worker, tm));
+}
+
+void querier::arm_timer(std::chrono::milliseconds delay, const std::shared_ptr<timer_msg>& tm, const gaddr_info& ginfo) const
 {
     HC_LOG_TRACE("");
+    tm->set_group_handle(ginfo.handle);
+    arm_timer(delay, tm);
+}
+
+void querier::cancel_timer(const std::shared_ptr<timer_msg>& tm) const
+{
+    HC_LOG_TRACE("");
+    if (tm != nullptr) {
+        m_timing->cancel_time(tm->get_timer_handle());
+    }
+}
+
+void querier::state_change_notification(const ip_addr& gaddr)
+{
+    HC_LOG_TRACE("");
+
+    //a deleted group is always a change
+    auto db_info_it = m_db.group_info.find(gaddr);
+    if (db_info_it != std::end(m_db.group_info)) {
+        uint64_t fingerprint = db_info_it->second.get_forwarding_fingerprint();
+        if (db_info_it->second.is_notified_forwarding_state(fingerprint)) {
+            HC_LOG_DEBUG("forwarding state of group " << gaddr << " unchanged, suppress notification");
+            ++m_suppressed_notification_count;
+            return;
+        }
+        db_info_it->second.set_notified_forwarding_state(fingerprint);
+    }
+
+    ++m_notification_count;
     m_cb_state_change(m_if_index, gaddr);
 }
 
@@ -791,7 +843,7 @@ timers_values& querier::get_timers_values()
 }
 
 //interface_filter_fun is very useless, please overwork ???????????????
-void querier::suggest_to_forward_traffic(const addr_storage& gaddr, std::list<std::pair<source, std::list<unsigned int>>>& rt_slist, std::function<bool(const addr_storage&)> interface_filter_fun) const
+void querier::suggest_to_forward_traffic(const ip_addr& gaddr, std::list<std::pair<source, std::list<unsigned int>>>& rt_slist, std::function<bool(const ip_addr&)> interface_filter_fun) const
 {
     HC_LOG_TRACE("");
 
@@ -837,7 +889,7 @@ void querier::suggest_to_forward_traffic(const addr_storage& gaddr, std::list<st
 
 }
 
-std::pair<mc_filter, source_list<source>> querier::get_group_membership_infos(const addr_storage& gaddr)
+std::pair<mc_filter, source_list<source>> querier::get_group_membership_infos(const ip_addr& gaddr)
 {
     HC_LOG_TRACE("");
     std::pair<mc_filter, source_list<source>> rt_pair;
@@ -870,6 +922,7 @@ std::string querier::to_string() const
 {
     std::ostringstream s;
     s << "##-- downstream interface: " << interfaces::get_if_name(m_if_index) << " (index:" << m_if_index << ") --##" << std::endl;
+    s << "state change notifications: " << m_notification_count << " suppressed: " << m_suppressed_notification_count << std::endl;
     s << m_db;
     return s.str();
 }
@@ -23,13 +23,27 @@
 
 #include "include/hamcast_logging.h"
 #include "include/proxy/receiver.hpp"
+#include "include/proxy/proxy_instance.hpp"
 
 #include <unistd.h>
+#include <poll.h>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+#include <netinet/in.h>
 
-receiver::receiver(proxy_instance* pr_i, int addr_family, const std::shared_ptr<const mroute_socket> mrt_sock, const std::shared_ptr<const interfaces> interfaces, bool in_debug_testing_mode)
+receiver::receiver(proxy_instance* pr_i, int addr_family, const std::shared_ptr<const mroute_socket> mrt_sock, const std::shared_ptr<const interfaces> interfaces, bool in_debug_testing_mode, const receiver_msg_handler& msg_handler)
     : m_running(false)
     , m_in_debug_testing_mode(in_debug_testing_mode)
     , m_thread(nullptr)
+    , m_wakeup_fd(-1)
+    , m_msg_handler(msg_handler)
+    , m_ctrl_size(0)
+    , m_last_msg_count(0)
+    , m_start_time(std::chrono::steady_clock::now())
+    , m_syscall_count(0)
+    , m_packet_count(0)
+    , m_max_packets_per_syscall(0)
     , m_proxy_instance(pr_i)
     , m_addr_family(addr_family)
     , m_mrt_sock(mrt_sock)
@@ -37,10 +51,11 @@ receiver::receiver(proxy_instance* pr_i, int addr_family, const std::shared_ptr<
 {
     HC_LOG_TRACE("");
 
-    if (!m_mrt_sock->set_receive_timeout(RECEIVER_RECV_TIMEOUT)) {
-        throw std::string("failed to set receive timeout");
+    m_wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_wakeup_fd < 0) {
+        HC_LOG_ERROR("failed to create eventfd! Error: " << strerror(errno) << " errno: " << errno);
+        throw std::string("failed to create eventfd");
     }
-
 }
 
 receiver::~receiver()
@@ -48,6 +63,8 @@ receiver::~receiver()
     HC_LOG_TRACE("");
     stop();
     join();
+
+    close(m_wakeup_fd);
 }
 
 bool receiver::is_if_index_relevant(unsigned int if_index) const
@@ -56,6 +73,32 @@ bool receiver::is_if_index_relevant(unsigned int if_index) const
     return m_relevant_if_index.find(if_index) != std::end(m_relevant_if_index);
 }
 
+bool receiver::is_query_relevant() const
+{
+    HC_LOG_TRACE("");
+    return !m_query_if_index.empty();
+}
+
+unsigned int receiver::get_ingress_if_index(struct msghdr* msg, const addr_storage& saddr) const
+{
+    HC_LOG_TRACE("");
+
+    for (struct cmsghdr* cmsgptr = CMSG_FIRSTHDR(msg); cmsgptr != nullptr; cmsgptr = CMSG_NXTHDR(msg, cmsgptr)) {
+        if (cmsgptr->cmsg_len == 0) {
+            break;
+        }
+
+        if (m_addr_family == AF_INET && cmsgptr->cmsg_level == IPPROTO_IP && cmsgptr->cmsg_type == IP_PKTINFO) {
+            return reinterpret_cast<struct in_pktinfo*>(CMSG_DATA(cmsgptr))->ipi_ifindex;
+        } else if (m_addr_family == AF_INET6 && cmsgptr->cmsg_level == IPPROTO_IPV6 && cmsgptr->cmsg_type == IPV6_PKTINFO) {
+            return reinterpret_cast<struct in6_pktinfo*>(CMSG_DATA(cmsgptr))->ipi6_ifindex;
+        }
+    }
+
+    HC_LOG_DEBUG("no packet info received, map source address to interface");
+    return m_interfaces->get_if_index(saddr);
+}
+
 void receiver::registrate_interface(unsigned int if_index)
 {
     HC_LOG_TRACE("interface: " << interfaces::get_if_name(if_index));
@@ -63,6 +106,7 @@ void receiver::registrate_interface(unsigned int if_index)
     std::lock_guard<std::mutex> lock(m_data_lock);
 
     m_relevant_if_index.insert(if_index);
+    update_socket_filter();
 }
 
 void receiver::del_interface(unsigned int if_index)
@@ -72,55 +116,220 @@ void receiver::del_interface(unsigned int if_index)
     std::lock_guard<std::mutex> lock(m_data_lock);
 
     m_relevant_if_index.erase(if_index);
+    update_socket_filter();
 }
 
-void receiver::worker_thread()
+void receiver::registrate_query_interface(unsigned int if_index)
+{
+    HC_LOG_TRACE("interface: " << interfaces::get_if_name(if_index));
+
+    std::lock_guard<std::mutex> lock(m_data_lock);
+
+    m_query_if_index.insert(if_index);
+    update_socket_filter();
+}
+
+void receiver::del_query_interface(unsigned int if_index)
+{
+    HC_LOG_TRACE("interface: " << interfaces::get_if_name(if_index));
+
+    std::lock_guard<std::mutex> lock(m_data_lock);
+
+    m_query_if_index.erase(if_index);
+    update_socket_filter();
+}
+
+void receiver::update_socket_filter()
 {
     HC_LOG_TRACE("");
 
-    int info_size = 0;
+    std::vector<struct sock_filter> prog;
+    generate_socket_filter(prog);
 
-    //########################
-    //create msg
-    //iov
+    if (!m_mrt_sock->set_socket_filter(prog)) {
+        HC_LOG_WARN("failed to update the socket filter, all packets are passed to userspace");
+    }
+}
 
-    std::unique_ptr<unsigned char[]> iov_buf { new unsigned char[get_iov_min_size()] };
-    //unsigned char iov_buf[r->get_iov_min_size()];
-    struct iovec iov;
-    iov.iov_base = iov_buf.get();
-    iov.iov_len = get_iov_min_size(); //sizeof(iov_buf);
+void receiver::add_filter_types(std::vector<struct sock_filter>& prog, const std::vector<unsigned char>& types)
+{
+    HC_LOG_TRACE("");
 
-    //control
-    std::unique_ptr<unsigned char[]> ctrl { new unsigned char[get_ctrl_min_size()] };
-    //unsigned char ctrl[r->get_ctrl_min_size()];
+    //each match jumps over the remaining comparisons and the drop
+    const unsigned int count = types.size();
+    for (unsigned int i = 0; i < count; ++i) {
+        prog.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, types[i], static_cast<__u8>(count - i), 0));
+    }
+    prog.push_back(BPF_STMT(BPF_RET | BPF_K, RECEIVER_FILTER_DROP));
+}
 
-    //create msghdr
-    struct msghdr msg;
-    msg.msg_name = nullptr;
-    msg.msg_namelen = 0;
+void receiver::add_filter_relevant_interfaces(std::vector<struct sock_filter>& prog, unsigned char query_type) const
+{
+    HC_LOG_TRACE("");
 
-    msg.msg_iov = &iov;
-    msg.msg_iovlen = 1;
+    //queries are checked against the query interfaces, a mismatch jumps over this block
+    if (!m_query_if_index.empty()) {
+        const unsigned int block_size = m_query_if_index.size() > RECEIVER_FILTER_MAX_IF_INDEXES ? 1 : m_query_if_index.size() + 3;
+        prog.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, query_type, 0, static_cast<__u8>(block_size)));
+        add_filter_interfaces(prog, m_query_if_index);
+    }
 
-    msg.msg_control = ctrl.get();
-    msg.msg_controllen = get_ctrl_min_size(); //sizeof(ctrl);
+    add_filter_interfaces(prog, m_relevant_if_index);
+}
 
-    msg.msg_flags = 0;
-    //########################
+void receiver::add_filter_interfaces(std::vector<struct sock_filter>& prog, const std::set<unsigned int>& if_indexes)
+{
+    HC_LOG_TRACE("");
+
+    //jump offsets are limited to 8 bit
+    if (if_indexes.size() > RECEIVER_FILTER_MAX_IF_INDEXES) {
+        prog.push_back(BPF_STMT(BPF_RET | BPF_K, RECEIVER_FILTER_ACCEPT));
+        return;
+    }
+
+    //each match jumps over the remaining comparisons and the drop to the accept
+    prog.push_back(BPF_STMT(BPF_LD | BPF_W | BPF_ABS, static_cast<__u32>(SKF_AD_OFF + SKF_AD_IFINDEX)));
+    const unsigned int count = if_indexes.size();
+    unsigned int i = 0;
+    for (auto if_index : if_indexes) {
+        prog.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, if_index, static_cast<__u8>(count - i), 0));
+        ++i;
+    }
+    prog.push_back(BPF_STMT(BPF_RET | BPF_K, RECEIVER_FILTER_DROP));
+    prog.push_back(BPF_STMT(BPF_RET | BPF_K, RECEIVER_FILTER_ACCEPT));
+}
+
+void receiver::forward_msg(const std::shared_ptr<proxy_msg>& msg)
+{
+    HC_LOG_TRACE("");
+
+    if (m_msg_handler) {
+        m_handler_msgs.push_back(msg);
+    } else {
+        m_proxy_instance->add_msg(msg);
+    }
+}
+
+void receiver::init_msg_ring()
+{
+    HC_LOG_TRACE("");
+
+    const unsigned int iov_size = get_iov_min_size();
+    m_ctrl_size = get_ctrl_min_size();
+
+    m_iov_buf.reset(new unsigned char[RECEIVER_MSG_BATCH_SIZE * iov_size]);
+    m_ctrl_buf.reset(new unsigned char[RECEIVER_MSG_BATCH_SIZE * m_ctrl_size]);
+    m_iovs.resize(RECEIVER_MSG_BATCH_SIZE);
+    m_names.resize(RECEIVER_MSG_BATCH_SIZE);
+    m_msgs.resize(RECEIVER_MSG_BATCH_SIZE);
+    m_handler_msgs.reserve(RECEIVER_MSG_BATCH_SIZE);
+
+    for (unsigned int i = 0; i < RECEIVER_MSG_BATCH_SIZE; ++i) {
+        m_iovs[i].iov_base = m_iov_buf.get() + i * iov_size;
+        m_iovs[i].iov_len = iov_size;
+
+        struct msghdr& msg = m_msgs[i].msg_hdr;
+        msg.msg_name = &m_names[i];
+        msg.msg_namelen = sizeof(struct sockaddr_storage);
+
+        msg.msg_iov = &m_iovs[i];
+        msg.msg_iovlen = 1;
+
+        msg.msg_control = m_ctrl_buf.get() + i * m_ctrl_size;
+        msg.msg_controllen = m_ctrl_size;
+
+        msg.msg_flags = 0;
+        m_msgs[i].msg_len = 0;
+    }
+
+    m_last_msg_count = 0;
+}
+
+int receiver::receive_pending()
+{
+    HC_LOG_TRACE("");
+
+    //recvmmsg() overwrites the name length, control length and flags of each received message
+    for (int i = 0; i < m_last_msg_count; ++i) {
+        m_msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_storage);
+        m_msgs[i].msg_hdr.msg_controllen = m_ctrl_size;
+        m_msgs[i].msg_hdr.msg_flags = 0;
+    }
+
+    int num_msgs = 0;
+    if (!m_mrt_sock->receive_mmsg(m_msgs.data(), RECEIVER_MSG_BATCH_SIZE, num_msgs)) {
+        HC_LOG_ERROR("received failed");
+        m_last_msg_count = 0;
+        return -1;
+    }
+    m_last_msg_count = num_msgs;
+
+    ++m_syscall_count;
+    m_packet_count += num_msgs;
+    if (static_cast<unsigned int>(num_msgs) > m_max_packets_per_syscall) {
+        m_max_packets_per_syscall = num_msgs;
+    }
+
+    if (num_msgs > 0) {
+        {
+            std::lock_guard<std::mutex> lock(m_data_lock);
+            for (int i = 0; i < num_msgs; ++i) {
+                if (m_msgs[i].msg_len > 0) {
+                    analyse_packet(&m_msgs[i].msg_hdr, m_msgs[i].msg_len);
+                }
+            }
+        }
+
+        //the handler may register or delete interfaces, which takes m_data_lock again
+        for (auto & e : m_handler_msgs) {
+            m_msg_handler(e);
+        }
+        m_handler_msgs.clear();
+    }
+
+    return num_msgs;
+}
+
+void receiver::worker_thread()
+{
+    HC_LOG_TRACE("");
+
+    pollfd fds[2];
+    fds[0].fd = m_mrt_sock->get_socket();
+    fds[0].events = POLLIN;
+    fds[1].fd = m_wakeup_fd;
+    fds[1].events = POLLIN;
 
     while (m_running) {
-        if (!m_mrt_sock->receive_msg(&msg, info_size)) {
-            HC_LOG_ERROR("received failed");
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            HC_LOG_ERROR("failed to poll mroute socket! Error: " << strerror(errno) << " errno: " << errno);
             sleep(1);
             continue;
         }
-        if (info_size == 0) {
-            continue; //on timeout
+
+        if (fds[1].revents & POLLIN) {
+            uint64_t value;
+            if (read(m_wakeup_fd, &value, sizeof(value)) < 0) {
+                HC_LOG_WARN("failed to read eventfd! Error: " << strerror(errno) << " errno: " << errno);
+            }
+            continue;
+        }
+
+        if (!(fds[0].revents & (POLLIN | POLLERR))) {
+            continue;
         }
 
-        m_data_lock.lock();
-        analyse_packet(&msg, info_size);
-        m_data_lock.unlock();
+        //drain the socket, a full batch indicates that more packets are pending
+        int num_msgs;
+        do {
+            num_msgs = receive_pending();
+            if (num_msgs < 0) {
+                sleep(1);
+            }
+        } while (m_running && num_msgs == RECEIVER_MSG_BATCH_SIZE);
     }
 }
 
@@ -133,7 +342,10 @@ bool receiver::is_running()
 void receiver::start()
 {
     HC_LOG_TRACE("");
-    if (!m_in_debug_testing_mode) {
+    init_msg_ring();
+    update_socket_filter();
+
+    if (!m_in_debug_testing_mode && !m_msg_handler) {
         m_running =  true;
         m_thread.reset(new std::thread(&receiver::worker_thread, this));
     }
@@ -144,6 +356,11 @@ void receiver::stop()
     HC_LOG_TRACE("");
 
     m_running = false;
+
+    uint64_t value = 1;
+    if (write(m_wakeup_fd, &value, sizeof(value)) < 0) {
+        HC_LOG_ERROR("failed to wake up receiver thread! Error: " << strerror(errno) << " errno: " << errno);
+    }
 }
 
 void receiver::join()
@@ -154,3 +371,31 @@ void receiver::join()
         m_thread->join();
     }
 }
+
+std::string receiver::to_string() const
+{
+    HC_LOG_TRACE("");
+    std::ostringstream s;
+
+    auto time_span = std::chrono::steady_clock::now() - m_start_time;
+    double seconds = std::chrono::duration_cast<std::chrono::duration<double>>(time_span).count();
+
+    unsigned long syscall_count = m_syscall_count;
+    unsigned long packet_count = m_packet_count;
+
+    s << "##-- receiver --##" << std::endl;
+    s << "syscalls: " << syscall_count << " packets: " << packet_count << " max packets per syscall: " << m_max_packets_per_syscall;
+    if (syscall_count > 0) {
+        s << " average packets per syscall: " << static_cast<double>(packet_count) / syscall_count;
+    }
+    if (seconds > 0) {
+        s << " syscalls per second: " << syscall_count / seconds;
+    }
+
+    return s.str();
+}
+
+std::ostream& operator<<(std::ostream& stream, const receiver& r)
+{
+    return stream << r.to_string();
+}
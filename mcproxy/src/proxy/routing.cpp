@@ -26,6 +26,8 @@
 #include "include/proxy/interfaces.hpp"
 #include "include/utils/addr_storage.hpp"
 #include "include/utils/mroute_socket.hpp"
+#include "include/utils/mroute_netlink.hpp"
+#include "include/proxy/check_kernel.hpp"
 
 #include <net/if.h>
 #include <linux/mroute.h>
@@ -40,41 +42,45 @@ routing::routing(int addr_family, std::shared_ptr<const mroute_socket> mrt_sock,
 {
     HC_LOG_TRACE("");
 
-    if (!m_if_prop.refresh_network_interfaces()) {
+    if (!if_registry::get_instance().is_valid()) {
         throw "failed to refresh netwok interfaces";
     }
+
+    //the kernel supports multicast routes via netlink only for IPv4
+    if (m_addr_family == AF_INET) {
+        std::unique_ptr<mroute_netlink> mrt_netlink(new mroute_netlink(table_number));
+        if (check_kernel::check_mroute_netlink(*mrt_netlink)) {
+            HC_LOG_DEBUG("set multicast routes via netlink");
+            m_mrt_netlink = std::move(mrt_netlink);
+        } else {
+            HC_LOG_DEBUG("set multicast routes via setsockopt");
+        }
+    }
 }
 
 bool routing::add_vif(int if_index, int vif) const
 {
     HC_LOG_TRACE("");
 
-    char cstr[IF_NAMESIZE];
-    const struct ifaddrs* item = nullptr;
+    flush_routes();
 
-    std::string if_name(if_indextoname(if_index, cstr)); //fehler!!!!!! könnte abastürzten ???????????????????????ßß<F8><F8><F8>
+    std::string if_name = interfaces::get_if_name(if_index);
 
-    //useless ????????????????????????????????????????????????????????????????????
-    if (m_addr_family == AF_INET) {
-        if ((item = m_if_prop.get_ip4_if(if_name)) == nullptr) {
-            HC_LOG_ERROR("interface not found: " << if_name);
-            return false;
-        }
-    } else if (m_addr_family == AF_INET6) {
-        if ((item = m_if_prop.get_ip6_if(if_name)->front()) == nullptr) {
-            HC_LOG_ERROR("interface not found: " << if_name);
-            return false;
-        }
-    } else {
+    if (m_addr_family != AF_INET && m_addr_family != AF_INET6) {
         HC_LOG_ERROR("wrong addr_family: " << m_addr_family);
         return false;
     }
 
-    if ((item->ifa_flags & IFF_POINTOPOINT) && (item->ifa_dstaddr != nullptr)) { //tunnel
+    if_registry_entry item;
+    if (!if_registry::get_instance().get_entry(if_index, item) || item.get_addrs(m_addr_family).empty()) {
+        HC_LOG_ERROR("interface not found: " << if_name);
+        return false;
+    }
 
-        //addr_storage p2p_addr(*(item->ifa_dstaddr));
+    const addr_storage& dstaddr = item.get_addrs(m_addr_family).front().dstaddr;
+    if ((item.flags & IFF_POINTOPOINT) && dstaddr.is_valid()) { //tunnel
 
-        if (!m_mrt_sock->add_vif(vif, if_index, addr_storage(*(item->ifa_dstaddr)))) {
+        if (!m_mrt_sock->add_vif(vif, if_index, dstaddr)) {
             return false;
         }
 
@@ -116,6 +122,16 @@ bool routing::add_route(int input_vif, const addr_storage& g_addr, const addr_st
         return false;
     }
 
+    if (m_mrt_netlink != nullptr) {
+        unsigned int input_if_index = m_interfaces->get_if_index(input_vif);
+        if (input_if_index != 0) {
+            return m_mrt_netlink->add_mroute(input_if_index, src_addr, g_addr, output_vif);
+        }
+
+        //keep the order of the changes
+        flush_routes();
+    }
+
     if (!m_mrt_sock->add_mroute(input_vif, src_addr, g_addr, output_vif)) {
         return false;
     }
@@ -127,6 +143,10 @@ bool routing::del_route(int vif, const addr_storage& g_addr, const addr_storage&
 {
     HC_LOG_TRACE("");
 
+    if (m_mrt_netlink != nullptr) {
+        return m_mrt_netlink->del_mroute(src_addr, g_addr);
+    }
+
     if (!m_mrt_sock->del_mroute(vif, src_addr, g_addr)) {
         return false;
     }
@@ -134,10 +154,45 @@ bool routing::del_route(int vif, const addr_storage& g_addr, const addr_storage&
     return true;
 }
 
+bool routing::flush_routes() const
+{
+    HC_LOG_TRACE("");
+
+    if (m_mrt_netlink != nullptr) {
+        return m_mrt_netlink->flush();
+    }
+
+    return true;
+}
+
+bool routing::flush_routes(std::list<mroute_change>& failed_routes) const
+{
+    HC_LOG_TRACE("");
+
+    if (m_mrt_netlink != nullptr) {
+        return m_mrt_netlink->flush(failed_routes);
+    }
+
+    return true;
+}
+
+std::string routing::to_string() const
+{
+    HC_LOG_TRACE("");
+
+    if (m_mrt_netlink != nullptr) {
+        return "kernel interface: netlink, " + m_mrt_netlink->to_string();
+    } else {
+        return "kernel interface: setsockopt";
+    }
+}
+
 bool routing::del_vif(int if_index, int vif) const
 {
     HC_LOG_TRACE("");
 
+    flush_routes();
+
     if (!m_mrt_sock->del_vif(vif)) {
         return false;
     }
@@ -161,8 +216,9 @@ routing::~routing()
 {
     HC_LOG_TRACE("");
 
-    //clean up all added interfaces
-    for (auto e : m_added_ifs) {
+    //clean up all added interfaces, del_vif erases them from m_added_ifs
+    auto added_ifs = m_added_ifs;
+    for (auto e : added_ifs) {
         del_vif(e, m_interfaces->get_virtual_if_index(e));
     }
 }
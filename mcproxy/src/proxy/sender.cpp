@@ -25,11 +25,17 @@
 #include "include/proxy/sender.hpp"
 #include "include/proxy/message_format.hpp" //source
 #include "include/proxy/timers_values.hpp"
+#include "include/utils/if_registry.hpp"
 
 #include <iostream>
+#include <sstream>
+#include <cstring>
 sender::sender(const std::shared_ptr<const interfaces>& interfaces, group_mem_protocol gmp)
     : m_group_mem_protocol(gmp)
     , m_interfaces(interfaces)
+    , m_memberships(get_addr_family(gmp))
+    , m_message_count(0)
+    , m_packet_count(0)
 {
     HC_LOG_TRACE("");
 
@@ -135,6 +141,31 @@ bool sender::send_mc_addr_and_src_specific_query(unsigned int if_index, const ti
 
     return rc;
 }
+
+unsigned int sender::get_report_capacity(unsigned int) const
+{
+    HC_LOG_TRACE("");
+    return 0;
+}
+
+unsigned int sender::get_record_size(unsigned int) const
+{
+    HC_LOG_TRACE("");
+    return 0;
+}
+
+bool sender::send_report(unsigned int if_index, const std::vector<report_record>& records) const
+{
+    using namespace std;
+    HC_LOG_TRACE("");
+    cout << "!!--ACTION: send report with " << records.size() << " records" << endl;
+    cout << "interface: " << interfaces::get_if_name(if_index) << endl;
+    for (auto & e : records) {
+        cout << get_mcast_addr_record_type_name(e.type) << " " << e.gaddr << " sources: " << e.sources.size() << endl;
+    }
+    cout << endl;
+    return true;
+}
 #else
 
 bool sender::send_record(unsigned int, mc_filter, const addr_storage&, const source_list<source>&) const
@@ -156,8 +187,109 @@ bool sender::send_mc_addr_and_src_specific_query(unsigned int, const timers_valu
     return false;    
 }
 
+unsigned int sender::get_report_capacity(unsigned int) const
+{
+    return 0;
+}
+
+unsigned int sender::get_record_size(unsigned int) const
+{
+    return 0;
+}
+
+bool sender::send_report(unsigned int, const std::vector<report_record>&) const
+{
+    return false;
+}
+
 #endif /* DEBUG_MODE */
 
+unsigned int sender::get_mtu(unsigned int if_index) const
+{
+    HC_LOG_TRACE("");
+
+    unsigned int mtu = if_registry::get_instance().get_mtu(if_index);
+    if (mtu > 0) {
+        return mtu;
+    } else if (is_IPv4(m_group_mem_protocol)) {
+        return SENDER_DEFAULT_IPV4_MTU;
+    } else {
+        return SENDER_DEFAULT_IPV6_MTU;
+    }
+}
+
+sender::packet_buffer& sender::get_packet_buffer(unsigned int if_index) const
+{
+    HC_LOG_TRACE("");
+
+    packet_buffer& buf = m_packet_buffers[if_index];
+    buf.data.clear();
+    buf.offsets.clear();
+    buf.sizes.clear();
+    return buf;
+}
+
+unsigned char* sender::add_packet(packet_buffer& buf, unsigned int size) const
+{
+    HC_LOG_TRACE("");
+
+    unsigned int offset = (buf.data.size() + SENDER_PACKET_ALIGNMENT - 1) / SENDER_PACKET_ALIGNMENT * SENDER_PACKET_ALIGNMENT;
+    buf.data.resize(offset + size, 0);
+    buf.offsets.push_back(offset);
+    buf.sizes.push_back(size);
+    return buf.data.data() + offset;
+}
+
+bool sender::send_packets(const addr_storage& dst_addr, const packet_buffer& buf) const
+{
+    HC_LOG_TRACE("");
+
+    unsigned int num_of_packets = buf.sizes.size();
+    m_iovecs.resize(num_of_packets);
+    m_msgs.resize(num_of_packets);
+
+    for (unsigned int i = 0; i < num_of_packets; ++i) {
+        m_iovecs[i].iov_base = const_cast<unsigned char*>(buf.data.data()) + buf.offsets[i];
+        m_iovecs[i].iov_len = buf.sizes[i];
+
+        memset(&m_msgs[i], 0, sizeof(mmsghdr));
+        m_msgs[i].msg_hdr.msg_name = const_cast<sockaddr*>(&dst_addr.get_sockaddr());
+        m_msgs[i].msg_hdr.msg_namelen = dst_addr.get_addr_len();
+        m_msgs[i].msg_hdr.msg_iov = &m_iovecs[i];
+        m_msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    ++m_message_count;
+
+    unsigned int sent = 0;
+    while (sent < num_of_packets) {
+        int num_msgs = 0;
+        if (!m_sock.send_mmsg(&m_msgs[sent], num_of_packets - sent, num_msgs) || num_msgs <= 0) {
+            return false;
+        }
+        sent += num_msgs;
+        m_packet_count += num_msgs;
+    }
+
+    return true;
+}
+
+std::string sender::to_string() const
+{
+    HC_LOG_TRACE("");
+    std::ostringstream s;
+
+    s << m_memberships.to_string() << std::endl;
+    s << "##-- sent messages --##" << std::endl;
+    s << "messages: " << m_message_count << " packets: " << m_packet_count;
+    return s.str();
+}
+
+std::ostream& operator<<(std::ostream& stream, const sender& s)
+{
+    return stream << s.to_string();
+}
+
 sender::~sender()
 {
     HC_LOG_TRACE("");
@@ -27,12 +27,23 @@
 #include "include/proxy/proxy_instance.hpp"
 #include "include/proxy/querier.hpp"
 #include "include/proxy/routing.hpp"
+#include "include/utils/mroute_netlink.hpp"
 #include "include/proxy/interfaces.hpp"
 #include "include/proxy/sender.hpp"
+#include "include/proxy/host_reporter.hpp"
 #include "include/proxy/timing.hpp"
 
 #include <algorithm>
 #include <memory>
+#include <set>
+
+#ifdef DEBUG_MODE
+#include "include/parser/parser.hpp"
+#include "include/utils/benchmark.hpp"
+
+#include <iomanip>
+#include <random>
+#endif /* DEBUG_MODE */
 
 //-------------------------------------------------------------------------------
 //-------------------------------------------------------------------------------
@@ -56,16 +67,73 @@ std::string source_state::to_string() const
     s << get_mc_filter_name(m_mc_filter) << "{" << m_source_list << "}";
     return s.str();
 }
+
+bool operator==(const source_state& l, const source_state& r)
+{
+    return l.m_mc_filter == r.m_mc_filter && l.m_source_list == r.m_source_list;
+}
+
+bool operator!=(const source_state& l, const source_state& r)
+{
+    return !(l == r);
+}
+//-------------------------------------------------------------------------------
+//-------------------------------------------------------------------------------
+source_owner_index::source_owner::source_owner()
+    : m_owner_pos(-1)
+    , m_aggregation(0)
+{
+}
+
+source_owner_index::source_owner_index()
+    : m_aggregation_count(0)
+{
+}
+
+void source_owner_index::add_source(const ip_addr& gaddr, const ip_addr& saddr, const upstream_list& upstreams, const downstream_list& downstreams)
+{
+    HC_LOG_TRACE("");
+
+    std::vector<std::string> upstr_if_names;
+    upstr_if_names.reserve(upstreams.size());
+    for (auto & upstr_e : upstreams) {
+        upstr_if_names.push_back(upstr_e.second->get_if_name());
+    }
+
+    source_owner& owner = m_sources[saddr];
+    owner.m_upstream_pos.clear();
+    owner.m_upstream_pos.reserve(downstreams.size());
+
+    for (auto & downs_e : downstreams) {
+        int first_pos = -1;
+        int upstream_pos = 0;
+        for (auto & upstr_e : upstreams) {
+            const std::string& upstr_if_name = upstr_if_names[upstream_pos];
+
+            //downstream out and upstream in
+            if (downs_e->match_output_filter(upstr_if_name, gaddr, saddr) && upstr_e.second->match_input_filter(upstr_if_name, gaddr, saddr)) {
+                first_pos = upstream_pos;
+                break;
+            }
+
+            ++upstream_pos;
+        }
+        owner.m_upstream_pos.push_back(first_pos);
+    }
+}
+
 //-------------------------------------------------------------------------------
 //-------------------------------------------------------------------------------
-interface_memberships::interface_memberships(rb_rule_matching_type upstream_in_rule_matching_type, const addr_storage& gaddr, const proxy_instance* pi, const simple_routing_data& routing_data)
+interface_memberships::interface_memberships(rb_rule_matching_type upstream_in_rule_matching_type, const ip_addr& gaddr, const proxy_instance* pi, const simple_routing_data& routing_data, source_owner_index* owner_index)
 {
     HC_LOG_TRACE("");
 
     if (upstream_in_rule_matching_type == RMT_FIRST) {
         process_upstream_in_first(gaddr, pi);
+    } else if (owner_index != nullptr) {
+        process_upstream_in_mutex(gaddr, pi, routing_data, *owner_index);
     } else {
-        process_upstream_in_mutex(gaddr, pi, routing_data);
+        HC_LOG_ERROR("index of the source owners not found");
     }
 }
 
@@ -95,7 +163,7 @@ void interface_memberships::merge_membership_infos(source_state& merge_to, const
     }
 }
 
-void interface_memberships::process_upstream_in_first(const addr_storage& gaddr, const proxy_instance* pi)
+void interface_memberships::process_upstream_in_first(const ip_addr& gaddr, const proxy_instance* pi)
 {
     HC_LOG_TRACE("");
 
@@ -115,23 +183,21 @@ void interface_memberships::process_upstream_in_first(const addr_storage& gaddr,
             tmp_sstate.m_mc_filter = cs.first.m_mc_filter;
 
             //sort out all unwanted sources
-            for (auto source_it = cs.first.m_source_list.begin(); source_it != cs.first.m_source_list.end();) {
+            cs.first.m_source_list.erase_if([&](const source & s) {
 
                 //downstream out
-                if (!cs.second->match_output_filter(interfaces::get_if_name(upstr_e.m_if_index), gaddr, source_it->saddr)) {
-                    source_it = cs.first.m_source_list.erase(source_it);
-                    continue;
+                if (!cs.second->match_output_filter(interfaces::get_if_name(upstr_e.m_if_index), gaddr, s.saddr)) {
+                    return true;
                 }
 
                 //upstream in
-                if (!upstr_e.m_interface->match_input_filter(interfaces::get_if_name(upstr_e.m_if_index), gaddr, source_it->saddr)) {
-                    tmp_sstate.m_source_list.insert(*source_it);
-                    source_it = cs.first.m_source_list.erase(source_it);
-                    continue;
+                if (!upstr_e.m_interface->match_input_filter(interfaces::get_if_name(upstr_e.m_if_index), gaddr, s.saddr)) {
+                    tmp_sstate.m_source_list.insert(s);
+                    return true;
                 }
 
-                ++source_it;
-            }
+                return false;
+            });
 
             if (!tmp_sstate.m_source_list.empty()) {
                 tmp_sstate_list.push_back(state_pair(tmp_sstate, cs.second));
@@ -149,7 +215,7 @@ void interface_memberships::process_upstream_in_first(const addr_storage& gaddr,
 
 }
 
-void interface_memberships::process_upstream_in_mutex(const addr_storage& gaddr, const proxy_instance* pi, const simple_routing_data& routing_data)
+void interface_memberships::process_upstream_in_mutex(const ip_addr& gaddr, const proxy_instance* pi, const simple_routing_data& routing_data, source_owner_index& owner_index)
 {
     HC_LOG_TRACE("");
 
@@ -160,45 +226,181 @@ void interface_memberships::process_upstream_in_mutex(const addr_storage& gaddr,
     }
     //print(ref_sstate_list);
 
-    //init and fill database
+    upstream_list upstreams;
     for (auto & upstr_e : pi->m_upstreams) {
+        upstreams.push_back(std::make_pair(upstr_e.m_if_index, upstr_e.m_interface));
+    }
+
+    process_upstream_in_mutex(gaddr, std::move(ref_sstate_list), upstreams, routing_data.get_interface_map(gaddr), owner_index, [pi](unsigned int if_index) {
+        return pi->is_upstream(if_index);
+    });
+}
+
+void interface_memberships::process_upstream_in_mutex(const ip_addr& gaddr, state_list&& ref_sstate_list, const upstream_list& upstreams, const std::map<ip_addr, unsigned int>& available_sources, source_owner_index& owner_index, const std::function<bool(unsigned int)>& is_upstream)
+{
+    HC_LOG_TRACE("");
+
+    //a known source belongs only to the last upstream which takes it from a downstream with a membership
+    const unsigned long aggregation = ++owner_index.m_aggregation_count;
+    unsigned int downstream_pos = 0;
+    for (auto & cs : ref_sstate_list) {
+        for (auto & s : cs.first.m_source_list) {
+            auto owner_it = owner_index.m_sources.find(s.saddr);
+            if (owner_it == owner_index.m_sources.end()) {
+                continue;
+            }
+
+            auto& owner = owner_it->second;
+            int upstream_pos = owner.m_upstream_pos[downstream_pos];
+            if (upstream_pos >= 0 && (owner.m_aggregation != aggregation || upstream_pos > owner.m_owner_pos)) {
+                owner.m_owner_pos = upstream_pos;
+                owner.m_aggregation = aggregation;
+            }
+        }
+        ++downstream_pos;
+    }
+
+    std::vector<std::string> upstr_if_names;
+    upstr_if_names.reserve(upstreams.size());
+    for (auto & upstr_e : upstreams) {
+        upstr_if_names.push_back(upstr_e.second->get_if_name());
+    }
+
+    //source states of every upstream (first) and downstream (second)
+    std::vector<std::vector<source_state>> sstates(upstreams.size(), std::vector<source_state>(ref_sstate_list.size()));
+
+    downstream_pos = 0;
+    for (auto & cs : ref_sstate_list) {
+        for (auto & upstream_sstates : sstates) {
+            upstream_sstates[downstream_pos].m_mc_filter = cs.first.m_mc_filter;
+        }
+
+        for (auto & s : cs.first.m_source_list) {
+            auto owner_it = owner_index.m_sources.find(s.saddr);
+            if (owner_it != owner_index.m_sources.end()) {
+
+                //a known source is taken from this downstream by the first matching upstream, which has to own it
+                auto& owner = owner_it->second;
+                int upstream_pos = owner.m_upstream_pos[downstream_pos];
+                if (upstream_pos >= 0 && owner.m_aggregation == aggregation && upstream_pos == owner.m_owner_pos) {
+                    auto av_src_it = available_sources.find(s.saddr);
+                    if (av_src_it != available_sources.end() && is_upstream(av_src_it->second)) {
+                        sstates[upstream_pos][downstream_pos].m_source_list.insert(s);
+                    }
+                }
+
+            } else {
+
+                //an unknown source is requested on every matching upstream
+                unsigned int upstream_pos = 0;
+                for (auto & upstr_e : upstreams) {
+                    const std::string& upstr_if_name = upstr_if_names[upstream_pos];
+
+                    //downstream out and upstream in
+                    if (cs.second->match_output_filter(upstr_if_name, gaddr, s.saddr) && upstr_e.second->match_input_filter(upstr_if_name, gaddr, s.saddr)) {
+                        sstates[upstream_pos][downstream_pos].m_source_list.insert(s);
+                    }
+
+                    ++upstream_pos;
+                }
+            }
+        }
+        ++downstream_pos;
+    }
+
+    //init and fill database
+    unsigned int upstream_pos = 0;
+    for (auto & upstr_e : upstreams) {
+        std::list<source_state> tmp_sstate_list;
+        for (auto & e : sstates[upstream_pos]) {
+            if (!e.m_source_list.empty()) {
+                tmp_sstate_list.push_back(std::move(e));
+            }
+        }
+
+        m_data.push_back(std::pair<unsigned int, std::list<source_state>>(upstr_e.first, std::move(tmp_sstate_list)));
+        ++upstream_pos;
+    }
+}
+
+source_state interface_memberships::get_group_memberships(unsigned int upstream_if_index)
+{
+    HC_LOG_TRACE("");
+
+    source_state result;
+    auto data_it = m_data.begin();
+    if (data_it != m_data.end() && data_it->first != upstream_if_index) {
+        HC_LOG_ERROR("unexpected upstream interface " << interfaces::get_if_name(upstream_if_index));
+        return result;
+    }
+
+    for (auto & e : data_it->second) {
+        merge_membership_infos(result, e);
+    }
+
+    m_data.pop_front();
+    return result;
+}
+
+std::string interface_memberships::to_string() const
+{
+    std::ostringstream s;
+    for (auto & e : m_data) {
+        s << interfaces::get_if_name(e.first) <<  ":";
+        for (auto & f : e.second) {
+            s << std::endl << indention(f.to_string());
+        }
+    }
+    return s.str();
+}
+
+#ifdef DEBUG_MODE
+void interface_memberships::print(const state_list& sl)
+{
+    std::cout << "-- print state_list --" << std::endl;
+    for (auto & e : sl) {
+        std::cout << "source state(first): " << e.first.to_string() << std::endl;
+        std::cout << "interface name(second): " << e.second->to_string_interface();
+        std::cout << "interface rule binding(second): " << e.second->to_string_rule_binding();
+    }
+
+}
+
+//the former aggregation of process_upstream_in_mutex(), every known source is removed from all states of the earlier upstreams at once
+static std::list<std::pair<unsigned int, std::list<source_state>>> test_old_upstream_in_mutex(const ip_addr& gaddr, std::list<std::pair<source_state, const std::shared_ptr<const interface>>> ref_sstate_list, const std::list<std::pair<unsigned int, std::shared_ptr<const interface>>>& upstreams, const std::map<ip_addr, unsigned int>& available_sources, const std::function<bool(unsigned int)>& is_upstream)
+{
+    std::list<std::pair<unsigned int, std::list<source_state>>> data;
+
+    for (auto & upstr_e : upstreams) {
 
         std::list<source_state> tmp_sstate_list;
 
-        //for every downstream interface
         for (auto cs_it = ref_sstate_list.begin(); cs_it != ref_sstate_list.end();) {
 
             source_state tmp_sstate;
             tmp_sstate.m_mc_filter = cs_it->first.m_mc_filter;
 
-            //sort out all unwanted sources
-            for (auto source_it = cs_it->first.m_source_list.begin(); source_it != cs_it->first.m_source_list.end();) {
+            cs_it->first.m_source_list.erase_if([&](const source & s) {
 
-                //downstream out
-                if (!cs_it->second->match_output_filter(interfaces::get_if_name(upstr_e.m_if_index), gaddr, source_it->saddr)) {
-                    ++source_it;
-                    continue;
+                if (!cs_it->second->match_output_filter(upstr_e.second->get_if_name(), gaddr, s.saddr)) {
+                    return false;
                 }
 
-                //upstream in
-                if (!upstr_e.m_interface->match_input_filter(interfaces::get_if_name(upstr_e.m_if_index), gaddr, source_it->saddr)) {
-                    ++source_it;
-                    continue;
+                if (!upstr_e.second->match_input_filter(upstr_e.second->get_if_name(), gaddr, s.saddr)) {
+                    return false;
                 }
 
-                const std::map<addr_storage, unsigned int>& available_sources = routing_data.get_interface_map(gaddr);
-                auto av_src_it = available_sources.find(source_it->saddr);
+                auto av_src_it = available_sources.find(s.saddr);
                 if (av_src_it != available_sources.end()) {
 
-                    if (pi->is_upstream(av_src_it->second)) {
-                        tmp_sstate.m_source_list.insert(*source_it);
+                    if (is_upstream(av_src_it->second)) {
+                        tmp_sstate.m_source_list.insert(s);
                     }
 
-                    //clean this->m_data
-                    for (auto & data_e : m_data) {
+                    for (auto & data_e : data) {
                         for (auto sstate_it = data_e.second.begin(); sstate_it != data_e.second.end();) {
 
-                            auto s_it = sstate_it->m_source_list.find(*source_it);
+                            auto s_it = sstate_it->m_source_list.find(s);
                             if (s_it != sstate_it->m_source_list.end()) {
                                 sstate_it->m_source_list.erase(s_it);
                             }
@@ -211,15 +413,14 @@ void interface_memberships::process_upstream_in_mutex(const addr_storage& gaddr,
                         }
                     }
 
-                    source_it = cs_it->first.m_source_list.erase(source_it);
-                    continue;
+                    return true;
 
                 } else {
-                    tmp_sstate.m_source_list.insert(*source_it);
+                    tmp_sstate.m_source_list.insert(s);
                 }
 
-                ++source_it;
-            }
+                return false;
+            });
 
             if (!tmp_sstate.m_source_list.empty()) {
                 tmp_sstate_list.push_back(tmp_sstate);
@@ -233,52 +434,224 @@ void interface_memberships::process_upstream_in_mutex(const addr_storage& gaddr,
             ++cs_it;
         }
 
-        m_data.push_back(std::pair<unsigned int, std::list<source_state>>(upstr_e.m_if_index, std::move(tmp_sstate_list)));
+        data.push_back(std::pair<unsigned int, std::list<source_state>>(upstr_e.first, std::move(tmp_sstate_list)));
     }
 
+    return data;
 }
 
-source_state interface_memberships::get_group_memberships(unsigned int upstream_if_index)
+void interface_memberships::test_upstream_in_mutex()
 {
+    using namespace std;
     HC_LOG_TRACE("");
+    cout << "##-- test upstream in mutex --##" << endl;
 
-    source_state result;
-    auto data_it = m_data.begin();
-    if (data_it != m_data.end() && data_it->first != upstream_if_index) {
-        HC_LOG_ERROR("unexpected upstream interface " << interfaces::get_if_name(upstream_if_index));
+    log_silencer silencer;
+
+    const ip_addr gaddr(addr_storage("232.1.1.1"));
+    std::default_random_engine random_engine(42);
+
+    //upstream n has the interface index n + 1, downstream n the interface index n + 1001
+    auto is_upstream = [](unsigned int if_index) {
+        return if_index < 1000;
+    };
+
+    auto get_saddr = [](unsigned int n) {
+        in_addr a;
+        a.s_addr = htonl(0x0a000001 + n); //10.0.0.1 + n
+        return ip_addr(addr_storage(a));
+    };
+
+    //proxy instance with the interfaces up0, up1, ... and down0, down1, ... and the given filters
+    auto parse_instance = [](unsigned int num_of_upstreams, unsigned int num_of_downstreams, const vector<string>& filters, inst_def_set & ids) {
+        ostringstream s;
+        s << "pinstance test:";
+        for (unsigned int i = 0; i < num_of_upstreams; ++i) {
+            s << " up" << i;
+        }
+        s << " ==>";
+        for (unsigned int i = 0; i < num_of_downstreams; ++i) {
+            s << " down" << i;
+        }
+
+        parser(0, s.str()).parse_instance_definition(ids);
+
+        auto gts = make_shared<global_table_set>();
+        for (auto & e : filters) {
+            parser(0, e).parse_interface_rule_binding(gts, IGMPv3, ids);
+        }
+
+        return *ids.find("test");
+    };
+
+    auto get_upstreams = [](const shared_ptr<instance_definition>& id) {
+        upstream_list result;
+        unsigned int if_index = 1;
+        for (auto & e : id->get_upstreams()) {
+            result.push_back(make_pair(if_index++, e));
+        }
         return result;
-    }
+    };
 
-    for (auto & e : data_it->second) {
-        merge_membership_infos(result, e);
+    //the index of the known sources, as the routing keeps it between the aggregations
+    auto get_owner_index = [&](const state_list & ref_sstate_list, const upstream_list & upstreams, const map<ip_addr, unsigned int>& available_sources) {
+        source_owner_index::downstream_list downstreams;
+        for (auto & e : ref_sstate_list) {
+            downstreams.push_back(e.second);
+        }
+
+        source_owner_index result;
+        for (auto & e : available_sources) {
+            result.add_source(gaddr, e.first, upstreams, downstreams);
+        }
+        return result;
+    };
+
+    auto run_new = [&](const state_list & ref_sstate_list, const upstream_list & upstreams, const map<ip_addr, unsigned int>& available_sources, source_owner_index & owner_index) {
+        interface_memberships im;
+        im.process_upstream_in_mutex(gaddr, state_list(ref_sstate_list), upstreams, available_sources, owner_index, is_upstream);
+        return im.m_data;
+    };
+
+    auto run_old = [&](const state_list & ref_sstate_list, const upstream_list & upstreams, const map<ip_addr, unsigned int>& available_sources) {
+        return test_old_upstream_in_mutex(gaddr, ref_sstate_list, upstreams, available_sources, is_upstream);
+    };
+
+    //equivalence with the former aggregation
+    const unsigned int num_of_cases = 3000;
+    const unsigned int source_pool = 16;
+    unsigned int failed = 0;
+    uniform_int_distribution<unsigned int> percent(0, 99);
+    for (unsigned int c = 0; c < num_of_cases; ++c) {
+        unsigned int num_of_upstreams = 1 + random_engine() % 4;
+        unsigned int num_of_downstreams = 1 + random_engine() % 5;
+
+        auto get_filter = [&](const string & if_type, const string & if_name, const string & direction) {
+            unsigned int from = random_engine() % source_pool;
+            unsigned int to = from + random_engine() % (source_pool - from);
+            string rule_if_name = direction == "out" && percent(random_engine) < 50 ? "up" + std::to_string(random_engine() % num_of_upstreams) : "";
+            return "pinstance test " + if_type + " " + if_name + " " + direction + (percent(random_engine) < 50 ? " whitelist" : " blacklist")
+                   + " table {" + rule_if_name + "(* | " + get_saddr(from).to_string() + " - " + get_saddr(to).to_string() + ")}";
+        };
+
+        vector<string> filters;
+        for (unsigned int i = 0; i < num_of_upstreams; ++i) {
+            if (percent(random_engine) < 30) {
+                filters.push_back(get_filter("upstream", "up" + std::to_string(i), "in"));
+            }
+        }
+        for (unsigned int i = 0; i < num_of_downstreams; ++i) {
+            if (percent(random_engine) < 30) {
+                filters.push_back(get_filter("downstream", "down" + std::to_string(i), "out"));
+            }
+        }
+
+        inst_def_set ids;
+        auto id = parse_instance(num_of_upstreams, num_of_downstreams, filters, ids);
+        auto upstreams = get_upstreams(id);
+
+        state_list ref_sstate_list;
+        for (auto & e : id->get_downstreams()) {
+            source_state sstate;
+            sstate.m_mc_filter = percent(random_engine) < 30 ? EXCLUDE_MODE : INCLUDE_MODE;
+            for (unsigned int i = 0; i < source_pool; ++i) {
+                if (percent(random_engine) < 50) {
+                    sstate.m_source_list.insert(source(get_saddr(i)));
+                }
+            }
+            ref_sstate_list.push_back(state_pair(sstate, e));
+        }
+
+        map<ip_addr, unsigned int> available_sources;
+        for (unsigned int i = 0; i < source_pool; ++i) {
+            if (percent(random_engine) < 40) {
+                if (percent(random_engine) < 50) {
+                    available_sources[get_saddr(i)] = 1 + random_engine() % num_of_upstreams;
+                } else {
+                    available_sources[get_saddr(i)] = 1001 + random_engine() % num_of_downstreams;
+                }
+            }
+        }
+
+        auto owner_index = get_owner_index(ref_sstate_list, upstreams, available_sources);
+        if (run_new(ref_sstate_list, upstreams, available_sources, owner_index) != run_old(ref_sstate_list, upstreams, available_sources)) {
+            ++failed;
+        }
+    }
+    cout << num_of_cases << " random cases, " << failed << " differ from the former aggregation" << endl;
+
+    //benchmark
+    const unsigned int num_of_upstreams = 8;
+    const unsigned int num_of_downstreams = 64;
+    const unsigned int num_of_sources = 1000;
+    const unsigned int runs = 5;
+
+    //every upstream accepts its share of the sources and half of the next share
+    vector<string> filters;
+    for (unsigned int i = 0; i < num_of_upstreams; ++i) {
+        unsigned int from = i * num_of_sources / num_of_upstreams;
+        unsigned int to = min(from + 3 * num_of_sources / (2 * num_of_upstreams), num_of_sources - 1);
+        filters.push_back("pinstance test upstream up" + std::to_string(i) + " in whitelist table {(* | " + get_saddr(from).to_string() + " - " + get_saddr(to).to_string() + ")}");
     }
 
-    m_data.pop_front();
-    return result;
-}
+    inst_def_set ids;
+    auto id = parse_instance(num_of_upstreams, num_of_downstreams, filters, ids);
+    auto upstreams = get_upstreams(id);
 
-std::string interface_memberships::to_string() const
-{
-    std::ostringstream s;
-    for (auto & e : m_data) {
-        s << interfaces::get_if_name(e.first) <<  ":";
-        for (auto & f : e.second) {
-            s << std::endl << indention(f.to_string());
+    //every eighth downstream is in exclude mode, the others request 80% of the sources
+    state_list ref_sstate_list;
+    unsigned int downstream_pos = 0;
+    for (auto & e : id->get_downstreams()) {
+        source_state sstate;
+        sstate.m_mc_filter = downstream_pos++ % 8 == 0 ? EXCLUDE_MODE : INCLUDE_MODE;
+        for (unsigned int i = 0; i < num_of_sources; ++i) {
+            if (percent(random_engine) < 80) {
+                sstate.m_source_list.insert(source(get_saddr(i)));
+            }
         }
+        ref_sstate_list.push_back(state_pair(sstate, e));
     }
-    return s.str();
-}
 
-#ifdef DEBUG_MODE
-void interface_memberships::print(const state_list& sl)
-{
-    std::cout << "-- print state_list --" << std::endl;
-    for (auto & e : sl) {
-        std::cout << "source state(first): " << e.first.to_string() << std::endl;
-        std::cout << "interface name(second): " << e.second->to_string_interface();
-        std::cout << "interface rule binding(second): " << e.second->to_string_rule_binding();
+    //all sources are known, 70% of them arrive on an upstream
+    map<ip_addr, unsigned int> available_sources;
+    for (unsigned int i = 0; i < num_of_sources; ++i) {
+        if (percent(random_engine) < 70) {
+            available_sources[get_saddr(i)] = 1 + random_engine() % num_of_upstreams;
+        } else {
+            available_sources[get_saddr(i)] = 1001 + random_engine() % num_of_downstreams;
+        }
     }
 
+    source_owner_index owner_index;
+    auto index_usec = measure_nsec([&]() {
+        owner_index = get_owner_index(ref_sstate_list, upstreams, available_sources);
+    }, runs) / (1000 * runs);
+
+    std::list<std::pair<unsigned int, std::list<source_state>>> new_data;
+    auto new_usec = measure_nsec([&]() {
+        new_data = run_new(ref_sstate_list, upstreams, available_sources, owner_index);
+    }, runs) / (1000 * runs);
+
+    std::list<std::pair<unsigned int, std::list<source_state>>> old_data;
+    auto old_usec = measure_nsec([&]() {
+        old_data = run_old(ref_sstate_list, upstreams, available_sources);
+    }, runs) / (1000 * runs);
+
+    cout << num_of_upstreams << " upstreams, " << num_of_downstreams << " downstreams, " << num_of_sources << " sources, " << available_sources.size() << " known sources" << endl;
+    cout << "owner index: " << setw(8) << index_usec << "usec to build, only on interface changes" << endl;
+    cout << "owner index: " << setw(8) << new_usec << "usec per aggregation" << endl;
+    cout << "former:      " << setw(8) << old_usec << "usec per aggregation" << endl;
+    cout << "results " << (new_data == old_data ? "match" : "differ") << ", sources per upstream:";
+    for (auto & data_e : new_data) {
+        unsigned long count = 0;
+        for (auto & e : data_e.second) {
+            count += e.m_source_list.size();
+        }
+        cout << " " << count;
+    }
+    cout << endl;
+
+    cout << "finished" << endl;
 }
 #endif /* DEBUG_MODE */
 
@@ -286,15 +659,31 @@ void interface_memberships::print(const state_list& sl)
 //-------------------------------------------------------------------------------
 simple_mc_proxy_routing::simple_mc_proxy_routing(const proxy_instance* p)
     : routing_management(p)
-    , m_data(p->m_group_mem_protocol, p->m_mrt_sock)
+    , m_data(p->m_group_mem_protocol, p->m_mrt_sock, p->m_table_number)
+    , m_mfc_change_count(0)
+    , m_mfc_avoided_count(0)
+    , m_mfc_failed_count(0)
+    , m_mfc_time(0)
+    , m_sweep_count(0)
+    , m_swept_source_count(0)
+    , m_expired_source_count(0)
+    , m_upstream_report_count(0)
+    , m_upstream_coalesced_count(0)
+    , m_upstream_unchanged_count(0)
 {
     HC_LOG_TRACE("");
 }
 
-std::chrono::seconds simple_mc_proxy_routing::get_source_life_time()
+simple_mc_proxy_routing::upstream_report::upstream_report()
+    : m_is_pending(false)
+    , m_is_updated(false)
+{
+}
+
+std::chrono::milliseconds simple_mc_proxy_routing::get_source_life_time()
 {
     HC_LOG_TRACE("");
-    return std::chrono::seconds(20);
+    return m_p->m_source_life_time;
 }
 
 void simple_mc_proxy_routing::event_new_source(const std::shared_ptr<proxy_msg>& msg)
@@ -304,17 +693,26 @@ void simple_mc_proxy_routing::event_new_source(const std::shared_ptr<proxy_msg>&
     switch (msg->get_type()) {
     case proxy_msg::NEW_SOURCE_MSG: {
         auto sm = std::static_pointer_cast<new_source_msg>(msg);
+        const ip_addr& gaddr = sm->get_gaddr();
         source s(sm->get_saddr());
+
+        //an already known source leaves its old sweep, which skips it later
         s.shared_source_timer = set_source_timer(sm->get_if_index(), sm->get_gaddr(), sm->get_saddr());
 
         //route calculation
         m_data.set_source(sm->get_if_index(), sm->get_gaddr(), s);
 
-        set_routes(sm->get_gaddr(), collect_interested_interfaces(sm->get_gaddr(), {sm->get_saddr()}));
+        set_routes(gaddr, collect_interested_interfaces(gaddr, {sm->get_saddr()}));
 
 
         if (is_rule_matching_type(IT_UPSTREAM, ID_IN, RMT_MUTEX)) {
-            process_membership_aggregation(RMT_MUTEX, sm->get_gaddr());
+            //a group without index gets it with all its sources at the aggregation
+            auto owner_it = m_source_owners.find(sm->get_gaddr());
+            if (owner_it != std::end(m_source_owners) && owner_it->second.m_sources.find(s.saddr) == std::end(owner_it->second.m_sources)) {
+                add_source_owners(owner_it->second, gaddr, {s.saddr});
+            }
+
+            process_membership_aggregation(RMT_MUTEX, gaddr);
         }
 
     }
@@ -325,7 +723,7 @@ void simple_mc_proxy_routing::event_new_source(const std::shared_ptr<proxy_msg>&
     }
 }
 
-void simple_mc_proxy_routing::event_querier_state_change(unsigned int /*if_index*/, const addr_storage& gaddr)
+void simple_mc_proxy_routing::event_querier_state_change(unsigned int /*if_index*/, const ip_addr& gaddr)
 {
     HC_LOG_TRACE("");
 
@@ -342,46 +740,77 @@ void simple_mc_proxy_routing::event_querier_state_change(unsigned int /*if_index
     }
 }
 
+void simple_mc_proxy_routing::event_interface_change()
+{
+    HC_LOG_TRACE("");
+
+    //the positions of the interfaces have changed, every group gets a new index at its next aggregation
+    m_source_owners.clear();
+}
+
 void simple_mc_proxy_routing::timer_triggerd_maintain_routing_table(const std::shared_ptr<proxy_msg>& msg)
 {
     HC_LOG_TRACE("");
 
-    std::shared_ptr<new_source_timer_msg> tm;
+    switch (msg->get_type()) {
+    case proxy_msg::SOURCE_SWEEP_TIMER_MSG: {
+        auto sweep = std::static_pointer_cast<source_sweep_timer_msg>(msg);
 
-    if (!msg.unique()) {
-        switch (msg->get_type()) {
-        case proxy_msg::NEW_SOURCE_TIMER_MSG: {
-            tm = std::static_pointer_cast<new_source_timer_msg>(msg);
+        auto sweep_it = m_source_sweeps.find(sweep->get_slot());
+        if (sweep_it != std::end(m_source_sweeps) && sweep_it->second == sweep) {
+            m_source_sweeps.erase(sweep_it);
+        }
 
-            auto cmp_source_lst = m_data.get_available_sources(tm->get_gaddr());
-            auto cmp_source_it = cmp_source_lst.find(tm->get_saddr());
-            if (cmp_source_it != cmp_source_lst.end()) {
-                if (tm.get() == cmp_source_it->shared_source_timer.get()) {
-                    auto saddr_it = m_data.refresh_source_or_del_it_if_unused(tm->get_gaddr(), tm->get_saddr());
-                    if (!saddr_it.second) {
+        ++m_sweep_count;
+        bool snapshot_taken = false;
+        std::set<ip_addr> changed_groups;
 
-                        del_route(tm->get_if_index(), tm->get_gaddr(), tm->get_saddr());
+        for (auto & e : sweep->get_sources()) {
+            auto& cmp_source_lst = m_data.get_available_sources(e.gaddr);
+            auto cmp_source_it = cmp_source_lst.find(e.saddr);
+            if (cmp_source_it == cmp_source_lst.end() || cmp_source_it->shared_source_timer.get() != sweep.get()) {
+                HC_LOG_DEBUG("source timer is outdate");
+                continue;
+            }
 
-                        if (is_rule_matching_type(IT_UPSTREAM, ID_IN, RMT_MUTEX)) {
-                            process_membership_aggregation(RMT_MUTEX, tm->get_gaddr());
-                        }
-                    } else {
-                        saddr_it.first->shared_source_timer = set_source_timer(tm->get_if_index(), tm->get_gaddr(), tm->get_saddr());
-                    }
+            //all sources of this slot are compared against one reading of the packet counters
+            if (!snapshot_taken) {
+                m_data.take_packet_count_snapshot();
+                snapshot_taken = true;
+            }
 
-                } else {
-                    HC_LOG_DEBUG("filter_timer is outdate");
+            ++m_swept_source_count;
+            auto saddr_it = m_data.refresh_source_or_del_it_if_unused(e.gaddr, e.saddr);
+            if (!saddr_it.second) {
+                //the route changes are sent together at the end of the batch
+                del_route(e.if_index, e.gaddr, e.saddr);
+                changed_groups.insert(e.gaddr);
+                ++m_expired_source_count;
+
+                auto owner_it = m_source_owners.find(e.gaddr);
+                if (owner_it != std::end(m_source_owners)) {
+                    owner_it->second.m_sources.erase(e.saddr);
+                    if (owner_it->second.m_sources.empty()) {
+                        m_source_owners.erase(owner_it);
+                    }
                 }
+            } else {
+                saddr_it.first->shared_source_timer = set_source_timer(e.if_index, e.gaddr, e.saddr);
             }
+        }
 
+        if (!changed_groups.empty() && is_rule_matching_type(IT_UPSTREAM, ID_IN, RMT_MUTEX)) {
+            for (auto & g : changed_groups) {
+                process_membership_aggregation(RMT_MUTEX, g);
+            }
         }
+    }
+    break;
+    case proxy_msg::UPSTREAM_REPORT_TIMER_MSG:
+        timer_triggerd_upstream_report(std::static_pointer_cast<upstream_report_timer_msg>(msg));
         break;
-        default:
-            HC_LOG_ERROR("unknown timer message format");
-            return;
-        }
-    } else {
-        HC_LOG_DEBUG("filter_timer is outdate");
+    default:
+        HC_LOG_ERROR("unknown timer message format");
         return;
     }
 }
@@ -415,11 +844,11 @@ bool simple_mc_proxy_routing::is_rule_matching_type(rb_interface_type interface_
     }
 }
 
-std::list<std::pair<source, std::list<unsigned int>>> simple_mc_proxy_routing::collect_interested_interfaces(const addr_storage& gaddr, const source_list<source>& slist) const
+std::list<std::pair<source, std::list<unsigned int>>> simple_mc_proxy_routing::collect_interested_interfaces(const ip_addr& gaddr, const source_list<source>& slist) const
 {
     HC_LOG_TRACE("");
 
-    const std::map<addr_storage, unsigned int>& input_if_index_map = m_data.get_interface_map(gaddr);
+    const std::map<ip_addr, unsigned int>& input_if_index_map = m_data.get_interface_map(gaddr);
 
     //add upstream interfaces
     std::list<std::pair<source, std::list<unsigned int>>> rt_list;
@@ -461,7 +890,7 @@ std::list<std::pair<source, std::list<unsigned int>>> simple_mc_proxy_routing::c
     }
 
     //add downstream interfaces
-    std::function<bool(unsigned int, const addr_storage&)> filter_fun = [&](unsigned int output_if_index, const addr_storage & saddr) {
+    std::function<bool(unsigned int, const ip_addr&)> filter_fun = [&](unsigned int output_if_index, const ip_addr & saddr) {
         auto input_if_it = input_if_index_map.find(saddr);
         if (input_if_it == input_if_index_map.end()) {
             HC_LOG_ERROR("input interface of multicast source " << saddr << " not found");
@@ -482,25 +911,63 @@ std::list<std::pair<source, std::list<unsigned int>>> simple_mc_proxy_routing::c
     return rt_list;
 }
 
-void simple_mc_proxy_routing::process_membership_aggregation(rb_rule_matching_type rule_matching_type, const addr_storage& gaddr)
+void simple_mc_proxy_routing::process_membership_aggregation(rb_rule_matching_type rule_matching_type, const ip_addr& gaddr)
 {
     HC_LOG_TRACE("");
 
     if (rule_matching_type == RMT_FIRST || rule_matching_type == RMT_MUTEX) {
-        interface_memberships im(rule_matching_type , gaddr, m_p, m_data);
+        source_owner_index* owner_index = rule_matching_type == RMT_MUTEX ? &get_source_owner_index(gaddr) : nullptr;
+        interface_memberships im(rule_matching_type , gaddr, m_p, m_data, owner_index);
         for (auto & e : m_p->m_upstreams) {
-            send_record(e.m_if_index, gaddr, im.get_group_memberships(e.m_if_index));
+            queue_record(e.m_if_index, gaddr, im.get_group_memberships(e.m_if_index));
+        }
+
+        //groups without known sources keep no index
+        if (owner_index != nullptr && owner_index->m_sources.empty()) {
+            m_source_owners.erase(gaddr);
         }
     } else {
         HC_LOG_ERROR("unkown rule matching type in this context");
     }
 }
 
-void simple_mc_proxy_routing::set_routes(const addr_storage& gaddr, const std::list<std::pair<source, std::list<unsigned int>>>& output_if_index) const
+source_owner_index& simple_mc_proxy_routing::get_source_owner_index(const ip_addr& gaddr)
+{
+    HC_LOG_TRACE("");
+
+    auto owner_it = m_source_owners.find(gaddr);
+    if (owner_it == std::end(m_source_owners)) {
+        owner_it = m_source_owners.insert(std::make_pair(gaddr, source_owner_index())).first;
+        add_source_owners(owner_it->second, gaddr, m_data.get_available_sources(gaddr));
+    }
+
+    return owner_it->second;
+}
+
+void simple_mc_proxy_routing::add_source_owners(source_owner_index& owner_index, const ip_addr& gaddr, const source_list<source>& slist) const
+{
+    HC_LOG_TRACE("");
+
+    source_owner_index::upstream_list upstreams;
+    for (auto & e : m_p->m_upstreams) {
+        upstreams.push_back(std::make_pair(e.m_if_index, e.m_interface));
+    }
+
+    source_owner_index::downstream_list downstreams;
+    for (auto & e : m_p->m_downstreams) {
+        downstreams.push_back(e.second.m_interface);
+    }
+
+    for (auto & s : slist) {
+        owner_index.add_source(gaddr, s.saddr, upstreams, downstreams);
+    }
+}
+
+void simple_mc_proxy_routing::set_routes(const ip_addr& gaddr, const std::list<std::pair<source, std::list<unsigned int>>>& output_if_index) const
 {
     HC_LOG_TRACE("");
 
-    const std::map<addr_storage, unsigned int>& input_if_index_map = m_data.get_interface_map(gaddr);
+    const std::map<ip_addr, unsigned int>& input_if_index_map = m_data.get_interface_map(gaddr);
     unsigned int input_if_index;
 
     for (auto & e : output_if_index) {
@@ -548,41 +1015,299 @@ void simple_mc_proxy_routing::set_routes(const addr_storage& gaddr, const std::l
                 continue;
             }
 
-            m_p->m_routing->add_route(m_p->m_interfaces->get_virtual_if_index(input_if_index), gaddr, e.first.saddr, vif_out);
+            add_mfc_entry(m_p->m_interfaces->get_virtual_if_index(input_if_index), gaddr, e.first.saddr, vif_out);
+        }
+
+    }
+}
+
+void simple_mc_proxy_routing::send_record(unsigned int upstream_if_index, const ip_addr& gaddr, const source_state& sstate) const
+{
+    HC_LOG_TRACE("");
+
+    if (m_p->m_host_reporter != nullptr) {
+        m_p->m_host_reporter->set_state(upstream_if_index, gaddr, sstate.m_mc_filter, sstate.m_source_list);
+    } else {
+        m_p->m_sender->send_record(upstream_if_index, sstate.m_mc_filter, gaddr.to_addr_storage(), sstate.m_source_list);
+    }
+}
+
+void simple_mc_proxy_routing::queue_record(unsigned int upstream_if_index, const ip_addr& gaddr, source_state&& sstate)
+{
+    HC_LOG_TRACE("");
+
+    auto report_it = m_upstream_reports.insert(std::make_pair(upstream_report_key(upstream_if_index, gaddr), upstream_report())).first;
+    upstream_report& report = report_it->second;
+    report.m_desired = std::move(sstate);
+
+    if (report.m_is_pending) {
+        //only the last state is sent when the timer expires
+        report.m_is_updated = true;
+        ++m_upstream_coalesced_count;
+        return;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    if (report.m_reported == report.m_desired) {
+        ++m_upstream_unchanged_count;
+        report_upstream(report_it, now);
+    } else if (now - report.m_last_report >= m_p->m_upstream_report_interval) {
+        report_upstream(report_it, now);
+    } else {
+        report.m_is_updated = true;
+        add_pending_upstream_report(report_it->first, report, now);
+    }
+}
+
+bool simple_mc_proxy_routing::report_upstream(std::map<upstream_report_key, upstream_report>::iterator report_it, std::chrono::steady_clock::time_point now)
+{
+    HC_LOG_TRACE("");
+
+    upstream_report& report = report_it->second;
+    const upstream_report_key& key = report_it->first;
+
+    if (report.m_reported != report.m_desired) {
+        //the upstream may have been removed in the meantime
+        if (m_p->is_upstream(key.first)) {
+            send_record(key.first, key.second, report.m_desired);
+        }
+
+        report.m_reported = report.m_desired;
+        report.m_last_report = now;
+        ++m_upstream_report_count;
+    }
+
+    if (report.m_reported.m_mc_filter == INCLUDE_MODE && report.m_reported.m_source_list.empty()) {
+        if (now - report.m_last_report >= m_p->m_upstream_report_interval) {
+            m_upstream_reports.erase(report_it);
+            return false;
+        } else {
+            //the group is left, keep the report time until the interval is over to delay a new join
+            add_pending_upstream_report(key, report, now);
+        }
+    }
+
+    return true;
+}
+
+void simple_mc_proxy_routing::add_pending_upstream_report(const upstream_report_key& key, upstream_report& report, std::chrono::steady_clock::time_point now)
+{
+    HC_LOG_TRACE("");
+
+    report.m_is_pending = true;
+    m_pending_upstream_reports.insert(key);
+    arm_upstream_report_timer(report.m_last_report + m_p->m_upstream_report_interval, now);
+}
+
+void simple_mc_proxy_routing::arm_upstream_report_timer(std::chrono::steady_clock::time_point end_time, std::chrono::steady_clock::time_point now)
+{
+    HC_LOG_TRACE("");
+    using namespace std::chrono;
+
+    if (m_upstream_report_timer != nullptr) {
+        if (m_upstream_report_timer_end <= end_time) {
+            return;
+        }
+        m_p->m_timing->cancel_time(m_upstream_report_timer->get_timer_handle());
+    }
+
+    //round up, the timer must not expire before the end time
+    auto delay = end_time > now ? duration_cast<milliseconds>(end_time - now) + milliseconds(1) : milliseconds(0);
+    m_upstream_report_timer = std::make_shared<upstream_report_timer_msg>(delay);
+    m_upstream_report_timer->set_timer_handle(m_p->m_timing->arm_time(delay, m_p, m_upstream_report_timer));
+    m_upstream_report_timer_end = end_time;
+}
+
+void simple_mc_proxy_routing::timer_triggerd_upstream_report(const std::shared_ptr<upstream_report_timer_msg>& msg)
+{
+    HC_LOG_TRACE("");
+
+    if (m_upstream_report_timer.get() != msg.get()) {
+        HC_LOG_DEBUG("upstream report timer is outdated");
+        return;
+    }
+    m_upstream_report_timer.reset();
+
+    auto now = std::chrono::steady_clock::now();
+    auto next_end_time = std::chrono::steady_clock::time_point::max();
+
+    std::vector<upstream_report_key> due_reports;
+    for (auto it = m_pending_upstream_reports.begin(); it != m_pending_upstream_reports.end();) {
+        auto report_it = m_upstream_reports.find(*it);
+        if (report_it == std::end(m_upstream_reports)) {
+            it = m_pending_upstream_reports.erase(it);
+            continue;
+        }
+
+        auto end_time = report_it->second.m_last_report + m_p->m_upstream_report_interval;
+        if (end_time > now) {
+            next_end_time = std::min(next_end_time, end_time);
+            ++it;
+        } else {
+            due_reports.push_back(*it);
+            it = m_pending_upstream_reports.erase(it);
+        }
+    }
+
+    for (auto & key : due_reports) {
+        auto report_it = m_upstream_reports.find(key);
+        upstream_report& report = report_it->second;
+        report.m_is_pending = false;
+
+        if (report.m_is_updated && report.m_reported == report.m_desired) {
+            ++m_upstream_unchanged_count;
         }
+        report.m_is_updated = false;
 
+        report_upstream(report_it, now);
+    }
+
+    //report_upstream() may have armed a new timer
+    if (next_end_time != std::chrono::steady_clock::time_point::max()) {
+        arm_upstream_report_timer(next_end_time, now);
+    }
+}
+
+void simple_mc_proxy_routing::del_route(unsigned int if_index, const ip_addr& gaddr, const ip_addr& saddr) const
+{
+    HC_LOG_TRACE("");
+    del_mfc_entry(m_p->m_interfaces->get_virtual_if_index(if_index), gaddr, saddr);
+}
+
+void simple_mc_proxy_routing::add_mfc_entry(int input_vif, const ip_addr& gaddr, const ip_addr& saddr, const std::list<int>& output_vifs) const
+{
+    HC_LOG_TRACE("");
+
+    mfc_entry entry {input_vif, std::vector<int>(output_vifs.begin(), output_vifs.end()), false};
+    std::sort(entry.m_output_vifs.begin(), entry.m_output_vifs.end());
+
+    auto& group_shadow = m_mfc_shadow[gaddr];
+    auto entry_it = group_shadow.find(saddr);
+    //an unknown entry is always set again
+    if (entry_it != std::end(group_shadow) && !entry_it->second.m_is_unknown && entry_it->second.m_input_vif == entry.m_input_vif && entry_it->second.m_output_vifs == entry.m_output_vifs) {
+        HC_LOG_DEBUG("route (" << gaddr << ", " << saddr << ") is unchanged");
+        ++m_mfc_avoided_count;
+        return;
+    }
+
+    //MRT_ADD_MFC replaces an existing entry
+    auto start_time = std::chrono::steady_clock::now();
+    bool rc = m_p->m_routing->add_route(input_vif, gaddr.to_addr_storage(), saddr.to_addr_storage(), output_vifs);
+    m_mfc_time += std::chrono::steady_clock::now() - start_time;
+    ++m_mfc_change_count;
+
+    if (rc) {
+        group_shadow[saddr] = std::move(entry);
+    } else if (entry_it != std::end(group_shadow)) { //the old entry may still be set, keep it for del_mfc_entry()
+        entry_it->second.m_is_unknown = true;
+    }
+
+    if (group_shadow.empty()) {
+        m_mfc_shadow.erase(gaddr);
+    }
+}
+
+void simple_mc_proxy_routing::del_mfc_entry(int input_vif, const ip_addr& gaddr, const ip_addr& saddr) const
+{
+    HC_LOG_TRACE("");
+
+    auto group_it = m_mfc_shadow.find(gaddr);
+    if (group_it == std::end(m_mfc_shadow) || group_it->second.find(saddr) == std::end(group_it->second)) {
+        HC_LOG_DEBUG("route (" << gaddr << ", " << saddr << ") is not set");
+        ++m_mfc_avoided_count;
+        return;
+    }
+
+    auto start_time = std::chrono::steady_clock::now();
+    m_p->m_routing->del_route(input_vif, gaddr.to_addr_storage(), saddr.to_addr_storage());
+    m_mfc_time += std::chrono::steady_clock::now() - start_time;
+    ++m_mfc_change_count;
+
+    group_it->second.erase(saddr);
+    if (group_it->second.empty()) {
+        m_mfc_shadow.erase(group_it);
     }
 }
 
-void simple_mc_proxy_routing::send_record(unsigned int upstream_if_index, const addr_storage& gaddr, const source_state& sstate) const
+void simple_mc_proxy_routing::flush_routes()
 {
     HC_LOG_TRACE("");
-    m_p->m_sender->send_record(upstream_if_index, sstate.m_mc_filter, gaddr, sstate.m_source_list);
+
+    //with netlink the changes are sent and acknowledged here, add_mfc_entry() and del_mfc_entry() only queue them
+    mroute_change_list failed_routes;
+    auto start_time = std::chrono::steady_clock::now();
+    m_p->m_routing->flush_routes(failed_routes);
+    m_mfc_time += std::chrono::steady_clock::now() - start_time;
+
+    //the kernel state of a failed change is unknown, the entry is kept so that it is set or deleted again
+    for (auto & e : failed_routes) {
+        HC_LOG_DEBUG("route (" << e.gaddr << ", " << e.saddr << ") is unknown");
+        ++m_mfc_failed_count;
+
+        auto& group_shadow = m_mfc_shadow[ip_addr(e.gaddr)];
+        auto entry_it = group_shadow.find(ip_addr(e.saddr));
+        if (e.is_add) {
+            //a later deletion of the same batch has removed the entry
+            if (entry_it != std::end(group_shadow)) {
+                entry_it->second.m_is_unknown = true;
+            }
+        } else if (entry_it == std::end(group_shadow)) { //otherwise a later add of the same batch has set the entry
+            group_shadow[ip_addr(e.saddr)] = mfc_entry {-1, std::vector<int>(), true};
+        }
+
+        if (group_shadow.empty()) {
+            m_mfc_shadow.erase(ip_addr(e.gaddr));
+        }
+    }
 }
 
-void simple_mc_proxy_routing::del_route(unsigned int if_index, const addr_storage& gaddr, const addr_storage& saddr) const
+std::string simple_mc_proxy_routing::to_string_mfc_statistics() const
 {
     HC_LOG_TRACE("");
-    m_p->m_routing->del_route(m_p->m_interfaces->get_virtual_if_index(if_index), gaddr, saddr);
+    std::ostringstream s;
+
+    unsigned long route_count = 0;
+    for (auto & e : m_mfc_shadow) {
+        route_count += e.second.size();
+    }
+
+    s << "##-- kernel routes --##" << std::endl;
+    s << "routes: " << route_count << " route changes: " << m_mfc_change_count << " unchanged routes skipped: " << m_mfc_avoided_count;
+    s << " failed route changes: " << m_mfc_failed_count;
+    s << " time to set routes: " << std::chrono::duration_cast<std::chrono::microseconds>(m_mfc_time).count() << "usec";
+    s << std::endl << m_p->m_routing->to_string();
+
+    return s.str();
 }
 
-std::shared_ptr<new_source_timer_msg> simple_mc_proxy_routing::set_source_timer(unsigned int if_index, const addr_storage& gaddr, const addr_storage& saddr)
+std::shared_ptr<source_sweep_timer_msg> simple_mc_proxy_routing::set_source_timer(unsigned int if_index, const ip_addr& gaddr, const ip_addr& saddr)
 {
     HC_LOG_TRACE("");
-    std::chrono::milliseconds source_life_time;
+    using namespace std::chrono;
+
+    milliseconds source_life_time;
     if (m_p->is_upstream(if_index) && is_rule_matching_type(IT_UPSTREAM, ID_IN, RMT_MUTEX)) {
         source_life_time = m_p->m_upstream_input_rule->get_timeout();
     } else {
         source_life_time = get_source_life_time();
     }
 
-    auto nst = std::make_shared<new_source_timer_msg>(if_index, gaddr, saddr, source_life_time);
-    m_p->m_timing->add_time(get_source_life_time(), m_p, nst);
+    //the expiry time is rounded up to the end of its slot
+    auto now = duration_cast<milliseconds>(steady_clock::now().time_since_epoch());
+    long slot = static_cast<long>((now + source_life_time).count() / SIMPLE_MC_PROXY_ROUTING_AGING_SLOT) + 1;
+
+    auto& sweep = m_source_sweeps[slot];
+    if (sweep == nullptr) {
+        auto delay = milliseconds(slot * SIMPLE_MC_PROXY_ROUTING_AGING_SLOT) - now;
+        sweep = std::make_shared<source_sweep_timer_msg>(slot, delay);
+        sweep->set_timer_handle(m_p->m_timing->arm_time(delay, m_p, sweep));
+    }
 
-    return nst;
+    sweep->get_sources().push_back(source_sweep_timer_msg::aging_source {if_index, gaddr, saddr});
+    return sweep;
 }
 
-bool simple_mc_proxy_routing::check_interface(rb_interface_type interface_type, rb_interface_direction interface_direction, unsigned int checking_if_index, unsigned int input_if_index, const addr_storage& gaddr, const addr_storage& saddr) const
+bool simple_mc_proxy_routing::check_interface(rb_interface_type interface_type, rb_interface_direction interface_direction, unsigned int checking_if_index, unsigned int input_if_index, const ip_addr& gaddr, const ip_addr& saddr) const
 {
     HC_LOG_TRACE("");
 
@@ -635,6 +1360,15 @@ bool simple_mc_proxy_routing::check_interface(rb_interface_type interface_type,
 std::string simple_mc_proxy_routing::to_string() const
 {
     HC_LOG_TRACE("");
-    return m_data.to_string();
+    std::ostringstream s;
+    s << m_data.to_string() << std::endl;
+    s << to_string_mfc_statistics() << std::endl;
+    s << "##-- source aging --##" << std::endl;
+    s << "source life time: " << m_p->m_source_life_time.count() << "msec pending sweeps: " << m_source_sweeps.size();
+    s << " sweeps: " << m_sweep_count << " aged sources: " << m_swept_source_count << " expired sources: " << m_expired_source_count << std::endl;
+    s << "##-- upstream reporting --##" << std::endl;
+    s << "report interval: " << m_p->m_upstream_report_interval.count() << "msec pending: " << m_pending_upstream_reports.size();
+    s << " reports: " << m_upstream_report_count << " coalesced updates: " << m_upstream_coalesced_count << " unchanged: " << m_upstream_unchanged_count;
+    return s.str();
 }
 
@@ -24,29 +24,103 @@
 #include "include/proxy/simple_routing_data.hpp"
 #include "include/proxy/message_format.hpp"
 #include "include/utils/mroute_socket.hpp"
+#include "include/utils/mroute_netlink.hpp"
 #include "include/proxy/interfaces.hpp"
 
-simple_routing_data::simple_routing_data(group_mem_protocol group_mem_protocol, const std::shared_ptr<const mroute_socket>& mrt_sock)
+simple_routing_data::simple_routing_data(group_mem_protocol group_mem_protocol, const std::shared_ptr<const mroute_socket>& mrt_sock, int table_number)
     : m_group_mem_protocol(group_mem_protocol)
     , m_mrt_sock(mrt_sock)
+    , m_mrt_netlink(new mroute_netlink(table_number))
+    , m_packet_counts_valid(false)
+    , m_dump_failure_count(0)
+    , m_dump_count(0)
+    , m_ioctl_count(0)
 {
     HC_LOG_TRACE("");
+
+    if (!m_mrt_netlink->create_socket()) {
+        HC_LOG_WARN("failed to open netlink socket, the packet counters are read for each route");
+        m_mrt_netlink.reset();
+    }
+}
+
+simple_routing_data::~simple_routing_data()
+{
+    HC_LOG_TRACE("");
+}
+
+bool simple_routing_data::refresh_packet_counts()
+{
+    HC_LOG_TRACE("");
+
+    //after a failed dump the packet counters are read for each route until the next dump
+    auto now = std::chrono::steady_clock::now();
+    if (now - m_packet_counts_time < std::chrono::milliseconds(SIMPLE_ROUTING_DATA_STATS_MAX_AGE)) {
+        return m_packet_counts_valid;
+    }
+
+    m_packet_counts.clear();
+    m_packet_counts_valid = false;
+
+    int addr_family = is_IPv4(m_group_mem_protocol) ? AF_INET : AF_INET6;
+    bool rc = m_mrt_netlink->dump_mroute_stats(addr_family, [this](const ip_addr & gaddr, const ip_addr & saddr, uint64_t packets) {
+        m_packet_counts[std::make_pair(gaddr, saddr)] = packets;
+    });
+    ++m_dump_count;
+
+    m_packet_counts_time = now;
+
+    if (!rc) {
+        m_packet_counts.clear();
+
+        if (++m_dump_failure_count >= SIMPLE_ROUTING_DATA_MAX_DUMP_FAILURES) {
+            HC_LOG_WARN("failed to dump the packet counters " << m_dump_failure_count << " times in a row, they are read for each route from now on");
+            m_mrt_netlink.reset();
+        } else {
+            HC_LOG_WARN("failed to dump the packet counters, they are read for each route until the next dump");
+        }
+        return false;
+    }
+
+    m_dump_failure_count = 0;
+    m_packet_counts_valid = true;
+    return true;
 }
 
-unsigned long simple_routing_data::get_current_packet_count(const addr_storage& gaddr, const addr_storage& saddr)
+void simple_routing_data::take_packet_count_snapshot()
 {
     HC_LOG_TRACE("");
 
+    if (m_mrt_netlink != nullptr) {
+        m_packet_counts_time = std::chrono::steady_clock::time_point();
+        refresh_packet_counts();
+    }
+}
+
+unsigned long simple_routing_data::get_current_packet_count(const ip_addr& gaddr, const ip_addr& saddr)
+{
+    HC_LOG_TRACE("");
+
+    //all source timers expiring within SIMPLE_ROUTING_DATA_STATS_MAX_AGE share one dump
+    if (m_mrt_netlink != nullptr && refresh_packet_counts()) {
+        auto it = m_packet_counts.find(std::make_pair(gaddr, saddr));
+        if (it != std::end(m_packet_counts)) {
+            return it->second;
+        }
+    }
+
+    //the route is newer than the dump or the dump is not available
+    ++m_ioctl_count;
     if (is_IPv4(m_group_mem_protocol)) {
         struct sioc_sg_req tmp_stat;
-        if (m_mrt_sock->get_mroute_stats(saddr, gaddr, &tmp_stat, nullptr)) {
+        if (m_mrt_sock->get_mroute_stats(saddr.to_addr_storage(), gaddr.to_addr_storage(), &tmp_stat, nullptr)) {
             return tmp_stat.pktcnt;
         } else {
             return true;
         }
     } else if (is_IPv6(m_group_mem_protocol)) {
         struct sioc_sg_req6 tmp_stat;
-        if (m_mrt_sock->get_mroute_stats(saddr, gaddr, nullptr, &tmp_stat)) {
+        if (m_mrt_sock->get_mroute_stats(saddr.to_addr_storage(), gaddr.to_addr_storage(), nullptr, &tmp_stat)) {
             return tmp_stat.pktcnt;
         } else {
             return true;
@@ -57,7 +131,7 @@ unsigned long simple_routing_data::get_current_packet_count(const addr_storage&
     }
 }
 
-void simple_routing_data::set_source(unsigned int if_index, const addr_storage& gaddr, const source& saddr)
+void simple_routing_data::set_source(unsigned int if_index, const ip_addr& gaddr, const source& saddr)
 {
     HC_LOG_TRACE("");
     auto gaddr_it = m_data.find(gaddr);
@@ -69,18 +143,18 @@ void simple_routing_data::set_source(unsigned int if_index, const addr_storage&
             gaddr_it->second.m_source_list.insert(saddr);
         }
 
-        auto map_result = gaddr_it->second.m_if_map.insert(std::pair<addr_storage, unsigned int>(saddr.saddr, if_index));
+        auto map_result = gaddr_it->second.m_if_map.insert(std::pair<ip_addr, unsigned int>(saddr.saddr, if_index));
         if (!map_result.second) {
             map_result.first->second = if_index;
             HC_LOG_WARN("data already exists");
         }
 
     } else {
-        m_data.insert(s_routing_data_pair(gaddr, sr_data_value({saddr}, {std::pair<addr_storage, unsigned int>(saddr.saddr, if_index)})));
+        m_data.insert(s_routing_data_pair(gaddr, sr_data_value({saddr}, {std::pair<ip_addr, unsigned int>(saddr.saddr, if_index)})));
     }
 }
 
-void simple_routing_data::del_source(const addr_storage& gaddr, const addr_storage& saddr)
+void simple_routing_data::del_source(const ip_addr& gaddr, const ip_addr& saddr)
 {
     HC_LOG_TRACE("");
     auto gaddr_it = m_data.find(gaddr);
@@ -94,7 +168,7 @@ void simple_routing_data::del_source(const addr_storage& gaddr, const addr_stora
 
 }
 
-std::pair<source_list<source>::iterator, bool> simple_routing_data::refresh_source_or_del_it_if_unused(const addr_storage& gaddr, const addr_storage& saddr)
+std::pair<source_list<source>::iterator, bool> simple_routing_data::refresh_source_or_del_it_if_unused(const ip_addr& gaddr, const ip_addr& saddr)
 {
     HC_LOG_TRACE("");
     auto gaddr_it = m_data.find(gaddr);
@@ -124,7 +198,7 @@ std::pair<source_list<source>::iterator, bool> simple_routing_data::refresh_sour
     return std::pair<source_list<source>::iterator, bool>(source_list<source>::iterator(), false);
 }
 
-const source_list<source>& simple_routing_data::get_available_sources(const addr_storage& gaddr) const
+const source_list<source>& simple_routing_data::get_available_sources(const ip_addr& gaddr) const
 {
     HC_LOG_TRACE("");
     static source_list<source> rt;
@@ -144,6 +218,7 @@ std::string simple_routing_data::to_string() const
     HC_LOG_TRACE("");
     ostringstream s;
     s << "##-- simple multicast routing information base --##";
+    s << endl << "packet counter dumps: " << m_dump_count << " single requests: " << m_ioctl_count;
 
     for (auto &  d : m_data) {
         s << endl << "group: " << d.first;
@@ -157,14 +232,14 @@ std::string simple_routing_data::to_string() const
     return s.str();
 }
 
-const std::map<addr_storage, unsigned int>& simple_routing_data::get_interface_map(const addr_storage& gaddr) const
+const std::map<ip_addr, unsigned int>& simple_routing_data::get_interface_map(const ip_addr& gaddr) const
 {
     HC_LOG_TRACE("");
     auto it = m_data.find(gaddr);
     if(it != std::end(m_data)){
         return it->second.m_if_map; 
     }else{
-        static std::map<addr_storage, unsigned int> result;
+        static std::map<ip_addr, unsigned int> result;
         result.clear();
         return result; 
     }
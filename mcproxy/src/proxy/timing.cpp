@@ -23,15 +23,51 @@
 #include "include/hamcast_logging.h"
 #include "include/proxy/timing.hpp"
 #include "include/proxy/worker.hpp"
+#include "include/utils/benchmark.hpp"
 
 #include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <cstring>
+#include <map>
+#include <random>
+#include <vector>
+
+#include <errno.h>
 #include <unistd.h>
+#include <poll.h>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+
+namespace
+{
+//upper bounds (in microseconds) of the lateness histogram, the last bucket collects the rest
+const std::array<long, TIMING_LATENESS_BUCKETS - 1> lateness_bounds {{100, 1000, 2000, 5000, 10000, 100000, 1000000}};
+}
 
-timing::timing():
-    m_running(false), m_thread(nullptr)
+timing::timing(bool own_thread):
+    m_start_time(std::chrono::steady_clock::now()), m_next_tick(0), m_size(0), m_timer_fd(-1), m_wakeup_fd(-1), m_is_armed(false), m_armed_tick(0), m_canceled_count(0), m_orphaned_count(0), m_running(false), m_thread(nullptr)
 {
     HC_LOG_TRACE("");
-    start();
+
+    m_lateness_histogram.fill(0);
+
+    m_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (m_timer_fd < 0) {
+        HC_LOG_ERROR("failed to create timerfd! Error: " << strerror(errno) << " errno: " << errno);
+        throw "failed to create timerfd";
+    }
+
+    m_wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_wakeup_fd < 0) {
+        HC_LOG_ERROR("failed to create eventfd! Error: " << strerror(errno) << " errno: " << errno);
+        close(m_timer_fd);
+        throw "failed to create eventfd";
+    }
+
+    if (own_thread) {
+        start();
+    }
 }
 
 timing::~timing()
@@ -39,43 +75,237 @@ timing::~timing()
     HC_LOG_TRACE("");
     stop();
     join();
+
+    close(m_timer_fd);
+    close(m_wakeup_fd);
 }
 
 void timing::worker_thread()
 {
     HC_LOG_TRACE("");
 
+    pollfd fds[2];
+    fds[0].fd = m_timer_fd;
+    fds[0].events = POLLIN;
+    fds[1].fd = m_wakeup_fd;
+    fds[1].events = POLLIN;
+
     while (m_running) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            HC_LOG_ERROR("failed to poll timerfd! Error: " << strerror(errno) << " errno: " << errno);
+            break;
+        }
 
-        std::mutex lokal_lock;
-        std::unique_lock<std::mutex> ull(lokal_lock);
+        if (fds[1].revents & POLLIN) {
+            uint64_t value;
+            if (read(m_wakeup_fd, &value, sizeof(value)) < 0) {
+                HC_LOG_WARN("failed to read eventfd! Error: " << strerror(errno) << " errno: " << errno);
+            }
+        }
 
-        if (m_db.empty()) {
-            sleep(TIMING_IDLE_POLLING_INTERVAL);
-        } else {
-            m_con_var.wait_until(ull, m_db.begin()->first);
+        if (fds[0].revents & POLLIN) {
+            process_timer_fd();
         }
+    }
+}
 
-        std::lock_guard<std::mutex> lock(m_global_lock);
+int timing::get_timer_fd() const
+{
+    return m_timer_fd;
+}
 
-        timing_db_key now = std::chrono::steady_clock::now();
+void timing::process_timer_fd()
+{
+    HC_LOG_TRACE("");
 
-        for (auto it = begin(m_db); it != end(m_db);) {
-            if (it->first <= now) {
-                timing_db_value& db_value = it->second;
-                (*std::get<1>(db_value).get())();
-                if (std::get<0>(db_value) != nullptr) {
-                    std::get<0>(db_value)->add_msg(std::get<1>(db_value));
-                }
+    //a concurrent rearm can reset the expiration counter, EAGAIN is fine
+    uint64_t value;
+    if (read(m_timer_fd, &value, sizeof(value)) < 0 && errno != EAGAIN) {
+        HC_LOG_WARN("failed to read timerfd! Error: " << strerror(errno) << " errno: " << errno);
+    }
 
-                it = m_db.erase(it);
-                continue;
+    std::lock_guard<std::mutex> lock(m_global_lock);
+    m_is_armed = false;
+    expire(get_current_tick());
+
+    if (m_size > 0) {
+        arm_timer_fd(get_next_event_tick());
+    }
+}
+
+bool timing::arm_timer_fd(timing_tick tick)
+{
+    auto deadline = std::chrono::duration_cast<std::chrono::nanoseconds>((m_start_time + std::chrono::milliseconds(tick)).time_since_epoch());
+
+    itimerspec its;
+    its.it_interval.tv_sec = 0;
+    its.it_interval.tv_nsec = 0;
+    its.it_value.tv_sec = deadline.count() / 1000000000;
+    its.it_value.tv_nsec = deadline.count() % 1000000000;
+
+    //a zero it_value disarms the timer
+    if (its.it_value.tv_sec == 0 && its.it_value.tv_nsec == 0) {
+        its.it_value.tv_nsec = 1;
+    }
+
+    if (timerfd_settime(m_timer_fd, TFD_TIMER_ABSTIME, &its, nullptr) < 0) {
+        HC_LOG_ERROR("failed to arm timerfd! Error: " << strerror(errno) << " errno: " << errno);
+        return false;
+    }
+
+    m_is_armed = true;
+    m_armed_tick = tick;
+    return true;
+}
+
+timing_tick timing::get_current_tick() const
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - m_start_time).count();
+}
+
+timing_tick timing::get_expiry_tick(std::chrono::milliseconds delay) const
+{
+    //round up to the next tick, a reminder never fires too early
+    timing_tick until = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - m_start_time + delay).count() + 1;
+    return until < m_next_tick ? m_next_tick : until;
+}
+
+timing_bucket& timing::get_bucket(timing_tick expiry)
+{
+    if (expiry / TIMING_TICKS_PER_SEC == m_next_tick / TIMING_TICKS_PER_SEC) {
+        return m_msec_wheel[expiry % TIMING_WHEEL_MSEC_SLOTS];
+    } else if (expiry / TIMING_TICKS_PER_MIN == m_next_tick / TIMING_TICKS_PER_MIN) {
+        return m_sec_wheel[(expiry / TIMING_TICKS_PER_SEC) % TIMING_WHEEL_SEC_SLOTS];
+    } else if (expiry / TIMING_TICKS_PER_HOUR == m_next_tick / TIMING_TICKS_PER_HOUR) {
+        return m_min_wheel[(expiry / TIMING_TICKS_PER_MIN) % TIMING_WHEEL_MIN_SLOTS];
+    } else {
+        return m_overflow;
+    }
+}
+
+void timing::place(timing_bucket& from, timing_bucket::iterator it)
+{
+    timing_bucket& b = get_bucket(it->m_expiry);
+    b.splice(b.end(), from, it);
+
+    //splice keeps the iterator valid
+    if (it->m_position != nullptr) {
+        it->m_position->m_bucket = &b;
+    }
+}
+
+void timing::cascade(timing_bucket& bucket)
+{
+    timing_bucket tmp;
+    tmp.splice(tmp.end(), bucket);
+
+    while (!tmp.empty()) {
+        place(tmp, tmp.begin());
+    }
+}
+
+timing_tick timing::get_next_event_tick() const
+{
+    const timing_tick t = m_next_tick;
+    timing_tick result = ((t / TIMING_TICKS_PER_HOUR) + 1) * TIMING_TICKS_PER_HOUR;
+
+    //remaining milliseconds of the current second
+    for (timing_tick i = t; i < ((t / TIMING_TICKS_PER_SEC) + 1) * TIMING_TICKS_PER_SEC; ++i) {
+        if (!m_msec_wheel[i % TIMING_WHEEL_MSEC_SLOTS].empty()) {
+            result = i;
+            break;
+        }
+    }
+
+    //remaining seconds of the current minute, including a not yet cascaded second boundary
+    for (timing_tick s = (t + TIMING_TICKS_PER_SEC - 1) / TIMING_TICKS_PER_SEC; s < ((t / TIMING_TICKS_PER_MIN) + 1) * TIMING_WHEEL_SEC_SLOTS && s * TIMING_TICKS_PER_SEC < result; ++s) {
+        if (!m_sec_wheel[s % TIMING_WHEEL_SEC_SLOTS].empty()) {
+            result = s * TIMING_TICKS_PER_SEC;
+            break;
+        }
+    }
+
+    //remaining minutes of the current hour, including a not yet cascaded minute boundary
+    for (timing_tick m = (t + TIMING_TICKS_PER_MIN - 1) / TIMING_TICKS_PER_MIN; m < ((t / TIMING_TICKS_PER_HOUR) + 1) * TIMING_WHEEL_MIN_SLOTS && m * TIMING_TICKS_PER_MIN < result; ++m) {
+        if (!m_min_wheel[m % TIMING_WHEEL_MIN_SLOTS].empty()) {
+            result = m * TIMING_TICKS_PER_MIN;
+            break;
+        }
+    }
+
+    if (!m_overflow.empty() && t % TIMING_TICKS_PER_HOUR == 0) {
+        result = t;
+    }
+
+    return result;
+}
 
-            } else {
-                break;
+void timing::expire(timing_tick now)
+{
+    while (m_next_tick <= now) {
+        if (m_size == 0) {
+            m_next_tick = now + 1;
+            return;
+        }
+
+        timing_tick next_tick = get_next_event_tick();
+        if (next_tick > now) {
+            m_next_tick = now + 1;
+            return;
+        }
+
+        m_next_tick = next_tick;
+
+        if (m_next_tick % TIMING_TICKS_PER_HOUR == 0) {
+            cascade(m_overflow);
+        }
+
+        if (m_next_tick % TIMING_TICKS_PER_MIN == 0) {
+            cascade(m_min_wheel[(m_next_tick / TIMING_TICKS_PER_MIN) % TIMING_WHEEL_MIN_SLOTS]);
+        }
+
+        if (m_next_tick % TIMING_TICKS_PER_SEC == 0) {
+            cascade(m_sec_wheel[(m_next_tick / TIMING_TICKS_PER_SEC) % TIMING_WHEEL_SEC_SLOTS]);
+        }
+
+        fire(m_msec_wheel[m_next_tick % TIMING_WHEEL_MSEC_SLOTS]);
+        ++m_next_tick;
+    }
+}
+
+void timing::fire(timing_bucket& bucket)
+{
+    timing_bucket expired;
+    expired.splice(expired.end(), bucket);
+    m_size -= expired.size();
+
+    auto now = std::chrono::steady_clock::now();
+
+    for (auto & e : expired) {
+        if (e.m_position != nullptr) {
+            e.m_position->m_is_pending = false;
+            e.m_position->m_bucket = nullptr;
+
+            e.m_msg = e.m_weak_msg.lock();
+            if (e.m_msg == nullptr) {
+                ++m_orphaned_count;
+                continue;
             }
+        }
 
-            ++it;
+        long lateness = std::chrono::duration_cast<std::chrono::microseconds>(now - (m_start_time + std::chrono::milliseconds(e.m_expiry))).count();
+        unsigned int i = 0;
+        while (i < lateness_bounds.size() && lateness >= lateness_bounds[i]) {
+            ++i;
+        }
+        ++m_lateness_histogram[i];
+
+        (*e.m_msg.get())();
+        if (e.m_worker != nullptr) {
+            e.m_worker->add_msg(e.m_msg);
         }
     }
 }
@@ -83,12 +313,87 @@ void timing::worker_thread()
 void timing::add_time(std::chrono::milliseconds delay, const worker* msg_worker, const std::shared_ptr<proxy_msg>& pr_msg)
 {
     HC_LOG_TRACE("");
-    timing_db_key until = std::chrono::steady_clock::now() + delay;
 
     std::lock_guard<std::mutex> lock(m_global_lock);
 
-    m_db.insert(timing_db_pair(until, std::make_tuple(msg_worker, pr_msg)));
-    m_con_var.notify_one();
+    timing_tick until = get_expiry_tick(delay);
+    get_bucket(until).emplace_back(until, msg_worker, pr_msg);
+    ++m_size;
+
+    if (!m_is_armed || until < m_armed_tick) {
+        arm_timer_fd(until);
+    }
+}
+
+timer_handle timing::arm_time(std::chrono::milliseconds delay, const worker* msg_worker, const std::shared_ptr<proxy_msg>& pr_msg)
+{
+    HC_LOG_TRACE("");
+    auto position = std::make_shared<timer_position>();
+
+    std::lock_guard<std::mutex> lock(m_global_lock);
+
+    timing_tick until = get_expiry_tick(delay);
+    timing_bucket& b = get_bucket(until);
+    b.emplace_back(until, msg_worker, std::weak_ptr<proxy_msg>(pr_msg), position);
+    ++m_size;
+
+    position->m_is_pending = true;
+    position->m_bucket = &b;
+    position->m_it = --b.end();
+
+    if (!m_is_armed || until < m_armed_tick) {
+        arm_timer_fd(until);
+    }
+
+    return position;
+}
+
+bool timing::rearm_time(const timer_handle& handle, std::chrono::milliseconds delay)
+{
+    HC_LOG_TRACE("");
+
+    if (handle == nullptr) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_global_lock);
+
+    if (!handle->m_is_pending) {
+        return false;
+    }
+
+    timing_tick until = get_expiry_tick(delay);
+    handle->m_it->m_expiry = until;
+    place(*handle->m_bucket, handle->m_it);
+
+    if (!m_is_armed || until < m_armed_tick) {
+        arm_timer_fd(until);
+    }
+
+    return true;
+}
+
+bool timing::cancel_time(const timer_handle& handle)
+{
+    HC_LOG_TRACE("");
+
+    if (handle == nullptr) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_global_lock);
+
+    if (!handle->m_is_pending) {
+        return false;
+    }
+
+    handle->m_bucket->erase(handle->m_it);
+    handle->m_is_pending = false;
+    handle->m_bucket = nullptr;
+
+    --m_size;
+    ++m_canceled_count;
+    return true;
 }
 
 void timing::stop_all_time(const worker* msg_worker)
@@ -97,14 +402,35 @@ void timing::stop_all_time(const worker* msg_worker)
 
     std::lock_guard<std::mutex> lock(m_global_lock);
 
-    for (auto it = begin(m_db); it != end(m_db);) {
-        if (std::get<0>(it->second) == msg_worker) {
-            it = m_db.erase(it);
-            continue;
+    auto remove_from = [&](timing_bucket & bucket) {
+        for (auto it = begin(bucket); it != end(bucket);) {
+            if (it->m_worker == msg_worker) {
+                if (it->m_position != nullptr) {
+                    it->m_position->m_is_pending = false;
+                    it->m_position->m_bucket = nullptr;
+                }
+
+                it = bucket.erase(it);
+                --m_size;
+                continue;
+            }
+            ++it;
         }
-        ++it;
+    };
+
+    for (auto & b : m_msec_wheel) {
+        remove_from(b);
+    }
+
+    for (auto & b : m_sec_wheel) {
+        remove_from(b);
+    }
+
+    for (auto & b : m_min_wheel) {
+        remove_from(b);
     }
 
+    remove_from(m_overflow);
 }
 
 void timing::start()
@@ -123,7 +449,11 @@ void timing::stop()
 {
     HC_LOG_TRACE("");
     m_running = false;
-    m_con_var.notify_one();
+
+    uint64_t value = 1;
+    if (write(m_wakeup_fd, &value, sizeof(value)) < 0) {
+        HC_LOG_ERROR("failed to wake up timing thread! Error: " << strerror(errno) << " errno: " << errno);
+    }
 }
 
 void timing::join() const
@@ -135,6 +465,37 @@ void timing::join() const
     }
 }
 
+std::string timing::to_string() const
+{
+    HC_LOG_TRACE("");
+    using namespace std;
+    ostringstream s;
+
+    std::lock_guard<std::mutex> lock(m_global_lock);
+
+    s << "##-- timing --##" << endl;
+    s << "pending reminders: " << m_size << endl;
+    s << "canceled reminders: " << m_canceled_count << endl;
+    s << "discarded reminders without owner: " << m_orphaned_count << endl;
+    s << "lateness histogram:";
+    for (unsigned int i = 0; i < m_lateness_histogram.size(); ++i) {
+        s << endl << "\t";
+        if (i < lateness_bounds.size()) {
+            s << "< " << setw(7) << lateness_bounds[i] << "us: ";
+        } else {
+            s << ">=" << setw(7) << lateness_bounds[i - 1] << "us: ";
+        }
+        s << m_lateness_histogram[i];
+    }
+
+    return s.str();
+}
+
+std::ostream& operator<<(std::ostream& stream, const timing& t)
+{
+    return stream << t.to_string();
+}
+
 #ifdef DEBUG_MODE
 void timing::test_timing()
 {
@@ -157,6 +518,117 @@ void timing::test_timing()
     sleep(10);
     cout << "finished" << endl;
 }
+
+void timing::test_timing_wheel()
+{
+    using namespace std;
+    using namespace std::chrono;
+    HC_LOG_TRACE("");
+    cout << "##-- test timing wheel --##" << endl;
+
+    log_silencer silencer;
+
+    const unsigned int num_of_timers = 1000000;
+    const unsigned int fire_window_msec = 2000;
+
+    std::default_random_engine random_engine(42);
+    std::uniform_int_distribution<long> long_delay(1, 3600 * 1000); //up to one hour
+    std::uniform_int_distribution<long> short_delay(1, fire_window_msec);
+
+    vector<shared_ptr<proxy_msg>> msgs;
+    vector<milliseconds> delays;
+    vector<milliseconds> new_delays;
+    for (unsigned int i = 0; i < num_of_timers; ++i) {
+        msgs.push_back(make_shared<debug_msg>());
+        delays.push_back(milliseconds(long_delay(random_engine)));
+        new_delays.push_back(milliseconds(long_delay(random_engine)));
+    }
+
+    auto print = [&](const string & name, unsigned long nsec) {
+        cout << setw(32) << left << name << " total: " << setw(8) << right << nsec / 1000000 << "msec per timer: " << setw(6) << nsec / num_of_timers << "nsec" << endl;
+    };
+
+    {
+        cout << "timing wheel (" << num_of_timers << " timers)" << endl;
+        timing t(false);
+        vector<timer_handle> handles;
+        handles.reserve(num_of_timers);
+
+        print("  arm", measure_nsec([&]() {
+            for (unsigned int i = 0; i < num_of_timers; ++i) {
+                handles.push_back(t.arm_time(delays[i], nullptr, msgs[i]));
+            }
+        }));
+
+        print("  rearm", measure_nsec([&]() {
+            for (unsigned int i = 0; i < num_of_timers; ++i) {
+                t.rearm_time(handles[i], new_delays[i]);
+            }
+        }));
+
+        print("  cancel", measure_nsec([&]() {
+            for (unsigned int i = 0; i < num_of_timers; ++i) {
+                t.cancel_time(handles[i]);
+            }
+        }));
+    }
+
+    {
+        timing t(false);
+        for (unsigned int i = 0; i < num_of_timers; ++i) {
+            t.add_time(milliseconds(short_delay(random_engine)), nullptr, msgs[i]);
+        }
+
+        std::this_thread::sleep_for(milliseconds(fire_window_msec + 100));
+        print("  fire", measure_nsec([&]() {
+            t.process_timer_fd();
+        }));
+        cout << "  pending after fire: " << t.m_size << endl;
+    }
+
+    {
+        cout << "multimap (" << num_of_timers << " timers)" << endl;
+        using timer_map = multimap<steady_clock::time_point, shared_ptr<proxy_msg>>;
+        timer_map m;
+        vector<timer_map::iterator> handles;
+        handles.reserve(num_of_timers);
+
+        print("  arm", measure_nsec([&]() {
+            for (unsigned int i = 0; i < num_of_timers; ++i) {
+                handles.push_back(m.insert(make_pair(steady_clock::now() + delays[i], msgs[i])));
+            }
+        }));
+
+        print("  rearm", measure_nsec([&]() {
+            for (unsigned int i = 0; i < num_of_timers; ++i) {
+                m.erase(handles[i]);
+                handles[i] = m.insert(make_pair(steady_clock::now() + new_delays[i], msgs[i]));
+            }
+        }));
+
+        print("  cancel", measure_nsec([&]() {
+            for (unsigned int i = 0; i < num_of_timers; ++i) {
+                m.erase(handles[i]);
+            }
+        }));
+
+        for (unsigned int i = 0; i < num_of_timers; ++i) {
+            m.insert(make_pair(steady_clock::now() + milliseconds(short_delay(random_engine)), msgs[i]));
+        }
+
+        std::this_thread::sleep_for(milliseconds(fire_window_msec + 100));
+        print("  fire", measure_nsec([&]() {
+            auto end = m.upper_bound(steady_clock::now());
+            for (auto it = m.begin(); it != end;) {
+                (*it->second)();
+                it = m.erase(it);
+            }
+        }));
+        cout << "  pending after fire: " << m.size() << endl;
+    }
+
+    cout << "finished" << endl;
+}
 #endif /* DEBUG_MODE */
 
 
@@ -23,9 +23,15 @@
 
 #include "include/hamcast_logging.h"
 #include "include/proxy/worker.hpp"
+#include "include/utils/benchmark.hpp"
 
 #include "unistd.h"
 
+#include <iostream>
+#include <iomanip>
+#include <queue>
+#include <condition_variable>
+
 worker::worker()
     : worker(WORKER_MESSAGE_QUEUE_DEFAULT_SIZE)
 {
@@ -152,4 +158,152 @@ void worker::test_worker()
     std::cout << "##-- end of test worker --##" << std::endl;
     sleep(4);
 }
+
+void worker::test_job_queue()
+{
+    using namespace std;
+    cout << "##-- test job queue --##" << endl;
+
+    log_silencer silencer;
+
+    const unsigned int msgs_per_producer = 200000;
+    const unsigned int batch_size = 64;
+
+    //the former job queue, one lock and a priority queue ordered by the message priority
+    class locked_priority_queue
+    {
+    private:
+        struct comp_proxy_msg {
+            bool operator()(const shared_ptr<proxy_msg>& l, const shared_ptr<proxy_msg>& r) const {
+                return *l > *r;
+            }
+        };
+
+        priority_queue<shared_ptr<proxy_msg>, vector<shared_ptr<proxy_msg>>, comp_proxy_msg> m_q;
+        mutex m_global_lock;
+        condition_variable m_cond_empty;
+
+    public:
+        void enqueue(const shared_ptr<proxy_msg>& msg) {
+            {
+                lock_guard<mutex> lock(m_global_lock);
+                m_q.push(msg);
+            }
+            m_cond_empty.notify_one();
+        }
+
+        shared_ptr<proxy_msg> dequeue() {
+            unique_lock<mutex> lock(m_global_lock);
+            m_cond_empty.wait(lock, [&]() {
+                return !m_q.empty();
+            });
+            auto msg = m_q.top();
+            m_q.pop();
+            return msg;
+        }
+
+        //drains up to max_count messages under one lock, like the batch dequeue of the lane queue
+        unsigned int dequeue_batch(vector<shared_ptr<proxy_msg>>& batch, unsigned int max_count) {
+            unique_lock<mutex> lock(m_global_lock);
+            m_cond_empty.wait(lock, [&]() {
+                return !m_q.empty();
+            });
+
+            unsigned int count = 0;
+            while (count < max_count && !m_q.empty()) {
+                batch.push_back(m_q.top());
+                m_q.pop();
+                ++count;
+            }
+            return count;
+        }
+    };
+
+    //all producers enqueue the same messages, the benchmark measures the queue and not the allocation
+    const vector<shared_ptr<proxy_msg>> msgs {
+        make_shared<test_msg>(0, proxy_msg::SYSTEMIC),
+        make_shared<test_msg>(1, proxy_msg::USER_INPUT),
+        make_shared<test_msg>(2, proxy_msg::SYSTEMIC),
+        make_shared<test_msg>(3, proxy_msg::SYSTEMIC)
+    };
+
+    auto run = [&](unsigned int num_of_producers, function<void(const shared_ptr<proxy_msg>&)> enqueue, function<unsigned int()> dequeue) {
+        unsigned long total = static_cast<unsigned long>(num_of_producers) * msgs_per_producer;
+        auto nsec = measure_nsec([&]() {
+            vector<thread> producers;
+            for (unsigned int p = 0; p < num_of_producers; ++p) {
+                producers.emplace_back([&]() {
+                    for (unsigned int i = 0; i < msgs_per_producer; ++i) {
+                        enqueue(msgs[i % msgs.size()]);
+                    }
+                });
+            }
+
+            unsigned long received = 0;
+            while (received < total) {
+                received += dequeue();
+            }
+
+            for (auto & e : producers) {
+                e.join();
+            }
+        });
+        cout << " " << setw(10) << total * 1000000 / (nsec / 1000) << " msgs/sec";
+    };
+
+    //single dequeues and batches of both queues, so that the batching and the lanes are measured separately
+    cout << "producers " << setw(20) << "lane queue" << setw(20) << "locked queue" << setw(20) << "lane queue batch" << setw(20) << "locked queue batch"
+         << " (batch " << batch_size << ")" << endl;
+    for (unsigned int num_of_producers : {1, 2, 4, 8}) {
+        cout << setw(9) << num_of_producers << " ";
+
+        {
+            message_queue<shared_ptr<proxy_msg>, lane_proxy_msg> q(WORKER_MESSAGE_QUEUE_DEFAULT_SIZE);
+            run(num_of_producers, [&](const shared_ptr<proxy_msg>& msg) {
+                q.enqueue(msg);
+            }, [&]() {
+                q.dequeue();
+                return 1;
+            });
+        }
+
+        {
+            locked_priority_queue q;
+            run(num_of_producers, [&](const shared_ptr<proxy_msg>& msg) {
+                q.enqueue(msg);
+            }, [&]() {
+                q.dequeue();
+                return 1;
+            });
+        }
+
+        {
+            message_queue<shared_ptr<proxy_msg>, lane_proxy_msg> q(WORKER_MESSAGE_QUEUE_DEFAULT_SIZE);
+            vector<shared_ptr<proxy_msg>> batch;
+            batch.reserve(batch_size);
+            run(num_of_producers, [&](const shared_ptr<proxy_msg>& msg) {
+                q.enqueue(msg);
+            }, [&]() {
+                batch.clear();
+                return q.dequeue_batch(batch, batch_size);
+            });
+        }
+
+        {
+            locked_priority_queue q;
+            vector<shared_ptr<proxy_msg>> batch;
+            batch.reserve(batch_size);
+            run(num_of_producers, [&](const shared_ptr<proxy_msg>& msg) {
+                q.enqueue(msg);
+            }, [&]() {
+                batch.clear();
+                return q.dequeue_batch(batch, batch_size);
+            });
+        }
+
+        cout << endl;
+    }
+
+    cout << "finished" << endl;
+}
 #endif /* DEBUG_MODE */
@@ -30,6 +30,17 @@
 #include <stdlib.h>
 #include <iostream>
 
+#ifdef DEBUG_MODE
+#include "include/utils/ip_addr.hpp"
+#include "include/utils/benchmark.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <random>
+#include <vector>
+#endif /* DEBUG_MODE */
+
 void addr_storage::clean()
 {
     reinterpret_cast<sockaddr_in6*>(&m_addr)->sin6_family = AF_UNSPEC;
@@ -980,4 +991,92 @@ void addr_storage::test_addr_storage_b()
         cout << "FAILED!" << endl;
     }
 }
+
+//builds a group map, looks up random groups and walks the map in order, as the membership and routing data do
+template<typename Key>
+static void test_group_keys(const std::string& name, const std::vector<addr_storage>& groups, const std::vector<addr_storage>& lookups)
+{
+    using namespace std;
+
+    const vector<Key> group_keys(groups.begin(), groups.end());
+    const vector<Key> lookup_keys(lookups.begin(), lookups.end());
+
+    auto print = [&](const string & op, unsigned long nsec, unsigned int num_of_ops) {
+        cout << "  " << setw(8) << left << op << setw(6) << right << nsec / 1000000 << "msec" << setw(6) << nsec / num_of_ops << "nsec/op";
+    };
+
+    cout << setw(24) << left << name << " key size: " << setw(3) << right << sizeof(Key);
+
+    map<Key, unsigned int> m;
+    print("insert", measure_nsec([&]() {
+        for (unsigned int i = 0; i < group_keys.size(); ++i) {
+            m[group_keys[i]] = i;
+        }
+    }), group_keys.size());
+
+    unsigned long found = 0;
+    print("lookup", measure_nsec([&]() {
+        for (auto & e : lookup_keys) {
+            found += m.count(e);
+        }
+    }), lookup_keys.size());
+
+    unsigned long sum = 0;
+    print("walk", measure_nsec([&]() {
+        for (auto & e : m) {
+            sum += e.second;
+        }
+    }), m.size());
+
+    cout << " (found " << found << ", sum " << sum << ")" << endl;
+}
+
+void addr_storage::test_ip_addr()
+{
+    using namespace std;
+    HC_LOG_TRACE("");
+    cout << "##-- test ip_addr --##" << endl;
+
+    log_silencer silencer;
+
+    const unsigned int num_of_groups = 100000;
+    const unsigned int num_of_lookups = 1000000;
+
+    std::default_random_engine random_engine(42);
+
+    for (int addr_family : {AF_INET, AF_INET6}) {
+        vector<addr_storage> groups;
+        for (unsigned int i = 0; i < num_of_groups; ++i) {
+            if (addr_family == AF_INET) {
+                in_addr a;
+                a.s_addr = htonl(0xe8000000 | i); //232.0.0.0/8
+                groups.push_back(addr_storage(a));
+            } else {
+                in6_addr a;
+                memset(&a, 0, sizeof(a));
+                a.s6_addr[0] = 0xff;
+                a.s6_addr[1] = 0x3e;
+                a.s6_addr[12] = i >> 24;
+                a.s6_addr[13] = i >> 16;
+                a.s6_addr[14] = i >> 8;
+                a.s6_addr[15] = i;
+                groups.push_back(addr_storage(a));
+            }
+        }
+        shuffle(groups.begin(), groups.end(), random_engine);
+
+        vector<addr_storage> lookups;
+        uniform_int_distribution<unsigned int> index(0, num_of_groups - 1);
+        for (unsigned int i = 0; i < num_of_lookups; ++i) {
+            lookups.push_back(groups[index(random_engine)]);
+        }
+
+        string family = addr_family == AF_INET ? "IPv4" : "IPv6";
+        cout << family << ", " << num_of_groups << " groups, " << num_of_lookups << " lookups" << endl;
+        test_group_keys<addr_storage>("  addr_storage", groups, lookups);
+        test_group_keys<ip_addr>("  ip_addr", groups, lookups);
+    }
+
+    cout << "finished" << endl;
+}
 #endif /* DEBUG_MODE */
@@ -0,0 +1,519 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+#include "include/hamcast_logging.h"
+#include "include/utils/if_registry.hpp"
+
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <netinet/in.h>
+#include <net/if.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+#include <cstring>
+#include <sstream>
+#include <map>
+#include <algorithm>
+
+const std::vector<if_registry_addr>& if_registry_entry::get_addrs(int addr_family) const
+{
+    return addr_family == AF_INET6 ? ip6_addrs : ip4_addrs;
+}
+
+if_registry::snapshot::snapshot()
+    : version(0)
+    , subnets_ip4(AF_INET)
+    , subnets_ip6(AF_INET6)
+{
+}
+
+if_registry::if_registry()
+    : m_version(0)
+    , m_seq(0)
+    , m_buf(IF_REGISTRY_RECV_BUF_SIZE)
+    , m_dump_sock(-1)
+    , m_event_sock(-1)
+    , m_wakeup_fd(-1)
+    , m_running(false)
+    , m_event_count(0)
+    , m_dump_count(0)
+{
+    HC_LOG_TRACE("");
+
+    if (!create_sockets()) {
+        HC_LOG_ERROR("failed to create the interface registry");
+        return;
+    }
+
+    //the events are subscribed before the first dump, no change gets lost
+    if (!refresh()) {
+        HC_LOG_ERROR("failed to read the network interfaces");
+    }
+
+    m_running = true;
+    m_thread.reset(new std::thread(&if_registry::listener_thread, this));
+}
+
+if_registry& if_registry::get_instance()
+{
+    static if_registry registry;
+    return registry;
+}
+
+bool if_registry::create_sockets()
+{
+    HC_LOG_TRACE("");
+
+    m_dump_sock = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (m_dump_sock < 0) {
+        HC_LOG_ERROR("failed to create netlink socket! Error: " << strerror(errno) << " errno: " << errno);
+        return false;
+    }
+
+    m_event_sock = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (m_event_sock < 0) {
+        HC_LOG_ERROR("failed to create netlink socket! Error: " << strerror(errno) << " errno: " << errno);
+        return false;
+    }
+
+    sockaddr_nl addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.nl_family = AF_NETLINK;
+    if (bind(m_dump_sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        HC_LOG_ERROR("failed to bind netlink socket! Error: " << strerror(errno) << " errno: " << errno);
+        return false;
+    }
+
+    addr.nl_groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR;
+    if (bind(m_event_sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        HC_LOG_ERROR("failed to subscribe the link and address events! Error: " << strerror(errno) << " errno: " << errno);
+        return false;
+    }
+
+    m_wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_wakeup_fd < 0) {
+        HC_LOG_ERROR("failed to create eventfd! Error: " << strerror(errno) << " errno: " << errno);
+        return false;
+    }
+
+    return true;
+}
+
+void if_registry::listener_thread()
+{
+    HC_LOG_TRACE("");
+
+    pollfd fds[2];
+    fds[0].fd = m_event_sock;
+    fds[0].events = POLLIN;
+    fds[1].fd = m_wakeup_fd;
+    fds[1].events = POLLIN;
+
+    while (m_running) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            HC_LOG_ERROR("failed to poll netlink socket! Error: " << strerror(errno) << " errno: " << errno);
+            return;
+        }
+
+        if (fds[1].revents & POLLIN) {
+            uint64_t value;
+            if (read(m_wakeup_fd, &value, sizeof(value)) < 0) {
+                HC_LOG_WARN("failed to read eventfd! Error: " << strerror(errno) << " errno: " << errno);
+            }
+        }
+
+        if ((fds[0].revents & POLLIN) && receive_events()) {
+            if (!refresh()) {
+                HC_LOG_ERROR("failed to refresh the network interfaces");
+            }
+        }
+    }
+}
+
+bool if_registry::receive_events()
+{
+    HC_LOG_TRACE("");
+
+    bool changed = false;
+    while (true) {
+        ssize_t len = recv(m_event_sock, m_buf.data(), m_buf.size(), MSG_DONTWAIT);
+        if (len < 0) {
+            if (errno == EINTR) {
+                continue;
+            } else if (errno == ENOBUFS) { //events are lost, the next dump reads everything again
+                HC_LOG_WARN("netlink event queue overrun");
+                changed = true;
+                continue;
+            } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                HC_LOG_ERROR("failed to receive netlink events! Error: " << strerror(errno) << " errno: " << errno);
+            }
+            return changed;
+        }
+
+        int remaining = static_cast<int>(len);
+        for (nlmsghdr* nlh = reinterpret_cast<nlmsghdr*>(m_buf.data()); NLMSG_OK(nlh, remaining); nlh = NLMSG_NEXT(nlh, remaining)) {
+            switch (nlh->nlmsg_type) {
+            case RTM_NEWLINK:
+            case RTM_DELLINK:
+            case RTM_NEWADDR:
+            case RTM_DELADDR:
+                ++m_event_count;
+                changed = true;
+                break;
+            default:
+                break;
+            }
+        }
+    }
+}
+
+bool if_registry::dump(uint16_t type, const std::function<void(const nlmsghdr*)>& msg_fun)
+{
+    HC_LOG_TRACE("");
+
+    //ifaddrmsg is a prefix of ifinfomsg, the family of both is AF_UNSPEC
+    struct {
+        nlmsghdr nlh;
+        ifinfomsg ifi;
+    } req;
+    memset(&req, 0, sizeof(req));
+    req.nlh.nlmsg_len = NLMSG_LENGTH(type == RTM_GETLINK ? sizeof(ifinfomsg) : sizeof(ifaddrmsg));
+    req.nlh.nlmsg_type = type;
+    req.nlh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    req.nlh.nlmsg_seq = ++m_seq;
+
+    if (send(m_dump_sock, &req, req.nlh.nlmsg_len, 0) < 0) {
+        HC_LOG_ERROR("failed to request the network interfaces! Error: " << strerror(errno) << " errno: " << errno);
+        return false;
+    }
+
+    bool interrupted = false;
+    while (true) {
+        ssize_t len = recv(m_dump_sock, m_buf.data(), m_buf.size(), 0);
+        if (len < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            HC_LOG_ERROR("failed to receive the network interfaces! Error: " << strerror(errno) << " errno: " << errno);
+            return false;
+        }
+
+        int remaining = static_cast<int>(len);
+        for (nlmsghdr* nlh = reinterpret_cast<nlmsghdr*>(m_buf.data()); NLMSG_OK(nlh, remaining); nlh = NLMSG_NEXT(nlh, remaining)) {
+            if (nlh->nlmsg_seq != req.nlh.nlmsg_seq) { //answer of an earlier dump
+                continue;
+            } else if (nlh->nlmsg_type == NLMSG_DONE) {
+                return !interrupted;
+            } else if (nlh->nlmsg_type == NLMSG_ERROR) {
+                int error = -reinterpret_cast<nlmsgerr*>(NLMSG_DATA(nlh))->error;
+                HC_LOG_ERROR("failed to dump the network interfaces! Error: " << strerror(error) << " errno: " << error);
+                return false;
+            }
+
+            if (nlh->nlmsg_flags & NLM_F_DUMP_INTR) {
+                interrupted = true;
+            } else {
+                msg_fun(nlh);
+            }
+        }
+    }
+}
+
+bool if_registry::refresh()
+{
+    HC_LOG_TRACE("");
+
+    for (int i = 0; i < IF_REGISTRY_DUMP_RETRIES; ++i) {
+        std::map<unsigned int, if_registry_entry> links;
+
+        bool rc = dump(RTM_GETLINK, [&links](const nlmsghdr * nlh) {
+            if (nlh->nlmsg_type != RTM_NEWLINK) {
+                return;
+            }
+
+            const ifinfomsg* ifi = reinterpret_cast<const ifinfomsg*>(NLMSG_DATA(nlh));
+            if_registry_entry e;
+            e.if_index = ifi->ifi_index;
+            e.flags = ifi->ifi_flags;
+            e.mtu = 0;
+
+            int attr_len = IFLA_PAYLOAD(nlh);
+            for (const rtattr* rta = IFLA_RTA(ifi); RTA_OK(rta, attr_len); rta = RTA_NEXT(rta, attr_len)) {
+                if (rta->rta_type == IFLA_IFNAME) {
+                    e.if_name = std::string(reinterpret_cast<const char*>(RTA_DATA(rta)), strnlen(reinterpret_cast<const char*>(RTA_DATA(rta)), RTA_PAYLOAD(rta)));
+                } else if (rta->rta_type == IFLA_MTU && RTA_PAYLOAD(rta) >= sizeof(uint32_t)) {
+                    e.mtu = *reinterpret_cast<const uint32_t*>(RTA_DATA(rta));
+                }
+            }
+
+            if (!e.if_name.empty()) {
+                links[e.if_index] = std::move(e);
+            }
+        });
+
+        rc = rc && dump(RTM_GETADDR, [&links](const nlmsghdr * nlh) {
+            if (nlh->nlmsg_type != RTM_NEWADDR) {
+                return;
+            }
+
+            const ifaddrmsg* ifa = reinterpret_cast<const ifaddrmsg*>(NLMSG_DATA(nlh));
+            auto it = links.find(ifa->ifa_index);
+            if (it == end(links) || (ifa->ifa_family != AF_INET && ifa->ifa_family != AF_INET6)) {
+                return;
+            }
+
+            const std::size_t addr_len = ifa->ifa_family == AF_INET ? sizeof(in_addr) : sizeof(in6_addr);
+            const void* local = nullptr;
+            const void* address = nullptr;
+
+            int attr_len = IFA_PAYLOAD(nlh);
+            for (const rtattr* rta = IFA_RTA(ifa); RTA_OK(rta, attr_len); rta = RTA_NEXT(rta, attr_len)) {
+                if (rta->rta_type == IFA_LOCAL && RTA_PAYLOAD(rta) >= addr_len) {
+                    local = RTA_DATA(rta);
+                } else if (rta->rta_type == IFA_ADDRESS && RTA_PAYLOAD(rta) >= addr_len) {
+                    address = RTA_DATA(rta);
+                }
+            }
+
+            auto to_addr = [ifa](const void * data) {
+                if (ifa->ifa_family == AF_INET) {
+                    in_addr a;
+                    memcpy(&a, data, sizeof(a));
+                    return addr_storage(a);
+                } else {
+                    in6_addr a;
+                    memcpy(&a, data, sizeof(a));
+                    return addr_storage(a);
+                }
+            };
+
+            //like getifaddrs(): IFA_LOCAL is the own address, a different IFA_ADDRESS is the peer of a point to point link
+            if_registry_addr a;
+            a.prefix_len = ifa->ifa_prefixlen;
+            if (local != nullptr) {
+                a.addr = to_addr(local);
+                if (address != nullptr && memcmp(local, address, addr_len) != 0) {
+                    a.dstaddr = to_addr(address);
+                }
+            } else if (address != nullptr) {
+                a.addr = to_addr(address);
+            } else {
+                return;
+            }
+
+            if (ifa->ifa_family == AF_INET) {
+                it->second.ip4_addrs.push_back(std::move(a));
+            } else {
+                it->second.ip6_addrs.push_back(std::move(a));
+            }
+        });
+
+        if (!rc) {
+            HC_LOG_DEBUG("dump of the network interfaces failed or interrupted, try again");
+            continue;
+        }
+
+        std::unique_ptr<snapshot> s(new snapshot());
+        s->version = ++m_version;
+        s->entries.reserve(links.size());
+        for (auto & e : links) {
+            s->entries.push_back(std::move(e.second));
+        }
+
+        std::sort(s->entries.begin(), s->entries.end(), [](const if_registry_entry & l, const if_registry_entry & r) {
+            return l.if_name < r.if_name;
+        });
+
+        for (auto & e : s->entries) {
+            s->by_index[e.if_index] = &e;
+            s->by_name[e.if_name] = &e;
+
+            for (auto & a : e.ip4_addrs) {
+                s->subnets_ip4.insert(a.addr, a.prefix_len, e.if_index);
+            }
+
+            for (auto & a : e.ip6_addrs) {
+                //all interfaces share the link local subnet, it does not identify an interface
+                if (!IN6_IS_ADDR_LINKLOCAL(&a.addr.get_in6_addr())) {
+                    s->subnets_ip6.insert(a.addr, a.prefix_len, e.if_index);
+                }
+            }
+        }
+
+        //readers of the replaced snapshot keep it alive until they are done
+        std::atomic_store(&m_current, std::shared_ptr<const snapshot>(std::move(s)));
+
+        ++m_dump_count;
+        return true;
+    }
+
+    return false;
+}
+
+std::shared_ptr<const if_registry::snapshot> if_registry::get_snapshot() const
+{
+    return std::atomic_load(&m_current);
+}
+
+const if_registry_entry* if_registry::find(const snapshot* s, unsigned int if_index) const
+{
+    if (s == nullptr) {
+        return nullptr;
+    }
+
+    auto it = s->by_index.find(if_index);
+    return it != s->by_index.end() ? it->second : nullptr;
+}
+
+bool if_registry::is_valid() const
+{
+    HC_LOG_TRACE("");
+    return get_snapshot() != nullptr;
+}
+
+unsigned long if_registry::get_version() const
+{
+    HC_LOG_TRACE("");
+    auto s = get_snapshot();
+    return s != nullptr ? s->version : 0;
+}
+
+bool if_registry::get_if_name(unsigned int if_index, std::string& if_name) const
+{
+    HC_LOG_TRACE("");
+    auto s = get_snapshot();
+    const if_registry_entry* e = find(s.get(), if_index);
+    if (e != nullptr) {
+        if_name = e->if_name;
+        return true;
+    } else {
+        return false;
+    }
+}
+
+unsigned int if_registry::get_if_index(const std::string& if_name) const
+{
+    HC_LOG_TRACE("");
+    auto s = get_snapshot();
+    if (s == nullptr) {
+        return 0;
+    }
+
+    auto it = s->by_name.find(if_name);
+    return it != s->by_name.end() ? it->second->if_index : 0;
+}
+
+unsigned int if_registry::get_if_index(const addr_storage& addr) const
+{
+    HC_LOG_TRACE("");
+    auto s = get_snapshot();
+    if (s == nullptr) {
+        return 0;
+    }
+
+    if (addr.get_addr_family() == AF_INET) {
+        return s->subnets_ip4.lookup(addr);
+    } else if (addr.get_addr_family() == AF_INET6) {
+        return s->subnets_ip6.lookup(addr);
+    } else {
+        return 0;
+    }
+}
+
+bool if_registry::get_entry(unsigned int if_index, if_registry_entry& entry) const
+{
+    HC_LOG_TRACE("");
+    auto s = get_snapshot();
+    const if_registry_entry* e = find(s.get(), if_index);
+    if (e != nullptr) {
+        entry = *e;
+        return true;
+    } else {
+        return false;
+    }
+}
+
+unsigned int if_registry::get_mtu(unsigned int if_index) const
+{
+    HC_LOG_TRACE("");
+    auto s = get_snapshot();
+    const if_registry_entry* e = find(s.get(), if_index);
+    return e != nullptr ? e->mtu : 0;
+}
+
+void if_registry::for_each(const std::function<void(const if_registry_entry&)>& fun) const
+{
+    HC_LOG_TRACE("");
+    auto s = get_snapshot();
+    if (s != nullptr) {
+        for (auto & e : s->entries) {
+            fun(e);
+        }
+    }
+}
+
+std::string if_registry::to_string() const
+{
+    HC_LOG_TRACE("");
+    std::ostringstream s;
+    s << "interface registry version: " << get_version() << " link/address events: " << m_event_count << " dumps: " << m_dump_count;
+    return s.str();
+}
+
+std::ostream& operator<<(std::ostream& stream, const if_registry& r)
+{
+    return stream << r.to_string();
+}
+
+if_registry::~if_registry()
+{
+    HC_LOG_TRACE("");
+
+    if (m_thread.get() != nullptr) {
+        m_running = false;
+        uint64_t value = 1;
+        if (write(m_wakeup_fd, &value, sizeof(value)) < 0) {
+            HC_LOG_ERROR("failed to wake up the interface registry! Error: " << strerror(errno) << " errno: " << errno);
+        }
+        m_thread->join();
+    }
+
+    std::atomic_store(&m_current, std::shared_ptr<const snapshot>());
+
+    if (m_dump_sock >= 0) {
+        close(m_dump_sock);
+    }
+
+    if (m_event_sock >= 0) {
+        close(m_event_sock);
+    }
+
+    if (m_wakeup_fd >= 0) {
+        close(m_wakeup_fd);
+    }
+}
@@ -152,6 +152,11 @@ int mc_socket::get_addr_family() const
     return m_addrFamily;
 }
 
+int mc_socket::get_socket() const
+{
+    return m_sock;
+}
+
 bool mc_socket::bind_udp_socket(const addr_storage& addr, in_port_t port) const
 {
     HC_LOG_TRACE("");
@@ -421,6 +426,71 @@ bool mc_socket::receive_msg(struct msghdr* msg, int& sizeOfInfo) const
     //     //#######################
 }
 
+bool mc_socket::receive_mmsg(struct mmsghdr* msgvec, unsigned int vlen, int& num_msgs) const
+{
+    HC_LOG_TRACE("");
+
+    if (!is_udp_valid()) {
+        HC_LOG_ERROR("udp_socket invalid");
+        return false;
+    }
+
+    int rc = recvmmsg(m_sock, msgvec, vlen, MSG_DONTWAIT, nullptr);
+    if (rc == -1) {
+        num_msgs = 0;
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+            return true;
+        } else {
+            HC_LOG_ERROR("failed to receive msgs Error: " << strerror(errno)  << " errno: " << errno);
+            return false;
+        }
+    } else {
+        num_msgs = rc;
+        return true;
+    }
+}
+
+bool mc_socket::send_mmsg(struct mmsghdr* msgvec, unsigned int vlen, int& num_msgs) const
+{
+    HC_LOG_TRACE("vlen: " << vlen);
+
+    if (!is_udp_valid()) {
+        HC_LOG_ERROR("udp_socket invalid");
+        return false;
+    }
+
+    int rc = sendmmsg(m_sock, msgvec, vlen, 0);
+    if (rc == -1) {
+        num_msgs = 0;
+        HC_LOG_ERROR("failed to send msgs Error: " << strerror(errno)  << " errno: " << errno);
+        return false;
+    } else {
+        num_msgs = rc;
+        return true;
+    }
+}
+
+bool mc_socket::set_socket_filter(const std::vector<struct sock_filter>& prog) const
+{
+    HC_LOG_TRACE("");
+
+    if (!is_udp_valid()) {
+        HC_LOG_ERROR("udp_socket invalid");
+        return false;
+    }
+
+    struct sock_fprog fprog;
+    fprog.len = prog.size();
+    fprog.filter = const_cast<struct sock_filter*>(prog.data());
+
+    if (setsockopt(m_sock, SOL_SOCKET, SO_ATTACH_FILTER, &fprog, sizeof(fprog)) < 0) {
+        HC_LOG_ERROR("failed to attach socket filter! Error: " << strerror(errno) << " errno: " << errno);
+        return false;
+    } else {
+        return true;
+    }
+}
+
 bool mc_socket::set_receive_timeout(long msec) const
 {
     HC_LOG_TRACE("");
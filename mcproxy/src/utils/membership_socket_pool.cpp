@@ -0,0 +1,209 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+#include "include/hamcast_logging.h"
+#include "include/utils/membership_socket_pool.hpp"
+
+#include <errno.h>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+membership_socket_pool::membership_socket_pool(int addr_family)
+    : m_addr_family(addr_family)
+    , m_capacity(addr_family == AF_INET ? read_ipv4_capacity() : MEMBERSHIP_SOCKET_POOL_IPV6_DEFAULT_CAPACITY)
+    , m_join_count(0)
+    , m_leave_count(0)
+    , m_filter_count(0)
+    , m_kernel_limit_count(0)
+{
+    HC_LOG_TRACE("");
+}
+
+unsigned int membership_socket_pool::read_ipv4_capacity()
+{
+    HC_LOG_TRACE("");
+
+    unsigned int capacity = 0;
+    std::ifstream is(MEMBERSHIP_SOCKET_POOL_IPV4_MAX_MEMBERSHIPS_FILE);
+    if (!(is >> capacity) || capacity == 0) {
+        HC_LOG_DEBUG("failed to read file:" << MEMBERSHIP_SOCKET_POOL_IPV4_MAX_MEMBERSHIPS_FILE);
+        return MEMBERSHIP_SOCKET_POOL_IPV4_DEFAULT_CAPACITY;
+    }
+
+    return capacity;
+}
+
+bool membership_socket_pool::add_socket()
+{
+    HC_LOG_TRACE("");
+
+    std::unique_ptr<mc_socket> sock(new mc_socket);
+    if (m_addr_family == AF_INET) {
+        if (!sock->create_udp_ipv4_socket()) {
+            return false;
+        }
+    } else if (m_addr_family == AF_INET6) {
+        if (!sock->create_udp_ipv6_socket()) {
+            return false;
+        }
+    } else {
+        HC_LOG_ERROR("wrong address family");
+        return false;
+    }
+
+    m_sockets.push_back(pool_socket {std::move(sock), 0, m_capacity});
+    m_free_sockets.insert(m_sockets.size() - 1);
+    return true;
+}
+
+void membership_socket_pool::set_count(unsigned int sock_index, unsigned int count)
+{
+    HC_LOG_TRACE("");
+
+    pool_socket& s = m_sockets[sock_index];
+    s.count = count;
+    if (s.count < s.capacity) {
+        m_free_sockets.insert(sock_index);
+    } else {
+        m_free_sockets.erase(sock_index);
+    }
+}
+
+int membership_socket_pool::join(const membership_key& key)
+{
+    HC_LOG_TRACE("");
+
+    while (true) {
+        if (m_free_sockets.empty() && !add_socket()) {
+            return -1;
+        }
+
+        //the first socket with a free slot at or after the socket of the hash
+        auto it = m_free_sockets.lower_bound(membership_key_hash()(key) % m_sockets.size());
+        if (it == m_free_sockets.end()) {
+            it = m_free_sockets.begin();
+        }
+
+        unsigned int sock_index = *it;
+        pool_socket& s = m_sockets[sock_index];
+        if (s.sock->join_group(key.gaddr.to_addr_storage(), key.if_index)) {
+            ++m_join_count;
+            set_count(sock_index, s.count + 1);
+            return sock_index;
+        }
+
+        int err = errno;
+        if ((err == ENOBUFS || err == ENOMEM) && s.count > 0) {
+            //the kernel allows less memberships than expected, try the next socket
+            HC_LOG_DEBUG("socket " << sock_index << " is full with " << s.count << " memberships");
+            ++m_kernel_limit_count;
+            s.capacity = s.count;
+            m_free_sockets.erase(sock_index);
+        } else {
+            HC_LOG_ERROR("failed to join group " << key.gaddr << " on interface " << key.if_index << "! Error: " << strerror(err) << " errno: " << err);
+            return -1;
+        }
+    }
+}
+
+bool membership_socket_pool::set_source_filter(unsigned int if_index, const addr_storage& gaddr, uint32_t filter_mode, const std::list<addr_storage>& src_list)
+{
+    HC_LOG_TRACE("");
+
+    membership_key key {if_index, ip_addr(gaddr)};
+    auto it = m_memberships.find(key);
+    if (it == m_memberships.end()) {
+        int sock_index = join(key);
+        if (sock_index < 0) {
+            return false;
+        }
+        it = m_memberships.insert(std::make_pair(key, sock_index)).first;
+    }
+
+    ++m_filter_count;
+    return m_sockets[it->second].sock->set_source_filter(if_index, gaddr, filter_mode, src_list);
+}
+
+bool membership_socket_pool::leave_group(unsigned int if_index, const addr_storage& gaddr)
+{
+    HC_LOG_TRACE("");
+
+    auto it = m_memberships.find(membership_key {if_index, ip_addr(gaddr)});
+    if (it == m_memberships.end()) {
+        return true;
+    }
+
+    unsigned int sock_index = it->second;
+    m_memberships.erase(it);
+
+    pool_socket& s = m_sockets[sock_index];
+    bool rc = s.sock->leave_group(gaddr, if_index);
+    ++m_leave_count;
+
+    //a lowered capacity is tried again
+    s.capacity = m_capacity;
+    set_count(sock_index, s.count - 1);
+
+    return rc;
+}
+
+unsigned int membership_socket_pool::size() const
+{
+    HC_LOG_TRACE("");
+    return m_memberships.size();
+}
+
+std::string membership_socket_pool::to_string() const
+{
+    HC_LOG_TRACE("");
+    std::ostringstream s;
+
+    s << "##-- upstream memberships --##" << std::endl;
+    s << "memberships: " << m_memberships.size() << " sockets: " << m_sockets.size() << " capacity per socket: " << m_capacity;
+    s << " joins: " << m_join_count << " leaves: " << m_leave_count << " source filters: " << m_filter_count << " kernel limits: " << m_kernel_limit_count;
+
+    if (!m_sockets.empty()) {
+        s << std::endl << "occupancy:";
+        if (m_sockets.size() <= MEMBERSHIP_SOCKET_POOL_PRINT_LIMIT) {
+            for (unsigned int i = 0; i < m_sockets.size(); ++i) {
+                s << " [" << i << "]:" << m_sockets[i].count;
+            }
+        } else {
+            auto cmp = [](const pool_socket & a, const pool_socket & b) {
+                return a.count < b.count;
+            };
+            s << " min: " << std::min_element(m_sockets.begin(), m_sockets.end(), cmp)->count;
+            s << " max: " << std::max_element(m_sockets.begin(), m_sockets.end(), cmp)->count;
+            s << " average: " << static_cast<double>(m_memberships.size()) / m_sockets.size();
+            s << " full sockets: " << m_sockets.size() - m_free_sockets.size();
+        }
+    }
+
+    return s.str();
+}
+
+std::ostream& operator<<(std::ostream& stream, const membership_socket_pool& p)
+{
+    return stream << p.to_string();
+}
@@ -0,0 +1,491 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+#include "include/hamcast_logging.h"
+#include "include/utils/mroute_netlink.hpp"
+#include "include/utils/mroute_socket.hpp"
+
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <unistd.h>
+#include <errno.h>
+#include <cstring>
+#include <sstream>
+#include <algorithm>
+
+#ifndef NETLINK_CAP_ACK
+#define NETLINK_CAP_ACK 10
+#endif
+
+mroute_netlink::mroute_netlink(int table_number)
+    : m_sock(-1)
+    , m_table_number(table_number)
+    , m_seq(0)
+    , m_request_count(0)
+    , m_sendmsg_count(0)
+    , m_error_count(0)
+{
+    HC_LOG_TRACE("");
+    m_send_buf.reserve(MROUTE_NETLINK_BATCH_SIZE);
+}
+
+bool mroute_netlink::create_socket()
+{
+    HC_LOG_TRACE("");
+
+    m_sock = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (m_sock < 0) {
+        HC_LOG_ERROR("failed to create netlink socket! Error: " << strerror(errno) << " errno: " << errno);
+        return false;
+    }
+
+    sockaddr_nl addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.nl_family = AF_NETLINK;
+    if (bind(m_sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        HC_LOG_ERROR("failed to bind netlink socket! Error: " << strerror(errno) << " errno: " << errno);
+        close(m_sock);
+        m_sock = -1;
+        return false;
+    }
+
+    //error messages contain only the header of the rejected request (since Linux 4.3)
+    int one = 1;
+    if (setsockopt(m_sock, SOL_NETLINK, NETLINK_CAP_ACK, &one, sizeof(one)) < 0) {
+        HC_LOG_DEBUG("failed to set NETLINK_CAP_ACK! Error: " << strerror(errno) << " errno: " << errno);
+    }
+
+    return true;
+}
+
+void mroute_netlink::add_attr(std::size_t msg_offset, uint16_t type, const void* data, std::size_t len)
+{
+    HC_LOG_TRACE("");
+
+    std::size_t attr_offset = m_send_buf.size();
+    m_send_buf.resize(attr_offset + RTA_SPACE(len), 0);
+
+    rtattr* rta = reinterpret_cast<rtattr*>(&m_send_buf[attr_offset]);
+    rta->rta_type = type;
+    rta->rta_len = RTA_LENGTH(len);
+    memcpy(RTA_DATA(rta), data, len);
+
+    reinterpret_cast<nlmsghdr*>(&m_send_buf[msg_offset])->nlmsg_len = m_send_buf.size() - msg_offset;
+}
+
+void mroute_netlink::queue_request(uint16_t type, unsigned int input_if_index, const addr_storage& source_addr, const addr_storage& group_addr, const std::list<int>* output_vif)
+{
+    HC_LOG_TRACE("");
+
+    std::size_t msg_offset = m_send_buf.size();
+    m_send_buf.resize(msg_offset + NLMSG_SPACE(sizeof(rtmsg)), 0);
+
+    nlmsghdr* nlh = reinterpret_cast<nlmsghdr*>(&m_send_buf[msg_offset]);
+    nlh->nlmsg_len = NLMSG_LENGTH(sizeof(rtmsg));
+    nlh->nlmsg_type = type;
+    //without NLM_F_ACK the kernel answers only rejected requests
+    nlh->nlmsg_flags = NLM_F_REQUEST | (type == RTM_NEWROUTE ? (NLM_F_CREATE | NLM_F_REPLACE) : 0);
+    nlh->nlmsg_seq = ++m_seq;
+
+    rtmsg* rtm = reinterpret_cast<rtmsg*>(NLMSG_DATA(nlh));
+    rtm->rtm_family = RTNL_FAMILY_IPMR;
+    rtm->rtm_dst_len = 32;
+    rtm->rtm_src_len = 32;
+    rtm->rtm_table = RT_TABLE_UNSPEC;
+    rtm->rtm_protocol = RTPROT_MROUTED; //like MRT_ADD_MFC, the route belongs to the mroute socket
+    rtm->rtm_scope = RT_SCOPE_UNIVERSE;
+    rtm->rtm_type = RTN_MULTICAST;
+
+    uint32_t table = m_table_number > 0 ? static_cast<uint32_t>(m_table_number) : static_cast<uint32_t>(RT_TABLE_DEFAULT);
+    add_attr(msg_offset, RTA_TABLE, &table, sizeof(table));
+
+    in_addr saddr = source_addr.get_in_addr();
+    in_addr gaddr = group_addr.get_in_addr();
+    add_attr(msg_offset, RTA_SRC, &saddr, sizeof(saddr));
+    add_attr(msg_offset, RTA_DST, &gaddr, sizeof(gaddr));
+
+    if (type == RTM_NEWROUTE) {
+        uint32_t iif = input_if_index;
+        add_attr(msg_offset, RTA_IIF, &iif, sizeof(iif));
+
+        //the kernel reads the ttl of virtual interface i from the i-th nexthop
+        int max_vif = -1;
+        for (auto e : *output_vif) {
+            max_vif = std::max(max_vif, e);
+        }
+
+        std::vector<rtnexthop> nexthops(max_vif + 1);
+        memset(nexthops.data(), 0, nexthops.size() * sizeof(rtnexthop));
+        for (auto & e : nexthops) {
+            e.rtnh_len = sizeof(rtnexthop);
+        }
+        for (auto e : *output_vif) {
+            nexthops[e].rtnh_hops = MROUTE_DEFAULT_TTL;
+        }
+
+        add_attr(msg_offset, RTA_MULTIPATH, nexthops.data(), nexthops.size() * sizeof(rtnexthop));
+    }
+
+    m_pending.push_back(pending_request {nlh->nlmsg_seq, mroute_change {type == RTM_NEWROUTE, group_addr, source_addr}, false});
+    ++m_request_count;
+
+    if (m_send_buf.size() >= MROUTE_NETLINK_BATCH_SIZE) {
+        flush();
+    }
+}
+
+bool mroute_netlink::add_mroute(unsigned int input_if_index, const addr_storage& source_addr, const addr_storage& group_addr, const std::list<int>& output_vif)
+{
+    HC_LOG_TRACE("");
+
+    if (m_sock < 0) {
+        HC_LOG_ERROR("netlink socket invalid");
+        return false;
+    }
+
+    if (output_vif.size() > MAXVIFS) {
+        HC_LOG_ERROR("output_vifNum_size to large: " << output_vif.size());
+        return false;
+    }
+
+    for (auto e : output_vif) {
+        if (e < 0 || e >= MAXVIFS) {
+            HC_LOG_ERROR("invalid virtual interface index: " << e);
+            return false;
+        }
+    }
+
+    queue_request(RTM_NEWROUTE, input_if_index, source_addr, group_addr, &output_vif);
+    return true;
+}
+
+bool mroute_netlink::del_mroute(const addr_storage& source_addr, const addr_storage& group_addr)
+{
+    HC_LOG_TRACE("");
+
+    if (m_sock < 0) {
+        HC_LOG_ERROR("netlink socket invalid");
+        return false;
+    }
+
+    queue_request(RTM_DELROUTE, 0, source_addr, group_addr, nullptr);
+    return true;
+}
+
+void mroute_netlink::fail_pending()
+{
+    HC_LOG_TRACE("");
+
+    for (auto & e : m_pending) {
+        fail_request(e);
+    }
+}
+
+void mroute_netlink::fail_request(pending_request& req)
+{
+    HC_LOG_TRACE("");
+
+    if (!req.is_failed) {
+        req.is_failed = true;
+        m_failed_routes.push_back(req.change);
+    }
+}
+
+bool mroute_netlink::flush(mroute_change_list& failed_routes)
+{
+    HC_LOG_TRACE("");
+
+    bool rc = flush();
+    failed_routes.splice(failed_routes.end(), m_failed_routes);
+    return rc;
+}
+
+bool mroute_netlink::flush()
+{
+    HC_LOG_TRACE("");
+
+    if (m_send_buf.empty()) {
+        return true;
+    }
+
+    sockaddr_nl kernel;
+    memset(&kernel, 0, sizeof(kernel));
+    kernel.nl_family = AF_NETLINK;
+
+    iovec iov;
+    iov.iov_base = m_send_buf.data();
+    iov.iov_len = m_send_buf.size();
+
+    msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_name = &kernel;
+    msg.msg_namelen = sizeof(kernel);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+
+    bool rc = true;
+    if (sendmsg(m_sock, &msg, 0) < 0) {
+        HC_LOG_ERROR("failed to send " << m_pending.size() << " multicast route changes! Error: " << strerror(errno) << " errno: " << errno);
+        m_error_count += m_pending.size();
+        fail_pending();
+        m_pending.clear();
+        rc = false;
+    } else {
+        ++m_sendmsg_count;
+    }
+
+    m_send_buf.clear();
+
+    //the kernel processes the requests during sendmsg(), so all answers are already queued
+    collect_acks();
+    m_pending.clear();
+
+    return rc;
+}
+
+unsigned int mroute_netlink::collect_acks()
+{
+    HC_LOG_TRACE("");
+
+    unsigned int error_count = 0;
+    char buf[MROUTE_NETLINK_ACK_BUF_SIZE] __attribute__((aligned(NLMSG_ALIGNTO)));
+
+    while (true) {
+        ssize_t len = recv(m_sock, buf, sizeof(buf), MSG_DONTWAIT);
+        if (len < 0) {
+            if (errno == EINTR) {
+                continue;
+            } else if (errno == ENOBUFS) {
+                //it is unknown which changes are rejected
+                HC_LOG_ERROR("netlink acknowledgements lost! Error: " << strerror(errno) << " errno: " << errno);
+                ++error_count;
+                fail_pending();
+                continue;
+            } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                HC_LOG_ERROR("failed to receive netlink acknowledgements! Error: " << strerror(errno) << " errno: " << errno);
+            }
+            break;
+        }
+
+        int remaining = static_cast<int>(len);
+        for (nlmsghdr* nlh = reinterpret_cast<nlmsghdr*>(buf); NLMSG_OK(nlh, remaining); nlh = NLMSG_NEXT(nlh, remaining)) {
+            if (nlh->nlmsg_type != NLMSG_ERROR) {
+                continue;
+            }
+
+            nlmsgerr* err = reinterpret_cast<nlmsgerr*>(NLMSG_DATA(nlh));
+            if (err->error == 0) { //ack
+                continue;
+            }
+
+            if (!m_pending.empty() && nlh->nlmsg_seq >= m_pending.front().seq && nlh->nlmsg_seq - m_pending.front().seq < m_pending.size()) {
+                auto& req = m_pending[nlh->nlmsg_seq - m_pending.front().seq];
+
+                //the route is already deleted
+                if (!req.change.is_add && err->error == -ENOENT) {
+                    HC_LOG_DEBUG("multicast route (" << req.change.gaddr << ", " << req.change.saddr << ") not found");
+                    continue;
+                }
+
+                ++error_count;
+                HC_LOG_ERROR("kernel rejected the multicast route (" << req.change.gaddr << ", " << req.change.saddr << ")! Error: " << strerror(-err->error) << " errno: " << -err->error);
+                fail_request(req);
+            } else {
+                ++error_count;
+                HC_LOG_ERROR("kernel rejected a multicast route change! Error: " << strerror(-err->error) << " errno: " << -err->error);
+                fail_pending();
+            }
+        }
+    }
+
+    m_error_count += error_count;
+    return error_count;
+}
+
+bool mroute_netlink::probe()
+{
+    HC_LOG_TRACE("");
+
+    if (m_sock < 0) {
+        return false;
+    }
+
+    flush();
+
+    //RTM_DELROUTE of (0.0.0.0, 0.0.0.0) with acknowledgement: ENOENT if the family is supported, EOPNOTSUPP otherwise
+    queue_request(RTM_DELROUTE, 0, addr_storage("0.0.0.0"), addr_storage("0.0.0.0"), nullptr);
+    reinterpret_cast<nlmsghdr*>(m_send_buf.data())->nlmsg_flags |= NLM_F_ACK;
+    m_pending.clear();
+    --m_request_count;
+
+    if (send(m_sock, m_send_buf.data(), m_send_buf.size(), 0) < 0) {
+        HC_LOG_DEBUG("failed to send netlink probe! Error: " << strerror(errno) << " errno: " << errno);
+        m_send_buf.clear();
+        return false;
+    }
+    m_send_buf.clear();
+
+    char buf[MROUTE_NETLINK_ACK_BUF_SIZE] __attribute__((aligned(NLMSG_ALIGNTO)));
+    ssize_t len = recv(m_sock, buf, sizeof(buf), MSG_DONTWAIT);
+    if (len < 0) {
+        HC_LOG_DEBUG("no answer to netlink probe! Error: " << strerror(errno) << " errno: " << errno);
+        return false;
+    }
+
+    nlmsghdr* nlh = reinterpret_cast<nlmsghdr*>(buf);
+    if (!NLMSG_OK(nlh, static_cast<int>(len)) || nlh->nlmsg_type != NLMSG_ERROR) {
+        return false;
+    }
+
+    int error = -reinterpret_cast<nlmsgerr*>(NLMSG_DATA(nlh))->error;
+    HC_LOG_DEBUG("netlink probe answer: " << strerror(error) << " errno: " << error);
+    return error == 0 || error == ENOENT;
+}
+
+bool mroute_netlink::dump_mroute_stats(int addr_family, const std::function<void(const ip_addr&, const ip_addr&, uint64_t)>& stats_fun)
+{
+    HC_LOG_TRACE("");
+
+    if (m_sock < 0) {
+        HC_LOG_ERROR("netlink socket invalid");
+        return false;
+    }
+
+    //answers of earlier route changes must not mix with the dump
+    flush();
+
+    unsigned char family;
+    if (addr_family == AF_INET) {
+        family = RTNL_FAMILY_IPMR;
+    } else if (addr_family == AF_INET6) {
+        family = RTNL_FAMILY_IP6MR;
+    } else {
+        HC_LOG_ERROR("wrong address family");
+        return false;
+    }
+
+    struct {
+        nlmsghdr nlh;
+        rtmsg rtm;
+    } req;
+    memset(&req, 0, sizeof(req));
+    req.nlh.nlmsg_len = NLMSG_LENGTH(sizeof(rtmsg));
+    req.nlh.nlmsg_type = RTM_GETROUTE;
+    req.nlh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    req.nlh.nlmsg_seq = ++m_seq;
+    req.rtm.rtm_family = family;
+
+    if (send(m_sock, &req, req.nlh.nlmsg_len, 0) < 0) {
+        HC_LOG_ERROR("failed to request the multicast routes! Error: " << strerror(errno) << " errno: " << errno);
+        return false;
+    }
+
+    const uint32_t table = m_table_number > 0 ? static_cast<uint32_t>(m_table_number) : static_cast<uint32_t>(RT_TABLE_DEFAULT);
+    const std::size_t addr_len = addr_family == AF_INET ? sizeof(in_addr) : sizeof(in6_addr);
+    std::vector<char> buf(MROUTE_NETLINK_BATCH_SIZE);
+
+    while (true) {
+        ssize_t len = recv(m_sock, buf.data(), buf.size(), 0);
+        if (len < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            HC_LOG_ERROR("failed to receive the multicast routes! Error: " << strerror(errno) << " errno: " << errno);
+            return false;
+        }
+
+        int remaining = static_cast<int>(len);
+        for (nlmsghdr* nlh = reinterpret_cast<nlmsghdr*>(buf.data()); NLMSG_OK(nlh, remaining); nlh = NLMSG_NEXT(nlh, remaining)) {
+            if (nlh->nlmsg_seq != req.nlh.nlmsg_seq) { //late answer of a route change
+                continue;
+            } else if (nlh->nlmsg_type == NLMSG_DONE) {
+                return true;
+            } else if (nlh->nlmsg_type == NLMSG_ERROR) {
+                int error = -reinterpret_cast<nlmsgerr*>(NLMSG_DATA(nlh))->error;
+                HC_LOG_ERROR("failed to dump the multicast routes! Error: " << strerror(error) << " errno: " << error);
+                return false;
+            } else if (nlh->nlmsg_type != RTM_NEWROUTE) {
+                continue;
+            }
+
+            rtmsg* rtm = reinterpret_cast<rtmsg*>(NLMSG_DATA(nlh));
+            if (rtm->rtm_family != family) {
+                continue;
+            }
+
+            uint32_t route_table = rtm->rtm_table;
+            const void* gaddr = nullptr;
+            const void* saddr = nullptr;
+            const rta_mfc_stats* stats = nullptr;
+
+            int attr_len = RTM_PAYLOAD(nlh);
+            for (rtattr* rta = RTM_RTA(rtm); RTA_OK(rta, attr_len); rta = RTA_NEXT(rta, attr_len)) {
+                if (rta->rta_type == RTA_TABLE && RTA_PAYLOAD(rta) >= sizeof(uint32_t)) {
+                    route_table = *reinterpret_cast<uint32_t*>(RTA_DATA(rta));
+                } else if (rta->rta_type == RTA_DST && RTA_PAYLOAD(rta) >= addr_len) {
+                    gaddr = RTA_DATA(rta);
+                } else if (rta->rta_type == RTA_SRC && RTA_PAYLOAD(rta) >= addr_len) {
+                    saddr = RTA_DATA(rta);
+                } else if (rta->rta_type == RTA_MFC_STATS && RTA_PAYLOAD(rta) >= sizeof(rta_mfc_stats)) {
+                    stats = reinterpret_cast<const rta_mfc_stats*>(RTA_DATA(rta));
+                }
+            }
+
+            if (route_table != table || gaddr == nullptr || saddr == nullptr || stats == nullptr) {
+                continue;
+            }
+
+            uint64_t packets;
+            memcpy(&packets, &stats->mfcs_packets, sizeof(packets));
+
+            if (addr_family == AF_INET) {
+                stats_fun(ip_addr(*reinterpret_cast<const in_addr*>(gaddr)), ip_addr(*reinterpret_cast<const in_addr*>(saddr)), packets);
+            } else {
+                stats_fun(ip_addr(*reinterpret_cast<const in6_addr*>(gaddr)), ip_addr(*reinterpret_cast<const in6_addr*>(saddr)), packets);
+            }
+        }
+    }
+}
+
+std::string mroute_netlink::to_string() const
+{
+    HC_LOG_TRACE("");
+    std::ostringstream s;
+    s << "netlink route changes: " << m_request_count << " sendmsg calls: " << m_sendmsg_count << " rejected: " << m_error_count;
+    return s.str();
+}
+
+std::ostream& operator<<(std::ostream& stream, const mroute_netlink& m)
+{
+    return stream << m.to_string();
+}
+
+mroute_netlink::~mroute_netlink()
+{
+    HC_LOG_TRACE("");
+
+    if (m_sock >= 0) {
+        flush();
+        close(m_sock);
+    }
+}
@@ -313,6 +313,30 @@ bool mroute_socket::set_ipv6_recv_pkt_info() const
     }
 }
 
+bool mroute_socket::set_ipv4_recv_pkt_info() const
+{
+    HC_LOG_TRACE("");
+
+    if (!is_udp_valid()) {
+        HC_LOG_ERROR("raw_socket invalid");
+        return false;
+    }
+
+    if (m_addrFamily == AF_INET) {
+        int on = 1;
+
+        if (setsockopt(m_sock, IPPROTO_IP, IP_PKTINFO, &on, sizeof(on)) < 0) {
+            HC_LOG_ERROR("failed to set IP_PKTINFO! Error: " << strerror(errno) << " errno: " << errno);
+            return false;
+        }
+
+        return true;
+    } else {
+        HC_LOG_ERROR("this funktion is only available vor IPv4 sockets ");
+        return false;
+    }
+}
+
 bool mroute_socket::set_ipv6_recv_hop_by_hop_msg() const
 {
     HC_LOG_TRACE("");
@@ -0,0 +1,128 @@
+/*
+ * This file is part of mcproxy.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * written by Sebastian Woelke, in cooperation with:
+ * INET group, Hamburg University of Applied Sciences,
+ * Website: http://mcproxy.realmv6.org/
+ */
+
+#include "include/hamcast_logging.h"
+#include "include/utils/prefix_trie.hpp"
+
+prefix_trie::prefix_trie(int addr_family)
+    : m_addr_family(addr_family)
+    , m_root(new node())
+{
+    HC_LOG_TRACE("");
+}
+
+unsigned int prefix_trie::get_max_prefix_len() const
+{
+    return (m_addr_family == AF_INET) ? 32 : 128;
+}
+
+bool prefix_trie::get_bit(const unsigned char* addr, unsigned int i)
+{
+    return (addr[i / 8] >> (7 - i % 8)) & 1;
+}
+
+const unsigned char* prefix_trie::get_bytes(const addr_storage& addr) const
+{
+    if (m_addr_family == AF_INET) {
+        return reinterpret_cast<const unsigned char*>(&addr.get_in_addr());
+    } else {
+        return reinterpret_cast<const unsigned char*>(&addr.get_in6_addr());
+    }
+}
+
+bool prefix_trie::insert(const addr_storage& prefix, unsigned int prefix_len, unsigned int value)
+{
+    HC_LOG_TRACE("");
+
+    if (prefix.get_addr_family() != m_addr_family || prefix_len > get_max_prefix_len() || value == PREFIX_TRIE_NO_VALUE) {
+        HC_LOG_ERROR("invalid prefix: " << prefix << "/" << prefix_len);
+        return false;
+    }
+
+    const unsigned char* bytes = get_bytes(prefix);
+    node* n = m_root.get();
+    for (unsigned int i = 0; i < prefix_len; ++i) {
+        auto& child = n->m_child[get_bit(bytes, i)];
+        if (!child) {
+            child.reset(new node());
+        }
+        n = child.get();
+    }
+
+    if (n->m_value != PREFIX_TRIE_NO_VALUE) {
+        return false;
+    }
+
+    n->m_value = value;
+    return true;
+}
+
+unsigned int prefix_trie::lookup(const addr_storage& addr) const
+{
+    HC_LOG_TRACE("");
+
+    if (addr.get_addr_family() != m_addr_family) {
+        return PREFIX_TRIE_NO_VALUE;
+    }
+
+    const unsigned char* bytes = get_bytes(addr);
+    const node* n = m_root.get();
+    unsigned int result = n->m_value;
+    for (unsigned int i = 0; i < get_max_prefix_len(); ++i) {
+        n = n->m_child[get_bit(bytes, i)].get();
+        if (n == nullptr) {
+            break;
+        }
+        if (n->m_value != PREFIX_TRIE_NO_VALUE) {
+            result = n->m_value;
+        }
+    }
+
+    return result;
+}
+
+void prefix_trie::clear()
+{
+    HC_LOG_TRACE("");
+    m_root.reset(new node());
+}
+
+unsigned int prefix_trie::get_prefix_len(const addr_storage& netmask)
+{
+    HC_LOG_TRACE("");
+
+    const unsigned char* bytes;
+    unsigned int size;
+    if (netmask.get_addr_family() == AF_INET) {
+        bytes = reinterpret_cast<const unsigned char*>(&netmask.get_in_addr());
+        size = sizeof(in_addr);
+    } else {
+        bytes = reinterpret_cast<const unsigned char*>(&netmask.get_in6_addr());
+        size = sizeof(in6_addr);
+    }
+
+    unsigned int result = 0;
+    while (result < size * 8 && get_bit(bytes, result)) {
+        ++result;
+    }
+    return result;
+}